@@ -27,6 +27,7 @@
 #include "algorithm.h"
 #include "profiler/profiler.h"
 #include <iostream>
+#include <algorithm>
 #include <set>
 #include <numeric>
 #include <map>
@@ -98,7 +99,9 @@ namespace algorithm {
 	vector<double> harmonic_centrality_subvector(size_t vlen, const vector<uint32_t> *edge_map,
 			size_t depth, size_t start, size_t len) {
 
-		char *all = new char[vlen];
+		// all[v] == epoch if v is visited by the current vertex, so it does not have to be cleared for every vertex.
+		uint32_t *all = new uint32_t[vlen]();
+		uint32_t epoch = 0;
 		uint32_t *level1 = new uint32_t[vlen];
 		uint32_t *level2 = new uint32_t[vlen];
 
@@ -113,11 +116,11 @@ namespace algorithm {
 
 			level_len[0] = 0;
 			level_len[1] = 0;
-			memset(all, 0, vlen);
+			epoch++;
 
 			levels[0][0] = vertex;
 			level_len[0]++;
-			all[vertex] = 1;
+			all[vertex] = epoch;
 
 			double harmonic = 0.0;
 			/*
@@ -134,9 +137,9 @@ namespace algorithm {
 				for (size_t j = 0; j < level_len[last_level]; j++) {
 					const uint32_t v = levels[last_level][j];
 					for (const uint32_t &edge : edge_map[v]) {
-						if (!all[edge]) {
+						if (all[edge] != epoch) {
 							levels[cur_level][level_len[cur_level]++] = edge;
-							all[edge] = 1;
+							all[edge] = epoch;
 						}
 					}
 				}
@@ -159,23 +162,102 @@ namespace algorithm {
 		return harmonics;
 	}
 
-	vector<double> harmonic_centrality(size_t vlen, const set<pair<uint32_t, uint32_t>> &edges, size_t depth) {
-		vector<double> harmonics;
+	/*
+	 * Multi source BFS as described by Then et al. https://doi.org/10.14778/2735496.2735507
+	 * Runs the BFS from up to 64 sources at the same time, bit i of seen[v] is set when source i has reached v. The
+	 * edges out of a vertex are only traversed once per level for all the sources. Only the vertices touched by a
+	 * batch are cleared after it.
+	 * */
+	class multi_source_bfs {
 
-		vector<uint32_t> *edge_map = new vector<uint32_t>[vlen];
-		for (const pair<uint32_t, uint32_t> &edge : edges) {
-			/*
-			second -> first mapping because we want to traverse the edges in the opposite direction of the edge. Incoming edges should increase
-			harmonic centrality of vertex.
-			*/
-			edge_map[edge.second].push_back(edge.first);
-		}
+		public:
 
-		vector<double> ret = harmonic_centrality(vlen, edge_map, depth);
+			explicit multi_source_bfs(const csr_graph &graph)
+			: m_graph(graph), m_seen(graph.num_vertices(), 0), m_frontier(graph.num_vertices(), 0),
+				m_next(graph.num_vertices(), 0) {
+			}
 
-		delete [] edge_map;
+			void run(uint32_t first_source, size_t num_sources, size_t depth, double *harmonic) {
 
-		return ret;
+				m_touched.clear();
+				m_frontier_list.clear();
+				for (size_t i = 0; i < num_sources; i++) {
+					const uint32_t v = first_source + i;
+					m_seen[v] = 1ull << i;
+					m_frontier[v] = 1ull << i;
+					m_frontier_list.push_back(v);
+					m_touched.push_back(v);
+				}
+
+				for (size_t level = 1; level <= depth; level++) {
+					m_next_list.clear();
+					for (const uint32_t v : m_frontier_list) {
+						const uint64_t bits = m_frontier[v];
+						m_frontier[v] = 0;
+						for (const uint32_t w : m_graph.neighbours(v)) {
+							const uint64_t new_bits = bits & ~m_seen[w];
+							if (!new_bits) continue;
+							if (!m_next[w]) m_next_list.push_back(w);
+							m_next[w] |= new_bits;
+						}
+					}
+					if (m_next_list.empty()) break;
+
+					/*
+						Counts the new vertices per source with bit sliced counters, bit i of slices[k] is bit k of the
+						count for source i. Adding a word is a ripple carry add that on average touches two slices.
+					*/
+					uint64_t slices[32] = {0};
+					for (const uint32_t w : m_next_list) {
+						const uint64_t bits = m_next[w];
+						if (!m_seen[w]) m_touched.push_back(w);
+						m_seen[w] |= bits;
+						m_frontier[w] = bits;
+						m_next[w] = 0;
+						uint64_t carry = bits;
+						for (size_t k = 0; carry; k++) {
+							const uint64_t next_carry = slices[k] & carry;
+							slices[k] ^= carry;
+							carry = next_carry;
+						}
+					}
+					for (size_t i = 0; i < num_sources; i++) {
+						size_t level_len = 0;
+						for (size_t k = 0; k < 32; k++) {
+							level_len |= ((slices[k] >> i) & 1ull) << k;
+						}
+						harmonic[i] += (double)level_len / level;
+					}
+					m_frontier_list.swap(m_next_list);
+				}
+
+				for (const uint32_t v : m_frontier_list) {
+					m_frontier[v] = 0;
+				}
+				for (const uint32_t v : m_touched) {
+					m_seen[v] = 0;
+				}
+			}
+
+		private:
+
+			const csr_graph &m_graph;
+			vector<uint64_t> m_seen;
+			vector<uint64_t> m_frontier;
+			vector<uint64_t> m_next;
+			vector<uint32_t> m_touched;
+			vector<uint32_t> m_frontier_list;
+			vector<uint32_t> m_next_list;
+
+	};
+
+	vector<double> harmonic_centrality(size_t vlen, const set<pair<uint32_t, uint32_t>> &edges, size_t depth) {
+		/*
+		The graph has the edges in the opposite direction because we want to traverse the edges in the opposite direction of the edge.
+		Incoming edges should increase harmonic centrality of vertex.
+		*/
+		const csr_graph graph(vlen, edges);
+		return harmonic_centrality(graph, depth, 1);
 	}
 
 	vector<double> harmonic_centrality(size_t vlen, const vector<uint32_t> *edge_map, size_t depth) {
@@ -184,40 +266,41 @@ namespace algorithm {
 
 	vector<double> harmonic_centrality_threaded(size_t vlen, const set<pair<uint32_t, uint32_t>> &edges, size_t depth,
 			size_t num_threads) {
+		const csr_graph graph(vlen, edges);
+		return harmonic_centrality(graph, depth, num_threads);
+	}
 
-		vector<uint32_t> *edge_map = new vector<uint32_t>[vlen];
-		for (const pair<uint32_t, uint32_t> &edge : edges) {
-			/*
-			second -> first mapping because we want to traverse the edges in the opposite direction of the edge. Incoming edges should increase
-			harmonic centrality of vertex.
-			*/
-			edge_map[edge.second].push_back(edge.first);
-		}
-
-		vector<double> ret = harmonic_centrality_threaded(vlen, edge_map, depth, num_threads);
+	vector<double> harmonic_centrality_threaded(size_t vlen, const vector<uint32_t> *edge_map, size_t depth, size_t num_threads) {
 
-		delete [] edge_map;
+		assert(vlen >= num_threads);
 
-		return ret;
+		const csr_graph graph(vlen, edge_map);
+		return harmonic_centrality(graph, depth, num_threads);
 	}
 
-	vector<double> harmonic_centrality_threaded(size_t vlen, const vector<uint32_t> *edge_map, size_t depth, size_t num_threads) {
+	vector<double> harmonic_centrality(const csr_graph &graph, size_t depth, size_t num_threads) {
 
-		assert(vlen >= num_threads);
+		const size_t vlen = graph.num_vertices();
+		const size_t batch_size = 64;
+		vector<double> harmonic(vlen, 0.0);
 
-		vector<future<vector<double>>> threads;
+		// Split the vertices into ranges of whole batches, one per thread.
+		const size_t num_batches = (vlen + batch_size - 1) / batch_size;
+		const size_t batches_per_thread = max<size_t>(1, ceil((double)num_batches / max<size_t>(1, num_threads)));
 
-		// Split the vertices into several vectors.
-		const size_t max_len = ceil((double)vlen / num_threads);
-		for (size_t i = 0; i < vlen; i += max_len) {
-			const size_t len = min(max_len, vlen - i);
-			threads.emplace_back(async(launch::async, harmonic_centrality_subvector, vlen, edge_map, depth, i, len));
+		vector<future<void>> threads;
+		for (size_t i = 0; i < vlen; i += batches_per_thread * batch_size) {
+			const size_t end = min(vlen, i + batches_per_thread * batch_size);
+			threads.emplace_back(async(launch::async, [&graph, &harmonic, batch_size, depth, i, end]() {
+				multi_source_bfs bfs(graph);
+				for (size_t source = i; source < end; source += batch_size) {
+					bfs.run(source, min(batch_size, end - source), depth, &harmonic[source]);
+				}
+			}));
 		}
 
-		vector<double> harmonic;
 		for (auto &thread : threads) {
-			vector<double> part = thread.get();
-			harmonic.insert(harmonic.end(), part.begin(), part.end());
+			thread.get();
 		}
 
 		return harmonic;
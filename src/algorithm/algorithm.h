@@ -30,6 +30,8 @@
 #include <set>
 #include <unordered_map>
 #include <cstdint>
+#include <cstddef>
+#include "csr_graph.h"
 
 namespace algorithm {
 
@@ -62,5 +64,10 @@ namespace algorithm {
 	std::vector<double> harmonic_centrality_threaded(size_t vlen, const std::vector<uint32_t> *edge_map,
 			size_t depth, size_t num_threads);
 
+	/*
+		Same as above on a graph of incoming edges. Runs a bit parallel BFS from 64 sources at a time.
+	*/
+	std::vector<double> harmonic_centrality(const csr_graph &graph, size_t depth, size_t num_threads);
+
 	std::vector<uint32_t> *set_to_edge_map(size_t n, const std::set<std::pair<uint32_t, uint32_t>> &edges);
 }
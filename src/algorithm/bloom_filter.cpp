@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bloom_filter.h"
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace algorithm {
+
+	const uint32_t bloom_salts[bloom_filter::words_per_block] = {
+		0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+	};
+
+	bloom_filter::bloom_filter(size_t num_keys, size_t bits_per_key)
+	: m_num_blocks(std::max<size_t>(1, (num_keys * bits_per_key + block_size * 8 - 1) / (block_size * 8))),
+		m_words(m_num_blocks * words_per_block, 0) {
+	}
+
+	void bloom_filter::insert(uint64_t key) {
+		const uint64_t hash = mix64(key);
+		uint32_t mask[words_per_block];
+		make_mask(hash, mask);
+		uint32_t *block = &m_words[block_for(hash, m_num_blocks) * words_per_block];
+		for (size_t i = 0; i < words_per_block; i++) {
+			block[i] |= mask[i];
+		}
+		m_num_keys++;
+	}
+
+	bool bloom_filter::contains(uint64_t key) const {
+		const uint64_t hash = mix64(key);
+		uint32_t mask[words_per_block];
+		make_mask(hash, mask);
+		const uint32_t *block = &m_words[block_for(hash, m_num_blocks) * words_per_block];
+		for (size_t i = 0; i < words_per_block; i++) {
+			if ((block[i] & mask[i]) != mask[i]) return false;
+		}
+		return true;
+	}
+
+	void bloom_filter::serialize(std::ostream &stream) const {
+		char header[header_size] = {0};
+		const uint64_t num_blocks = m_num_blocks;
+		const uint64_t num_keys = m_num_keys;
+		memcpy(&header[0], &num_blocks, sizeof(uint64_t));
+		memcpy(&header[8], &num_keys, sizeof(uint64_t));
+		stream.write(header, header_size);
+		stream.write((const char *)m_words.data(), m_words.size() * sizeof(uint32_t));
+	}
+
+	bool bloom_filter::contains(const char *data, size_t len, uint64_t key) {
+		if (len < header_size) return true;
+		uint64_t num_blocks;
+		memcpy(&num_blocks, data, sizeof(uint64_t));
+		if (num_blocks == 0 || len != header_size + num_blocks * block_size) return true;
+
+		const uint64_t hash = mix64(key);
+		uint32_t mask[words_per_block];
+		make_mask(hash, mask);
+		const char *block = data + header_size + block_for(hash, num_blocks) * block_size;
+		for (size_t i = 0; i < words_per_block; i++) {
+			uint32_t word;
+			memcpy(&word, block + i * sizeof(uint32_t), sizeof(uint32_t));
+			if ((word & mask[i]) != mask[i]) return false;
+		}
+		return true;
+	}
+
+	/*
+		The upper 32 bits of the hash pick the block with a multiply and shift instead of a modulo, the lower 32 bits
+		pick the bit in every word.
+	*/
+	size_t bloom_filter::block_for(uint64_t hash, size_t num_blocks) {
+		return (size_t)(((hash >> 32) * (uint64_t)num_blocks) >> 32);
+	}
+
+	void bloom_filter::make_mask(uint64_t hash, uint32_t *mask) {
+		const uint32_t key = (uint32_t)hash;
+		for (size_t i = 0; i < words_per_block; i++) {
+			mask[i] = 1u << ((key * bloom_salts[i]) >> 27);
+		}
+	}
+
+}
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace algorithm {
+
+	/*
+		Split block bloom filter as used by Parquet. Every key sets one bit in each of the 8 words of a single 32
+		byte block, so a lookup reads one cache line. With 12 bits per key the false positive rate is about 0.5%.
+
+		Serialized as a 32 byte header (number of blocks and number of keys) followed by the blocks, contains() can
+		test a serialized filter in place so filters can be checked directly from an mmapped file.
+	*/
+	class bloom_filter {
+
+		public:
+
+			static const size_t words_per_block = 8;
+			static const size_t block_size = words_per_block * sizeof(uint32_t);
+			static const size_t header_size = 32;
+			static const size_t default_bits_per_key = 12;
+
+			explicit bloom_filter(size_t num_keys, size_t bits_per_key = default_bits_per_key);
+
+			void insert(uint64_t key);
+			bool contains(uint64_t key) const;
+
+			size_t num_blocks() const { return m_num_blocks; }
+			size_t num_keys() const { return m_num_keys; }
+
+			void serialize(std::ostream &stream) const;
+
+			/*
+				Tests a serialized filter of len bytes. Returns true for data that is not a valid filter so a broken
+				file only costs a lookup.
+			*/
+			static bool contains(const char *data, size_t len, uint64_t key);
+
+		private:
+
+			size_t m_num_blocks;
+			size_t m_num_keys = 0;
+			std::vector<uint32_t> m_words;
+
+			static size_t block_for(uint64_t hash, size_t num_blocks);
+			static void make_mask(uint64_t hash, uint32_t *mask);
+
+	};
+
+}
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "csr_graph.h"
+
+using namespace std;
+
+namespace algorithm {
+
+	csr_graph::csr_graph()
+	: m_offsets(1, 0) {
+	}
+
+	csr_graph::csr_graph(uint32_t n, const vector<uint32_t> *edge_map) {
+		m_offsets.reserve(n + 1);
+		m_offsets.push_back(0);
+		for (uint32_t v = 0; v < n; v++) {
+			m_offsets.push_back(m_offsets.back() + edge_map[v].size());
+		}
+		m_edges.reserve(m_offsets.back());
+		for (uint32_t v = 0; v < n; v++) {
+			m_edges.insert(m_edges.end(), edge_map[v].begin(), edge_map[v].end());
+		}
+	}
+
+	csr_graph::csr_graph(uint32_t n, const set<pair<uint32_t, uint32_t>> &edges)
+	: m_offsets(n + 1, 0) {
+		for (const pair<uint32_t, uint32_t> &edge : edges) {
+			m_offsets[edge.second + 1]++;
+		}
+		for (uint32_t v = 0; v < n; v++) {
+			m_offsets[v + 1] += m_offsets[v];
+		}
+		m_edges.resize(edges.size());
+		vector<uint64_t> pos(m_offsets.begin(), m_offsets.end() - 1);
+		for (const pair<uint32_t, uint32_t> &edge : edges) {
+			m_edges[pos[edge.second]++] = edge.first;
+		}
+	}
+
+	csr_graph::csr_graph(vector<uint64_t> &&offsets, vector<uint32_t> &&edges)
+	: m_offsets(std::move(offsets)), m_edges(std::move(edges)) {
+	}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <set>
+#include <span>
+#include <cstdint>
+
+namespace algorithm {
+
+	/*
+		Graph in compressed sparse row layout. The neighbours of vertex v are stored at
+		m_edges[m_offsets[v]] ... m_edges[m_offsets[v + 1] - 1] so the whole graph is two contiguous arrays.
+	*/
+	class csr_graph {
+
+		public:
+
+			csr_graph();
+			csr_graph(uint32_t n, const std::vector<uint32_t> *edge_map);
+
+			/*
+				Builds the graph of incoming edges, the neighbours of v are the vertices with an edge (from, v). Same
+				as set_to_edge_map.
+			*/
+			csr_graph(uint32_t n, const std::set<std::pair<uint32_t, uint32_t>> &edges);
+			csr_graph(std::vector<uint64_t> &&offsets, std::vector<uint32_t> &&edges);
+
+			uint32_t num_vertices() const { return m_offsets.size() - 1; }
+			size_t num_edges() const { return m_edges.size(); }
+
+			std::span<const uint32_t> neighbours(uint32_t v) const {
+				return std::span<const uint32_t>(m_edges.data() + m_offsets[v], m_offsets[v + 1] - m_offsets[v]);
+			}
+
+		private:
+
+			std::vector<uint64_t> m_offsets;
+			std::vector<uint32_t> m_edges;
+
+	};
+
+}
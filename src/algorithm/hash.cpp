@@ -28,17 +28,15 @@
 
 namespace algorithm {
 
-	static const size_t seed = 0xc70f6907ul;
-
 	/*
 		Murmur hash by Austin Appleby
 		Taken from here https://sites.google.com/site/murmurhash/
 	*/
 	size_t murmur_hash(const char *key, size_t len) {
-		const uint64_t m = 0xc6a4a7935bd1e995ull;
-		const int r = 47;
+		const uint64_t m = murmur_m;
+		const int r = murmur_r;
 
-		uint64_t h = seed ^ (len * m);
+		uint64_t h = murmur_seed ^ (len * m);
 
 		const uint64_t * data = (const uint64_t *)key;
 		const uint64_t * end = data + (len/8);
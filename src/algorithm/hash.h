@@ -24,10 +24,100 @@
  * SOFTWARE.
  */
 
+#pragma once
+
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
 
 namespace algorithm {
 
+	inline const uint64_t murmur_seed = 0xc70f6907ull;
+	inline const uint64_t murmur_m = 0xc6a4a7935bd1e995ull;
+	inline const int murmur_r = 47;
+
+	size_t murmur_hash(const char *key, size_t len);
 	size_t hash(const std::string &str);
 
+	/*
+		The 64 bit finalizer of murmur3. A bijective mix of all the bits of x, used to hash integers.
+	*/
+	inline uint64_t mix64(uint64_t x) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ull;
+		x ^= x >> 33;
+		return x;
+	}
+
+	/*
+		Incremental version of hash(). Murmur seeds with the length so the total length has to be known up front,
+		the digest is then identical to hash() of all the updates concatenated. Used to hash n-grams without
+		building the n-gram string.
+	*/
+	class incremental_hash {
+
+		public:
+
+			explicit incremental_hash(size_t total_len)
+			: m_h(murmur_seed ^ (total_len * murmur_m)) {
+			}
+
+			void update(const char *data, size_t len) {
+				if (m_tail_len) {
+					while (m_tail_len < 8 && len) {
+						m_tail[m_tail_len++] = *data++;
+						len--;
+					}
+					if (m_tail_len < 8) return;
+					add_block(m_tail);
+					m_tail_len = 0;
+				}
+				while (len >= 8) {
+					add_block(data);
+					data += 8;
+					len -= 8;
+				}
+				memcpy(m_tail, data, len);
+				m_tail_len = len;
+			}
+
+			void update(std::string_view str) {
+				update(str.data(), str.size());
+			}
+
+			size_t digest() const {
+				uint64_t h = m_h;
+				if (m_tail_len) {
+					for (size_t i = 0; i < m_tail_len; i++) {
+						h ^= uint64_t((unsigned char)m_tail[i]) << (8 * i);
+					}
+					h *= murmur_m;
+				}
+				h ^= h >> murmur_r;
+				h *= murmur_m;
+				h ^= h >> murmur_r;
+				return h;
+			}
+
+		private:
+
+			uint64_t m_h;
+			char m_tail[8];
+			size_t m_tail_len = 0;
+
+			void add_block(const char *block) {
+				uint64_t k;
+				memcpy(&k, block, sizeof(k));
+				k *= murmur_m;
+				k ^= k >> murmur_r;
+				k *= murmur_m;
+				m_h ^= k;
+				m_h *= murmur_m;
+			}
+
+	};
+
 }
@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace algorithm {
+
+	/*
+		Open addressing hash map for keys that already are hashes, like our word and url hashes. It is meant to be
+		used as scratch space that is filled and cleared over and over again. clear() only resets the slots that are
+		in use and keeps all the memory so refilling it does not allocate anything. Iterates in insertion order.
+		References to values are invalidated by inserts.
+	*/
+	template<typename value_type>
+	class hash_map {
+
+		public:
+
+			typedef std::pair<uint64_t, value_type> entry;
+			typedef typename std::vector<entry>::iterator iterator;
+			typedef typename std::vector<entry>::const_iterator const_iterator;
+
+			explicit hash_map(size_t initial_capacity = 1024) {
+				size_t capacity = 16;
+				while (capacity < initial_capacity * 2) capacity *= 2;
+				resize_slots(capacity);
+			}
+
+			/*
+				Returns a reference to the value of key, inserts a default constructed value if key is not present.
+			*/
+			value_type &operator[](uint64_t key) {
+				const size_t slot = find_slot(key);
+				if (m_slots[slot] == 0) {
+					return insert_at(slot, key, value_type())->second;
+				}
+				return m_entries[m_slots[slot] - 1].second;
+			}
+
+			/*
+				Inserts key if not present. Returns true if the key was inserted and false if it was already there.
+			*/
+			bool insert(uint64_t key, const value_type &value) {
+				const size_t slot = find_slot(key);
+				if (m_slots[slot] != 0) return false;
+				insert_at(slot, key, value);
+				return true;
+			}
+
+			const value_type *find(uint64_t key) const {
+				const size_t slot = find_slot(key);
+				if (m_slots[slot] == 0) return nullptr;
+				return &m_entries[m_slots[slot] - 1].second;
+			}
+
+			bool contains(uint64_t key) const {
+				return m_slots[find_slot(key)] != 0;
+			}
+
+			void clear() {
+				for (size_t slot : m_entry_slots) {
+					m_slots[slot] = 0;
+				}
+				m_entries.clear();
+				m_entry_slots.clear();
+			}
+
+			size_t size() const { return m_entries.size(); }
+			bool empty() const { return m_entries.empty(); }
+
+			iterator begin() { return m_entries.begin(); }
+			iterator end() { return m_entries.end(); }
+			const_iterator begin() const { return m_entries.begin(); }
+			const_iterator end() const { return m_entries.end(); }
+
+		private:
+
+			// Slot values are index + 1 into m_entries, zero means empty.
+			std::vector<uint32_t> m_slots;
+			std::vector<entry> m_entries;
+			std::vector<size_t> m_entry_slots;
+			size_t m_mask = 0;
+			size_t m_shift = 0;
+
+			size_t home_slot(uint64_t key) const {
+				// Fibonacci hashing, spreads keys even if the low bits are not random.
+				return (key * 0x9e3779b97f4a7c15ull) >> m_shift;
+			}
+
+			size_t find_slot(uint64_t key) const {
+				size_t slot = home_slot(key);
+				while (m_slots[slot] != 0 && m_entries[m_slots[slot] - 1].first != key) {
+					slot = (slot + 1) & m_mask;
+				}
+				return slot;
+			}
+
+			entry *insert_at(size_t slot, uint64_t key, const value_type &value) {
+				if ((m_entries.size() + 1) * 2 > m_slots.size()) {
+					resize_slots(m_slots.size() * 2);
+					slot = find_slot(key);
+				}
+				m_entries.emplace_back(key, value);
+				m_entry_slots.push_back(slot);
+				m_slots[slot] = m_entries.size();
+				return &m_entries.back();
+			}
+
+			void resize_slots(size_t capacity) {
+				m_slots.assign(capacity, 0);
+				m_mask = capacity - 1;
+				m_shift = 64;
+				while (capacity > 1) {
+					capacity >>= 1;
+					m_shift--;
+				}
+				for (size_t i = 0; i < m_entries.size(); i++) {
+					const size_t slot = find_slot(m_entries[i].first);
+					m_slots[slot] = i + 1;
+					m_entry_slots[i] = slot;
+				}
+			}
+
+	};
+
+}
@@ -29,61 +29,173 @@
 
 #include "profiler/profiler.h"
 #include "logger/logger.h"
+#include "utils/scheduler.hpp"
 #include <thread>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 using namespace std;
 
 namespace algorithm {
 
-	void hyper_ball_worker(double t, size_t v_begin, size_t v_end, const vector<uint32_t> *edge_map,
-			vector<hyper_log_log> &c, vector<hyper_log_log> &a, vector<double> &harmonic) {
+	namespace {
 
-		profiler::instance prof("Timetaker");
-		for (uint32_t v = v_begin; v < v_end; v++) {
-			a[v] = c[v];
-			for (const uint32_t &w : edge_map[v]) {
-				a[v] += c[w];
-			}
+		/*
+			Contiguous array of registers, allocated on the heap or memory mapped from a file that is removed again
+			when the array is destroyed.
+		*/
+		class register_array {
+
+			public:
+
+				register_array(size_t len, const string &file_name)
+				: m_len(len), m_file_name(file_name) {
+					if (file_name.empty()) {
+						m_heap.resize(len, 0);
+						m_data = m_heap.data();
+						return;
+					}
+					m_fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+					if (m_fd < 0 || ftruncate(m_fd, len) != 0) {
+						throw runtime_error("Could not create hyper_ball counter file " + file_name);
+					}
+					void *ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+					if (ptr == MAP_FAILED) {
+						throw runtime_error("Could not mmap hyper_ball counter file " + file_name);
+					}
+					m_data = (uint8_t *)ptr;
+				}
+
+				~register_array() {
+					if (m_fd >= 0) {
+						if (m_data) munmap(m_data, m_len);
+						close(m_fd);
+						unlink(m_file_name.c_str());
+					}
+				}
+
+				uint8_t *data() { return m_data; }
+
+			private:
+
+				size_t m_len;
+				string m_file_name;
+				vector<uint8_t> m_heap;
+				uint8_t *m_data = nullptr;
+				int m_fd = -1;
+
+		};
 
-			// a[v] is t + 1 and c[v] is at t
-			harmonic[v] += (1.0 / (t + 1.0)) * (a[v].count() - c[v].count());
-		}
-		for (uint32_t v = v_begin; v < v_end; v++) {
-			c[v] = a[v];
-		}
 	}
 
-	vector<double> hyper_ball(uint32_t n, const vector<uint32_t> *edge_map) {
+	vector<double> hyper_ball(const csr_graph &graph, int register_bits, size_t max_distance,
+			const string &counter_dir) {
 
-		const size_t num_threads = min(12, (int)n);
-		const size_t items_per_thread = n / num_threads;
-		vector<hyper_log_log> c(n);
-		vector<hyper_log_log> a(n);
-		vector<double> harmonic(n, 0.0);
+		const uint32_t n = graph.num_vertices();
+		const size_t m = 1ull << register_bits;
+		const size_t vertices_per_task = 1 << 14;
 
-		for (uint32_t v = 0; v < n; v++) {
-			c[v].insert(v);
-		}
+		register_array c_array(n * m, counter_dir.empty() ? "" : counter_dir + "/hyper_ball_c.bin");
+		register_array a_array(n * m, counter_dir.empty() ? "" : counter_dir + "/hyper_ball_a.bin");
+		uint8_t *c = c_array.data();
+		uint8_t *a = a_array.data();
+
+		vector<double> harmonic(n, 0.0);
+		vector<size_t> counts(n, 0);
+		vector<uint8_t> changed(n, 1);
+		vector<uint8_t> next_changed(n, 0);
 
-		double t = 0.0;
-		while (true) {
-			vector<thread> threads;
-			for (size_t i = 0; i < num_threads; i++) {
-				const size_t v_begin = i * items_per_thread;
-				const size_t v_end = (i == num_threads - 1) ? n : (i + 1) * items_per_thread;
-				thread th(hyper_ball_worker, t, v_begin, v_end, edge_map, ref(c), ref(a), ref(harmonic));
-				threads.push_back(move(th));
+		const auto for_each_range = [n, vertices_per_task](const function<size_t(uint32_t, uint32_t)> &fun) {
+			const size_t num_ranges = (n + vertices_per_task - 1) / vertices_per_task;
+			vector<size_t> results(num_ranges, 0);
+			utils::task_group tasks(utils::priority::background);
+			for (size_t range = 0; range < num_ranges; range++) {
+				const uint32_t begin = range * vertices_per_task;
+				const uint32_t end = min<size_t>(n, begin + vertices_per_task);
+				tasks.run([&fun, &results, range, begin, end]() {
+					results[range] = fun(begin, end);
+				});
 			}
+			tasks.wait();
+			size_t sum = 0;
+			for (size_t result : results) {
+				sum += result;
+			}
+			return sum;
+		};
 
-			for (thread &th : threads) {
-				th.join();
+		for_each_range([&](uint32_t begin, uint32_t end) {
+			for (uint32_t v = begin; v < end; v++) {
+				hyper_log_log::insert_register(&c[v * m], register_bits, v);
+				counts[v] = hyper_log_log::count_registers(&c[v * m], register_bits);
 			}
-			LOG_INFO("Finished run t = " + to_string(t));
-			t += 1.0;
-			if (t > 40.0) break;
+			return 0;
+		});
+
+		for (size_t t = 0; t < max_distance; t++) {
+
+			profiler::instance prof("hyper_ball iteration");
+
+			/*
+				a[v] is the union of c[v] and the counters of the neighbours. If no neighbour changed in the last step
+				a[v] equals c[v] and the vertex is skipped.
+			*/
+			const size_t num_changed = for_each_range([&](uint32_t begin, uint32_t end) {
+				size_t num_changed = 0;
+				for (uint32_t v = begin; v < end; v++) {
+					next_changed[v] = 0;
+
+					bool neighbour_changed = false;
+					for (const uint32_t w : graph.neighbours(v)) {
+						if (changed[w]) {
+							neighbour_changed = true;
+							break;
+						}
+					}
+					if (!neighbour_changed) continue;
+
+					uint8_t *a_v = &a[v * m];
+					memcpy(a_v, &c[v * m], m);
+					for (const uint32_t w : graph.neighbours(v)) {
+						hyper_log_log::merge_registers(a_v, &c[w * m], m);
+					}
+
+					if (memcmp(a_v, &c[v * m], m) == 0) continue;
+
+					const size_t count = hyper_log_log::count_registers(a_v, register_bits);
+					harmonic[v] += (1.0 / (t + 1.0)) * ((double)count - (double)counts[v]);
+					counts[v] = count;
+					next_changed[v] = 1;
+					num_changed++;
+				}
+				return num_changed;
+			});
+
+			for_each_range([&](uint32_t begin, uint32_t end) {
+				for (uint32_t v = begin; v < end; v++) {
+					if (next_changed[v]) {
+						memcpy(&c[v * m], &a[v * m], m);
+					}
+				}
+				return 0;
+			});
+
+			changed.swap(next_changed);
+
+			LOG_INFO("Finished run t = " + to_string(t) + " with " + to_string(num_changed) + " changed counters");
+			if (num_changed == 0) break;
 		}
 
 		return harmonic;
 	}
 
+	vector<double> hyper_ball(uint32_t n, const vector<uint32_t> *edge_map) {
+		const csr_graph graph(n, edge_map);
+		return hyper_ball(graph, 15, 40);
+	}
+
 }
@@ -27,10 +27,22 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <cstdint>
+#include "csr_graph.h"
 
 namespace algorithm {
 
+	/*
+		Approximates the harmonic centrality of all vertices with the HyperBall algorithm by Boldi and Vigna.
+		https://arxiv.org/abs/1308.2144
+
+		Every vertex has a hyper log log counter of 2^register_bits registers, all counters are stored in one
+		contiguous array. The iteration stops when no counter changes or after max_distance steps. If counter_dir is
+		not empty the counters are memory mapped from files in that directory instead of allocated on the heap.
+	*/
+	std::vector<double> hyper_ball(const csr_graph &graph, int register_bits, size_t max_distance = 40,
+		const std::string &counter_dir = "");
 	std::vector<double> hyper_ball(uint32_t n, const std::vector<uint32_t> *edge_map);
 
 }
@@ -25,28 +25,29 @@
  */
 
 #include "hyper_log_log.h"
+#include "hash.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace algorithm {
 
 	hyper_log_log::hyper_log_log() {
-		m_M = new char[m_len];
-		memset(m_M, 0, m_len);
 	}
 
-	hyper_log_log::hyper_log_log(const hyper_log_log &other) {
-		m_M = new char[m_len];
-		memcpy(m_M, other.m_M, m_len);
+	hyper_log_log::hyper_log_log(const hyper_log_log &other)
+	: m_b(other.m_b) {
+		*this = other;
 	}
 
 	hyper_log_log::hyper_log_log(const char *m) {
-		m_M = new char[m_len];
+		m_M = new uint8_t[m_len];
 		memcpy(m_M, m, m_len);
 	}
 
 	hyper_log_log::hyper_log_log(size_t b)
 	: m_b(b) {
-		m_M = new char[m_len];
-		memset(m_M, 0, m_len);
 	}
 
 	hyper_log_log::~hyper_log_log() {
@@ -54,48 +55,112 @@ namespace algorithm {
 	}
 
 	void hyper_log_log::insert(size_t v) {
-		size_t x = m_hasher(std::to_string(v));
-		size_t j = x >> (64-m_b);
-		m_M[j] = std::max(m_M[j], leading_zeros_plus_one(x << m_b));
+		const uint64_t x = mix64(v);
+		const size_t j = x >> (64-m_b);
+		// x << m_b has the low m_b bits cleared so the rank is at most 64 - m_b + 1, the last bucket of the estimator.
+		set_register(j, std::min<char>(leading_zeros_plus_one(x << m_b), 64 - m_b + 1));
 	}
 
+	void hyper_log_log::insert_register(uint8_t *registers, int b, size_t v) {
+		const uint64_t x = mix64(v);
+		const size_t j = x >> (64-b);
+		const uint8_t value = (x << b) == 0 ? 64 - b + 1 : __builtin_clzll(x << b) + 1;
+		registers[j] = std::max(registers[j], value);
+	}
+
+	/*
+	 * Uses the improved estimator by Otmar Ertl, https://arxiv.org/abs/1702.01284 computed from the histogram of
+	 * the register values. Unlike the raw estimator with small range correction it has no bias in the range
+	 * around 2.5 * m where the original switches between linear counting and the raw estimate.
+	 * */
 	size_t hyper_log_log::count() const {
-		double Z = 0.0;
-		for (size_t j = 0; j < m_len; j++) {
-			Z += 1.0 / (1ull << m_M[j]);
+
+		if (m_M) {
+			return count_registers(m_M, m_b);
 		}
-		double E = m_alpha * m_len * m_len / Z;
 
-		// Only small range correction implemented since we use 64 bit hash.
-		if (E <= (5.0/2.0) * m_len) {
-			size_t V = num_zero_registers();
-			if (V != 0) {
-				E = m_len * log((double)m_len / V);
-			}
+		size_t histogram[66] = {0};
+		histogram[0] = m_len - m_sparse.size();
+		for (uint32_t reg : m_sparse) {
+			histogram[reg & 0xff]++;
+		}
+		return estimate(histogram, m_b);
+	}
+
+	size_t hyper_log_log::count_registers(const uint8_t *registers, int b) {
+		const size_t len = 1ull << b;
+		size_t histogram[66] = {0};
+		for (size_t j = 0; j < len; j++) {
+			histogram[registers[j]]++;
+		}
+		return estimate(histogram, b);
+	}
+
+	size_t hyper_log_log::estimate(const size_t *histogram, int b) {
+		const size_t q = 64 - b;
+		const double m = (double)(1ull << b);
+		double z = m * tau(1.0 - histogram[q + 1] / m);
+		for (size_t k = q; k >= 1; k--) {
+			z = 0.5 * (z + histogram[k]);
 		}
+		z += m * sigma(histogram[0] / m);
 
-		return (size_t)E;
+		const double alpha_inf = 0.5 / std::log(2.0);
+		return (size_t)std::llround(alpha_inf * m * m / z);
 	}
 
 	void hyper_log_log::reset() {
-		memset(m_M, 0, m_len);
+		delete [] m_M;
+		m_M = nullptr;
+		m_sparse.clear();
 	}
 
-	char hyper_log_log::leading_zeros_plus_one(size_t x) const {
-		size_t num_zeros = 1;
-		for (size_t i = 0; i < 64; i++) {
-			if ((x >> (64 - 1 - i)) & 0x1ull) return num_zeros;
-			num_zeros++;
+	char *hyper_log_log::data() {
+		to_dense();
+		return (char *)m_M;
+	}
+
+	void hyper_log_log::serialize(std::ostream &stream) const {
+		const uint8_t format = sparse() ? format_sparse : format_dense;
+		stream.write((char *)&format, sizeof(uint8_t));
+		if (sparse()) {
+			const uint32_t len = m_sparse.size();
+			stream.write((char *)&len, sizeof(uint32_t));
+			stream.write((char *)m_sparse.data(), len * sizeof(uint32_t));
+		} else {
+			stream.write((char *)m_M, m_len);
 		}
-		return num_zeros;
 	}
 
-	size_t hyper_log_log::num_zero_registers() const {
-		size_t num_zero = 0;
-		for (size_t i = 0; i < m_len; i++) {
-			if (m_M[i] == 0) num_zero++;
+	void hyper_log_log::deserialize(std::istream &stream) {
+		reset();
+		uint8_t format = 0;
+		if (!stream.read((char *)&format, sizeof(uint8_t))) return;
+
+		if (format == format_sparse) {
+			uint32_t len = 0;
+			stream.read((char *)&len, sizeof(uint32_t));
+			if (!stream || len > m_max_sparse) {
+				stream.setstate(std::ios::failbit);
+				return;
+			}
+			m_sparse.resize(len);
+			stream.read((char *)m_sparse.data(), len * sizeof(uint32_t));
+		} else if (format == format_dense) {
+			m_M = new uint8_t[m_len];
+			stream.read((char *)m_M, m_len);
+		} else {
+			// Legacy format, the byte we read is the first of the dense registers.
+			m_M = new uint8_t[m_len];
+			m_M[0] = format;
+			stream.read((char *)m_M + 1, m_len - 1);
 		}
-		return num_zero;
+		if (!stream) reset();
+	}
+
+	char hyper_log_log::leading_zeros_plus_one(size_t x) const {
+		if (x == 0) return 65;
+		return __builtin_clzll(x) + 1;
 	}
 
 	double hyper_log_log::error_bound() const {
@@ -104,24 +169,107 @@ namespace algorithm {
 	}
 
 	hyper_log_log hyper_log_log::operator +(const hyper_log_log &hl) const {
-		hyper_log_log res;
-		for (size_t i = 0; i < m_len && i < hl.m_len; i++) {
-			res.m_M[i] = std::max(m_M[i], hl.m_M[i]);
-		}
-
+		hyper_log_log res(*this);
+		res += hl;
 		return res;
 	}
 
 	hyper_log_log &hyper_log_log::operator +=(const hyper_log_log &hl) {
-		for (size_t i = 0; i < m_len && i < hl.m_len; i++) {
-			m_M[i] = std::max(m_M[i], hl.m_M[i]);
+		if (hl.m_M == nullptr) {
+			for (uint32_t reg : hl.m_sparse) {
+				set_register(reg >> 8, reg & 0xff);
+			}
+			return *this;
 		}
+
+		to_dense();
+		merge_registers(m_M, hl.m_M, std::min(m_len, hl.m_len));
 		return *this;
 	}
 
+	void hyper_log_log::merge_registers(uint8_t *registers, const uint8_t *other, size_t len) {
+		size_t i = 0;
+		#ifdef __SSE2__
+		for (; i + 16 <= len; i += 16) {
+			const __m128i a = _mm_loadu_si128((const __m128i *)&registers[i]);
+			const __m128i b = _mm_loadu_si128((const __m128i *)&other[i]);
+			_mm_storeu_si128((__m128i *)&registers[i], _mm_max_epu8(a, b));
+		}
+		#endif
+		for (; i < len; i++) {
+			registers[i] = std::max(registers[i], other[i]);
+		}
+	}
+
 	hyper_log_log &hyper_log_log::operator =(const hyper_log_log &other) {
-		memcpy(m_M, other.m_M, m_len);
+		if (this == &other) return *this;
+		if (other.m_M == nullptr) {
+			delete [] m_M;
+			m_M = nullptr;
+			m_sparse = other.m_sparse;
+		} else {
+			if (m_M == nullptr) m_M = new uint8_t[m_len];
+			memcpy(m_M, other.m_M, m_len);
+			m_sparse = std::vector<uint32_t>{};
+		}
 		return *this;
 	}
 
-}
\ No newline at end of file
+	double hyper_log_log::sigma(double x) {
+		if (x == 1.0) return INFINITY;
+		double y = 1.0;
+		double z = x;
+		double z_prev;
+		do {
+			x *= x;
+			z_prev = z;
+			z += x * y;
+			y += y;
+		} while (z != z_prev);
+		return z;
+	}
+
+	double hyper_log_log::tau(double x) {
+		if (x == 0.0 || x == 1.0) return 0.0;
+		double y = 1.0;
+		double z = 1.0 - x;
+		double z_prev;
+		do {
+			x = std::sqrt(x);
+			z_prev = z;
+			y *= 0.5;
+			z -= (1.0 - x) * (1.0 - x) * y;
+		} while (z != z_prev);
+		return z / 3.0;
+	}
+
+	void hyper_log_log::set_register(size_t j, uint8_t value) {
+		if (m_M) {
+			m_M[j] = std::max(m_M[j], value);
+			return;
+		}
+
+		const uint32_t reg = (j << 8) | value;
+		auto iter = std::lower_bound(m_sparse.begin(), m_sparse.end(), (uint32_t)(j << 8));
+		if (iter != m_sparse.end() && (*iter >> 8) == j) {
+			*iter = std::max(*iter, reg);
+			return;
+		}
+		m_sparse.insert(iter, reg);
+
+		if (m_sparse.size() > m_max_sparse) {
+			to_dense();
+		}
+	}
+
+	void hyper_log_log::to_dense() {
+		if (m_M) return;
+		m_M = new uint8_t[m_len];
+		memset(m_M, 0, m_len);
+		for (uint32_t reg : m_sparse) {
+			m_M[reg >> 8] = reg & 0xff;
+		}
+		m_sparse = std::vector<uint32_t>{};
+	}
+
+}
@@ -28,8 +28,10 @@
 
 #include <cmath>
 #include <cstring>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 namespace algorithm {
 
@@ -38,6 +40,10 @@ namespace algorithm {
 	 * http://algo.inria.fr/flajolet/Publications/FlFuGaMe07.pdf
 	 *
 	 * Using 64 bit hash instead of 32bit.
+	 *
+	 * Small sets are stored sparse as a sorted list of (register, value) pairs and switch to the dense array of
+	 * 2^b registers when the list would use more than a quarter of the dense size. Both representations give
+	 * exactly the same count.
 	 * */
 
 	class hyper_log_log {
@@ -54,9 +60,20 @@ namespace algorithm {
 			double error_bound() const;
 			void reset();
 
-			const char *data() const { return m_M; };
-			char *data() { return m_M; };
+			/*
+			 * Direct access to the dense registers, converts to the dense representation.
+			 * */
+			char *data();
 			size_t data_size() const { return m_len; };
+			bool sparse() const { return m_M == nullptr; };
+
+			/*
+			 * Compact serialization, sparse counters are stored as their list of registers. The first byte is a format
+			 * tag above any register value, so deserialize also reads the legacy format that was only the 2^b dense
+			 * registers.
+			 * */
+			void serialize(std::ostream &stream) const;
+			void deserialize(std::istream &stream);
 
 			hyper_log_log operator +(const hyper_log_log &hl) const;
 			hyper_log_log &operator +=(const hyper_log_log &hl);
@@ -64,15 +81,31 @@ namespace algorithm {
 
 			char leading_zeros_plus_one(size_t x) const;
 
+			/*
+			 * Operations on raw dense registers of 2^b bytes. Used by hyper_ball to keep all its counters in one
+			 * contiguous array.
+			 * */
+			static void insert_register(uint8_t *registers, int b, size_t v);
+			static size_t count_registers(const uint8_t *registers, int b);
+			static void merge_registers(uint8_t *registers, const uint8_t *other, size_t len);
+
 		private:
 			
-			char *m_M; // Points to registers.
+			uint8_t *m_M = nullptr; // Points to dense registers, nullptr while sparse.
+			std::vector<uint32_t> m_sparse; // Sorted (register << 8 | value) while sparse.
 			const int m_b = 15;
 			const size_t m_len = 1ull << m_b; // 2^m_b
-			const double m_alpha = 0.7213/(1.0 + 1.079/m_len);
-			std::hash<std::string> m_hasher;
+			const size_t m_max_sparse = m_len / 16;
+
+			static const uint8_t format_dense = 0xf0;
+			static const uint8_t format_sparse = 0xf1;
+
+			static size_t estimate(const size_t *histogram, int b);
+			static double sigma(double x);
+			static double tau(double x);
 
-			size_t num_zero_registers() const;
+			void set_register(size_t j, uint8_t value);
+			void to_dense();
 
 	};
 
@@ -68,17 +68,23 @@ namespace api {
 
 		metric.m_total_found = 0;
 
+		profiler::span profiler_index("search_engine::search_deduplicate");
 		vector<full_text_record> results = search_engine::search_deduplicate(allocation->record_storage, index, {}, {}, query, config::result_limit, metric);
+		profiler_index.stop();
 
 		post_processor::post_processor pp(query);
 
+		profiler::span profiler_snippets("api::snippets");
 		vector<result_with_snippet> with_snippets;
 		for (full_text_record &res : results) {
 			const string tsv_data = ht.find(res.m_value);
 			with_snippets.emplace_back(result_with_snippet(tsv_data, res));
 		}
+		profiler_snippets.stop();
 
+		profiler::span profiler_post_processor("post_processor::run");
 		pp.run(with_snippets);
+		profiler_post_processor.stop();
 
 		api_response response(with_snippets, metric, profiler.get());
 
@@ -95,7 +101,7 @@ namespace api {
 		search_engine::reset_search_metric(metric);
 
 		vector<url_link::full_text_record> links;
-		profiler::instance profiler_links("search_engine::search<url_link::full_text_record>");
+		profiler::span profiler_links("search_engine::search<url_link::full_text_record>");
 		links = search_engine::search<url_link::full_text_record>(allocation->link_storage, link_index, {}, {}, query, 500000, metric);
 		profiler_links.stop();
 
@@ -138,7 +144,7 @@ namespace api {
 		search_engine::reset_search_metric(metric);
 
 		vector<url_link::full_text_record> links;
-		profiler::instance profiler_links("search_engine::search<url_link::full_text_record>");
+		profiler::span profiler_links("search_engine::search<url_link::full_text_record>");
 		links = search_engine::search<url_link::full_text_record>(allocation->link_storage, link_index, {}, {}, query, 500000, metric);
 		profiler_links.stop();
 
@@ -150,14 +156,14 @@ namespace api {
 		const size_t total_url_links_found = metric.m_total_found;
 
 		vector<domain_link::full_text_record> domain_links;
-		profiler::instance profiler_domain_links("search_engine::search<domain_link::full_text_record>");
+		profiler::span profiler_domain_links("search_engine::search<domain_link::full_text_record>");
 		domain_links = search_engine::search<domain_link::full_text_record>(allocation->domain_link_storage, domain_link_index, {}, {}, query,
 			100000, metric);
 		profiler_domain_links.stop();
 
 		const size_t total_domain_links_found = metric.m_total_found;
 
-		profiler::instance profiler_index("search_engine::search_with_links");
+		profiler::span profiler_index("search_engine::search_with_links");
 		vector<full_text_record> results = search_engine::search_deduplicate(allocation->record_storage, index, links, domain_links, query,
 			config::result_limit, metric);
 		profiler_index.stop();
@@ -189,7 +195,7 @@ namespace api {
 		struct full_text::search_metric metric;
 		search_engine::reset_search_metric(metric);
 
-		profiler::instance profiler_index("search_engine::search_with_links");
+		profiler::span profiler_index("search_engine::search_with_links");
 		vector<full_text_record> results = search_engine::search(allocation->record_storage, index, {}, {}, query, config::result_limit,
 			metric);
 		profiler_index.stop();
@@ -219,7 +225,7 @@ namespace api {
 		search_engine::reset_search_metric(metric);
 
 		vector<url_link::full_text_record> links;
-		profiler::instance profiler_links("search_engine::search<url_link::full_text_record>");
+		profiler::span profiler_links("search_engine::search<url_link::full_text_record>");
 		links = search_engine::search<url_link::full_text_record>(allocation->link_storage, link_index, {}, {}, query, 500000, metric);
 		profiler_links.stop();
 
@@ -230,7 +236,7 @@ namespace api {
 		metric.m_total_url_links_found = metric.m_total_found;
 		metric.m_total_found = 0;
 
-		profiler::instance profiler_index("search_engine::search_with_links");
+		profiler::span profiler_index("search_engine::search_with_links");
 		vector<full_text_record> results = search_engine::search(allocation->record_storage, index, links, {}, query, config::result_limit,
 			metric);
 		profiler_index.stop();
@@ -260,7 +266,7 @@ namespace api {
 		search_engine::reset_search_metric(metric);
 
 		vector<url_link::full_text_record> links;
-		profiler::instance profiler_links("search_engine::search<url_link::full_text_record>");
+		profiler::span profiler_links("search_engine::search<url_link::full_text_record>");
 		links = search_engine::search<url_link::full_text_record>(allocation->link_storage, link_index, {}, {}, query, 500000, metric);
 		profiler_links.stop();
 
@@ -271,14 +277,14 @@ namespace api {
 		metric.m_total_url_links_found = metric.m_total_found;
 		metric.m_total_found = 0;
 
-		profiler::instance profiler_domain_links("search_engine::search<domain_link::full_text_record>");
+		profiler::span profiler_domain_links("search_engine::search<domain_link::full_text_record>");
 		vector<domain_link::full_text_record> domain_links = search_engine::search<domain_link::full_text_record>(allocation->domain_link_storage,
 			domain_link_index, {}, {}, query, 10000, metric);
 		profiler_domain_links.stop();
 
 		metric.m_total_domain_links_found = metric.m_total_found;
 
-		profiler::instance profiler_index("search_engine::search_with_links");
+		profiler::span profiler_index("search_engine::search_with_links");
 		vector<full_text_record> results = search_engine::search(allocation->record_storage, index, links, domain_links, query, config::result_limit,
 			metric);
 		profiler_index.stop();
@@ -391,8 +397,8 @@ namespace api {
 
 		full_text_result_set<full_text_record> *result_set = fut.get();
 
-		search_engine::apply_link_scores(links, result_set);
-		search_engine::apply_domain_link_scores(domain_links, result_set);
+		search_engine::apply_link_scores(links, result_set, allocation->scratch);
+		search_engine::apply_domain_link_scores(domain_links, result_set, allocation->scratch);
 
 		vector<full_text_record> results(result_set->span_pointer()->begin(), result_set->span_pointer()->end());
 
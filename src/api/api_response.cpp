@@ -28,6 +28,7 @@
 #include "api/result_with_snippet.h"
 #include "full_text/search_metric.h"
 #include "parser/unicode.h"
+#include "profiler/profiler.h"
 #include "json.hpp"
 
 using namespace std;
@@ -63,6 +64,10 @@ namespace api {
 		message["link_url_matches"] = metric.m_link_url_matches;
 		message["results"] = result_array;
 
+		if (profiler::is_tracing()) {
+			message["trace"] = json::parse(profiler::span_tree_json(profiler::current_trace()));
+		}
+
 		//m_response = message.dump();
 		m_response = message.dump(4);
 	}
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bench/bench.h"
+#include "bench/search_load.h"
+#include "config.h"
+#include "storage/storage.h"
+#include "logger/logger.h"
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+
+void help() {
+	cout << "Usage: ./bench [OPTION]..." << endl;
+	cout << "--list list the benchmarks" << endl;
+	cout << "--filter=STR only run benchmarks with names containing STR" << endl;
+	cout << "--repetitions=N time every benchmark N times and report the median (default 5)" << endl;
+	cout << "--min-time=SECONDS minimum time of each repetition (default 0.5)" << endl;
+	cout << "--json=FILE write the results as json to FILE" << endl;
+	cout << "--storage-root=DIR write the indexes to DIR/0 ... DIR/N-1 instead of the configured storage root" << endl;
+	cout << "--storage-devices=N number of storage devices under --storage-root (default from config)" << endl;
+	cout << endl;
+	cout << "--search-load build a synthetic index and replay a query log through api::search" << endl;
+	cout << "--root=DIR directory for the generated corpus (default /tmp/alexandria_search_load)" << endl;
+	cout << "--db=NAME name of the index (default search_load)" << endl;
+	cout << "--no-build reuse the index from a previous run" << endl;
+	cout << "--documents=N number of documents in the corpus (default 100000)" << endl;
+	cout << "--vocabulary=N number of distinct words in the corpus (default 50000)" << endl;
+	cout << "--queries=N length of the query log (default 10000)" << endl;
+	cout << "--concurrency=N number of client threads (default 1)" << endl;
+	cout << "--qps=N target queries per second, zero runs closed loop (default 0)" << endl;
+	cout << "--warmup=N queries to run before measuring (default 500)" << endl;
+}
+
+int main(int argc, const char **argv) {
+
+	bench::options opts;
+	bench::search_load_options load_opts;
+	bool search_load = false;
+	string json_file;
+	string storage_root;
+	size_t storage_devices = 0;
+	for (int i = 1; i < argc; i++) {
+		const string arg(argv[i]);
+		const string value = arg.substr(arg.find('=') + 1);
+		if (arg == "--list") {
+			for (const string &name : bench::benchmark_names()) {
+				cout << name << endl;
+			}
+			return 0;
+		} else if (arg.starts_with("--filter=")) {
+			opts.m_filter = value;
+		} else if (arg.starts_with("--repetitions=")) {
+			opts.m_repetitions = stoul(value);
+		} else if (arg.starts_with("--min-time=")) {
+			opts.m_min_time = stod(value);
+		} else if (arg.starts_with("--json=")) {
+			json_file = value;
+		} else if (arg.starts_with("--storage-root=")) {
+			storage_root = value;
+		} else if (arg.starts_with("--storage-devices=")) {
+			storage_devices = stoull(value);
+		} else if (arg == "--search-load") {
+			search_load = true;
+		} else if (arg.starts_with("--root=")) {
+			load_opts.m_root = value;
+		} else if (arg.starts_with("--db=")) {
+			load_opts.m_db_name = value;
+		} else if (arg == "--no-build") {
+			load_opts.m_build = false;
+		} else if (arg.starts_with("--documents=")) {
+			load_opts.m_corpus.m_num_documents = stoull(value);
+		} else if (arg.starts_with("--vocabulary=")) {
+			load_opts.m_corpus.m_vocabulary_size = stoull(value);
+		} else if (arg.starts_with("--queries=")) {
+			load_opts.m_queries.m_num_queries = stoull(value);
+		} else if (arg.starts_with("--concurrency=")) {
+			load_opts.m_replay.m_concurrency = stoull(value);
+		} else if (arg.starts_with("--qps=")) {
+			load_opts.m_replay.m_target_qps = stod(value);
+		} else if (arg.starts_with("--warmup=")) {
+			load_opts.m_replay.m_warmup_queries = stoull(value);
+		} else {
+			help();
+			return 0;
+		}
+	}
+
+	logger::start_logger_thread();
+
+	if (getenv("ALEXANDRIA_CONFIG") != NULL) {
+		config::read_config(getenv("ALEXANDRIA_CONFIG"));
+	}
+
+	if (storage_root.size()) {
+		config::storage_root = storage_root;
+		config::storage_devices.clear();
+		if (storage_devices) config::storage_num_devices = storage_devices;
+		storage::create_layout();
+	}
+
+	if (search_load) {
+		const bench::load_report report = bench::run_search_load(load_opts);
+		bench::print_load_report(report);
+
+		if (json_file.size()) {
+			ofstream outfile(json_file, ios::trunc);
+			outfile << bench::load_report_json(report, load_opts) << endl;
+		}
+	} else {
+		const vector<bench::result> results = bench::run(opts);
+
+		if (json_file.size()) {
+			ofstream outfile(json_file, ios::trunc);
+			outfile << bench::results_json(results, opts) << endl;
+		}
+	}
+
+	logger::join_logger_thread();
+
+	return 0;
+}
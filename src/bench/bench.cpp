@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bench.h"
+#include "json.hpp"
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using json = nlohmann::ordered_json;
+
+namespace bench {
+
+	state::state(size_t iterations)
+	: m_iterations(iterations), m_remaining(iterations)
+	{
+	}
+
+	bool state::keep_running() {
+		if (!m_started) {
+			m_started = true;
+			resume_timing();
+		}
+		if (m_remaining == 0) {
+			if (m_running) pause_timing();
+			return false;
+		}
+		m_remaining--;
+		return true;
+	}
+
+	void state::pause_timing() {
+		m_elapsed_ns += chrono::duration<double, nano>(chrono::steady_clock::now() - m_start).count();
+		m_running = false;
+	}
+
+	void state::resume_timing() {
+		m_running = true;
+		m_start = chrono::steady_clock::now();
+	}
+
+	vector<pair<string, benchmark_function>> &registry() {
+		// Function local so registration from static initializers in other files is safe.
+		static vector<pair<string, benchmark_function>> benchmarks;
+		return benchmarks;
+	}
+
+	bool register_benchmark(const string &name, benchmark_function fun) {
+		registry().emplace_back(name, fun);
+		return true;
+	}
+
+	vector<string> benchmark_names() {
+		vector<string> names;
+		for (const auto &iter : registry()) {
+			names.push_back(iter.first);
+		}
+		return names;
+	}
+
+	double run_once(const benchmark_function &fun, size_t iterations, size_t &items_processed) {
+		state st(iterations);
+		fun(st);
+		items_processed = st.items_processed();
+		return st.elapsed_ns();
+	}
+
+	result run_benchmark(const string &name, const benchmark_function &fun, const options &opts) {
+
+		// Grow the iteration count until one run takes at least min_time.
+		const double min_time_ns = opts.m_min_time * 1e9;
+		size_t iterations = 1;
+		size_t items_processed = 0;
+		while (true) {
+			const double elapsed_ns = run_once(fun, iterations, items_processed);
+			if (elapsed_ns >= min_time_ns || iterations >= 1000000000) break;
+			const double multiplier = elapsed_ns > 0.0 ? min(10.0, 1.4 * min_time_ns / elapsed_ns) : 10.0;
+			iterations = max(iterations + 1, (size_t)(iterations * multiplier));
+		}
+
+		vector<double> ns_per_iteration;
+		double total_ns = 0.0;
+		size_t total_items = 0;
+		for (size_t i = 0; i < max(opts.m_repetitions, (size_t)1); i++) {
+			const double elapsed_ns = run_once(fun, iterations, items_processed);
+			ns_per_iteration.push_back(elapsed_ns / iterations);
+			total_ns += elapsed_ns;
+			total_items += items_processed;
+		}
+		sort(ns_per_iteration.begin(), ns_per_iteration.end());
+
+		result res;
+		res.m_name = name;
+		res.m_iterations = iterations;
+		res.m_ns_per_iteration = ns_per_iteration[ns_per_iteration.size() / 2];
+		res.m_min_ns_per_iteration = ns_per_iteration[0];
+		res.m_items_per_second = total_ns > 0.0 ? total_items / (total_ns / 1e9) : 0.0;
+		return res;
+	}
+
+	vector<result> run(const options &opts) {
+		vector<result> results;
+		for (const auto &iter : registry()) {
+			if (iter.first.find(opts.m_filter) == string::npos) continue;
+
+			const result res = run_benchmark(iter.first, iter.second, opts);
+			cout << res.m_name << ": " << res.m_ns_per_iteration << " ns/iteration (min " << res.m_min_ns_per_iteration
+				<< ") " << res.m_iterations << " iterations";
+			if (res.m_items_per_second > 0.0) {
+				cout << " " << res.m_items_per_second << " items/s";
+			}
+			cout << endl;
+
+			results.push_back(res);
+		}
+		return results;
+	}
+
+	string results_json(const vector<result> &results, const options &opts) {
+		json message;
+
+		char hostname[256] = {0};
+		gethostname(hostname, sizeof(hostname) - 1);
+		char date[64];
+		const time_t now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+		message["context"]["date"] = date;
+		message["context"]["host"] = hostname;
+		message["context"]["num_cpus"] = thread::hardware_concurrency();
+		message["context"]["repetitions"] = opts.m_repetitions;
+		message["context"]["min_time"] = opts.m_min_time;
+
+		json benchmarks = json::array();
+		for (const result &res : results) {
+			json benchmark;
+			benchmark["name"] = res.m_name;
+			benchmark["iterations"] = res.m_iterations;
+			benchmark["ns_per_iteration"] = res.m_ns_per_iteration;
+			benchmark["min_ns_per_iteration"] = res.m_min_ns_per_iteration;
+			benchmark["items_per_second"] = res.m_items_per_second;
+			benchmarks.push_back(benchmark);
+		}
+		message["benchmarks"] = benchmarks;
+
+		return message.dump(2);
+	}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+	Small microbenchmark harness in the style of google benchmark. A benchmark is a function that does its setup
+	and then loops while state.keep_running(), only the loop is timed:
+
+		void bench_something(bench::state &state) {
+			const auto data = make_data();
+			while (state.keep_running()) {
+				bench::do_not_optimize(something(data));
+			}
+			state.set_items_processed(state.iterations() * data.size());
+		}
+		BENCHMARK(bench_something);
+
+	The runner first finds an iteration count that runs for at least min_time seconds and then times that many
+	iterations repetitions times. Benchmarks generate their data with fixed seeds so runs are comparable across
+	commits.
+*/
+
+namespace bench {
+
+	class state {
+
+		public:
+
+			explicit state(size_t iterations);
+
+			bool keep_running();
+
+			// Excludes per iteration setup from the timing.
+			void pause_timing();
+			void resume_timing();
+
+			void set_items_processed(size_t items) { m_items_processed = items; }
+
+			size_t iterations() const { return m_iterations; }
+			size_t items_processed() const { return m_items_processed; }
+			double elapsed_ns() const { return m_elapsed_ns; }
+
+		private:
+
+			const size_t m_iterations;
+			size_t m_remaining;
+			bool m_started = false;
+			bool m_running = false;
+			std::chrono::steady_clock::time_point m_start;
+			double m_elapsed_ns = 0.0;
+			size_t m_items_processed = 0;
+
+	};
+
+	struct result {
+		std::string m_name;
+		size_t m_iterations;
+		double m_ns_per_iteration; // Median over the repetitions.
+		double m_min_ns_per_iteration;
+		double m_items_per_second; // Zero if the benchmark does not set items processed.
+	};
+
+	struct options {
+		std::string m_filter; // Runs benchmarks with names containing the filter.
+		size_t m_repetitions = 5;
+		double m_min_time = 0.5;
+	};
+
+	using benchmark_function = std::function<void(state &)>;
+
+	bool register_benchmark(const std::string &name, benchmark_function fun);
+	std::vector<std::string> benchmark_names();
+
+	std::vector<result> run(const options &opts);
+	std::string results_json(const std::vector<result> &results, const options &opts);
+
+	// Keeps the compiler from optimizing away the computation of value.
+	template<typename T>
+	inline void do_not_optimize(const T &value) {
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+
+}
+
+#define BENCHMARK(fun) static const bool bench_registered_##fun = bench::register_benchmark(#fun, fun)
@@ -0,0 +1,555 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bench.h"
+#include "text/text.h"
+#include "algorithm/hash.h"
+#include "algorithm/hyper_log_log.h"
+#include "algorithm/algorithm.h"
+#include "URL.h"
+#include "url_view.h"
+#include "indexer/level.h"
+#include "indexer/index_builder.h"
+#include "indexer/index.h"
+#include "search_engine/search_engine.h"
+#include "hash_table/hash_table.h"
+#include "hash_table_helper/hash_table_helper.h"
+#include "parser/html_parser.h"
+#include "common/ThreadPool.h"
+#include "utils/thread_pool.hpp"
+#include "utils/scheduler.hpp"
+#include <random>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
+using namespace std;
+
+/*
+	Synthetic data, every generator takes its own seed so adding a benchmark does not change the data of others.
+*/
+namespace {
+
+	const vector<string> vocabulary = {"the", "search", "engine", "Alexandria", "index,", "(open)", "källkod", "über",
+		"a.b-c", "C++", "www.example.com", "|", "!", "data:", "incomprehensibilities", "of", "and", "news", "Sverige",
+		"2021", "HTML5", "e-mail", "café", "ångström"};
+
+	vector<string> make_documents(size_t num_documents, size_t words_per_document, uint32_t seed) {
+		mt19937 gen(seed);
+		vector<string> documents;
+		for (size_t i = 0; i < num_documents; i++) {
+			string document;
+			for (size_t j = 0; j < words_per_document; j++) {
+				document += vocabulary[gen() % vocabulary.size()] + " ";
+			}
+			documents.push_back(document);
+		}
+		return documents;
+	}
+
+	vector<string> make_urls(size_t num_urls, uint32_t seed) {
+		const vector<string> hosts = {"www.example.com", "svt.se", "sub.domain.org", "www.bbc.co.uk", "github.com",
+			"en.wikipedia.org"};
+		mt19937 gen(seed);
+		vector<string> urls;
+		for (size_t i = 0; i < num_urls; i++) {
+			urls.push_back((gen() % 2 ? "https://" : "http://") + hosts[gen() % hosts.size()] + "/path/" +
+				to_string(gen() % 100000) + "/page.html" + (gen() % 3 == 0 ? "?id=" + to_string(gen()) : ""));
+		}
+		return urls;
+	}
+
+	// Sorted and unique values, every value is kept with the probability density.
+	template<typename data_record>
+	vector<data_record> make_sorted_records(size_t max_value, double density, uint32_t seed) {
+		mt19937 gen(seed);
+		uniform_real_distribution<double> dist(0.0, 1.0);
+		vector<data_record> records;
+		for (uint64_t value = 0; value < max_value; value++) {
+			if (dist(gen) < density) {
+				data_record record{};
+				record.m_value = value;
+				record.m_score = 1.0f;
+				records.push_back(record);
+			}
+		}
+		return records;
+	}
+
+	// Link file lines, source host, source path, target host, target path and link text.
+	vector<string> make_link_lines(size_t num_lines, uint32_t seed) {
+		const vector<string> hosts = {"www.example.com", "svt.se", "sub.domain.org", "www.bbc.co.uk", "github.com"};
+		mt19937 gen(seed);
+		vector<string> lines;
+		for (size_t i = 0; i < num_lines; i++) {
+			lines.push_back(hosts[gen() % hosts.size()] + "\t/page" + to_string(gen()) + ".html\t" +
+				hosts[gen() % hosts.size()] + "\t/target/" + to_string(i) + "\tsome link text");
+		}
+		return lines;
+	}
+
+	// Power law in-degree, the targets are skewed towards the low vertex ids like in the host graph.
+	set<pair<uint32_t, uint32_t>> make_edges(uint32_t num_vertices, uint32_t seed) {
+		mt19937 gen(seed);
+		uniform_real_distribution<double> dist(0.0, 1.0);
+		set<pair<uint32_t, uint32_t>> edges;
+		for (uint32_t v = 0; v < num_vertices; v++) {
+			const size_t out_degree = 1 + gen() % 9;
+			for (size_t i = 0; i < out_degree; i++) {
+				const double u = dist(gen);
+				edges.insert(make_pair(v, (uint32_t)(u * u * u * (num_vertices - 1))));
+			}
+		}
+		return edges;
+	}
+
+	string make_html(uint32_t seed) {
+		mt19937 gen(seed);
+		const vector<string> paragraphs = make_documents(50, 40, seed);
+		string html = "<!DOCTYPE html><html><head><title>" + paragraphs[0].substr(0, 60) + "</title>"
+			"<meta name=\"description\" content=\"" + paragraphs[1].substr(0, 150) + "\"></head><body>"
+			"<h1>" + paragraphs[2].substr(0, 40) + "</h1>";
+		for (const string &paragraph : paragraphs) {
+			html += "<div class=\"content\"><p>" + paragraph + "<a href=\"https://www.example.com/" + to_string(gen()) +
+				"\">link text</a></p><script>var x = 1;</script></div>";
+		}
+		return html + "</body></html>";
+	}
+
+	// Exposes the protected intersection of the index levels.
+	class intersection_level : public indexer::level {
+		public:
+		indexer::level_type get_type() const { return indexer::level_type::domain; }
+		void add_snippet(const indexer::snippet &) {}
+		void add_document(size_t, const string &) {}
+		void add_index_file(const string &, function<void(uint64_t, const string &)>, function<void(uint64_t, uint64_t)>) {}
+		void merge() {}
+		void calculate_scores() {}
+		void clean_up() {}
+		vector<indexer::return_record> find(const string &, const vector<size_t> &, const vector<indexer::link_record> &,
+			const vector<indexer::domain_link_record> &) { return {}; }
+
+		template<typename data_record>
+		vector<indexer::return_record> run_intersection(const vector<vector<data_record>> &input) const {
+			return intersection(input);
+		}
+	};
+
+}
+
+void text_get_full_text_words(bench::state &state) {
+	const vector<string> documents = make_documents(100, 200, 1);
+	size_t num_words = 0;
+	while (state.keep_running()) {
+		for (const string &document : documents) {
+			const vector<string> words = text::get_full_text_words(document);
+			num_words += words.size();
+			bench::do_not_optimize(words);
+		}
+	}
+	state.set_items_processed(num_words);
+}
+BENCHMARK(text_get_full_text_words);
+
+/*
+	Expanded words hashed to 3-grams like the indexer does, with the allocating tokenizer and with the string_view
+	tokenizer that reuses its buffers.
+*/
+void text_ngram_hash(bench::state &state) {
+	const vector<string> documents = make_documents(100, 200, 15);
+	size_t num_bytes = 0;
+	for (const string &document : documents) num_bytes += document.size();
+	uint64_t sum = 0;
+	while (state.keep_running()) {
+		for (const string &document : documents) {
+			const vector<string> words = text::get_expanded_full_text_words(document);
+			text::words_to_ngram_hash(words, 3, [&sum](uint64_t hash) {
+				sum += hash;
+			});
+		}
+	}
+	bench::do_not_optimize(sum);
+	state.set_items_processed(state.iterations() * num_bytes);
+}
+BENCHMARK(text_ngram_hash);
+
+void text_ngram_hash_views(bench::state &state) {
+	const vector<string> documents = make_documents(100, 200, 15);
+	size_t num_bytes = 0;
+	for (const string &document : documents) num_bytes += document.size();
+	uint64_t sum = 0;
+	string buffer;
+	vector<string_view> words;
+	while (state.keep_running()) {
+		for (const string &document : documents) {
+			text::get_expanded_full_text_words(document, buffer, words);
+			text::words_to_ngram_hash(words, 3, [&sum](uint64_t hash) {
+				sum += hash;
+			});
+		}
+	}
+	bench::do_not_optimize(sum);
+	state.set_items_processed(state.iterations() * num_bytes);
+}
+BENCHMARK(text_ngram_hash_views);
+
+void algorithm_hash(bench::state &state) {
+	const vector<string> documents = make_documents(1, 10000, 2);
+	const vector<string> words = text::get_full_text_words(documents[0]);
+	while (state.keep_running()) {
+		for (const string &word : words) {
+			bench::do_not_optimize(algorithm::hash(word));
+		}
+	}
+	state.set_items_processed(state.iterations() * words.size());
+}
+BENCHMARK(algorithm_hash);
+
+void url_parse(bench::state &state) {
+	const vector<string> urls = make_urls(1000, 3);
+	while (state.keep_running()) {
+		for (const string &str : urls) {
+			const URL url(str);
+			bench::do_not_optimize(url.hash());
+		}
+	}
+	state.set_items_processed(state.iterations() * urls.size());
+}
+BENCHMARK(url_parse);
+
+void url_view_parse(bench::state &state) {
+	const vector<string> urls = make_urls(1000, 3);
+	while (state.keep_running()) {
+		for (const string &str : urls) {
+			const url_view url(str);
+			bench::do_not_optimize(url.hash());
+		}
+	}
+	state.set_items_processed(state.iterations() * urls.size());
+}
+BENCHMARK(url_view_parse);
+
+void link_line_url(bench::state &state) {
+	const vector<string> lines = make_link_lines(1000, 17);
+	vector<string> cols;
+	while (state.keep_running()) {
+		for (const string &line : lines) {
+			boost::algorithm::split(cols, line, boost::is_any_of("\t"));
+			const URL source_url(cols[0], cols[1]);
+			const URL target_url(cols[2], cols[3]);
+			bench::do_not_optimize(source_url.link_hash(target_url, cols[4]) + target_url.host_hash());
+		}
+	}
+	state.set_items_processed(state.iterations() * lines.size());
+}
+BENCHMARK(link_line_url);
+
+void link_line_url_view(bench::state &state) {
+	const vector<string> lines = make_link_lines(1000, 17);
+	vector<string_view> cols;
+	while (state.keep_running()) {
+		for (const string &line : lines) {
+			text::split_view(line, cols);
+			const url_view source_url(cols[0], cols[1]);
+			const url_view target_url(cols[2], cols[3]);
+			bench::do_not_optimize(source_url.link_hash(target_url, cols[4]) + target_url.host_hash());
+		}
+	}
+	state.set_items_processed(state.iterations() * lines.size());
+}
+BENCHMARK(link_line_url_view);
+
+void hyper_log_log_insert(bench::state &state) {
+	mt19937_64 gen(4);
+	vector<uint64_t> values(100000);
+	for (uint64_t &value : values) value = gen();
+	while (state.keep_running()) {
+		algorithm::hyper_log_log hll;
+		for (uint64_t value : values) {
+			hll.insert(value);
+		}
+		bench::do_not_optimize(hll);
+	}
+	state.set_items_processed(state.iterations() * values.size());
+}
+BENCHMARK(hyper_log_log_insert);
+
+void hyper_log_log_count(bench::state &state) {
+	mt19937_64 gen(5);
+	algorithm::hyper_log_log hll;
+	for (size_t i = 0; i < 1000000; i++) {
+		hll.insert(gen());
+	}
+	while (state.keep_running()) {
+		bench::do_not_optimize(hll.count());
+	}
+	state.set_items_processed(state.iterations());
+}
+BENCHMARK(hyper_log_log_count);
+
+void harmonic_centrality_bfs(bench::state &state) {
+	const uint32_t num_vertices = 20000;
+	const set<pair<uint32_t, uint32_t>> edges = make_edges(num_vertices, 16);
+	vector<uint32_t> *edge_map = algorithm::set_to_edge_map(num_vertices, edges);
+	while (state.keep_running()) {
+		bench::do_not_optimize(algorithm::harmonic_centrality(num_vertices, edge_map, 6));
+	}
+	delete [] edge_map;
+	state.set_items_processed(state.iterations() * num_vertices);
+}
+BENCHMARK(harmonic_centrality_bfs);
+
+void harmonic_centrality_multi_source(bench::state &state) {
+	const uint32_t num_vertices = 20000;
+	const algorithm::csr_graph graph(num_vertices, make_edges(num_vertices, 16));
+	while (state.keep_running()) {
+		bench::do_not_optimize(algorithm::harmonic_centrality(graph, 6, 1));
+	}
+	state.set_items_processed(state.iterations() * num_vertices);
+}
+BENCHMARK(harmonic_centrality_multi_source);
+
+void level_intersection(bench::state &state) {
+	const vector<vector<indexer::domain_record>> input = {
+		make_sorted_records<indexer::domain_record>(1000000, 0.2, 6),
+		make_sorted_records<indexer::domain_record>(1000000, 0.1, 7),
+		make_sorted_records<indexer::domain_record>(1000000, 0.05, 8)
+	};
+	intersection_level lvl;
+	while (state.keep_running()) {
+		bench::do_not_optimize(lvl.run_intersection(input));
+	}
+	state.set_items_processed(state.iterations() * (input[0].size() + input[1].size() + input[2].size()));
+}
+BENCHMARK(level_intersection);
+
+void search_engine_value_intersection(bench::state &state) {
+	const double densities[] = {0.2, 0.1, 0.05};
+	vector<full_text::full_text_result_set<full_text::full_text_record> *> result_sets;
+	size_t num_records = 0;
+	for (size_t i = 0; i < 3; i++) {
+		// Values up to 4 * ft_max_results_per_section keeps every result set within one section.
+		const auto records = make_sorted_records<full_text::full_text_record>(4 * config::ft_max_results_per_section,
+			densities[i], 9 + i);
+		auto *result_set = new full_text::full_text_result_set<full_text::full_text_record>(records.size());
+		copy(records.begin(), records.end(), result_set->data_pointer());
+		result_sets.push_back(result_set);
+		num_records += records.size();
+	}
+	const vector<int> sections = {0, 0, 0};
+	while (state.keep_running()) {
+		vector<full_text::full_text_record> dest;
+		search_engine::value_intersection(result_sets, sections, dest);
+		bench::do_not_optimize(dest);
+	}
+	state.set_items_processed(state.iterations() * num_records);
+	for (auto *result_set : result_sets) {
+		delete result_set;
+	}
+}
+BENCHMARK(search_engine_value_intersection);
+
+void index_builder_merge(bench::state &state) {
+	mt19937_64 gen(12);
+	const size_t num_records = 100000;
+	indexer::index_builder<indexer::generic_record> idx("bench_index", 0);
+	while (state.keep_running()) {
+		state.pause_timing();
+		idx.truncate();
+		for (size_t i = 0; i < num_records; i++) {
+			idx.add(gen() % 10000, indexer::generic_record(gen() % 1000000, 1.0f));
+		}
+		idx.append();
+		state.resume_timing();
+
+		idx.merge();
+	}
+	state.set_items_processed(state.iterations() * num_records);
+}
+BENCHMARK(index_builder_merge);
+
+/*
+	Lookups in an index shard of 10000 even keys, index_find_missing looks up the odd keys that the key filter answers
+	without reading the shard.
+*/
+void build_find_index() {
+	static bool built = false;
+	if (built) return;
+	indexer::index_builder<indexer::generic_record> idx("bench_find_index", 0);
+	idx.truncate();
+	for (uint64_t key = 0; key < 20000; key += 2) {
+		idx.add(key, indexer::generic_record(key, 1.0f));
+	}
+	idx.append();
+	idx.merge();
+	built = true;
+}
+
+void index_find_lookups(bench::state &state, uint64_t offset) {
+	build_find_index();
+	indexer::index<indexer::generic_record> idx("bench_find_index", 0);
+	mt19937 gen(14);
+	vector<uint64_t> keys;
+	for (size_t i = 0; i < 1000; i++) {
+		keys.push_back((gen() % 10000) * 2 + offset);
+	}
+	while (state.keep_running()) {
+		for (uint64_t key : keys) {
+			bench::do_not_optimize(idx.find(key));
+		}
+	}
+	state.set_items_processed(state.iterations() * keys.size());
+}
+
+void index_find(bench::state &state) {
+	index_find_lookups(state, 0);
+}
+BENCHMARK(index_find);
+
+void index_find_missing(bench::state &state) {
+	index_find_lookups(state, 1);
+}
+BENCHMARK(index_find_missing);
+
+void hash_table_find(bench::state &state) {
+	const size_t num_items = 100000;
+	static bool built = false;
+	if (!built) {
+		hash_table_helper::truncate("bench_hash_table");
+		vector<hash_table::hash_table_shard_builder *> shards = hash_table_helper::create_shard_builders("bench_hash_table");
+		for (size_t i = 0; i < num_items; i++) {
+			hash_table_helper::add_data(shards, algorithm::hash(to_string(i)), "value for item number " + to_string(i));
+		}
+		hash_table_helper::write(shards);
+		hash_table_helper::sort(shards);
+		hash_table_helper::delete_shard_builders(shards);
+		built = true;
+	}
+	static hash_table::hash_table ht("bench_hash_table");
+
+	mt19937 gen(13);
+	vector<uint64_t> keys;
+	for (size_t i = 0; i < 1000; i++) {
+		keys.push_back(algorithm::hash(to_string(gen() % num_items)));
+	}
+	while (state.keep_running()) {
+		for (uint64_t key : keys) {
+			bench::do_not_optimize(ht.find(key));
+		}
+	}
+	state.set_items_processed(state.iterations() * keys.size());
+}
+BENCHMARK(hash_table_find);
+
+void html_parser_parse(bench::state &state) {
+	vector<string> pages;
+	size_t num_bytes = 0;
+	for (uint32_t seed = 0; seed < 10; seed++) {
+		pages.push_back(make_html(100 + seed));
+		num_bytes += pages.back().size();
+	}
+	parser::html_parser parser;
+	while (state.keep_running()) {
+		for (const string &page : pages) {
+			parser.parse(page, "https://www.example.com/page.html");
+			bench::do_not_optimize(parser.text());
+		}
+	}
+	state.set_items_processed(state.iterations() * num_bytes);
+}
+BENCHMARK(html_parser_parse);
+
+/*
+	Indexing runs one task per document. Search splits every query in 8 small tasks like calculate_intersection, with
+	a ThreadPool per query or a task group on the shared scheduler.
+*/
+void thread_pool_indexing(bench::state &state) {
+	const vector<string> documents = make_documents(2000, 200, 18);
+	atomic<size_t> num_words = 0;
+	while (state.keep_running()) {
+		utils::thread_pool pool(utils::scheduler::default_num_threads());
+		for (const string &document : documents) {
+			pool.enqueue([&num_words, &document]() {
+				num_words += text::get_expanded_full_text_words(document).size();
+			});
+		}
+		pool.run_all();
+	}
+	state.set_items_processed(state.iterations() * documents.size());
+}
+BENCHMARK(thread_pool_indexing);
+
+void scheduler_indexing(bench::state &state) {
+	const vector<string> documents = make_documents(2000, 200, 18);
+	atomic<size_t> num_words = 0;
+	while (state.keep_running()) {
+		utils::task_group tasks(utils::priority::background);
+		for (const string &document : documents) {
+			tasks.run([&num_words, &document]() {
+				num_words += text::get_expanded_full_text_words(document).size();
+			});
+		}
+		tasks.wait();
+	}
+	state.set_items_processed(state.iterations() * documents.size());
+}
+BENCHMARK(scheduler_indexing);
+
+void thread_pool_search(bench::state &state) {
+	const size_t tasks_per_query = 8;
+	const vector<string> documents = make_documents(tasks_per_query, 200, 19);
+	atomic<size_t> num_words = 0;
+	while (state.keep_running()) {
+		ThreadPool pool(tasks_per_query);
+		vector<future<void>> results;
+		for (const string &document : documents) {
+			results.emplace_back(pool.enqueue([&num_words, &document]() {
+				num_words += text::get_expanded_full_text_words(document).size();
+			}));
+		}
+		for (auto &result : results) {
+			result.get();
+		}
+	}
+	state.set_items_processed(state.iterations());
+}
+BENCHMARK(thread_pool_search);
+
+void scheduler_search(bench::state &state) {
+	const size_t tasks_per_query = 8;
+	const vector<string> documents = make_documents(tasks_per_query, 200, 19);
+	atomic<size_t> num_words = 0;
+	while (state.keep_running()) {
+		utils::task_group tasks(utils::priority::query);
+		for (const string &document : documents) {
+			tasks.run([&num_words, &document]() {
+				num_words += text::get_expanded_full_text_words(document).size();
+			});
+		}
+		tasks.wait();
+	}
+	state.set_items_processed(state.iterations());
+}
+BENCHMARK(scheduler_search);
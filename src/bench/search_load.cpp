@@ -0,0 +1,397 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "search_load.h"
+#include "config.h"
+#include "URL.h"
+#include "api/api.h"
+#include "common/sub_system.h"
+#include "full_text/full_text.h"
+#include "full_text/full_text_index.h"
+#include "full_text/full_text_indexer_runner.h"
+#include "hash_table/hash_table.h"
+#include "hash_table_helper/hash_table_helper.h"
+#include "search_allocation/search_allocation.h"
+#include "profiler/profiler.h"
+#include "logger/logger.h"
+#include "json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <unistd.h>
+
+using namespace std;
+using json = nlohmann::ordered_json;
+
+namespace bench {
+
+	zipf_distribution::zipf_distribution(size_t n, double exponent)
+	: m_cdf(n)
+	{
+		double sum = 0.0;
+		for (size_t rank = 0; rank < n; rank++) {
+			sum += 1.0 / pow((double)(rank + 1), exponent);
+			m_cdf[rank] = sum;
+		}
+		for (double &value : m_cdf) {
+			value /= sum;
+		}
+	}
+
+	size_t zipf_distribution::sample(double uniform) const {
+		const size_t rank = upper_bound(m_cdf.begin(), m_cdf.end(), uniform) - m_cdf.begin();
+		return min(rank, m_cdf.size() - 1);
+	}
+
+	string synthetic_word(size_t rank) {
+		// Consonant vowel syllables, the rank is written in base 70 with at least two digits so every word is unique.
+		const char *consonants = "bdfgklmnprstvz";
+		const char *vowels = "aeiou";
+		string word;
+		for (size_t n = rank + 70; n > 0; n /= 70) {
+			word += consonants[(n % 70) / 5];
+			word += vowels[(n % 70) % 5];
+		}
+		return word;
+	}
+
+	string synthetic_domain(size_t rank) {
+		return synthetic_word(rank) + ".com";
+	}
+
+	namespace {
+
+		void append_words(string &line, size_t num_words, const zipf_distribution &words, mt19937_64 &gen) {
+			for (size_t i = 0; i < num_words; i++) {
+				if (i > 0) line += ' ';
+				line += synthetic_word(words(gen));
+			}
+		}
+
+		double percentile(const vector<uint64_t> &sorted_nanos, double p) {
+			if (sorted_nanos.empty()) return 0.0;
+			const size_t rank = (size_t)ceil(p * sorted_nanos.size());
+			return sorted_nanos[min(max<size_t>(rank, 1), sorted_nanos.size()) - 1] / 1000.0;
+		}
+
+		size_t total_found(const string &response) {
+			const string key = "\"total_found\":";
+			const size_t pos = response.find(key);
+			if (pos == string::npos) return 0;
+			return strtoull(response.c_str() + pos + key.size(), nullptr, 10);
+		}
+
+		struct client_result {
+			vector<uint64_t> m_latencies;
+			size_t m_errors = 0;
+			size_t m_total_found = 0;
+		};
+
+	}
+
+	vector<string> generate_corpus(const corpus_options &options, const string &root) {
+
+		boost::filesystem::create_directories(root);
+
+		mt19937_64 gen(options.m_seed);
+		const zipf_distribution words(options.m_vocabulary_size, options.m_zipf_exponent);
+		const zipf_distribution domains(options.m_num_domains, options.m_zipf_exponent);
+
+		ofstream domain_info(root + "/domain_info.tsv", ios::trunc);
+		for (size_t rank = 0; rank < options.m_num_domains; rank++) {
+			const double harmonic = 1.0 / sqrt((double)(rank + 1));
+			domain_info << URL::host_reverse(synthetic_domain(rank)) << '\t' << options.m_num_domains / (rank + 1) << '\t' << harmonic << '\n';
+		}
+		ofstream dictionary(root + "/dictionary.tsv", ios::trunc);
+
+		vector<string> files;
+		vector<ofstream> streams;
+		for (size_t i = 0; i < options.m_num_files; i++) {
+			files.push_back(root + "/corpus_" + to_string(i) + ".tsv");
+			streams.emplace_back(files.back(), ios::trunc);
+		}
+
+		string line;
+		for (size_t doc_id = 0; doc_id < options.m_num_documents; doc_id++) {
+			line = "https://" + synthetic_domain(domains(gen)) + "/page/" + to_string(doc_id) + "\t";
+			append_words(line, 6, words, gen);
+			line += '\t';
+			append_words(line, 4, words, gen);
+			line += '\t';
+			append_words(line, 20, words, gen);
+			line += '\t';
+			append_words(line, options.m_words_per_document, words, gen);
+			streams[doc_id % options.m_num_files] << line << '\n';
+		}
+
+		return files;
+	}
+
+	void build_index(const string &db_name, const string &root, const vector<string> &files) {
+
+		full_text::truncate_url_to_domain(db_name);
+		full_text::truncate_index(db_name);
+		hash_table_helper::truncate(db_name);
+
+		common::sub_system sub_system(root + "/domain_info.tsv", root + "/dictionary.tsv");
+		full_text::full_text_indexer_runner runner(db_name, db_name, &sub_system);
+		runner.run(files);
+	}
+
+	vector<string> generate_queries(const corpus_options &corpus, const query_options &options) {
+
+		mt19937_64 gen(options.m_seed);
+		const zipf_distribution words(corpus.m_vocabulary_size, corpus.m_zipf_exponent);
+		const zipf_distribution unique_queries(options.m_num_unique_queries, options.m_zipf_exponent);
+
+		vector<string> pool;
+		for (size_t i = 0; i < options.m_num_unique_queries; i++) {
+			string query;
+			append_words(query, 1 + gen() % options.m_max_query_words, words, gen);
+			pool.push_back(query);
+		}
+
+		vector<string> queries;
+		for (size_t i = 0; i < options.m_num_queries; i++) {
+			queries.push_back(pool[unique_queries(gen)]);
+		}
+
+		return queries;
+	}
+
+	load_report replay(const string &db_name, const vector<string> &queries, const replay_options &options) {
+
+		const size_t num_clients = max<size_t>(options.m_concurrency, 1);
+		const size_t num_warmup = min(options.m_warmup_queries, queries.size());
+		const double interval_nanos = options.m_target_qps > 0.0 ? 1.0e9 / options.m_target_qps : 0.0;
+
+		atomic<size_t> next_warmup(0);
+		atomic<size_t> next_query(0);
+		mutex lock;
+		condition_variable cond;
+		size_t num_ready = 0;
+		bool started = false;
+		uint64_t start_nanos = 0;
+		vector<client_result> results(num_clients);
+
+		vector<thread> clients;
+		for (size_t client_id = 0; client_id < num_clients; client_id++) {
+			clients.emplace_back([&, client_id]() {
+
+				search_allocation::allocation *allocation = search_allocation::create_allocation();
+				hash_table::hash_table ht(db_name);
+				full_text::full_text_index<full_text::full_text_record> index(db_name);
+
+				client_result &result = results[client_id];
+
+				auto run_query = [&](const string &query) {
+					stringstream response_stream;
+					try {
+						api::search(query, ht, index, allocation, response_stream);
+						result.m_total_found += total_found(response_stream.str());
+					} catch (const exception &) {
+						result.m_errors++;
+					}
+					search_allocation::reset_allocation(allocation);
+				};
+
+				for (size_t query_id = next_warmup++; query_id < num_warmup; query_id = next_warmup++) {
+					run_query(queries[query_id]);
+				}
+
+				{
+					unique_lock<mutex> guard(lock);
+					num_ready++;
+					cond.notify_all();
+					cond.wait(guard, [&started]() { return started; });
+				}
+
+				result.m_errors = 0;
+				result.m_total_found = 0;
+				for (size_t query_id = next_query++; query_id < queries.size(); query_id = next_query++) {
+					uint64_t due = profiler::now_nanos();
+					if (interval_nanos > 0.0) {
+						due = start_nanos + (uint64_t)(query_id * interval_nanos);
+						const uint64_t now = profiler::now_nanos();
+						if (due > now) {
+							this_thread::sleep_for(chrono::nanoseconds(due - now));
+						}
+					}
+					run_query(queries[query_id]);
+					result.m_latencies.push_back(profiler::now_nanos() - due);
+				}
+
+				search_allocation::delete_allocation(allocation);
+			});
+		}
+
+		{
+			unique_lock<mutex> guard(lock);
+			cond.wait(guard, [&num_ready, num_clients]() { return num_ready == num_clients; });
+			// Only the spans of the measured queries go into the stage breakdown.
+			profiler::report_reset();
+			start_nanos = profiler::now_nanos();
+			started = true;
+		}
+		cond.notify_all();
+
+		for (thread &client : clients) {
+			client.join();
+		}
+		const uint64_t end_nanos = profiler::now_nanos();
+
+		load_report report;
+		vector<uint64_t> latencies;
+		size_t sum_total_found = 0;
+		for (const client_result &result : results) {
+			latencies.insert(latencies.end(), result.m_latencies.begin(), result.m_latencies.end());
+			report.m_errors += result.m_errors;
+			sum_total_found += result.m_total_found;
+		}
+		sort(latencies.begin(), latencies.end());
+
+		report.m_queries = latencies.size();
+		report.m_elapsed_s = (end_nanos - start_nanos) / 1.0e9;
+		report.m_qps = report.m_elapsed_s > 0.0 ? report.m_queries / report.m_elapsed_s : 0.0;
+		if (report.m_queries > 0) {
+			uint64_t sum = 0;
+			for (uint64_t latency : latencies) sum += latency;
+			report.m_mean_us = (double)sum / report.m_queries / 1000.0;
+			report.m_mean_total_found = (double)sum_total_found / report.m_queries;
+		}
+		report.m_p50_us = percentile(latencies, 0.5);
+		report.m_p95_us = percentile(latencies, 0.95);
+		report.m_p99_us = percentile(latencies, 0.99);
+		report.m_p999_us = percentile(latencies, 0.999);
+		report.m_max_us = latencies.size() ? latencies.back() / 1000.0 : 0.0;
+
+		for (const profiler::span_summary &summary : profiler::span_summaries()) {
+			if (summary.m_count == 0) continue;
+			report.m_stages.push_back(stage_summary{
+				.m_name = summary.m_name,
+				.m_count = summary.m_count,
+				.m_mean_us = (double)summary.m_total_nanos / summary.m_count / 1000.0,
+				.m_p50_us = summary.percentile(0.5) / 1000.0,
+				.m_p99_us = summary.percentile(0.99) / 1000.0,
+				.m_max_us = summary.m_max_nanos / 1000.0
+			});
+		}
+
+		return report;
+	}
+
+	load_report run_search_load(const search_load_options &options) {
+
+		if (options.m_build) {
+			LOG_INFO("Generating corpus of " + to_string(options.m_corpus.m_num_documents) + " documents in " + options.m_root);
+			const vector<string> files = generate_corpus(options.m_corpus, options.m_root);
+			LOG_INFO("Indexing corpus into " + options.m_db_name);
+			build_index(options.m_db_name, options.m_root, files);
+		}
+
+		const vector<string> queries = generate_queries(options.m_corpus, options.m_queries);
+		LOG_INFO("Replaying " + to_string(queries.size()) + " queries");
+
+		return replay(options.m_db_name, queries, options.m_replay);
+	}
+
+	void print_load_report(const load_report &report) {
+		cout << fixed << setprecision(1);
+		cout << "queries: " << report.m_queries << " errors: " << report.m_errors << " elapsed: " << report.m_elapsed_s << "s qps: "
+			<< report.m_qps << " mean total_found: " << report.m_mean_total_found << endl;
+		cout << "latency us mean: " << report.m_mean_us << " p50: " << report.m_p50_us << " p95: " << report.m_p95_us << " p99: "
+			<< report.m_p99_us << " p999: " << report.m_p999_us << " max: " << report.m_max_us << endl;
+		for (const stage_summary &stage : report.m_stages) {
+			cout << left << setw(48) << stage.m_name << right << " count: " << stage.m_count << " mean: " << stage.m_mean_us << "us p50: "
+				<< stage.m_p50_us << "us p99: " << stage.m_p99_us << "us max: " << stage.m_max_us << "us" << endl;
+		}
+		cout << defaultfloat;
+	}
+
+	string load_report_json(const load_report &report, const search_load_options &options) {
+		json message;
+
+		char hostname[256] = {0};
+		gethostname(hostname, sizeof(hostname) - 1);
+		char date[64];
+		const time_t now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+		message["context"]["date"] = date;
+		message["context"]["host"] = hostname;
+		message["context"]["num_cpus"] = thread::hardware_concurrency();
+
+		message["corpus"]["documents"] = options.m_corpus.m_num_documents;
+		message["corpus"]["domains"] = options.m_corpus.m_num_domains;
+		message["corpus"]["vocabulary"] = options.m_corpus.m_vocabulary_size;
+		message["corpus"]["words_per_document"] = options.m_corpus.m_words_per_document;
+		message["corpus"]["zipf_exponent"] = options.m_corpus.m_zipf_exponent;
+		message["corpus"]["seed"] = options.m_corpus.m_seed;
+
+		message["replay"]["queries"] = options.m_queries.m_num_queries;
+		message["replay"]["unique_queries"] = options.m_queries.m_num_unique_queries;
+		message["replay"]["concurrency"] = options.m_replay.m_concurrency;
+		message["replay"]["target_qps"] = options.m_replay.m_target_qps;
+		message["replay"]["warmup_queries"] = options.m_replay.m_warmup_queries;
+
+		message["queries"] = report.m_queries;
+		message["errors"] = report.m_errors;
+		message["elapsed_s"] = report.m_elapsed_s;
+		message["qps"] = report.m_qps;
+		message["mean_total_found"] = report.m_mean_total_found;
+		message["latency_us"]["mean"] = report.m_mean_us;
+		message["latency_us"]["p50"] = report.m_p50_us;
+		message["latency_us"]["p95"] = report.m_p95_us;
+		message["latency_us"]["p99"] = report.m_p99_us;
+		message["latency_us"]["p999"] = report.m_p999_us;
+		message["latency_us"]["max"] = report.m_max_us;
+
+		json stages = json::array();
+		for (const stage_summary &stage : report.m_stages) {
+			json item;
+			item["name"] = stage.m_name;
+			item["count"] = stage.m_count;
+			item["mean_us"] = stage.m_mean_us;
+			item["p50_us"] = stage.m_p50_us;
+			item["p99_us"] = stage.m_p99_us;
+			item["max_us"] = stage.m_max_us;
+			stages.push_back(item);
+		}
+		message["stages"] = stages;
+
+		return message.dump(2);
+	}
+
+}
@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+	End to end search load test. A deterministic synthetic corpus is written as tsv files and indexed with the real
+	full_text_indexer_runner, then a zipfian query log is replayed through api::search in process by a number of
+	client threads, either as fast as possible (closed loop) or at a target rate (open loop). The report has the
+	latency percentiles of the whole requests, the throughput and the per stage histograms of the profiler spans.
+*/
+
+namespace bench {
+
+	/*
+		Zipf distribution over the ranks 0 ... n - 1, rank k is drawn with probability proportional to 1 / (k + 1)^s.
+		Draws only depend on the 64 bit output of the generator so they are the same on every platform.
+	*/
+	class zipf_distribution {
+
+		public:
+
+			zipf_distribution(size_t n, double exponent);
+
+			template<typename generator>
+			size_t operator()(generator &gen) const {
+				return sample((double)(gen() >> 11) * 0x1.0p-53);
+			}
+
+		private:
+
+			std::vector<double> m_cdf;
+
+			size_t sample(double uniform) const;
+
+	};
+
+	struct corpus_options {
+		size_t m_num_documents = 100000;
+		size_t m_num_domains = 2000;
+		size_t m_vocabulary_size = 50000;
+		size_t m_words_per_document = 100;
+		size_t m_num_files = 8;
+		double m_zipf_exponent = 1.0;
+		uint64_t m_seed = 1;
+	};
+
+	struct query_options {
+		size_t m_num_queries = 10000;
+		// The log is drawn with a zipf distribution from this many distinct queries so popular queries repeat.
+		size_t m_num_unique_queries = 2000;
+		size_t m_max_query_words = 3;
+		double m_zipf_exponent = 1.0;
+		uint64_t m_seed = 2;
+	};
+
+	struct replay_options {
+		size_t m_concurrency = 1;
+		// Queries per second over all clients, zero runs closed loop.
+		double m_target_qps = 0.0;
+		// Run before the measurement and not reported.
+		size_t m_warmup_queries = 500;
+	};
+
+	struct stage_summary {
+		std::string m_name;
+		size_t m_count;
+		double m_mean_us;
+		double m_p50_us;
+		double m_p99_us;
+		double m_max_us;
+	};
+
+	struct load_report {
+		size_t m_queries = 0;
+		size_t m_errors = 0;
+		double m_elapsed_s = 0.0;
+		double m_qps = 0.0;
+		double m_mean_total_found = 0.0;
+		double m_mean_us = 0.0;
+		double m_p50_us = 0.0;
+		double m_p95_us = 0.0;
+		double m_p99_us = 0.0;
+		double m_p999_us = 0.0;
+		double m_max_us = 0.0;
+		std::vector<stage_summary> m_stages;
+	};
+
+	struct search_load_options {
+		std::string m_root = "/tmp/alexandria_search_load";
+		std::string m_db_name = "search_load";
+		bool m_build = true;
+		corpus_options m_corpus;
+		query_options m_queries;
+		replay_options m_replay;
+	};
+
+	std::string synthetic_word(size_t rank);
+	std::string synthetic_domain(size_t rank);
+
+	/*
+		Writes the corpus to num_files tsv files in the same column layout as the warc output (url, title, h1, meta,
+		text) together with a domain_info.tsv giving every domain a harmonic centrality. Returns the data files.
+	*/
+	std::vector<std::string> generate_corpus(const corpus_options &options, const std::string &root);
+
+	void build_index(const std::string &db_name, const std::string &root, const std::vector<std::string> &files);
+
+	std::vector<std::string> generate_queries(const corpus_options &corpus, const query_options &options);
+
+	/*
+		Each client thread has its own hash_table, full_text_index and search allocation just like the server
+		workers. In open loop mode query i is due at start + i / target_qps and its latency is measured from that
+		time, so queueing behind slow queries is part of the latency instead of lowering the offered load.
+	*/
+	load_report replay(const std::string &db_name, const std::vector<std::string> &queries, const replay_options &options);
+
+	load_report run_search_load(const search_load_options &options);
+
+	void print_load_report(const load_report &report);
+	std::string load_report_json(const load_report &report, const search_load_options &options);
+
+}
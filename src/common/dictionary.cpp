@@ -68,6 +68,10 @@ namespace common {
 		return m_rows.find(hash<string>{}(key));
 	}
 
+	unordered_map<size_t, dictionary_row>::const_iterator dictionary::find_hash(size_t key_hash) const {
+		return m_rows.find(key_hash);
+	}
+
 	unordered_map<size_t, dictionary_row>::const_iterator dictionary::begin() const {
 		return m_rows.begin();
 	}
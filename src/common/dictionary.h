@@ -47,6 +47,8 @@ namespace common {
 			void load_tsv(file::tsv_file &tsv_file);
 
 			std::unordered_map<size_t, dictionary_row>::const_iterator find(const std::string &key) const;
+			// Same as find(key) with the hash of the key already calculated.
+			std::unordered_map<size_t, dictionary_row>::const_iterator find_hash(size_t key_hash) const;
 
 			std::unordered_map<size_t, dictionary_row>::const_iterator begin() const;
 			std::unordered_map<size_t, dictionary_row>::const_iterator end() const;
@@ -51,6 +51,21 @@ namespace common {
 		});
 	}
 
+	sub_system::sub_system(const string &domain_index_file, const string &dictionary_file) {
+
+		file::tsv_file domain_index(domain_index_file);
+		m_domain_index = new dictionary(domain_index);
+
+		file::tsv_file dict_data(dictionary_file);
+		m_dictionary = new dictionary(dict_data);
+
+		dict_data.read_column_into(0, m_words);
+
+		sort(m_words.begin(), m_words.end(), [](const string &a, const string &b) {
+			return a < b;
+		});
+	}
+
 	sub_system::~sub_system() {
 		delete m_dictionary;
 		delete m_domain_index;
@@ -42,6 +42,8 @@ namespace common {
 		public:
 
 			sub_system();
+			// Reads the domain index and dictionary from local files instead of downloading them.
+			sub_system(const std::string &domain_index_file, const std::string &dictionary_file);
 			~sub_system();
 
 			const dictionary *domain_index() const;
@@ -41,6 +41,11 @@ namespace config {
 	string url_store_path = "/alexandria/urlstore";
 	string url_store_cache_path = "/mnt/4/urlstore_cache";
 
+	string storage_root = "/mnt";
+	size_t storage_num_devices = 8;
+	vector<string> storage_devices;
+	string storage_placement = "round_robin";
+
 	size_t nodes_in_cluster = 1;
 	size_t node_id = 0;
 
@@ -61,6 +66,8 @@ namespace config {
 	size_t shard_hash_table_size = 100000;
 	size_t html_parser_long_text_len = 1000;
 	size_t ft_shard_builder_buffer_len = 240000;
+	size_t gz_num_threads_decoding = 8;
+	size_t domain_stats_max_age_hours = 24;
 
 	size_t ft_num_shards = 2048;
 	size_t ft_max_sections = 8;
@@ -70,6 +77,7 @@ namespace config {
 	size_t ft_num_threads_indexing = 24;
 	size_t ft_num_threads_merging = 24;
 	size_t ft_num_threads_appending = 8;
+	size_t ft_max_merge_memory_mb = 1000;
 
 	double ft_cached_bytes_per_shard() {
 		return (ft_max_cache_gb * 1000ul*1000ul*1000ul) / (ft_num_shards * ft_num_threads_indexing);
@@ -79,6 +87,7 @@ namespace config {
 
 		batches.clear();
 		link_batches.clear();
+		storage_devices.clear();
 
 		ifstream in(config_file);
 
@@ -124,6 +133,14 @@ namespace config {
 				batches.push_back(parts[1]);
 			} else if (parts[0] == "link_batches") {
 				link_batches.push_back(parts[1]);
+			} else if (parts[0] == "storage_root") {
+				storage_root = parts[1];
+			} else if (parts[0] == "storage_num_devices") {
+				storage_num_devices = stoull(parts[1]);
+			} else if (parts[0] == "storage_devices") {
+				storage_devices.push_back(parts[1]);
+			} else if (parts[0] == "storage_placement") {
+				storage_placement = parts[1];
 			} else if (parts[0] == "worker_count") {
 				worker_count = stoi(parts[1]);
 			} else if (parts[0] == "query_max_words") {
@@ -152,6 +169,8 @@ namespace config {
 				ft_num_threads_merging = stoi(parts[1]);
 			} else if (parts[0] == "ft_num_threads_appending") {
 				ft_num_threads_appending = stoi(parts[1]);
+			} else if (parts[0] == "ft_max_merge_memory_mb") {
+				ft_max_merge_memory_mb = stoi(parts[1]);
 			} else if (parts[0] == "file_upload_user") {
 				file_upload_user = parts[1];
 			} else if (parts[0] == "file_upload_password") {
@@ -166,6 +185,10 @@ namespace config {
 				shard_hash_table_size = stoull(parts[1]);
 			} else if (parts[0] == "html_parser_long_text_len") {
 				html_parser_long_text_len = stoull(parts[1]);
+			} else if (parts[0] == "gz_num_threads_decoding") {
+				gz_num_threads_decoding = stoull(parts[1]);
+			} else if (parts[0] == "domain_stats_max_age_hours") {
+				domain_stats_max_age_hours = stoull(parts[1]);
 			}
 		}
 	}
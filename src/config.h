@@ -40,6 +40,12 @@ namespace config {
 	extern std::string url_store_path;
 	extern std::string url_store_cache_path;
 
+	// Storage topology, see storage/storage.h
+	extern std::string storage_root;
+	extern size_t storage_num_devices;
+	extern std::vector<std::string> storage_devices;
+	extern std::string storage_placement;
+
 	const size_t url_store_shards = 24;
 
 	extern size_t nodes_in_cluster;
@@ -63,6 +69,8 @@ namespace config {
 	extern size_t shard_hash_table_size;
 	extern size_t html_parser_long_text_len;
 	extern size_t ft_shard_builder_buffer_len;
+	extern size_t gz_num_threads_decoding;
+	extern size_t domain_stats_max_age_hours;
 
 	/*
 		Constants only configurable at compilation time.
@@ -77,6 +85,7 @@ namespace config {
 	extern size_t ft_num_threads_indexing;
 	extern size_t ft_num_threads_merging;
 	extern size_t ft_num_threads_appending;
+	extern size_t ft_max_merge_memory_mb;
 	double ft_cached_bytes_per_shard();
 
 	// Link indexer config
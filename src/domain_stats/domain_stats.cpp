@@ -25,39 +25,116 @@
  */
 
 #include "domain_stats.h"
+#include "stats_table.h"
 #include <iostream>
-#include "common/dictionary.h"
+#include <sstream>
+#include <boost/filesystem.hpp>
 #include "file/tsv_file_remote.h"
 #include "logger/logger.h"
 #include "common/system.h"
+#include "storage/storage.h"
+#include "config.h"
 
 using namespace std;
 
 namespace domain_stats {
 
-	common::dictionary domain_data;
+	// The columns of domain_info.tsv that are kept in the table, the harmonic centrality is column 1.
+	const size_t num_columns = 2;
+	const size_t harmonic_column = 1;
+
+	stats_table domain_data;
+
+	string stats_table_filename() {
+		const string tsv_filename = storage::primary_path(common::domain_index_filename());
+		return tsv_filename.substr(0, tsv_filename.rfind('.')) + ".bin";
+	}
 
 	void download_domain_stats() {
 		LOG_INFO("download domain_info.tsv");
 		file::tsv_file_remote domain_info_tsv(common::domain_index_filename());
 		LOG_INFO("parsing.....");
-		domain_data.load_tsv(domain_info_tsv);
+
+		vector<uint64_t> keys;
+		vector<float> values;
+		while (!domain_info_tsv.eof()) {
+			const string line = domain_info_tsv.get_line();
+			stringstream ss(line);
+			string col;
+			getline(ss, col, '\t');
+			if (col.empty()) continue;
+
+			// The tsv is keyed by the reversed host, the table by the same host hash as URL::host_hash().
+			keys.push_back(hash<string>{}(URL::host_reverse(col)));
+
+			size_t num_values = 0;
+			while (num_values < num_columns && getline(ss, col, '\t')) {
+				try {
+					values.push_back(stof(col));
+					num_values++;
+				} catch(const invalid_argument &error) {
+				} catch(const out_of_range &error) {
+				}
+			}
+			for (; num_values < num_columns; num_values++) {
+				values.push_back(0.0f);
+			}
+		}
+
+		domain_data.build(keys, values, num_columns);
+		LOG_INFO("built domain stats table with " + to_string(domain_data.size()) + " hosts");
+
+		domain_data.write(stats_table_filename());
+		domain_data.read(stats_table_filename());
 	}
 
-	float harmonic_centrality(const URL &url) {
-		return harmonic_centrality(url.host_reverse());
+	/*
+		The table is stale if the tsv next to it was downloaded after the table was built or if it is older than
+		config::domain_stats_max_age_hours, the remote domain_info.tsv is updated between runs.
+	*/
+	bool load_domain_stats() {
+		const string table_filename = stats_table_filename();
+		const string tsv_filename = storage::primary_path(common::domain_index_filename());
+		boost::system::error_code error;
+		const time_t table_time = boost::filesystem::last_write_time(table_filename, error);
+		if (error) return false;
+		const time_t tsv_time = boost::filesystem::last_write_time(tsv_filename, error);
+		if (!error && tsv_time > table_time) {
+			LOG_INFO("domain stats table is older than " + tsv_filename);
+			return false;
+		}
+		if (time(nullptr) - table_time > (time_t)config::domain_stats_max_age_hours * 3600) {
+			LOG_INFO("domain stats table is older than " + to_string(config::domain_stats_max_age_hours) + " hours");
+			return false;
+		}
+
+		try {
+			domain_data.read(table_filename);
+		} catch (const runtime_error &error) {
+			LOG_INFO(error.what());
+			return false;
+		}
+		LOG_INFO("loaded domain stats table with " + to_string(domain_data.size()) + " hosts");
+		return true;
 	}
 
-	float harmonic_centrality(const std::string &reverse_host) {
+	float harmonic_centrality(const URL &url) {
+		const float *row = domain_data.find(url.host_hash());
+		return row ? row[harmonic_column] : 0.0f;
+	}
 
-		const auto iter = domain_data.find(reverse_host);
+	float harmonic_centrality(const url_view &url) {
+		const float *row = domain_data.find(url.host_hash());
+		return row ? row[harmonic_column] : 0.0f;
+	}
 
-		float harmonic = 0.0f;
-		if (iter != domain_data.end()) {
-			const common::dictionary_row row = iter->second;
-			harmonic = row.get_float(1);
-		}
+	float harmonic_centrality(const string &reverse_host) {
+		const float *row = domain_data.find(hash<string>{}(URL::host_reverse(reverse_host)));
+		return row ? row[harmonic_column] : 0.0f;
+	}
 
-		return harmonic;
+	void harmonic_centrality(const vector<uint64_t> &host_hashes, vector<float> &harmonics) {
+		harmonics.resize(host_hashes.size());
+		domain_data.find_column(host_hashes.data(), host_hashes.size(), harmonic_column, harmonics.data());
 	}
 }
@@ -27,10 +27,24 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 #include "URL.h"
+#include "url_view.h"
 
 namespace domain_stats {
+
+	/*
+		Downloads domain_info.tsv and builds the stats table, the table is saved next to the tsv file so
+		load_domain_stats() can mmap it without downloading and parsing the tsv again. load_domain_stats() returns
+		false if the table is missing, older than the tsv or config::domain_stats_max_age_hours, or invalid.
+	*/
 	void download_domain_stats();
+	bool load_domain_stats();
+
 	float harmonic_centrality(const URL &url);
-	float harmonic_centrality(const std::string &domain);
+	float harmonic_centrality(const url_view &url);
+	float harmonic_centrality(const std::string &reverse_host);
+
+	// Harmonic centrality of every host hash, 0 for unknown hosts.
+	void harmonic_centrality(const std::vector<uint64_t> &host_hashes, std::vector<float> &harmonics);
 }
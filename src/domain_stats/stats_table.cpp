@@ -0,0 +1,242 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "stats_table.h"
+#include "algorithm/hash.h"
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+namespace domain_stats {
+
+	namespace {
+
+		const char table_magic[8] = {'A', 'L', 'X', 'D', 'S', 'T', '0', '1'};
+
+		struct table_header {
+			char m_magic[8];
+			uint64_t m_size;
+			uint64_t m_num_columns;
+			uint64_t m_num_buckets;
+			uint64_t m_num_slots;
+			uint64_t m_empty_key;
+		};
+
+		inline size_t fast_range(uint64_t hash, size_t range) {
+			return ((unsigned __int128)hash * range) >> 64;
+		}
+
+		size_t displacement_bytes(size_t num_buckets) {
+			// Padded so the keys after the displacements are 8 byte aligned.
+			return (num_buckets * sizeof(uint32_t) + 7) & ~(size_t)7;
+		}
+
+	}
+
+	stats_table::stats_table() {
+	}
+
+	size_t stats_table::bucket(uint64_t hash) const {
+		return fast_range(hash, m_num_buckets);
+	}
+
+	size_t stats_table::slot(uint64_t hash, uint32_t displacement) const {
+		return fast_range(algorithm::mix64(hash ^ (displacement * 0x9e3779b97f4a7c15ull)), m_num_slots);
+	}
+
+	void stats_table::build(const vector<uint64_t> &keys, const vector<float> &values, size_t num_columns) {
+
+		m_file.reset();
+
+		// Unique keys, the last row of a duplicated key wins.
+		vector<size_t> rows(keys.size());
+		iota(rows.begin(), rows.end(), 0);
+		stable_sort(rows.begin(), rows.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+		vector<size_t> unique_rows;
+		for (size_t i = 0; i < rows.size(); i++) {
+			if (i + 1 < rows.size() && keys[rows[i]] == keys[rows[i + 1]]) continue;
+			unique_rows.push_back(rows[i]);
+		}
+
+		// The smallest key not in the table marks empty slots.
+		m_empty_key = 0;
+		for (size_t row : unique_rows) {
+			if (keys[row] == m_empty_key) m_empty_key++;
+			else if (keys[row] > m_empty_key) break;
+		}
+
+		m_size = unique_rows.size();
+		m_num_columns = num_columns;
+		m_num_buckets = max<size_t>(1, m_size / 4);
+		m_num_slots = max<size_t>(1, m_size + m_size / 4);
+
+		vector<vector<size_t>> buckets(m_num_buckets);
+		for (size_t row : unique_rows) {
+			buckets[bucket(algorithm::mix64(keys[row]))].push_back(row);
+		}
+
+		// Place the largest buckets first while the table is empty.
+		vector<size_t> bucket_order(m_num_buckets);
+		iota(bucket_order.begin(), bucket_order.end(), 0);
+		stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t a, size_t b) {
+			return buckets[a].size() > buckets[b].size();
+		});
+
+		m_displacement_memory.assign(m_num_buckets, 0);
+		m_key_memory.assign(m_num_slots, m_empty_key);
+		m_value_memory.assign(m_num_slots * m_num_columns, 0.0f);
+		vector<bool> used(m_num_slots, false);
+		vector<size_t> slots;
+
+		for (size_t bucket_id : bucket_order) {
+			const vector<size_t> &bucket_rows = buckets[bucket_id];
+			if (bucket_rows.empty()) break;
+
+			for (uint32_t displacement = 0; ; displacement++) {
+				if (displacement == UINT32_MAX) {
+					throw runtime_error("Could not build perfect hash for stats_table");
+				}
+				slots.clear();
+				bool ok = true;
+				for (size_t row : bucket_rows) {
+					const size_t s = slot(algorithm::mix64(keys[row]), displacement);
+					if (used[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) {
+						ok = false;
+						break;
+					}
+					slots.push_back(s);
+				}
+				if (!ok) continue;
+
+				m_displacement_memory[bucket_id] = displacement;
+				for (size_t i = 0; i < bucket_rows.size(); i++) {
+					used[slots[i]] = true;
+					m_key_memory[slots[i]] = keys[bucket_rows[i]];
+					copy(values.begin() + bucket_rows[i] * m_num_columns, values.begin() + (bucket_rows[i] + 1) * m_num_columns,
+						m_value_memory.begin() + slots[i] * m_num_columns);
+				}
+				break;
+			}
+		}
+
+		m_displacements = m_displacement_memory.data();
+		m_keys = m_key_memory.data();
+		m_values = m_value_memory.data();
+	}
+
+	void stats_table::write(const string &file_name) const {
+		ofstream outfile(file_name, ios::binary | ios::trunc);
+		if (!outfile.is_open()) {
+			throw runtime_error("Could not open stats_table file " + file_name);
+		}
+
+		table_header header;
+		memcpy(header.m_magic, table_magic, sizeof(table_magic));
+		header.m_size = m_size;
+		header.m_num_columns = m_num_columns;
+		header.m_num_buckets = m_num_buckets;
+		header.m_num_slots = m_num_slots;
+		header.m_empty_key = m_empty_key;
+
+		const char padding[8] = {0};
+		outfile.write((const char *)&header, sizeof(header));
+		outfile.write((const char *)m_displacements, m_num_buckets * sizeof(uint32_t));
+		outfile.write(padding, displacement_bytes(m_num_buckets) - m_num_buckets * sizeof(uint32_t));
+		outfile.write((const char *)m_keys, m_num_slots * sizeof(uint64_t));
+		outfile.write((const char *)m_values, m_num_slots * m_num_columns * sizeof(float));
+	}
+
+	void stats_table::read(const string &file_name) {
+		auto table_file = make_unique<file::mmap_file>(file_name);
+		const table_header *header = (const table_header *)table_file->data();
+		if (table_file->size() < sizeof(table_header) || memcmp(header->m_magic, table_magic, sizeof(table_magic)) != 0) {
+			throw runtime_error("Invalid stats_table file " + file_name);
+		}
+
+		const size_t keys_pos = sizeof(table_header) + displacement_bytes(header->m_num_buckets);
+		const size_t values_pos = keys_pos + header->m_num_slots * sizeof(uint64_t);
+		if (table_file->size() != values_pos + header->m_num_slots * header->m_num_columns * sizeof(float)) {
+			throw runtime_error("Invalid stats_table file " + file_name);
+		}
+
+		m_size = header->m_size;
+		m_num_columns = header->m_num_columns;
+		m_num_buckets = header->m_num_buckets;
+		m_num_slots = header->m_num_slots;
+		m_empty_key = header->m_empty_key;
+		m_displacements = (const uint32_t *)(table_file->data() + sizeof(table_header));
+		m_keys = (const uint64_t *)(table_file->data() + keys_pos);
+		m_values = (const float *)(table_file->data() + values_pos);
+
+		m_displacement_memory = vector<uint32_t>{};
+		m_key_memory = vector<uint64_t>{};
+		m_value_memory = vector<float>{};
+		m_file = std::move(table_file);
+	}
+
+	const float *stats_table::find(uint64_t key) const {
+		if (m_size == 0 || key == m_empty_key) return nullptr;
+		const uint64_t hash = algorithm::mix64(key);
+		const size_t s = slot(hash, m_displacements[bucket(hash)]);
+		if (m_keys[s] != key) return nullptr;
+		return &m_values[s * m_num_columns];
+	}
+
+	void stats_table::find_column(const uint64_t *keys, size_t len, size_t column, float *values, float default_value) const {
+		if (m_size == 0) {
+			fill(values, values + len, default_value);
+			return;
+		}
+
+		const size_t group_size = 16;
+		uint64_t hashes[group_size];
+		size_t slots[group_size];
+
+		for (size_t begin = 0; begin < len; begin += group_size) {
+			const size_t end = min(len, begin + group_size);
+
+			for (size_t i = begin; i < end; i++) {
+				hashes[i - begin] = algorithm::mix64(keys[i]);
+				__builtin_prefetch(&m_displacements[bucket(hashes[i - begin])]);
+			}
+			for (size_t i = begin; i < end; i++) {
+				slots[i - begin] = slot(hashes[i - begin], m_displacements[bucket(hashes[i - begin])]);
+				__builtin_prefetch(&m_keys[slots[i - begin]]);
+				__builtin_prefetch(&m_values[slots[i - begin] * m_num_columns + column]);
+			}
+			for (size_t i = begin; i < end; i++) {
+				const size_t s = slots[i - begin];
+				const bool found = m_keys[s] == keys[i] && keys[i] != m_empty_key;
+				values[i] = found ? m_values[s * m_num_columns + column] : default_value;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "file/mmap_file.h"
+
+namespace domain_stats {
+
+	/*
+		Frozen table from host hash to a packed row of num_columns floats.
+
+		Keys are placed with a hash and displace perfect hash: the keys are grouped in buckets of about four and every
+		bucket gets a displacement seed that sends all its keys to free slots. A lookup reads one displacement and one
+		slot, the key is stored in the slot to detect misses. The table is built once, written to a binary file and
+		mmapped by read().
+	*/
+	class stats_table {
+
+		public:
+
+			stats_table();
+
+			// Builds the table from keys and num_columns values per key. If a key is duplicated the last row wins.
+			void build(const std::vector<uint64_t> &keys, const std::vector<float> &values, size_t num_columns);
+			void write(const std::string &file_name) const;
+			void read(const std::string &file_name);
+
+			size_t size() const { return m_size; }
+			size_t num_columns() const { return m_num_columns; }
+
+			// Returns the row of key or nullptr if the key is not in the table.
+			const float *find(uint64_t key) const;
+
+			/*
+				Looks up a whole block of keys. Sets values[i] to the column of keys[i] or to default_value if the key is
+				not in the table. The memory for every group of keys is prefetched before it is read.
+			*/
+			void find_column(const uint64_t *keys, size_t len, size_t column, float *values,
+				float default_value = 0.0f) const;
+
+		private:
+
+			size_t m_size = 0;
+			size_t m_num_columns = 0;
+			size_t m_num_buckets = 0;
+			size_t m_num_slots = 0;
+			uint64_t m_empty_key = 0;
+
+			const uint32_t *m_displacements = nullptr;
+			const uint64_t *m_keys = nullptr;
+			const float *m_values = nullptr;
+
+			std::vector<uint32_t> m_displacement_memory;
+			std::vector<uint64_t> m_key_memory;
+			std::vector<float> m_value_memory;
+			std::unique_ptr<file::mmap_file> m_file;
+
+			size_t bucket(uint64_t hash) const;
+			size_t slot(uint64_t hash, uint32_t displacement) const;
+
+	};
+
+}
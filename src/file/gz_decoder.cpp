@@ -0,0 +1,322 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gz_decoder.h"
+#include "config.h"
+#include "utils/scheduler.hpp"
+#include <cstring>
+#include <climits>
+#include <memory>
+#include "zlib.h"
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+using namespace std;
+
+namespace file {
+
+	namespace {
+
+		enum class member_status { complete, incomplete, bad };
+
+		/*
+			Inflates single gzip members. Keeps the zlib (and libdeflate) state between members so we don't allocate
+			a new window for every record.
+		*/
+		class member_inflater {
+
+			public:
+
+				member_inflater() {
+					memset(&m_zstream, 0, sizeof(m_zstream));
+					m_initialized = inflateInit2(&m_zstream, 15 + 16) == Z_OK;
+					#ifdef HAVE_LIBDEFLATE
+					m_decompressor = libdeflate_alloc_decompressor();
+					#endif
+				}
+
+				~member_inflater() {
+					if (m_initialized) inflateEnd(&m_zstream);
+					#ifdef HAVE_LIBDEFLATE
+					if (m_decompressor) libdeflate_free_decompressor(m_decompressor);
+					#endif
+				}
+
+				/*
+					Inflates the member starting at data and appends the result to output. Sets consumed to the
+					compressed size of the member. Output is left untouched if the member is not complete.
+				*/
+				member_status inflate_member(const char *data, size_t len, string &output, size_t &consumed) {
+					#ifdef HAVE_LIBDEFLATE
+					if (m_decompressor && inflate_member_libdeflate(data, len, output, consumed)) {
+						return member_status::complete;
+					}
+					// libdeflate cannot tell truncated from corrupt data, so let zlib have a look.
+					#endif
+					return inflate_member_zlib(data, len, output, consumed);
+				}
+
+			private:
+
+				z_stream m_zstream;
+				bool m_initialized;
+				vector<char> m_buffer = vector<char>(256*1024);
+
+				#ifdef HAVE_LIBDEFLATE
+				libdeflate_decompressor *m_decompressor;
+
+				/*
+					libdeflate needs the whole member in one buffer. Members are inflated into this uninitialized
+					buffer and only the actual output is appended, resizing output to the buffer size would zero
+					fill it for every member.
+				*/
+				unique_ptr<char[]> m_member_buffer;
+				size_t m_member_buffer_len = 0;
+
+				bool inflate_member_libdeflate(const char *data, size_t len, string &output, size_t &consumed) {
+					if (m_member_buffer_len == 0) {
+						m_member_buffer_len = 1024*1024;
+						m_member_buffer.reset(new char[m_member_buffer_len]);
+					}
+					while (true) {
+						size_t actual_in = 0, actual_out = 0;
+						libdeflate_result res = libdeflate_gzip_decompress_ex(m_decompressor, data, len,
+							m_member_buffer.get(), m_member_buffer_len, &actual_in, &actual_out);
+						if (res == LIBDEFLATE_SUCCESS) {
+							output.append(m_member_buffer.get(), actual_out);
+							consumed = actual_in;
+							return true;
+						}
+						if (res != LIBDEFLATE_INSUFFICIENT_SPACE) {
+							return false;
+						}
+						m_member_buffer_len *= 2;
+						m_member_buffer.reset(new char[m_member_buffer_len]);
+					}
+				}
+				#endif
+
+				member_status inflate_member_zlib(const char *data, size_t len, string &output, size_t &consumed) {
+					if (!m_initialized) return member_status::bad;
+
+					inflateReset(&m_zstream);
+
+					const size_t output_start = output.size();
+
+					m_zstream.next_in = (unsigned char *)data;
+					m_zstream.avail_in = (uInt)min(len, (size_t)UINT_MAX);
+
+					while (true) {
+						m_zstream.next_out = (unsigned char *)m_buffer.data();
+						m_zstream.avail_out = (uInt)m_buffer.size();
+
+						int ret = inflate(&m_zstream, Z_NO_FLUSH);
+						output.append(m_buffer.data(), m_buffer.size() - m_zstream.avail_out);
+
+						if (ret == Z_STREAM_END) {
+							consumed = (const char *)m_zstream.next_in - data;
+							return member_status::complete;
+						}
+						if (ret != Z_OK && ret != Z_BUF_ERROR) {
+							output.resize(output_start);
+							return member_status::bad;
+						}
+						if (m_zstream.avail_in == 0 && m_zstream.avail_out > 0) {
+							// Ran out of input before the end of the member.
+							output.resize(output_start);
+							return member_status::incomplete;
+						}
+					}
+				}
+
+		};
+
+		struct range_result {
+			string m_output;
+			vector<size_t> m_member_ends;
+			size_t m_end = 0;
+			bool m_error = false;
+		};
+
+		/*
+			Returns the position of the first real member header in [from, to) or string::npos.
+		*/
+		size_t find_member_start(const char *data, size_t len, size_t from, size_t to) {
+			member_inflater inflater;
+			string scratch;
+			size_t pos = from;
+			while (pos < to) {
+				const char *ptr = (const char *)memchr(data + pos, 0x1f, to - pos);
+				if (ptr == nullptr) break;
+				const size_t offset = ptr - data;
+				// Magic bytes, deflate compression method and no reserved flag bits set.
+				if (offset + 4 <= len && (unsigned char)data[offset + 1] == 0x8b && data[offset + 2] == 8 &&
+					((unsigned char)data[offset + 3] & 0xe0) == 0) {
+					size_t consumed;
+					scratch.clear();
+					if (inflater.inflate_member(data + offset, len - offset, scratch, consumed) == member_status::complete) {
+						return offset;
+					}
+				}
+				pos = offset + 1;
+			}
+			return string::npos;
+		}
+
+		/*
+			Inflates all members starting in [start, end). The last member is allowed to continue past end.
+		*/
+		void decode_range(const char *data, size_t len, size_t start, size_t end, range_result &result) {
+			member_inflater inflater;
+			size_t pos = start;
+			while (pos < end) {
+				size_t consumed;
+				member_status status = inflater.inflate_member(data + pos, len - pos, result.m_output, consumed);
+				if (status == member_status::bad) {
+					result.m_error = true;
+					break;
+				}
+				if (status == member_status::incomplete) break;
+				result.m_member_ends.push_back(result.m_output.size());
+				pos += consumed;
+			}
+			result.m_end = pos;
+		}
+
+		void emit_members(const range_result &result, const function<void(const char *, size_t)> &callback) {
+			size_t prev = 0;
+			for (size_t member_end : result.m_member_ends) {
+				callback(result.m_output.data() + prev, member_end - prev);
+				prev = member_end;
+			}
+		}
+
+	}
+
+	gz_decoder::gz_decoder(size_t num_threads)
+	: m_num_threads(max(num_threads, (size_t)1)) {
+	}
+
+	gz_decoder::~gz_decoder() {
+	}
+
+	size_t gz_decoder::decode(const char *data, size_t len, const function<void(const char *, size_t)> &callback) {
+
+		m_error = false;
+		if (len == 0) return 0;
+
+		const size_t num_ranges = min(m_num_threads, max(len / m_min_bytes_per_thread, (size_t)1));
+
+		if (num_ranges == 1) {
+			range_result result;
+			decode_range(data, len, 0, len, result);
+			emit_members(result, callback);
+			m_error = result.m_error;
+			return result.m_end;
+		}
+
+		vector<size_t> starts(num_ranges + 1, string::npos);
+		starts[0] = 0;
+		starts[num_ranges] = len;
+
+		utils::task_group tasks;
+		for (size_t i = 1; i < num_ranges; i++) {
+			tasks.run([data, len, num_ranges, i, &starts]() {
+				starts[i] = find_member_start(data, len, (i * len) / num_ranges, ((i + 1) * len) / num_ranges);
+			});
+		}
+		tasks.wait();
+
+		// Ranges without any member start are empty, the range before them will decode their data.
+		for (size_t i = num_ranges - 1; i > 0; i--) {
+			if (starts[i] == string::npos) starts[i] = starts[i + 1];
+		}
+
+		vector<range_result> results(num_ranges);
+		for (size_t i = 0; i < num_ranges; i++) {
+			if (starts[i] == starts[i + 1]) continue;
+			tasks.run([data, len, i, &starts, &results]() {
+				decode_range(data, len, starts[i], starts[i + 1], results[i]);
+			});
+		}
+		tasks.wait();
+
+		/*
+			Every range has to end exactly where the next one starts. Anything else means that a range start was not
+			a real member boundary (or the data is broken), then we just decode everything on this thread.
+		*/
+		size_t pos = 0;
+		bool consistent = true;
+		vector<size_t> used_ranges;
+		for (size_t i = 0; i < num_ranges; i++) {
+			if (starts[i] == starts[i + 1]) continue;
+			if (starts[i] != pos) {
+				consistent = false;
+				break;
+			}
+			used_ranges.push_back(i);
+			pos = results[i].m_end;
+			if (results[i].m_error) {
+				m_error = true;
+				break;
+			}
+		}
+
+		if (!consistent) {
+			range_result result;
+			decode_range(data, len, 0, len, result);
+			emit_members(result, callback);
+			m_error = result.m_error;
+			return result.m_end;
+		}
+
+		for (size_t i : used_ranges) {
+			emit_members(results[i], callback);
+		}
+
+		return pos;
+	}
+
+	string gz_decompress(const string &data, bool &error) {
+		gz_decoder decoder(config::gz_num_threads_decoding);
+		string result;
+		const size_t consumed = decoder.decode(data.data(), data.size(), [&result](const char *member, size_t len) {
+			result.append(member, len);
+		});
+		error = decoder.error() || consumed != data.size();
+		return result;
+	}
+
+	void gz_decompress_to_stream(const string &data, ostream &output_stream, bool &error) {
+		gz_decoder decoder(config::gz_num_threads_decoding);
+		const size_t consumed = decoder.decode(data.data(), data.size(), [&output_stream](const char *member, size_t len) {
+			output_stream.write(member, len);
+		});
+		error = decoder.error() || consumed != data.size();
+	}
+
+}
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <string>
+
+namespace file {
+
+	/*
+		Decoder for multi-member gzip data, like the commoncrawl WARC files where every record is its own gzip member.
+
+		The input is split into one range per thread and every thread finds the first real member header in its range.
+		A candidate header is only accepted if a complete member (including the crc32 trailer) inflates from it. The
+		threads then inflate their members in parallel and the callback is called with the decompressed members in
+		the original order.
+
+		If compiled with HAVE_LIBDEFLATE the members are inflated with libdeflate, otherwise with zlib.
+	*/
+	class gz_decoder {
+
+		public:
+
+			explicit gz_decoder(size_t num_threads);
+			~gz_decoder();
+
+			/*
+				Decodes all complete members in data and calls callback(data, len) once for every member, in order.
+				Returns the number of bytes consumed. Everything after that is the beginning of a member that continues
+				in the next chunk of data, so the caller should keep it and prepend it to the next call.
+				If the data is corrupt decoding stops at the bad member and error() returns true.
+			*/
+			size_t decode(const char *data, size_t len, const std::function<void(const char *, size_t)> &callback);
+
+			bool error() const { return m_error; };
+
+		private:
+
+			size_t m_num_threads;
+			bool m_error = false;
+
+			const size_t m_min_bytes_per_thread = 1024*1024;
+
+	};
+
+	/*
+		Decompress a complete gzip buffer (single or multi member). Sets error to true if the data is not valid gzip.
+	*/
+	std::string gz_decompress(const std::string &data, bool &error);
+	void gz_decompress_to_stream(const std::string &data, std::ostream &output_stream, bool &error);
+
+}
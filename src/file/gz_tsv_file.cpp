@@ -25,9 +25,8 @@
  */
 
 #include "gz_tsv_file.h"
+#include "gz_decoder.h"
 #include <exception>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 #include <boost/algorithm/string.hpp>
 
 using namespace std;
@@ -41,14 +40,16 @@ namespace file {
 	gz_tsv_file::gz_tsv_file(const string &file_name) {
 		m_file_name = file_name;
 
-		ifstream infile(m_file_name);
+		ifstream infile(m_file_name, ios::binary);
 
 		if (infile.is_open()) {
-			boost::iostreams::filtering_istream decompress_stream;
-			decompress_stream.push(boost::iostreams::gzip_decompressor());
-			decompress_stream.push(infile);
+			const string compressed = string(istreambuf_iterator<char>(infile), {});
 
-			m_data = string(istreambuf_iterator<char>(decompress_stream), {});
+			bool error;
+			m_data = gz_decompress(compressed, error);
+			if (error) {
+				throw runtime_error("Could not decompress file: " + m_file_name);
+			}
 		}
 	}
 
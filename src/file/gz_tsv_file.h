@@ -34,8 +34,6 @@
 #include <map>
 #include <string.h>
 
-#define TSV_FILE_DESTINATION "/mnt/0"
-
 namespace file {
 
 	class gz_tsv_file {
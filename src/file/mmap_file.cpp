@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mmap_file.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace file {
+
+	mmap_file::mmap_file(const std::string &file_name) {
+		const int fd = open(file_name.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Could not open file " + file_name);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			throw std::runtime_error("Could not stat file " + file_name);
+		}
+		m_size = st.st_size;
+		if (m_size == 0) {
+			close(fd);
+			return;
+		}
+
+		void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+		// The mapping stays valid after the file is closed, so many files can be mapped without using up descriptors.
+		close(fd);
+		if (ptr == MAP_FAILED) {
+			throw std::runtime_error("Could not mmap file " + file_name);
+		}
+		madvise(ptr, m_size, MADV_WILLNEED);
+		m_data = (const char *)ptr;
+	}
+
+	mmap_file::~mmap_file() {
+		if (m_data) {
+			munmap((void *)m_data, m_size);
+		}
+	}
+
+}
@@ -11,10 +11,10 @@
  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
  * copies of the Software, and to permit persons to whom the Software is
  * furnished to do so, subject to the following conditions:
- *
+ * 
  * The above copyright notice and this permission notice shall be included in all
  * copies or substantial portions of the Software.
- *
+ * 
  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
@@ -26,33 +26,32 @@
 
 #pragma once
 
-#include <iostream>
-#include <thread>
-#include <future>
-#include <queue>
+#include <string>
+#include <cstddef>
 
-namespace common {
+namespace file {
 
-	class simple_thread_pool {
+	/*
+		Read only memory mapping of a whole file. Throws std::runtime_error if the file can not be mapped.
+	*/
+	class mmap_file {
 
 		public:
 
-			explicit simple_thread_pool(size_t);
-			~simple_thread_pool();
-
-			void enqueue(std::function<void()> &&fun);
+			explicit mmap_file(const std::string &file_name);
+			~mmap_file();
 
-		private:
+			mmap_file(const mmap_file &) = delete;
+			mmap_file &operator=(const mmap_file &) = delete;
 
-			void handle_work();
+			const char *data() const { return m_data; }
+			size_t size() const { return m_size; }
 
-			std::vector<std::thread> m_workers;
-			std::queue<std::function<void()>> m_queue;
+		private:
 
-			std::mutex m_queue_lock;
-			std::condition_variable m_condition;
-			bool m_stop = false;
+			const char *m_data = nullptr;
+			size_t m_size = 0;
 
 	};
-	
+
 }
@@ -27,6 +27,7 @@
 #include "tsv_file_remote.h"
 #include "logger/logger.h"
 #include "transfer/transfer.h"
+#include "storage/storage.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -57,7 +58,7 @@ namespace file {
 	}
 
 	string tsv_file_remote::get_path() const {
-		return string(TSV_FILE_DESTINATION) + "/" + m_file_name;
+		return storage::primary_path(m_file_name);
 	}
 
 	int tsv_file_remote::download_file() {
@@ -34,6 +34,8 @@
 #include "search_engine/search_engine.h"
 #include "hash_table_helper/hash_table_helper.h"
 #include "url_store/url_store.h"
+#include "storage/storage.h"
+#include <boost/filesystem.hpp>
 
 using namespace std;
 
@@ -44,10 +46,11 @@ namespace full_text {
 	void truncate_url_to_domain(const string &index_name) {
 
 		for (size_t bucket_id = 0; bucket_id < 8; bucket_id++) {
-			const string file_name = "/mnt/"+to_string(bucket_id)+"/full_text/url_to_domain_"+index_name+".fti";
+			const string file_name = url_to_domain::bucket_file_name(index_name, bucket_id);
 			ofstream outfile(file_name, ios::binary | ios::trunc);
 			outfile.close();
 		}
+		boost::filesystem::remove(url_to_domain::table_file_name(index_name));
 
 	}
 
@@ -127,8 +130,8 @@ namespace full_text {
 
 	bool is_indexed() {
 
-		// First check if file /mnt/0/indexed exists.
-		ifstream infile("/mnt/0/indexed");
+		// First check if the file indexed exists on the first storage device.
+		ifstream infile(storage::primary_path("indexed"));
 		if (infile.is_open()) {
 			return true;
 		}
@@ -140,7 +143,7 @@ namespace full_text {
 	}
 
 	void mark_indexed() {
-		ofstream outfile("/mnt/0/indexed", ios::trunc);
+		ofstream outfile(storage::primary_path("indexed"), ios::trunc);
 		if (outfile.is_open()) {
 			outfile << 1;
 		}
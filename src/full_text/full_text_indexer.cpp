@@ -28,6 +28,7 @@
 #include "full_text.h"
 #include "logger/logger.h"
 #include "text/text.h"
+#include "utils/scheduler.hpp"
 #include <math.h>
 
 using namespace std;
@@ -45,6 +46,13 @@ namespace full_text {
 		}
 	}
 
+	full_text_indexer::full_text_indexer(int id, const string &db_name, const common::sub_system *sub_system, url_to_domain *url_to_domain,
+			full_text_shard_writer *shard_writer)
+	: m_indexer_id(id), m_db_name(db_name), m_sub_system(sub_system), m_url_to_domain(url_to_domain), m_shard_writer(shard_writer),
+		m_partitions(shard_writer->num_writers())
+	{
+	}
+
 	full_text_indexer::~full_text_indexer() {
 		for (full_text_shard_builder<struct full_text_record> *shard : m_shards) {
 			delete shard;
@@ -58,16 +66,16 @@ namespace full_text {
 		size_t added_urls = 0;
 		const size_t check_for_full_shards_every = 1000;
 		while (getline(stream, line)) {
-			vector<string> col_values;
-			boost::algorithm::split(col_values, line, boost::is_any_of("\t"));
+			text::split_view(line, m_columns);
 
-			URL url(col_values[0]);
+			const url_view url(m_columns[0]);
 
 			float harmonic = url.harmonic(m_sub_system);
 
-			m_url_to_domain->add_url(url.hash(), url.host_hash());
+			const uint64_t key_hash = url.hash();
+			const uint64_t domain_hash = url.host_hash();
 
-			uint64_t key_hash = url.hash();
+			m_url_to_domain->add_url(key_hash, domain_hash);
 
 			if (config::index_snippets) {
 				shard_builders[key_hash % config::ht_num_shards]->add(key_hash, line + "\t" + batch);
@@ -75,33 +83,33 @@ namespace full_text {
 
 			if (config::index_text) {
 
-				const string site_colon = "site:" + url.host() + " site:www." + url.host() + " " + url.host() + " " + url.domain_without_tld();
+				m_site_buffer.assign("site:").append(url.host()).append(" site:www.").append(url.host()).append(" ")
+					.append(url.host()).append(" ").append(url.domain_without_tld());
 
 				size_t score_index = 0;
-				map<uint64_t, float> word_map;
+				m_word_map.clear();
 
-				add_data_to_word_map(word_map, site_colon, 20*harmonic);
+				add_data_to_word_map(m_site_buffer, 20*harmonic);
 
 				for (size_t col_index : cols) {
-					add_expanded_data_to_word_map(word_map, col_values[col_index], scores[score_index]*harmonic);
+					add_expanded_data_to_word_map(m_columns[col_index], scores[score_index]*harmonic);
 					score_index++;
 				}
-				for (const auto &iter : word_map) {
-					const uint64_t word_hash = iter.first;
-					const size_t shard_id = word_hash % config::ft_num_shards;
-					m_shards[shard_id]->add(word_hash, full_text_record{.m_value = key_hash, .m_score = iter.second, .m_domain_hash = url.host_hash()});
+				for (const auto &iter : m_word_map) {
+					add_record(iter.first, full_text_record{.m_value = key_hash, .m_score = iter.second, .m_domain_hash = domain_hash});
 				}
-				word_map.clear();
 			}
 
 			added_urls++;
 
-			if (added_urls % check_for_full_shards_every == 0) {
+			if (!m_shard_writer && added_urls % check_for_full_shards_every == 0) {
 				write_cache(write_mutex);
 			}
 		}
 
-		write_cache(write_mutex);
+		if (!m_shard_writer) {
+			write_cache(write_mutex);
+		}
 
 		return added_urls;
 	}
@@ -118,18 +126,15 @@ namespace full_text {
 		if (full_shards.size()) {
 			write_mutex.lock();
 
-			ThreadPool pool(config::ft_num_threads_appending);
-			std::vector<std::future<void>> results;
+			utils::task_group tasks(utils::priority::background);
 			for (full_text_shard_builder<struct full_text_record> *shard : full_shards) {
-				results.emplace_back(pool.enqueue([shard] {
+				tasks.run([shard] {
 					shard->append();
-				}));
-			}
-			
-			for (auto &fut : results) {
-				fut.get();
+				});
 			}
-		
+
+			tasks.wait();
+
 			write_mutex.unlock();
 		}
 
@@ -137,6 +142,7 @@ namespace full_text {
 	}
 
 	void full_text_indexer::flush_cache(vector<mutex> &write_mutexes) {
+		flush_partitions();
 		size_t idx = 0;
 		for (full_text_shard_builder<struct full_text_record> *shard : m_shards) {
 			write_mutexes[idx].lock();
@@ -147,6 +153,17 @@ namespace full_text {
 		}
 	}
 
+	/*
+		Hands over the partially filled partitions to the shard writer.
+	*/
+	void full_text_indexer::flush_partitions() {
+		if (!m_shard_writer) return;
+		for (size_t writer_id = 0; writer_id < m_partitions.size(); writer_id++) {
+			m_shard_writer->push(writer_id, std::move(m_partitions[writer_id]));
+			m_partitions[writer_id] = full_text_shard_writer::batch{};
+		}
+	}
+
 	void full_text_indexer::read_url_to_domain() {
 		m_url_to_domain->read();
 	}
@@ -155,38 +172,36 @@ namespace full_text {
 		m_url_to_domain->write(m_indexer_id);
 	}
 
-	void full_text_indexer::add_expanded_data_to_word_map(map<uint64_t, float> &word_map, const string &text, float score) const {
+	void full_text_indexer::add_expanded_data_to_word_map(string_view text, float score) {
 
-		vector<string> words = text::get_expanded_full_text_words(text);
-		map<uint64_t, uint64_t> uniq;
+		text::get_expanded_full_text_words(text, m_word_buffer, m_words);
+		m_uniq.clear();
 
 		if (config::n_grams > 1) {
-			text::words_to_ngram_hash(words, config::n_grams, [&word_map, &uniq, score](const uint64_t hash) {
-				if (uniq.find(hash) == uniq.end()) {
-					word_map[hash] += score;
-					uniq[hash] = hash;
+			text::words_to_ngram_hash(m_words, config::n_grams, [this, score](const uint64_t hash) {
+				if (m_uniq.insert(hash, true)) {
+					m_word_map[hash] += score;
 				}
 			});
 		} else {
-			for (const string &word : words) {
-				const uint64_t word_hash = algorithm::hash(word);
-				if (uniq.find(word_hash) == uniq.end()) {
-					word_map[word_hash] += score;
-					uniq[word_hash] = word_hash;
+			for (std::string_view word : m_words) {
+				const uint64_t word_hash = algorithm::murmur_hash(word.data(), word.size());
+				if (m_uniq.insert(word_hash, true)) {
+					m_word_map[word_hash] += score;
 				}
 			}
 		}
 	}
 
-	void full_text_indexer::add_data_to_word_map(map<uint64_t, float> &word_map, const string &text, float score) const {
+	void full_text_indexer::add_data_to_word_map(string_view text, float score) {
 
-		vector<string> words = text::get_full_text_words(text);
-		map<uint64_t, uint64_t> uniq;
-		for (const string &word : words) {
+		text::get_full_text_words(text, m_word_buffer, m_words);
+		m_uniq.clear();
+
+		for (std::string_view word : m_words) {
 			const uint64_t word_hash = m_hasher(word);
-			if (uniq.find(word_hash) == uniq.end()) {
-				word_map[word_hash] += score;
-				uniq[word_hash] = word_hash;
+			if (m_uniq.insert(word_hash, true)) {
+				m_word_map[word_hash] += score;
 			}
 		}
 	}
@@ -197,9 +212,24 @@ namespace full_text {
 		for (const string &word : words) {
 
 			const uint64_t word_hash = m_hasher(word);
-			const size_t shard_id = word_hash % config::ft_num_shards;
+			add_record(word_hash, full_text_record{.m_value = url.hash(), .m_score = score, .m_domain_hash = url.host_hash()});
+		}
+	}
 
-			m_shards[shard_id]->add(word_hash, full_text_record{.m_value = url.hash(), .m_score = score, .m_domain_hash = url.host_hash()});
+	void full_text_indexer::add_record(uint64_t word_hash, const full_text_record &record) {
+		if (m_shard_writer) {
+			const size_t writer_id = m_shard_writer->writer_for_key(word_hash);
+			full_text_shard_writer::batch &partition = m_partitions[writer_id];
+			if (partition.capacity() == 0) {
+				partition.reserve(m_partition_batch_size);
+			}
+			partition.emplace_back(word_hash, record);
+			if (partition.size() >= m_partition_batch_size) {
+				m_shard_writer->push(writer_id, std::move(partition));
+				partition = full_text_shard_writer::batch{};
+			}
+		} else {
+			m_shards[word_hash % config::ft_num_shards]->add(word_hash, record);
 		}
 	}
 }
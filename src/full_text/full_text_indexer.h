@@ -36,13 +36,16 @@ class full_text_indexer;
 
 #include "full_text_shard.h"
 #include "full_text_shard_builder.h"
+#include "full_text_shard_writer.h"
 #include "full_text_index.h"
 #include "url_to_domain.h"
 #include "URL.h"
+#include "url_view.h"
 #include "common/sub_system.h"
 #include "hash_table/hash_table_shard_builder.h"
 #include "url_link/link.h"
 #include "full_text_record.h"
+#include "algorithm/hash_map.h"
 
 namespace full_text {
 
@@ -51,6 +54,8 @@ namespace full_text {
 		public:
 
 			full_text_indexer(int id, const std::string &db_name, const common::sub_system *sub_system, url_to_domain *url_to_domain);
+			full_text_indexer(int id, const std::string &db_name, const common::sub_system *sub_system, url_to_domain *url_to_domain,
+				full_text_shard_writer *shard_writer);
 			~full_text_indexer();
 
 			size_t add_stream(std::vector<hash_table::hash_table_shard_builder *> &shard_builders, std::basic_istream<char> &stream,
@@ -58,19 +63,18 @@ namespace full_text {
 			size_t write_cache(std::mutex &write_mutex);
 			size_t write_large(std::vector<std::mutex> &write_mutexes);
 			void flush_cache(std::vector<std::mutex> &write_mutexes);
+			void flush_partitions();
 			void read_url_to_domain();
 			void write_url_to_domain();
 			void add_domain_link(uint64_t word_hash, const url_link::link &link);
 			void add_url_link(uint64_t word_hash, const url_link::link &link);
 
 			bool has_key(uint64_t key) const {
-				return m_url_to_domain->get_url_to_domain().count(key) > 0;
+				return m_url_to_domain->has_url(key);
 			}
 
 			bool has_domain(uint64_t domain_hash) const {
-				auto iter = m_url_to_domain->domains().find(domain_hash);
-				if (iter == m_url_to_domain->domains().end()) return false;
-				return iter->second > 0;
+				return m_url_to_domain->has_domain(domain_hash);
 			}
 
 			const url_to_domain *get_url_to_domain() const {
@@ -82,14 +86,35 @@ namespace full_text {
 			int m_indexer_id;
 			const std::string m_db_name;
 			const common::sub_system *m_sub_system;
-			std::hash<std::string> m_hasher;
+			std::hash<std::string_view> m_hasher;
 			std::vector<full_text_shard_builder<struct full_text_record> *> m_shards;
 
 			url_to_domain *m_url_to_domain = NULL;
 
-			void add_expanded_data_to_word_map(std::map<uint64_t, float> &word_map, const std::string &text, float score) const;
-			void add_data_to_word_map(std::map<uint64_t, float> &word_map, const std::string &text, float score) const;
+			/*
+				When a shard writer is given the records are not added to own shard builders but partitioned per
+				writer thread into m_partitions and handed over in batches of m_partition_batch_size.
+			*/
+			full_text_shard_writer *m_shard_writer = NULL;
+			std::vector<full_text_shard_writer::batch> m_partitions;
+			const size_t m_partition_batch_size = 10000;
+
+			/*
+				Scratch space for add_stream, reused for every document so the indexing loop does not allocate.
+				m_word_map holds the score per word hash for the current document and m_uniq the words already
+				seen in the current column.
+			*/
+			algorithm::hash_map<float> m_word_map;
+			algorithm::hash_map<bool> m_uniq;
+			std::string m_word_buffer;
+			std::vector<std::string_view> m_words;
+			std::vector<std::string_view> m_columns;
+			std::string m_site_buffer;
+
+			void add_expanded_data_to_word_map(std::string_view text, float score);
+			void add_data_to_word_map(std::string_view text, float score);
 			void add_data_to_shards(const URL &url, const std::string &text, float score);
+			void add_record(uint64_t word_hash, const full_text_record &record);
 
 	};
 
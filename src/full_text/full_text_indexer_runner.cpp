@@ -42,8 +42,7 @@ namespace full_text {
 		m_cc_batch(cc_batch),
 		m_db_name(db_name),
 		m_hash_table_name(hash_table_name),
-		m_hash_table_mutexes(config::ft_num_shards),
-		m_full_text_mutexes(config::ft_num_shards)
+		m_hash_table_mutexes(config::ft_num_shards)
 	{
 		m_sub_system = sub_system;
 		m_did_allocate_sub_system = false;
@@ -54,8 +53,7 @@ namespace full_text {
 		m_cc_batch(cc_batch),
 		m_db_name(db_name),
 		m_hash_table_name(hash_table_name),
-		m_hash_table_mutexes(config::ft_num_shards),
-		m_full_text_mutexes(config::ft_num_shards)
+		m_hash_table_mutexes(config::ft_num_shards)
 	{
 		m_sub_system = new common::sub_system();
 		m_did_allocate_sub_system = true;
@@ -66,8 +64,7 @@ namespace full_text {
 		m_cc_batch("none"),
 		m_db_name(db_name),
 		m_hash_table_name(hash_table_name),
-		m_hash_table_mutexes(config::ft_num_shards),
-		m_full_text_mutexes(config::ft_num_shards)
+		m_hash_table_mutexes(config::ft_num_shards)
 	{
 		m_sub_system = sub_system;
 		m_did_allocate_sub_system = false;
@@ -83,6 +80,12 @@ namespace full_text {
 
 		truncate_cache();
 
+		/*
+			The indexing threads read and tokenize the files and partition the records over the writer threads of
+			shard_writer, which own the full text shard builders and append them to the cache files.
+		*/
+		full_text_shard_writer shard_writer(m_db_name, config::ft_num_threads_appending);
+
 		ThreadPool pool(config::ft_num_threads_indexing);
 		std::vector<std::future<string>> results;
 
@@ -93,8 +96,8 @@ namespace full_text {
 		for (const vector<string> &chunk : chunks) {
 
 			results.emplace_back(
-				pool.enqueue([this, chunk, id] {
-					return run_index_thread_with_local_files(chunk, id);
+				pool.enqueue([this, chunk, id, &shard_writer] {
+					return run_index_thread_with_local_files(chunk, id, shard_writer);
 				})
 			);
 
@@ -106,6 +109,8 @@ namespace full_text {
 			result.get();
 		}
 
+		shard_writer.close();
+
 		merge();
 		sort();
 	}
@@ -161,7 +166,8 @@ namespace full_text {
 
 	}
 
-	string full_text_indexer_runner::run_index_thread_with_local_files(const vector<string> &local_files, int id) {
+	string full_text_indexer_runner::run_index_thread_with_local_files(const vector<string> &local_files, int id,
+			full_text_shard_writer &shard_writer) {
 
 		vector<hash_table::hash_table_shard_builder *> shard_builders;
 		for (size_t i = 0; i < config::ht_num_shards; i++) {
@@ -169,7 +175,7 @@ namespace full_text {
 		}
 
 		url_to_domain url_to_domain(m_db_name);
-		full_text_indexer indexer(id, m_db_name, m_sub_system, &url_to_domain);
+		full_text_indexer indexer(id, m_db_name, m_sub_system, &url_to_domain, &shard_writer);
 		size_t idx = 1;
 		for (const string &local_file : local_files) {
 
@@ -193,8 +199,8 @@ namespace full_text {
 
 			idx++;
 		}
-		LOG_INFO("Done with all, flushing cache");
-		indexer.flush_cache(m_full_text_mutexes);
+		LOG_INFO("Done with all, flushing partitions");
+		indexer.flush_partitions();
 
 		LOG_INFO("Done, writing hash table shards");
 		for (size_t i = 0; i < config::ht_num_shards; i++) {
@@ -32,6 +32,7 @@
 #include "common/ThreadPool.h"
 #include "hash_table/hash_table.h"
 #include "full_text_record.h"
+#include "full_text_shard_writer.h"
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/copy.hpp>
@@ -62,13 +63,13 @@ namespace full_text {
 			const common::sub_system *m_sub_system;
 
 			std::vector<std::mutex> m_hash_table_mutexes;
-			std::vector<std::mutex> m_full_text_mutexes;
 			std::mutex m_write_mutex;
 			std::mutex m_write_url_to_domain_mutex;
 
 			bool m_did_allocate_sub_system;
 
-			std::string run_index_thread_with_local_files(const std::vector<std::string> &local_files, int id);
+			std::string run_index_thread_with_local_files(const std::vector<std::string> &local_files, int id,
+				full_text_shard_writer &shard_writer);
 			std::string run_merge_thread(size_t shard_id);
 
 	};
@@ -65,7 +65,7 @@ namespace full_text {
 			bool has_next_section();
 			size_t num_sections();
 			void close_sections();
-			void copy_vector(const std::vector<data_record> &vec);
+			void copy_vector(std::span<const data_record> vec);
 
 		private:
 
@@ -163,7 +163,7 @@ namespace full_text {
 	}
 
 	template<typename data_record>
-	void full_text_result_set<data_record>::copy_vector(const std::vector<data_record> &vec) {
+	void full_text_result_set<data_record>::copy_vector(std::span<const data_record> vec) {
 		memcpy(&m_data_pointer[0], vec.data(), vec.size() * sizeof(data_record));
 		resize(vec.size());
 	}
@@ -43,6 +43,8 @@ namespace full_text {
 #include "full_text_result_set.h"
 
 #include "logger/logger.h"
+#include "storage/storage.h"
+#include "indexer/key_filter.h"
 #include "profiler/profiler.h"
 
 /*
@@ -73,6 +75,7 @@ namespace full_text {
 			std::string mountpoint() const;
 			std::string filename() const;
 			std::string key_filename() const;
+			std::string filter_filename() const;
 			size_t shard_id() const;
 			bool empty() const;
 
@@ -82,12 +85,13 @@ namespace full_text {
 
 			std::string m_db_name;
 			size_t m_shard_id;
+			std::string m_mountpoint;
 		
 	};
 
 	template<typename data_record>
 	full_text_shard<data_record>::full_text_shard(const std::string &db_name, size_t shard)
-	: m_db_name(db_name), m_shard_id(shard) {
+	: m_db_name(db_name), m_shard_id(shard), m_mountpoint(storage::device_root(storage::shard_device("fti_" + db_name, shard))) {
 	}
 
 	template<typename data_record>
@@ -97,6 +101,11 @@ namespace full_text {
 	template<typename data_record>
 	void full_text_shard<data_record>::find(uint64_t key, full_text_result_set<data_record> *result_set) const {
 
+		if (!indexer::key_filter::may_contain(filter_filename(), key)) {
+			result_set->resize(0);
+			return;
+		}
+
 		std::ifstream reader(filename(), std::ios::binary);
 
 		size_t key_pos = read_key_pos(reader, key);
@@ -107,14 +116,14 @@ namespace full_text {
 		}
 
 		// Read page.
-		profiler::instance prof2("read keys");
+		profiler::span prof2("full_text_shard::read keys");
 		reader.seekg(key_pos);
 
 		size_t num_keys;
 		reader.read((char *)&num_keys, sizeof(size_t));
 
 
-		LOG_INFO("num keys: " + std::to_string(num_keys));
+		LOG_DEBUG("num keys: " + std::to_string(num_keys));
 
 		uint64_t *keys = new uint64_t[num_keys];
 
@@ -122,7 +131,7 @@ namespace full_text {
 
 		prof2.stop();
 
-		profiler::instance prof3("find key");
+		profiler::span prof3("full_text_shard::find key");
 
 		size_t key_data_pos = SIZE_MAX;
 		for (size_t i = 0; i < num_keys; i++) {
@@ -140,7 +149,7 @@ namespace full_text {
 
 		char buffer[64];
 
-		profiler::instance prof4("read data");
+		profiler::span prof4("full_text_shard::read data");
 
 		// Read position and length.
 		reader.seekg(key_pos + 8 + num_keys * 8 + key_data_pos * 8, std::ios::beg);
@@ -172,7 +181,7 @@ namespace full_text {
 	template<typename data_record>
 	size_t full_text_shard<data_record>::read_key_pos(std::ifstream &reader, uint64_t key) const {
 
-		profiler::instance prof1("read_key_pos " + key_filename());
+		profiler::span prof1("full_text_shard::read_key_pos");
 
 		const size_t hash_pos = key % config::shard_hash_table_size;
 
@@ -189,6 +198,10 @@ namespace full_text {
 	template<typename data_record>
 	size_t full_text_shard<data_record>::total_num_results(uint64_t key) const {
 
+		if (!indexer::key_filter::may_contain(filter_filename(), key)) {
+			return 0;
+		}
+
 		std::ifstream reader(filename(), std::ios::binary);
 
 		size_t key_pos = read_key_pos(reader, key);
@@ -229,17 +242,22 @@ namespace full_text {
 
 	template<typename data_record>
 	std::string full_text_shard<data_record>::mountpoint() const {
-		return std::to_string(m_shard_id % 8);
+		return m_mountpoint;
 	}
 
 	template<typename data_record>
 	std::string full_text_shard<data_record>::filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".idx";
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".idx";
 	}
 
 	template<typename data_record>
 	std::string full_text_shard<data_record>::key_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".keys";
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".keys";
+	}
+
+	template<typename data_record>
+	std::string full_text_shard<data_record>::filter_filename() const {
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".bloom";
 	}
 
 	template<typename data_record>
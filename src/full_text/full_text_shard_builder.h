@@ -32,6 +32,7 @@
 #include <vector>
 #include <fstream>
 #include <algorithm>
+#include <memory>
 
 namespace full_text {
 	template<typename data_record> class full_text_shard_builder;
@@ -43,6 +44,9 @@ namespace full_text {
 #include "full_text_record.h"
 #include "url_to_domain.h"
 #include "logger/logger.h"
+#include "file/file.h"
+#include "storage/storage.h"
+#include "indexer/key_filter.h"
 
 namespace full_text {
 
@@ -68,7 +72,9 @@ namespace full_text {
 			std::string cache_filename() const;
 			std::string key_cache_filename() const;
 			std::string key_filename() const;
+			std::string filter_filename() const;
 			std::string target_filename() const;
+			std::string run_filename() const;
 
 			void truncate();
 			void truncate_cache_files();
@@ -80,6 +86,7 @@ namespace full_text {
 
 			const std::string m_db_name;
 			const size_t m_shard_id;
+			const std::string m_mountpoint;
 			const size_t m_max_cache_size;
 
 			const size_t m_max_cache_file_size = 300 * 1000 * 1000; // 200mb.
@@ -93,7 +100,35 @@ namespace full_text {
 			std::map<uint64_t, std::vector<data_record>> m_cache;
 			std::map<uint64_t, size_t> m_total_results;
 
-			void read_append_cache();
+			/*
+				Used by merge() to spill the shard to sorted runs and merge them back, ordered by hash table slot,
+				key and value so the merged output comes out one page at a time.
+			*/
+			struct merge_entry {
+				uint64_t m_key;
+				data_record m_record;
+			};
+
+			struct run_reader {
+				std::ifstream m_reader;
+				size_t m_remaining;
+				std::vector<merge_entry> m_buffer;
+				size_t m_pos = 0;
+
+				bool next(merge_entry &entry);
+			};
+
+			static bool merge_order(const merge_entry &a, const merge_entry &b);
+			size_t merge_buffer_len() const;
+			void write_sorted_runs(std::vector<size_t> &run_lengths, std::vector<merge_entry> &memory_run);
+			void add_to_run(const merge_entry &entry, std::vector<merge_entry> &run, std::ofstream &run_writer,
+				std::vector<size_t> &run_lengths);
+			void spill_run(std::vector<merge_entry> &run, std::ofstream &run_writer, std::vector<size_t> &run_lengths);
+			void merge_runs(const std::vector<size_t> &run_lengths, std::vector<merge_entry> &memory_run);
+			void finish_key(uint64_t key, std::vector<data_record> &top, size_t total, std::vector<uint64_t> &page_keys,
+				std::vector<size_t> &page_lens, std::vector<size_t> &page_totals, std::vector<data_record> &page_data) const;
+			size_t write_page(std::ofstream &writer, const std::vector<uint64_t> &keys, const std::vector<size_t> &lens,
+				const std::vector<size_t> &totals, const std::vector<data_record> &data) const;
 			void read_data_to_cache();
 			bool read_page(std::ifstream &reader);
 			void save_file();
@@ -106,12 +141,14 @@ namespace full_text {
 
 	template<typename data_record>
 	full_text_shard_builder<data_record>::full_text_shard_builder(const std::string &db_name, size_t shard_id)
-	: m_db_name(db_name), m_shard_id(shard_id), m_max_cache_size(config::ft_cached_bytes_per_shard() / sizeof(data_record)) {
+	: m_db_name(db_name), m_shard_id(shard_id),
+		m_mountpoint(storage::device_root(storage::shard_device("fti_" + db_name, shard_id))), m_max_cache_size(config::ft_cached_bytes_per_shard() / sizeof(data_record)) {
 	}
 
 	template<typename data_record>
 	full_text_shard_builder<data_record>::full_text_shard_builder(const std::string &db_name, size_t shard_id, size_t bytes_per_shard)
-	: m_db_name(db_name), m_shard_id(shard_id), m_max_cache_size(bytes_per_shard / sizeof(data_record)) {
+	: m_db_name(db_name), m_shard_id(shard_id),
+		m_mountpoint(storage::device_root(storage::shard_device("fti_" + db_name, shard_id))), m_max_cache_size(bytes_per_shard / sizeof(data_record)) {
 	}
 
 	template<typename data_record>
@@ -209,26 +246,54 @@ namespace full_text {
 		m_keys.shrink_to_fit();
 	}
 
+	/*
+		Merges the append cache into the shard file. The previous shard file and the append cache are read as streams
+		and spilled to sorted runs of at most config::ft_max_merge_memory_mb, the runs are then k-way merged and the
+		top ft_max_results_per_section * ft_max_sections results per key are picked on the fly. So the memory used is
+		bounded by the config and the size of the largest page instead of the size of the shard.
+	*/
 	template<typename data_record>
 	void full_text_shard_builder<data_record>::merge() {
 
-		read_append_cache();
-		sort_cache();
-		save_file();
+		m_cache.clear();
+		m_total_results.clear();
+
+		std::vector<size_t> run_lengths;
+		std::vector<merge_entry> memory_run;
+		write_sorted_runs(run_lengths, memory_run);
+		merge_runs(run_lengths, memory_run);
 		truncate_cache_files();
 
 	}
 
 	template<typename data_record>
-	void full_text_shard_builder<data_record>::read_append_cache() {
+	bool full_text_shard_builder<data_record>::merge_order(const merge_entry &a, const merge_entry &b) {
+		const size_t slot_a = a.m_key % config::shard_hash_table_size;
+		const size_t slot_b = b.m_key % config::shard_hash_table_size;
+		if (slot_a != slot_b) return slot_a < slot_b;
+		if (a.m_key != b.m_key) return a.m_key < b.m_key;
+		return a.m_record.m_value < b.m_record.m_value;
+	}
 
-		m_cache.clear();
-		m_total_results.clear();
+	template<typename data_record>
+	size_t full_text_shard_builder<data_record>::merge_buffer_len() const {
+		const size_t min_buffer_len = 1000;
+		return std::max(min_buffer_len, (config::ft_max_merge_memory_mb * 1000ul*1000ul) / sizeof(merge_entry));
+	}
 
-		// Read the current file.
-		read_data_to_cache();
+	/*
+		Reads the current shard file page by page and the append cache in chunks and writes them as sorted runs to
+		run_filename(). The length of each run is pushed to run_lengths. If everything fits in one run it is sorted
+		and returned in memory_run instead and the run file is never written.
+	*/
+	template<typename data_record>
+	void full_text_shard_builder<data_record>::write_sorted_runs(std::vector<size_t> &run_lengths,
+			std::vector<merge_entry> &memory_run) {
+
+		// Opened by spill_run on the first spill.
+		std::ofstream run_writer;
 
-		// Read the cache into memory.
+		std::ifstream target_reader(target_filename(), std::ios::binary);
 		std::ifstream reader(cache_filename(), std::ios::binary);
 		if (!reader.is_open()) {
 			throw LOG_ERROR_EXCEPTION("Could not open full text shard (" + cache_filename() + "). Error: " + std::string(strerror(errno)));
@@ -239,45 +304,271 @@ namespace full_text {
 			throw LOG_ERROR_EXCEPTION("Could not open full text shard (" + key_cache_filename() + "). Error: " + std::string(strerror(errno)));
 		}
 
+		// The file sizes bound the number of records, so small shards do not reserve the whole merge budget.
+		size_t max_records = 0;
+		for (std::ifstream *file : {&target_reader, &reader}) {
+			if (!file->is_open()) continue;
+			file->seekg(0, std::ios::end);
+			max_records += (size_t)file->tellg() / sizeof(data_record);
+			file->seekg(0, std::ios::beg);
+		}
+
+		std::vector<merge_entry> run;
+		run.reserve(std::min(merge_buffer_len(), max_records));
+
+		// Read the current file.
+		if (target_reader.is_open()) {
+			uint64_t num_keys;
+			while (target_reader.read((char *)&num_keys, sizeof(uint64_t))) {
+				std::vector<uint64_t> keys(num_keys);
+				std::vector<size_t> lens(num_keys);
+				target_reader.read((char *)keys.data(), num_keys * sizeof(uint64_t));
+				// Skip the positions, the data is stored in the same order as the keys.
+				target_reader.seekg(num_keys * sizeof(size_t), std::ios::cur);
+				target_reader.read((char *)lens.data(), num_keys * sizeof(size_t));
+				// Skip the totals, they are recalculated from the unique records.
+				target_reader.seekg(num_keys * sizeof(size_t), std::ios::cur);
+
+				for (size_t i = 0; i < num_keys; i++) {
+					merge_entry entry;
+					entry.m_key = keys[i];
+					for (size_t j = 0; j < lens[i] / sizeof(data_record); j++) {
+						if (!target_reader.read((char *)&entry.m_record, sizeof(data_record))) {
+							throw LOG_ERROR_EXCEPTION("Data stopped before end in full text shard (" + target_filename() + ")");
+						}
+						add_to_run(entry, run, run_writer, run_lengths);
+					}
+				}
+			}
+		}
+
+		// Read the append cache.
 		const size_t buffer_len = 100000;
-		const size_t buffer_size = sizeof(data_record) * buffer_len;
-		const size_t key_buffer_size = sizeof(uint64_t) * buffer_len;
-		char *buffer;
-		char *key_buffer;
-		try {
-			buffer = new char[buffer_size];
-		} catch (std::bad_alloc &exception) {
-			std::cout << "bad_alloc detected: " << exception.what() << " file: " << __FILE__ << " line: " << __LINE__ << std::endl;
-			std::cout << "tried to allocate: " << buffer_size << " bytes" << std::endl;
-			return;
+		std::vector<data_record> records(buffer_len);
+		std::vector<uint64_t> keys(buffer_len);
+		while (reader && key_reader) {
+			reader.read((char *)records.data(), buffer_len * sizeof(data_record));
+			key_reader.read((char *)keys.data(), buffer_len * sizeof(uint64_t));
+
+			const size_t num_records = std::min(reader.gcount() / sizeof(data_record), key_reader.gcount() / sizeof(uint64_t));
+			for (size_t i = 0; i < num_records; i++) {
+				add_to_run(merge_entry{.m_key = keys[i], .m_record = records[i]}, run, run_writer, run_lengths);
+			}
 		}
-		try {
-			key_buffer = new char[key_buffer_size];
-		} catch (std::bad_alloc &exception) {
-			std::cout << "bad_alloc detected: " << exception.what() << " file: " << __FILE__ << " line: " << __LINE__ << std::endl;
-			std::cout << "tried to allocate: " << key_buffer_size << " bytes" << std::endl;
-			return;
+
+		if (run_lengths.size() == 0) {
+			std::sort(run.begin(), run.end(), merge_order);
+			memory_run.swap(run);
+		} else {
+			spill_run(run, run_writer, run_lengths);
 		}
+	}
 
-		reader.seekg(0, std::ios::beg);
+	template<typename data_record>
+	void full_text_shard_builder<data_record>::add_to_run(const merge_entry &entry, std::vector<merge_entry> &run,
+			std::ofstream &run_writer, std::vector<size_t> &run_lengths) {
+		run.push_back(entry);
+		if (run.size() >= merge_buffer_len()) {
+			spill_run(run, run_writer, run_lengths);
+		}
+	}
 
-		while (!reader.eof()) {
+	template<typename data_record>
+	void full_text_shard_builder<data_record>::spill_run(std::vector<merge_entry> &run, std::ofstream &run_writer,
+			std::vector<size_t> &run_lengths) {
+		if (run.size() == 0) return;
+
+		if (!run_writer.is_open()) {
+			run_writer.open(run_filename(), std::ios::binary | std::ios::trunc);
+			if (!run_writer.is_open()) {
+				throw LOG_ERROR_EXCEPTION("Could not open full text shard (" + run_filename() + "). Error: " + std::string(strerror(errno)));
+			}
+		}
 
-			reader.read(buffer, buffer_size);
-			key_reader.read(key_buffer, key_buffer_size);
+		std::sort(run.begin(), run.end(), merge_order);
+		run_writer.write((const char *)run.data(), run.size() * sizeof(merge_entry));
+		run_lengths.push_back(run.size());
+		run.clear();
+	}
 
-			const size_t read_bytes = reader.gcount();
-			const size_t num_records = read_bytes / sizeof(data_record);
+	template<typename data_record>
+	bool full_text_shard_builder<data_record>::run_reader::next(merge_entry &entry) {
+		if (m_pos == m_buffer.size()) {
+			if (m_remaining == 0) return false;
+			const size_t to_read = std::min(m_remaining, m_buffer.capacity());
+			m_buffer.resize(to_read);
+			m_reader.read((char *)m_buffer.data(), to_read * sizeof(merge_entry));
+			m_remaining -= to_read;
+			m_pos = 0;
+		}
+		entry = m_buffer[m_pos++];
+		return true;
+	}
 
-			for (size_t i = 0; i < num_records; i++) {
-				const data_record *record = (data_record *)&buffer[i * sizeof(data_record)];
-				const uint64_t key = *((uint64_t *)&key_buffer[i * sizeof(uint64_t)]);
-				m_cache[key].push_back(*record);
+	/*
+		K-way merges the sorted runs into the shard file. Records with the same value for a key are only counted once,
+		the first one is kept. For each key the best results by score are kept in a heap so only the records that go
+		into the output are held in memory. A non empty memory_run is merged as a run that is already fully read, the
+		run file is removed when the merge is done.
+	*/
+	template<typename data_record>
+	void full_text_shard_builder<data_record>::merge_runs(const std::vector<size_t> &run_lengths,
+			std::vector<merge_entry> &memory_run) {
+
+		// Readers search the shard without a filter while it is rewritten, the new filter is written last.
+		indexer::key_filter::remove(filter_filename());
+
+		std::ofstream writer(target_filename(), std::ios::binary | std::ios::trunc);
+		if (!writer.is_open()) {
+			throw LOG_ERROR_EXCEPTION("Could not open full text shard. Error: " + std::string(strerror(errno)));
+		}
+
+		std::ofstream key_writer(key_filename(), std::ios::binary | std::ios::trunc);
+		if (!key_writer.is_open()) {
+			throw LOG_ERROR_EXCEPTION("Could not open full text shard. Error: " + std::string(strerror(errno)));
+		}
+
+		reset_key_file(key_writer);
+
+		// The read buffers of the runs share the memory limit.
+		const size_t buffer_len = std::max<size_t>(1000, merge_buffer_len() / (run_lengths.size() + 1));
+
+		std::vector<std::unique_ptr<run_reader>> runs;
+		size_t run_offset = 0;
+		for (size_t run_length : run_lengths) {
+			auto run = std::make_unique<run_reader>();
+			run->m_reader.open(run_filename(), std::ios::binary);
+			if (!run->m_reader.is_open()) {
+				throw LOG_ERROR_EXCEPTION("Could not open full text shard (" + run_filename() + "). Error: " + std::string(strerror(errno)));
+			}
+			run->m_reader.seekg(run_offset * sizeof(merge_entry));
+			run->m_remaining = run_length;
+			run->m_buffer.reserve(buffer_len);
+			run_offset += run_length;
+			runs.push_back(std::move(run));
+		}
+		if (memory_run.size()) {
+			auto run = std::make_unique<run_reader>();
+			run->m_remaining = 0;
+			run->m_buffer.swap(memory_run);
+			runs.push_back(std::move(run));
+		}
+
+		// Min heap of the current entry of each run.
+		std::vector<std::pair<merge_entry, size_t>> heap;
+		const auto heap_order = [](const std::pair<merge_entry, size_t> &a, const std::pair<merge_entry, size_t> &b) {
+			return merge_order(b.first, a.first);
+		};
+		for (size_t run_id = 0; run_id < runs.size(); run_id++) {
+			merge_entry entry;
+			if (runs[run_id]->next(entry)) {
+				heap.emplace_back(entry, run_id);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), heap_order);
+
+		const size_t max_results = config::ft_max_results_per_section * config::ft_max_sections;
+		const auto score_order = [](const data_record &a, const data_record &b) {
+			return a.m_score > b.m_score;
+		};
+
+		std::vector<uint64_t> shard_keys;
+		std::vector<uint64_t> page_keys;
+		std::vector<size_t> page_lens;
+		std::vector<size_t> page_totals;
+		std::vector<data_record> page_data;
+		size_t current_slot = SIZE_MAX;
+
+		std::vector<data_record> top;
+		uint64_t current_key = 0;
+		uint64_t last_value = 0;
+		size_t total = 0;
+
+		while (heap.size()) {
+			std::pop_heap(heap.begin(), heap.end(), heap_order);
+			const merge_entry entry = heap.back().first;
+			const size_t run_id = heap.back().second;
+			if (runs[run_id]->next(heap.back().first)) {
+				std::push_heap(heap.begin(), heap.end(), heap_order);
+			} else {
+				heap.pop_back();
+			}
+
+			if (total > 0 && entry.m_key != current_key) {
+				finish_key(current_key, top, total, page_keys, page_lens, page_totals, page_data);
+				total = 0;
+			}
+
+			const size_t slot = entry.m_key % config::shard_hash_table_size;
+			if (slot != current_slot) {
+				if (page_keys.size()) {
+					write_key(key_writer, current_slot, write_page(writer, page_keys, page_lens, page_totals, page_data));
+					shard_keys.insert(shard_keys.end(), page_keys.begin(), page_keys.end());
+				}
+				page_keys.clear();
+				page_lens.clear();
+				page_totals.clear();
+				page_data.clear();
+				current_slot = slot;
+			}
+
+			if (total > 0 && entry.m_record.m_value == last_value) continue;
+
+			current_key = entry.m_key;
+			last_value = entry.m_record.m_value;
+			total++;
+
+			if (top.size() < max_results) {
+				top.push_back(entry.m_record);
+				std::push_heap(top.begin(), top.end(), score_order);
+			} else if (max_results > 0 && entry.m_record.m_score > top.front().m_score) {
+				std::pop_heap(top.begin(), top.end(), score_order);
+				top.back() = entry.m_record;
+				std::push_heap(top.begin(), top.end(), score_order);
 			}
 		}
 
-		delete [] key_buffer;
-		delete [] buffer;
+		if (total > 0) {
+			finish_key(current_key, top, total, page_keys, page_lens, page_totals, page_data);
+		}
+		if (page_keys.size()) {
+			write_key(key_writer, current_slot, write_page(writer, page_keys, page_lens, page_totals, page_data));
+			shard_keys.insert(shard_keys.end(), page_keys.begin(), page_keys.end());
+		}
+
+		writer.close();
+		key_writer.close();
+		indexer::key_filter::write(filter_filename(), shard_keys);
+
+		if (run_lengths.size()) {
+			file::delete_file(run_filename());
+		}
+	}
+
+	/*
+		Orders the results of a key the same way as sort_cache() and adds them to the page.
+	*/
+	template<typename data_record>
+	void full_text_shard_builder<data_record>::finish_key(uint64_t key, std::vector<data_record> &top, size_t total,
+			std::vector<uint64_t> &page_keys, std::vector<size_t> &page_lens, std::vector<size_t> &page_totals,
+			std::vector<data_record> &page_data) const {
+
+		if (total > config::ft_max_results_per_section) {
+			std::sort(top.begin(), top.end(), [](const data_record &a, const data_record &b) {
+				return a.m_score > b.m_score;
+			});
+			order_sections_by_value(top);
+		} else {
+			std::sort(top.begin(), top.end(), [](const data_record &a, const data_record &b) {
+				return a.m_value < b.m_value;
+			});
+		}
+
+		page_keys.push_back(key);
+		page_lens.push_back(top.size() * sizeof(data_record));
+		page_totals.push_back(total);
+		page_data.insert(page_data.end(), top.begin(), top.end());
+		top.clear();
 	}
 
 	template<typename data_record>
@@ -458,6 +749,9 @@ namespace full_text {
 	template<typename data_record>
 	void full_text_shard_builder<data_record>::save_file() {
 
+		// Readers search the shard without a filter while it is rewritten, the new filter is written last.
+		indexer::key_filter::remove(filter_filename());
+
 		std::ofstream writer(target_filename(), std::ios::binary | std::ios::trunc);
 		if (!writer.is_open()) {
 			throw LOG_ERROR_EXCEPTION("Could not open full text shard. Error: " + std::string(strerror(errno)));
@@ -471,8 +765,10 @@ namespace full_text {
 		reset_key_file(key_writer);
 
 		std::unordered_map<uint64_t, std::vector<uint64_t>> pages;
+		std::vector<uint64_t> shard_keys;
 		for (auto &iter : m_cache) {
 			pages[iter.first % config::shard_hash_table_size].push_back(iter.first);
+			shard_keys.push_back(iter.first);
 		}
 
 		for (const auto &iter : pages) {
@@ -481,6 +777,10 @@ namespace full_text {
 			write_key(key_writer, iter.first, page_pos);
 		}
 
+		writer.close();
+		key_writer.close();
+		indexer::key_filter::write(filter_filename(), shard_keys);
+
 		/*std::sort(keys.begin(), keys.end(), [](const uint64_t a, const uint64_t b) {
 			return a < b;
 		});
@@ -540,6 +840,35 @@ namespace full_text {
 		return page_pos;
 	}
 
+	/*
+	 * Writes the page with keys, appending it to the file stream writer. The records of the keys are stored after
+	 * each other in data.
+	 * */
+	template<typename data_record>
+	size_t full_text_shard_builder<data_record>::write_page(std::ofstream &writer, const std::vector<uint64_t> &keys,
+			const std::vector<size_t> &lens, const std::vector<size_t> &totals, const std::vector<data_record> &data) const {
+
+		const size_t page_pos = writer.tellp();
+
+		size_t num_keys = keys.size();
+
+		std::vector<size_t> v_pos;
+		size_t pos = 0;
+		for (size_t len : lens) {
+			v_pos.push_back(pos);
+			pos += len;
+		}
+
+		writer.write((char *)&num_keys, 8);
+		writer.write((char *)keys.data(), keys.size() * 8);
+		writer.write((char *)v_pos.data(), keys.size() * 8);
+		writer.write((char *)lens.data(), keys.size() * 8);
+		writer.write((char *)totals.data(), keys.size() * 8);
+		writer.write((char *)data.data(), sizeof(data_record) * data.size());
+
+		return page_pos;
+	}
+
 	template<typename data_record>
 	void full_text_shard_builder<data_record>::reset_key_file(std::ofstream &key_writer) {
 		key_writer.seekp(0);
@@ -551,27 +880,37 @@ namespace full_text {
 
 	template<typename data_record>
 	std::string full_text_shard_builder<data_record>::mountpoint() const {
-		return std::to_string(m_shard_id % 8);
+		return m_mountpoint;
 	}
 
 	template<typename data_record>
 	std::string full_text_shard_builder<data_record>::cache_filename() const {
-		return "/mnt/" + mountpoint() + "/output/precache_" + m_db_name + "_" + std::to_string(m_shard_id) + ".cache";
+		return mountpoint() + "/output/precache_" + m_db_name + "_" + std::to_string(m_shard_id) + ".cache";
 	}
 
 	template<typename data_record>
 	std::string full_text_shard_builder<data_record>::key_cache_filename() const {
-		return "/mnt/" + mountpoint() + "/output/precache_" + m_db_name + "_" + std::to_string(m_shard_id) +".keys";
+		return mountpoint() + "/output/precache_" + m_db_name + "_" + std::to_string(m_shard_id) +".keys";
 	}
 
 	template<typename data_record>
 	std::string full_text_shard_builder<data_record>::key_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".keys";
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".keys";
+	}
+
+	template<typename data_record>
+	std::string full_text_shard_builder<data_record>::filter_filename() const {
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".bloom";
+	}
+
+	template<typename data_record>
+	std::string full_text_shard_builder<data_record>::run_filename() const {
+		return mountpoint() + "/output/precache_" + m_db_name + "_" + std::to_string(m_shard_id) + ".runs";
 	}
 
 	template<typename data_record>
 	std::string full_text_shard_builder<data_record>::target_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".idx";
+		return mountpoint() + "/full_text/fti_" + m_db_name + "_" + std::to_string(m_shard_id) + ".idx";
 	}
 
 	/*
@@ -582,6 +921,8 @@ namespace full_text {
 
 		truncate_cache_files();
 
+		indexer::key_filter::remove(filter_filename());
+
 		std::ofstream target_writer(target_filename(), std::ios::trunc);
 		target_writer.close();
 	}
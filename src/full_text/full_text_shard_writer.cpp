@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "full_text_shard_writer.h"
+#include "full_text_shard_builder.h"
+#include "logger/logger.h"
+
+using namespace std;
+
+namespace full_text {
+
+	full_text_shard_writer::full_text_shard_writer(const string &db_name, size_t num_writers) {
+
+		num_writers = std::max<size_t>(1, std::min(num_writers, config::ft_num_shards));
+
+		// There is only one set of shard builders so each of them can use the full share of the cache.
+		const double bytes_per_shard = (config::ft_max_cache_gb * 1000ul*1000ul*1000ul) / config::ft_num_shards;
+
+		for (size_t writer_id = 0; writer_id < num_writers; writer_id++) {
+			m_writers.emplace_back(std::make_unique<writer>());
+		}
+		for (size_t shard_id = 0; shard_id < config::ft_num_shards; shard_id++) {
+			m_writers[shard_id % num_writers]->m_shards.push_back(
+				new full_text_shard_builder<full_text_record>(db_name, shard_id, bytes_per_shard));
+		}
+		for (auto &w : m_writers) {
+			writer *ptr = w.get();
+			w->m_thread = std::thread([this, ptr]() { run_writer(*ptr); });
+		}
+	}
+
+	full_text_shard_writer::~full_text_shard_writer() {
+		close();
+	}
+
+	void full_text_shard_writer::push(size_t writer_id, batch &&records) {
+		if (records.size() == 0) return;
+
+		writer &w = *m_writers[writer_id];
+		unique_lock lock(w.m_lock);
+		w.m_not_full.wait(lock, [this, &w]() { return w.m_queue.size() < m_max_queued_batches; });
+		w.m_queue.emplace_back(std::move(records));
+		lock.unlock();
+		w.m_not_empty.notify_one();
+	}
+
+	/*
+		Waits for all queued batches to be added, appends what is left in the shard builders and stops the writers.
+	*/
+	void full_text_shard_writer::close() {
+		if (m_closed) return;
+		m_closed = true;
+
+		for (auto &w : m_writers) {
+			{
+				lock_guard lock(w->m_lock);
+				w->m_closed = true;
+			}
+			w->m_not_empty.notify_one();
+		}
+		for (auto &w : m_writers) {
+			w->m_thread.join();
+			for (full_text_shard_builder<full_text_record> *shard : w->m_shards) {
+				delete shard;
+			}
+			w->m_shards.clear();
+		}
+	}
+
+	void full_text_shard_writer::run_writer(writer &w) {
+
+		// The shard builders owned by this writer are indexed by shard_id / num_writers.
+		const size_t num_writers = m_writers.size();
+
+		while (true) {
+			batch records;
+			{
+				unique_lock lock(w.m_lock);
+				w.m_not_empty.wait(lock, [&w]() { return w.m_queue.size() || w.m_closed; });
+				if (w.m_queue.size() == 0) break;
+				records = std::move(w.m_queue.front());
+				w.m_queue.pop_front();
+			}
+			w.m_not_full.notify_one();
+
+			for (const auto &iter : records) {
+				const size_t shard_id = iter.first % config::ft_num_shards;
+				w.m_shards[shard_id / num_writers]->add(iter.first, iter.second);
+			}
+
+			for (full_text_shard_builder<full_text_record> *shard : w.m_shards) {
+				if (shard->full()) {
+					shard->append();
+				}
+			}
+		}
+
+		for (full_text_shard_builder<full_text_record> *shard : w.m_shards) {
+			shard->append();
+		}
+	}
+
+}
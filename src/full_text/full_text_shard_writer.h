@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include "config.h"
+#include "full_text_record.h"
+
+namespace full_text {
+
+	template<typename data_record> class full_text_shard_builder;
+
+	/*
+		Owns the single set of full_text_shard_builders used while indexing. The shards are partitioned over
+		num_writers dedicated writer threads (shard_id % num_writers) so every shard builder is only ever touched by
+		one thread and appends need no locking. Producers partition their (word_hash, record) pairs locally and hand
+		over whole batches with push(), which blocks when the queue of the writer is full so memory stays bounded.
+	*/
+	class full_text_shard_writer {
+
+		public:
+
+			typedef std::vector<std::pair<uint64_t, full_text_record>> batch;
+
+			full_text_shard_writer(const std::string &db_name, size_t num_writers);
+			~full_text_shard_writer();
+
+			size_t num_writers() const { return m_writers.size(); }
+			size_t writer_for_key(uint64_t key) const { return (key % config::ft_num_shards) % m_writers.size(); }
+
+			void push(size_t writer_id, batch &&records);
+			void close();
+
+		private:
+
+			struct writer {
+				std::mutex m_lock;
+				std::condition_variable m_not_empty;
+				std::condition_variable m_not_full;
+				std::deque<batch> m_queue;
+				bool m_closed = false;
+				std::vector<full_text_shard_builder<full_text_record> *> m_shards;
+				std::thread m_thread;
+			};
+
+			const size_t m_max_queued_batches = 8;
+			std::vector<std::unique_ptr<writer>> m_writers;
+			bool m_closed = false;
+
+			void run_writer(writer &w);
+
+	};
+
+}
@@ -27,11 +27,35 @@
 #include "url_to_domain.h"
 #include "logger/logger.h"
 #include "indexer/merger.h"
+#include "algorithm/hash.h"
+#include "storage/storage.h"
+#include <future>
+#include <atomic>
+#include <algorithm>
+#include <optional>
+#include <cstring>
+#include <boost/filesystem.hpp>
 
 using namespace std;
 
 namespace full_text {
 
+	namespace {
+
+		const char table_magic[8] = {'A', 'L', 'X', 'U', '2', 'D', '0', '1'};
+
+		struct table_header {
+			char m_magic[8];
+			uint64_t m_source_size;
+			uint64_t m_num_urls;
+			uint64_t m_capacity;
+			uint64_t m_num_domains;
+			uint64_t m_has_zero_url;
+			uint64_t m_zero_url_domain;
+		};
+
+	}
+
 	url_to_domain::url_to_domain(const string &db_name)
 	: m_db_name(db_name)
 	{
@@ -48,65 +72,251 @@ namespace full_text {
 
 	void url_to_domain::add_url(uint64_t url_hash, uint64_t domain_hash) {
 		m_lock.lock();
-		m_url_to_domain[url_hash] = domain_hash;
-		m_domains[domain_hash]++;
+		m_added.push_back(entry{url_hash, domain_hash});
 		m_lock.unlock();
 	}
 
-	void url_to_domain::read() {
-		lock_guard lock(m_lock);
-		for (size_t bucket_id = 0; bucket_id < 8; bucket_id++) {
-			const string file_name = "/mnt/"+(to_string(bucket_id))+"/full_text/url_to_domain_"+m_db_name+".fti";
-
-			ifstream infile(file_name, ios::binary);
-			if (infile.is_open()) {
-
-				char buffer[8];
-
-				do {
-
-					infile.read(buffer, sizeof(uint64_t));
-					if (infile.eof()) break;
-
-					uint64_t url_hash = *((uint64_t *)buffer);
+	bool url_to_domain::has_domain(uint64_t domain_hash) const {
+		return binary_search(m_domains, m_domains + m_num_domains, domain_hash);
+	}
 
-					infile.read(buffer, sizeof(uint64_t));
-					uint64_t domain_hash = *((uint64_t *)buffer);
+	const uint64_t *url_to_domain::find_url(uint64_t url_hash) const {
+		if (m_capacity == 0) return nullptr;
+		if (url_hash == 0) {
+			// Zero marks empty slots so the zero hash is stored outside the table.
+			return m_has_zero_url ? &m_zero_url_domain : nullptr;
+		}
+		size_t pos = slot(url_hash);
+		while (m_table[pos].m_url_hash != 0) {
+			if (m_table[pos].m_url_hash == url_hash) return &m_table[pos].m_domain_hash;
+			if (++pos == m_capacity) pos = 0;
+		}
+		return nullptr;
+	}
 
-					m_url_to_domain[url_hash] = domain_hash;
-					m_domains[domain_hash]++;
+	string url_to_domain::bucket_file_name(const string &db_name, size_t bucket_id) {
+		return storage::shard_path("url_to_domain_" + db_name, bucket_id, "full_text/url_to_domain_" + db_name + ".fti");
+	}
 
-				} while (!infile.eof());
+	string url_to_domain::table_file_name(const string &db_name) {
+		return storage::primary_path("full_text/url_to_domain_" + db_name + ".map");
+	}
 
-				infile.close();
-			}
+	void url_to_domain::read() {
+		lock_guard lock(m_lock);
+		if (!load_table()) {
+			build_table();
+			save_table();
 		}
 	}
 
-	void url_to_domain::write(size_t indexer_id) {\
+	void url_to_domain::write(size_t indexer_id) {
 		lock_guard lock(m_lock);
-		const string file_name = "/mnt/"+(to_string(indexer_id % 8))+"/full_text/url_to_domain_"+m_db_name+".fti";
+		const string file_name = bucket_file_name(m_db_name, indexer_id);
 
 		ofstream outfile(file_name, ios::binary | ios::app);
 		if (!outfile.is_open()) {
 			throw LOG_ERROR_EXCEPTION("Could not open url_to_domain file");
 		}
 
-		for (const auto &iter : m_url_to_domain) {
-			outfile.write((const char *)&(iter.first), sizeof(uint64_t));
-			outfile.write((const char *)&(iter.second), sizeof(uint64_t));
+		if (m_added.size()) {
+			outfile.write((const char *)m_added.data(), m_added.size() * sizeof(entry));
+			boost::filesystem::remove(table_file_name(m_db_name));
 		}
 
-		m_url_to_domain = std::unordered_map<uint64_t, uint64_t>{}; // Frees memory
-		m_domains = std::unordered_map<uint64_t, size_t>{}; // Frees memory
+		m_added = vector<entry>{}; // Frees memory
 
 		outfile.close();
 	}
 
 	void url_to_domain::truncate() {
 		for (size_t i = 0; i < 8; i++) {
-			const string file_name = "/mnt/"+(to_string(i))+"/full_text/url_to_domain_"+m_db_name+".fti";
-			ofstream outfile(file_name, ios::trunc);
+			ofstream outfile(bucket_file_name(m_db_name, i), ios::trunc);
+		}
+		boost::filesystem::remove(table_file_name(m_db_name));
+	}
+
+	size_t url_to_domain::slot(uint64_t url_hash) const {
+		return ((unsigned __int128)algorithm::mix64(url_hash) * m_capacity) >> 64;
+	}
+
+	size_t url_to_domain::bucket_files_size() const {
+		size_t size = 0;
+		for (size_t bucket_id = 0; bucket_id < 8; bucket_id++) {
+			boost::system::error_code error;
+			const size_t file_size = boost::filesystem::file_size(bucket_file_name(m_db_name, bucket_id), error);
+			if (!error) size += file_size;
+		}
+		return size;
+	}
+
+	void url_to_domain::build_table() {
+
+		m_table_file.reset();
+
+		// Read the buckets in parallel.
+		vector<future<vector<entry>>> reads;
+		for (size_t bucket_id = 0; bucket_id < 8; bucket_id++) {
+			reads.emplace_back(async(launch::async, [this, bucket_id]() {
+				vector<entry> entries;
+				ifstream infile(bucket_file_name(m_db_name, bucket_id), ios::binary);
+				if (infile.is_open()) {
+					infile.seekg(0, ios::end);
+					entries.resize(infile.tellg() / sizeof(entry));
+					infile.seekg(0, ios::beg);
+					infile.read((char *)entries.data(), entries.size() * sizeof(entry));
+				}
+				return entries;
+			}));
+		}
+		vector<vector<entry>> buckets;
+		size_t total = 0;
+		for (auto &result : reads) {
+			buckets.push_back(result.get());
+			total += buckets.back().size();
+		}
+
+		// Load factor of at most 0.75, the capacity does not need to be a power of two.
+		m_capacity = max<size_t>(16, total + total / 3 + 1);
+		m_table_memory.assign(m_capacity, entry{0, 0});
+		m_has_zero_url = false;
+		m_zero_url_domain = 0;
+		entry *table = m_table_memory.data();
+
+		/*
+			Insert the buckets in parallel. The first pass claims the slots with compare and swap on the url hash and
+			records the highest bucket holding each url in owners. The second pass only lets the owner bucket write the
+			domain, so like reading the buckets in order the last entry of the highest bucket wins.
+		*/
+		vector<uint8_t> owners(m_capacity, 0);
+		vector<optional<uint64_t>> zero_url_domains(buckets.size());
+		vector<future<size_t>> claims;
+		for (size_t bucket_id = 0; bucket_id < buckets.size(); bucket_id++) {
+			claims.emplace_back(async(launch::async, [this, &buckets, bucket_id, table, &owners, &zero_url_domains]() {
+				const uint8_t bucket_owner = bucket_id + 1;
+				size_t inserted = 0;
+				for (const entry &e : buckets[bucket_id]) {
+					// The zero url hash marks empty slots so it is kept outside the table.
+					if (e.m_url_hash == 0) {
+						zero_url_domains[bucket_id] = e.m_domain_hash;
+						continue;
+					}
+					size_t pos = slot(e.m_url_hash);
+					while (true) {
+						atomic_ref<uint64_t> key(table[pos].m_url_hash);
+						uint64_t expected = 0;
+						if (key.compare_exchange_strong(expected, e.m_url_hash, memory_order_relaxed)) {
+							inserted++;
+						}
+						if (expected == 0 || expected == e.m_url_hash) break;
+						if (++pos == m_capacity) pos = 0;
+					}
+					atomic_ref<uint8_t> owner(owners[pos]);
+					uint8_t current = owner.load(memory_order_relaxed);
+					while (current < bucket_owner && !owner.compare_exchange_weak(current, bucket_owner, memory_order_relaxed));
+				}
+				return inserted;
+			}));
+		}
+
+		m_num_urls = 0;
+		for (size_t bucket_id = 0; bucket_id < buckets.size(); bucket_id++) {
+			m_num_urls += claims[bucket_id].get();
+			if (zero_url_domains[bucket_id]) {
+				m_num_urls += m_has_zero_url ? 0 : 1;
+				m_has_zero_url = true;
+				m_zero_url_domain = *zero_url_domains[bucket_id];
+			}
+		}
+
+		vector<future<vector<uint64_t>>> inserts;
+		for (size_t bucket_id = 0; bucket_id < buckets.size(); bucket_id++) {
+			inserts.emplace_back(async(launch::async, [this, &buckets, bucket_id, table, &owners]() {
+				vector<uint64_t> domains;
+				domains.reserve(buckets[bucket_id].size());
+				for (const entry &e : buckets[bucket_id]) {
+					domains.push_back(e.m_domain_hash);
+					if (e.m_url_hash == 0) continue;
+					size_t pos = slot(e.m_url_hash);
+					while (table[pos].m_url_hash != e.m_url_hash) {
+						if (++pos == m_capacity) pos = 0;
+					}
+					if (owners[pos] == bucket_id + 1) {
+						table[pos].m_domain_hash = e.m_domain_hash;
+					}
+				}
+				sort(domains.begin(), domains.end());
+				domains.erase(unique(domains.begin(), domains.end()), domains.end());
+				return domains;
+			}));
 		}
+
+		m_domain_memory.clear();
+		for (auto &result : inserts) {
+			const vector<uint64_t> domains = result.get();
+			const size_t middle = m_domain_memory.size();
+			m_domain_memory.insert(m_domain_memory.end(), domains.begin(), domains.end());
+			inplace_merge(m_domain_memory.begin(), m_domain_memory.begin() + middle, m_domain_memory.end());
+			m_domain_memory.erase(unique(m_domain_memory.begin(), m_domain_memory.end()), m_domain_memory.end());
+		}
+
+		m_table = m_table_memory.data();
+		m_domains = m_domain_memory.data();
+		m_num_domains = m_domain_memory.size();
+	}
+
+	void url_to_domain::save_table() const {
+		const string file_name = table_file_name(m_db_name);
+		const string tmp_file_name = file_name + ".tmp";
+
+		ofstream outfile(tmp_file_name, ios::binary | ios::trunc);
+		if (!outfile.is_open()) {
+			LOG_INFO("Could not save url_to_domain table " + file_name);
+			return;
+		}
+
+		table_header header;
+		memcpy(header.m_magic, table_magic, sizeof(table_magic));
+		header.m_source_size = bucket_files_size();
+		header.m_num_urls = m_num_urls;
+		header.m_capacity = m_capacity;
+		header.m_num_domains = m_num_domains;
+		header.m_has_zero_url = m_has_zero_url;
+		header.m_zero_url_domain = m_zero_url_domain;
+
+		outfile.write((const char *)&header, sizeof(header));
+		outfile.write((const char *)m_table, m_capacity * sizeof(entry));
+		outfile.write((const char *)m_domains, m_num_domains * sizeof(uint64_t));
+		outfile.close();
+
+		boost::filesystem::rename(tmp_file_name, file_name);
+	}
+
+	bool url_to_domain::load_table() {
+		const string file_name = table_file_name(m_db_name);
+		if (!boost::filesystem::exists(file_name)) return false;
+
+		auto table_file = make_unique<file::mmap_file>(file_name);
+		if (table_file->size() < sizeof(table_header)) return false;
+
+		const table_header *header = (const table_header *)table_file->data();
+		if (memcmp(header->m_magic, table_magic, sizeof(table_magic)) != 0) return false;
+		if (header->m_source_size != bucket_files_size()) return false;
+		if (table_file->size() != sizeof(table_header) + header->m_capacity * sizeof(entry) +
+				header->m_num_domains * sizeof(uint64_t)) return false;
+
+		m_table_memory = vector<entry>{};
+		m_domain_memory = vector<uint64_t>{};
+
+		m_capacity = header->m_capacity;
+		m_num_urls = header->m_num_urls;
+		m_num_domains = header->m_num_domains;
+		m_has_zero_url = header->m_has_zero_url;
+		m_zero_url_domain = header->m_zero_url_domain;
+		m_table = (const entry *)(table_file->data() + sizeof(table_header));
+		m_domains = (const uint64_t *)(table_file->data() + sizeof(table_header) + m_capacity * sizeof(entry));
+		m_table_file = std::move(table_file);
+
+		return true;
 	}
 }
@@ -28,11 +28,24 @@
 
 #include <iostream>
 #include <fstream>
-#include <unordered_map>
+#include <vector>
+#include <memory>
 #include <mutex>
+#include "file/mmap_file.h"
 
 namespace full_text {
 
+	/*
+		Maps url hashes to domain hashes. Urls are added with add_url and appended to the bucket files by write().
+
+		read() loads all bucket files in parallel into an open addressing table of (url_hash, domain_hash) pairs and
+		a sorted list of the domain hashes, and saves them to url_to_domain_<db_name>.map. The next read() mmaps that
+		file instead of reading the buckets again. write() and truncate() remove the map file. A url stored more than once
+		gets the domain of its last entry in the highest bucket, the same as reading the buckets in order.
+
+		The table does not change after read() so has_url() and has_domain() can be called from any number of threads
+		without locking. They only see the urls loaded by read(), not the ones added with add_url.
+	*/
 	class url_to_domain {
 
 		public:
@@ -45,27 +58,52 @@ namespace full_text {
 			void truncate();
 
 			size_t size() const {
-				return m_url_to_domain.size();
+				return m_num_urls;
 			}
 
-			bool has_url(uint64_t url_hash) {
-				std::lock_guard guard(m_lock); 
-				return m_url_to_domain.count(url_hash) > 0;
+			bool has_url(uint64_t url_hash) const {
+				return find_url(url_hash) != nullptr;
 			}
 
-			bool has_domain(uint64_t domain_hash) {
-				return m_domains.count(domain_hash) > 0;
-			}
+			bool has_domain(uint64_t domain_hash) const;
 
+			// Returns a pointer to the domain hash of the url or nullptr if the url is not in the table.
+			const uint64_t *find_url(uint64_t url_hash) const;
 
-			const std::unordered_map<uint64_t, uint64_t> &get_url_to_domain() const { return m_url_to_domain; };
-			const std::unordered_map<uint64_t, size_t> &domains() const { return m_domains; };
+			static std::string bucket_file_name(const std::string &db_name, size_t bucket_id);
+			static std::string table_file_name(const std::string &db_name);
 
 		private:
+
+			struct entry {
+				uint64_t m_url_hash;
+				uint64_t m_domain_hash;
+			};
+
 			const std::string m_db_name;
-			std::unordered_map<uint64_t, uint64_t> m_url_to_domain;
-			std::unordered_map<uint64_t, size_t> m_domains;
+
+			// Urls added since the last write().
+			std::vector<entry> m_added;
 			std::mutex m_lock;
 
+			// The loaded table, points into m_table_memory or the mmapped file.
+			const entry *m_table = nullptr;
+			const uint64_t *m_domains = nullptr;
+			size_t m_capacity = 0;
+			size_t m_num_urls = 0;
+			size_t m_num_domains = 0;
+			bool m_has_zero_url = false;
+			uint64_t m_zero_url_domain = 0;
+
+			std::vector<entry> m_table_memory;
+			std::vector<uint64_t> m_domain_memory;
+			std::unique_ptr<file::mmap_file> m_table_file;
+
+			size_t slot(uint64_t url_hash) const;
+			size_t bucket_files_size() const;
+			void build_table();
+			void save_table() const;
+			bool load_table();
+
 	};
 }
@@ -26,7 +26,7 @@
 
 #include "builder.h"
 #include "config.h"
-#include "utils/thread_pool.hpp"
+#include "utils/scheduler.hpp"
 
 using namespace std;
 
@@ -51,16 +51,16 @@ namespace hash_table {
 
 	void builder::merge() {
 		cout << "Merging hash table" << endl;
-		utils::thread_pool pool(24);
+		utils::task_group tasks(utils::priority::background);
 		for (hash_table_shard_builder *shard : m_shards) {
-			pool.enqueue([shard]() -> void {
+			tasks.run([shard]() -> void {
 				shard->write();
 				shard->sort();
 				shard->optimize();
 			});
 		}
 
-		pool.run_all();
+		tasks.wait();
 
 		cout << "...done" << endl;
 	}
@@ -27,13 +27,15 @@
 #include "config.h"
 #include "hash_table_shard.h"
 #include "logger/logger.h"
+#include "storage/storage.h"
 
 using namespace std;
 
 namespace hash_table {
 
 	hash_table_shard::hash_table_shard(const string &db_name, size_t shard_id)
-	: m_db_name(db_name), m_shard_id(shard_id), m_loaded(false), m_size(0)
+	: m_db_name(db_name), m_shard_id(shard_id), m_mountpoint(storage::device_root(storage::shard_device("ht_" + db_name, shard_id))),
+		m_loaded(false), m_size(0)
 	{
 		load();
 	}
@@ -81,13 +83,11 @@ namespace hash_table {
 	}
 
 	string hash_table_shard::filename_data() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data";
 	}
 
 	string hash_table_shard::filename_pos() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos";
 	}
 
 	size_t hash_table_shard::shard_id() const {
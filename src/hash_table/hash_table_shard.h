@@ -59,6 +59,7 @@ namespace hash_table {
 
 			const std::string m_db_name;
 			size_t m_shard_id;
+			const std::string m_mountpoint;
 			bool m_loaded;
 			size_t m_size;
 
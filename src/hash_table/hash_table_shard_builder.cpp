@@ -27,6 +27,7 @@
 #include "config.h"
 #include "hash_table_shard_builder.h"
 #include "logger/logger.h"
+#include "storage/storage.h"
 #include "file/file.h"
 #include "indexer/merger.h"
 
@@ -35,7 +36,8 @@ using namespace std;
 namespace hash_table {
 
 	hash_table_shard_builder::hash_table_shard_builder(const string &db_name, size_t shard_id)
-	: m_db_name(db_name), m_shard_id(shard_id), m_cache_limit(25 + rand() % 10)
+	: m_db_name(db_name), m_shard_id(shard_id), m_mountpoint(storage::device_root(storage::shard_device("ht_" + db_name, shard_id))),
+		m_cache_limit(25 + rand() % 10)
 	{
 		indexer::merger::register_appender((size_t)this, [this]() {write();});
 	}
@@ -177,23 +179,19 @@ namespace hash_table {
 	}
 
 	string hash_table_shard_builder::filename_data() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data";
 	}
 
 	string hash_table_shard_builder::filename_pos() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos";
 	}
 
 	string hash_table_shard_builder::filename_data_tmp() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data.tmp";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".data.tmp";
 	}
 
 	string hash_table_shard_builder::filename_pos_tmp() const {
-		size_t disk_shard = m_shard_id % 8;
-		return "/mnt/" + to_string(disk_shard) + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos.tmp";
+		return m_mountpoint + "/hash_table/ht_" + m_db_name + "_" + to_string(m_shard_id) + ".pos.tmp";
 	}
 
 	void hash_table_shard_builder::read_keys() {
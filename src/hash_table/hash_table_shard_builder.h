@@ -59,6 +59,7 @@ namespace hash_table {
 			std::map<uint64_t, std::string> m_cache;
 			const std::string m_db_name;
 			size_t m_shard_id;
+			const std::string m_mountpoint;
 			const size_t m_cache_limit;
 			std::map<uint64_t, size_t> m_sort_pos;
 			std::mutex m_lock;
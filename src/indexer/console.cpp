@@ -189,8 +189,10 @@ namespace indexer {
 
 	
 	void index_new() {
-		domain_stats::download_domain_stats();
-		LOG_INFO("Done download_domain_stats");
+		if (!domain_stats::load_domain_stats()) {
+			domain_stats::download_domain_stats();
+			LOG_INFO("Done download_domain_stats");
+		}
 
 		for (const string &batch : config::batches) {
 			indexer::index_tree idx_tree;
@@ -0,0 +1,230 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "document_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace indexer {
+
+	atomic<size_t> next_document_stats_shard(0);
+	thread_local size_t thread_document_stats_shard = SIZE_MAX;
+
+	document_stats::document_stats() {
+	}
+
+	void document_stats::add(uint64_t document_id) {
+		if (thread_document_stats_shard == SIZE_MAX) {
+			thread_document_stats_shard = next_document_stats_shard.fetch_add(1, memory_order_relaxed) % num_shards;
+		}
+		shard &s = m_shards[thread_document_stats_shard];
+
+		lock_guard lock(s.m_lock);
+		s.m_counter.insert(document_id);
+		s.m_sizes[document_id]++;
+	}
+
+	void document_stats::merge() {
+
+		vector<pair<uint64_t, uint32_t>> added;
+		for (shard &s : m_shards) {
+			lock_guard lock(s.m_lock);
+			m_counter += s.m_counter;
+			s.m_counter.reset();
+			added.insert(added.end(), s.m_sizes.begin(), s.m_sizes.end());
+			s.m_sizes = unordered_map<uint64_t, uint32_t>{};
+		}
+
+		if (added.empty()) return;
+
+		// The same document can have been added by several threads.
+		std::sort(added.begin(), added.end());
+
+		vector<uint64_t> document_ids;
+		vector<uint32_t> document_sizes;
+		document_ids.reserve(m_document_ids.size() + added.size());
+		document_sizes.reserve(m_document_ids.size() + added.size());
+
+		size_t i = 0;
+		size_t j = 0;
+		while (i < m_document_ids.size() || j < added.size()) {
+			uint64_t document_id;
+			if (j == added.size() || (i < m_document_ids.size() && m_document_ids[i] < added[j].first)) {
+				document_id = m_document_ids[i];
+			} else {
+				document_id = added[j].first;
+			}
+			uint32_t size = 0;
+			if (i < m_document_ids.size() && m_document_ids[i] == document_id) {
+				size += m_document_sizes[i++];
+			}
+			while (j < added.size() && added[j].first == document_id) {
+				size += added[j++].second;
+			}
+			document_ids.push_back(document_id);
+			document_sizes.push_back(size);
+		}
+
+		for (const auto &iter : added) {
+			m_total_size += iter.second;
+		}
+		m_document_ids.swap(document_ids);
+		m_document_sizes.swap(document_sizes);
+	}
+
+	void document_stats::reset() {
+		for (shard &s : m_shards) {
+			lock_guard lock(s.m_lock);
+			s.m_counter.reset();
+			s.m_sizes = unordered_map<uint64_t, uint32_t>{};
+		}
+		m_counter.reset();
+		m_document_ids = vector<uint64_t>{};
+		m_document_sizes = vector<uint32_t>{};
+		m_total_size = 0;
+	}
+
+	size_t document_stats::document_size(uint64_t document_id) const {
+		auto iter = lower_bound(m_document_ids.cbegin(), m_document_ids.cend(), document_id);
+		if (iter == m_document_ids.cend() || *iter != document_id) return 0;
+		return m_document_sizes[iter - m_document_ids.cbegin()];
+	}
+
+	float document_stats::avg_document_size() const {
+		if (m_document_ids.empty()) return 0.0f;
+		return (float)m_total_size / m_document_ids.size();
+	}
+
+	/*
+		Number of bytes left in the stream, used to check table sizes before allocating them.
+	*/
+	size_t remaining_bytes(istream &stream) {
+		const streampos pos = stream.tellg();
+		stream.seekg(0, ios::end);
+		const streampos end = stream.tellg();
+		stream.seekg(pos);
+		if (pos < 0 || end < pos) return 0;
+		return end - pos;
+	}
+
+	void document_stats::serialize(ostream &stream) const {
+		stream.write((char *)&meta_magic, sizeof(uint64_t));
+		stream.write((char *)&meta_version, sizeof(uint32_t));
+
+		const size_t document_count = m_counter.count();
+		stream.write((char *)&document_count, sizeof(size_t));
+		m_counter.serialize(stream);
+
+		const size_t num_docs = m_document_ids.size();
+		stream.write((char *)&num_docs, sizeof(size_t));
+		stream.write((char *)m_document_ids.data(), num_docs * sizeof(uint64_t));
+		stream.write((char *)m_document_sizes.data(), num_docs * sizeof(uint32_t));
+	}
+
+	void document_stats::deserialize(istream &stream) {
+		reset();
+
+		// An empty meta file is what truncate leaves.
+		uint64_t magic = 0;
+		if (remaining_bytes(stream) < sizeof(uint64_t)) return;
+		stream.read((char *)&magic, sizeof(uint64_t));
+		if (magic != meta_magic) {
+			stream.seekg(-(streamoff)sizeof(uint64_t), ios::cur);
+			deserialize_legacy(stream);
+			return;
+		}
+
+		uint32_t version = 0;
+		stream.read((char *)&version, sizeof(uint32_t));
+		if (version != meta_version) {
+			throw runtime_error("Unsupported document stats version " + to_string(version));
+		}
+
+		size_t document_count = 0;
+		stream.read((char *)&document_count, sizeof(size_t));
+		m_counter.deserialize(stream);
+
+		size_t num_docs = 0;
+		stream.read((char *)&num_docs, sizeof(size_t));
+		if (!stream || num_docs > remaining_bytes(stream) / (sizeof(uint64_t) + sizeof(uint32_t))) {
+			reset();
+			throw runtime_error("Corrupt document stats");
+		}
+		m_document_ids.resize(num_docs);
+		m_document_sizes.resize(num_docs);
+		stream.read((char *)m_document_ids.data(), num_docs * sizeof(uint64_t));
+		stream.read((char *)m_document_sizes.data(), num_docs * sizeof(uint32_t));
+		if (!stream) {
+			reset();
+			throw runtime_error("Corrupt document stats");
+		}
+		for (uint32_t size : m_document_sizes) {
+			m_total_size += size;
+		}
+	}
+
+	/*
+		The legacy layout is the document count, the dense hyper log log registers and the number of documents followed
+		by unsorted (document id, size_t size) pairs.
+	*/
+	void document_stats::deserialize_legacy(istream &stream) {
+
+		size_t document_count = 0;
+		stream.read((char *)&document_count, sizeof(size_t));
+		m_counter.deserialize(stream);
+
+		size_t num_docs = 0;
+		stream.read((char *)&num_docs, sizeof(size_t));
+		if (!stream || num_docs > remaining_bytes(stream) / (sizeof(uint64_t) + sizeof(size_t))) {
+			reset();
+			throw runtime_error("Corrupt legacy document stats");
+		}
+
+		vector<pair<uint64_t, size_t>> sizes(num_docs);
+		for (auto &iter : sizes) {
+			stream.read((char *)&iter.first, sizeof(uint64_t));
+			stream.read((char *)&iter.second, sizeof(size_t));
+		}
+		if (!stream) {
+			reset();
+			throw runtime_error("Corrupt legacy document stats");
+		}
+		std::sort(sizes.begin(), sizes.end());
+
+		m_document_ids.reserve(num_docs);
+		m_document_sizes.reserve(num_docs);
+		for (const auto &iter : sizes) {
+			m_document_ids.push_back(iter.first);
+			m_document_sizes.push_back(iter.second);
+			m_total_size += iter.second;
+		}
+	}
+
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "algorithm/hyper_log_log.h"
+
+namespace indexer {
+
+	/*
+		Document count and raw document sizes (number of added postings per document) for an index builder.
+
+		add() is called concurrently from the indexing threads. Every thread picks one of the shards the first time
+		it adds so the shard locks are practically uncontended. merge() folds the shards into a sorted table of
+		document ids with a parallel array of sizes, that is what document_size() searches and what is written
+		to the meta file in two bulk writes.
+	*/
+	class document_stats {
+
+	public:
+
+		document_stats();
+
+		void add(uint64_t document_id);
+
+		/*
+			Moves everything added since the last merge into the sorted table. Not thread safe with itself but
+			add() can run concurrently.
+		*/
+		void merge();
+		void reset();
+
+		size_t num_documents() const { return m_counter.count(); }
+		size_t document_size(uint64_t document_id) const;
+		float avg_document_size() const;
+		size_t table_size() const { return m_document_ids.size(); }
+
+		/*
+			The serialized stats start with a magic and a version. deserialize also converts the legacy meta files
+			that had no header and stored the sizes as (document id, size_t) pairs, and throws std::runtime_error
+			on an unknown version or a table that does not fit in the stream.
+		*/
+		void serialize(std::ostream &stream) const;
+		void deserialize(std::istream &stream);
+
+	private:
+
+		struct alignas(64) shard {
+			std::mutex m_lock;
+			::algorithm::hyper_log_log m_counter;
+			std::unordered_map<uint64_t, uint32_t> m_sizes;
+		};
+
+		static const size_t num_shards = 32;
+		std::array<shard, num_shards> m_shards;
+
+		::algorithm::hyper_log_log m_counter;
+		std::vector<uint64_t> m_document_ids;
+		std::vector<uint32_t> m_document_sizes;
+		size_t m_total_size = 0;
+
+		static constexpr uint64_t meta_magic = 0x5354415453434f44ull; // "DOCSTATS"
+		static constexpr uint32_t meta_version = 1;
+
+		void deserialize_legacy(std::istream &stream);
+
+	};
+
+}
@@ -26,6 +26,9 @@
 
 #pragma once
 
+#include "storage/storage.h"
+#include "key_filter.h"
+
 namespace indexer {
 
 	template<typename data_record>
@@ -50,6 +53,7 @@ namespace indexer {
 
 		std::string m_db_name;
 		size_t m_id;
+		std::string m_mountpoint;
 		const size_t m_hash_table_size;
 		size_t m_unique_count = 0;
 
@@ -59,18 +63,21 @@ namespace indexer {
 		std::string filename() const;
 		std::string key_filename() const;
 		std::string meta_filename() const;
+		std::string filter_filename() const;
 		
 	};
 
 	template<typename data_record>
 	index<data_record>::index(const std::string &db_name, size_t id)
-	: m_db_name(db_name), m_id(id), m_hash_table_size(config::shard_hash_table_size) {
+	: m_db_name(db_name), m_id(id), m_mountpoint(storage::device_root(storage::shard_device("full_text/" + db_name, id))),
+		m_hash_table_size(config::shard_hash_table_size) {
 		read_meta();
 	}
 
 	template<typename data_record>
 	index<data_record>::index(const std::string &db_name, size_t id, size_t hash_table_size)
-	: m_db_name(db_name), m_id(id), m_hash_table_size(hash_table_size) {
+	: m_db_name(db_name), m_id(id), m_mountpoint(storage::device_root(storage::shard_device("full_text/" + db_name, id))),
+		m_hash_table_size(hash_table_size) {
 		read_meta();
 	}
 
@@ -87,6 +94,11 @@ namespace indexer {
 	template<typename data_record>
 	std::vector<data_record> index<data_record>::find(uint64_t key, size_t &total_found) const {
 
+		if (!key_filter::may_contain(filter_filename(), key)) {
+			total_found = 0;
+			return {};
+		}
+
 		size_t key_pos = read_key_pos(key);
 
 		if (key_pos == SIZE_MAX) {
@@ -192,22 +204,27 @@ namespace indexer {
 
 	template<typename data_record>
 	std::string index<data_record>::mountpoint() const {
-		return std::to_string(m_id % 8);
+		return m_mountpoint;
 	}
 
 	template<typename data_record>
 	std::string index<data_record>::filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".data";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".data";
 	}
 
 	template<typename data_record>
 	std::string index<data_record>::key_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".keys";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".keys";
 	}
 
 	template<typename data_record>
 	std::string index<data_record>::meta_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".meta";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".meta";
+	}
+
+	template<typename data_record>
+	std::string index<data_record>::filter_filename() const {
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".bloom";
 	}
 
 }
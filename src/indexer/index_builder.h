@@ -36,6 +36,8 @@
 #include "score_builder.h"
 #include "algorithm/hyper_log_log.h"
 #include "config.h"
+#include "storage/storage.h"
+#include "key_filter.h"
 #include "logger/logger.h"
 #include "memory/debugger.h"
 
@@ -76,6 +78,7 @@ namespace indexer {
 
 		std::string m_db_name;
 		const size_t m_id;
+		const std::string m_mountpoint;
 		const size_t m_hash_table_size;
 		const size_t m_max_results;
 
@@ -116,26 +119,30 @@ namespace indexer {
 		std::string key_filename() const;
 		std::string target_filename() const;
 		std::string meta_filename() const;
+		std::string filter_filename() const;
 
 	};
 
 	template<typename data_record>
 	index_builder<data_record>::index_builder(const std::string &db_name, size_t id)
-	: m_db_name(db_name), m_id(id), m_hash_table_size(config::shard_hash_table_size), m_max_results(config::ft_max_results_per_section) {
+	: m_db_name(db_name), m_id(id), m_mountpoint(storage::device_root(storage::shard_device("full_text/" + db_name, id))),
+		m_hash_table_size(config::shard_hash_table_size), m_max_results(config::ft_max_results_per_section) {
 		merger::register_merger((size_t)this, [this]() {merge();});
 		merger::register_appender((size_t)this, [this]() {append();});
 	}
 
 	template<typename data_record>
 	index_builder<data_record>::index_builder(const std::string &db_name, size_t id, size_t hash_table_size)
-	: m_db_name(db_name), m_id(id), m_hash_table_size(hash_table_size), m_max_results(config::ft_max_results_per_section) {
+	: m_db_name(db_name), m_id(id), m_mountpoint(storage::device_root(storage::shard_device("full_text/" + db_name, id))),
+		m_hash_table_size(hash_table_size), m_max_results(config::ft_max_results_per_section) {
 		merger::register_merger((size_t)this, [this]() {append();});
 		merger::register_appender((size_t)this, [this]() {append();});
 	}
 
 	template<typename data_record>
 	index_builder<data_record>::index_builder(const std::string &db_name, size_t id, size_t hash_table_size, size_t max_results)
-	: m_db_name(db_name), m_id(id), m_hash_table_size(hash_table_size), m_max_results(max_results) {
+	: m_db_name(db_name), m_id(id), m_mountpoint(storage::device_root(storage::shard_device("full_text/" + db_name, id))),
+		m_hash_table_size(hash_table_size), m_max_results(max_results) {
 		merger::register_merger((size_t)this, [this]() {append();});
 		merger::register_appender((size_t)this, [this]() {append();});
 	}
@@ -230,6 +237,8 @@ namespace indexer {
 		create_directories();
 		truncate_cache_files();
 
+		key_filter::remove(filter_filename());
+
 		std::ofstream target_writer(target_filename(), std::ios::trunc);
 		target_writer.close();
 
@@ -257,9 +266,7 @@ namespace indexer {
 
 	template<typename data_record>
 	void index_builder<data_record>::create_directories() {
-		for (size_t i = 0; i < 8; i++) {
-			boost::filesystem::create_directories("/mnt/" + std::to_string(i) + "/full_text/" + m_db_name);
-		}
+		storage::create_directories("full_text/" + m_db_name);
 	}
 
 	template<typename data_record>
@@ -509,6 +516,9 @@ namespace indexer {
 	template<typename data_record>
 	void index_builder<data_record>::save_file() {
 
+		// Readers search the shard without a filter while it is rewritten, the new filter is written last.
+		key_filter::remove(filter_filename());
+
 		std::ofstream writer(target_filename(), std::ios::binary | std::ios::trunc);
 		if (!writer.is_open()) {
 			throw LOG_ERROR_EXCEPTION("Could not open full text shard. Error: " + std::string(strerror(errno)));
@@ -527,12 +537,14 @@ namespace indexer {
 		}
 
 		std::map<uint64_t, std::vector<uint64_t>> pages;
+		std::vector<uint64_t> shard_keys;
 		for (auto &iter : m_cache) {
 			if (m_hash_table_size) {
 				pages[iter.first % m_hash_table_size].push_back(iter.first);
 			} else {
 				pages[0].push_back(iter.first);
 			}
+			shard_keys.push_back(iter.first);
 		}
 
 		for (const auto &iter : pages) {
@@ -542,6 +554,12 @@ namespace indexer {
 				write_key(key_writer, iter.first, page_pos);
 			}
 		}
+
+		writer.close();
+		if (open_keyfile) {
+			key_writer.close();
+		}
+		key_filter::write(filter_filename(), shard_keys);
 	}
 
 	template<typename data_record>
@@ -700,7 +718,7 @@ namespace indexer {
 
 		if (infile.is_open()) {
 			infile.seekg(sizeof(meta));
-			infile.read(hll->data(), hll->data_size());
+			hll->deserialize(infile);
 
 			// Read total counters.
 			size_t num_total_counters = 0;
@@ -710,7 +728,7 @@ namespace indexer {
 				std::shared_ptr<::algorithm::hyper_log_log> ptr =
 					std::make_shared<::algorithm::hyper_log_log>();
 				infile.read((char *)(&key), sizeof(uint64_t));
-				infile.read(ptr->data(), ptr->data_size());
+				ptr->deserialize(infile);
 				m_result_counters[key] = ptr;
 			}
 		}
@@ -731,46 +749,51 @@ namespace indexer {
 
 		if (outfile.is_open()) {
 			outfile.write((char *)(&m), sizeof(m));
-			outfile.write(hll->data(), hll->data_size());
+			hll->serialize(outfile);
 
 			// Write total counters.
 			const size_t num_total_counters = m_result_counters.size();
 			outfile.write((char *)(&num_total_counters), sizeof(size_t));
 			for (const auto &iter : m_result_counters) {
 				outfile.write((char *)(&iter.first), sizeof(uint64_t));
-				outfile.write(iter.second->data(), iter.second->data_size());
+				iter.second->serialize(outfile);
 			}
 		}
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::mountpoint() const {
-		return std::to_string(m_id % 8);
+		return m_mountpoint;
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::cache_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".cache";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".cache";
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::key_cache_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) +".cache.keys";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) +".cache.keys";
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::key_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".keys";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".keys";
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::target_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".data";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".data";
 	}
 
 	template<typename data_record>
 	std::string index_builder<data_record>::meta_filename() const {
-		return "/mnt/" + mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".meta";
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".meta";
+	}
+
+	template<typename data_record>
+	std::string index_builder<data_record>::filter_filename() const {
+		return mountpoint() + "/full_text/" + m_db_name + "/" + std::to_string(m_id) + ".bloom";
 	}
 
 }
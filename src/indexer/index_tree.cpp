@@ -27,9 +27,12 @@
 #include "index_tree.h"
 #include "merger.h"
 #include "domain_stats/domain_stats.h"
-#include "url_link/link.h"
+#include "url_view.h"
+#include "text/text.h"
 #include "algorithm/algorithm.h"
-#include "utils/thread_pool.hpp"
+#include "utils/scheduler.hpp"
+#include "storage/storage.h"
+#include <atomic>
 
 using namespace std;
 
@@ -76,15 +79,23 @@ namespace indexer {
 
 	void index_tree::add_index_files_threaded(const vector<string> &local_paths, size_t num_threads) {
 
-		utils::thread_pool pool(num_threads);
-
-		for (const string &local_path : local_paths) {
-			pool.enqueue([this, local_path]() -> void {
-				add_index_file(local_path);
+		/*
+			At most num_threads files are processed at the same time, every task takes the next file from the shared
+			index until all files are added.
+		*/
+		atomic<size_t> next_path = 0;
+		utils::task_group tasks(utils::priority::background);
+
+		for (size_t i = 0; i < min(num_threads, local_paths.size()); i++) {
+			tasks.run([this, &local_paths, &next_path]() {
+				size_t path_id;
+				while ((path_id = next_path++) < local_paths.size()) {
+					add_index_file(local_paths[path_id]);
+				}
 			});
 		}
 
-		pool.run_all();
+		tasks.wait();
 
 		m_url_to_domain->write(0);
 		m_hash_table->merge();
@@ -95,29 +106,28 @@ namespace indexer {
 
 		ifstream infile(local_path, ios::in);
 		string line;
+		vector<string_view> col_values;
+		string word_buffer;
+		vector<string_view> words;
 		while (getline(infile, line)) {
-			vector<string> col_values;
-			boost::algorithm::split(col_values, line, boost::is_any_of("\t"));
+			text::split_view(line, col_values);
 
-			URL target_url(col_values[2], col_values[3]);
-			URL source_url(col_values[0], col_values[1]);
+			const url_view target_url(col_values[2], col_values[3]);
+			const url_view source_url(col_values[0], col_values[1]);
 
-			float target_harmonic = domain_stats::harmonic_centrality(target_url);
 			float source_harmonic = domain_stats::harmonic_centrality(source_url);
 
-			const string link_text = col_values[4].substr(0, 1000);
-
-			const url_link::link link(source_url, target_url, source_harmonic, target_harmonic);
+			const string_view link_text = col_values[4].substr(0, 1000);
 
 			const uint64_t domain_link_hash = source_url.domain_link_hash(target_url, link_text);
 			const uint64_t link_hash = source_url.link_hash(target_url, link_text);
 
 			const bool has_url = m_url_to_domain->has_url(target_url.hash());
 
-			vector<string> words = text::get_expanded_full_text_words(link_text);
-			for (const string &word : words) {
+			text::get_expanded_full_text_words(link_text, word_buffer, words);
+			for (string_view word : words) {
 
-				const uint64_t word_hash = ::algorithm::hash(word);
+				const uint64_t word_hash = ::algorithm::murmur_hash(word.data(), word.size());
 
 				domain_link_record rec(domain_link_hash, source_harmonic);
 				rec.m_source_domain = source_url.host_hash();
@@ -139,15 +149,23 @@ namespace indexer {
 
 		m_url_to_domain->read();
 
-		utils::thread_pool pool(num_threads);
-
-		for (auto &local_path : local_paths) {
-			pool.enqueue([this, local_path]() -> void {
-				add_link_file(local_path);
+		/*
+			At most num_threads files are processed at the same time, every task takes the next file from the shared
+			index until all files are added.
+		*/
+		atomic<size_t> next_path = 0;
+		utils::task_group tasks(utils::priority::background);
+
+		for (size_t i = 0; i < min(num_threads, local_paths.size()); i++) {
+			tasks.run([this, &local_paths, &next_path]() {
+				size_t path_id;
+				while ((path_id = next_path++) < local_paths.size()) {
+					add_link_file(local_paths[path_id]);
+				}
 			});
 		}
 
-		pool.run_all();
+		tasks.wait();
 	}
 
 	void index_tree::merge() {
@@ -216,14 +234,10 @@ namespace indexer {
 	}
 
 	void index_tree::create_directories(level_type lvl) {
-		for (size_t i = 0; i < 8; i++) {
-			boost::filesystem::create_directories("/mnt/" + std::to_string(i) + "/full_text/" + level_to_str(lvl));
-		}
+		storage::create_directories("full_text/" + level_to_str(lvl));
 	}
 
 	void index_tree::delete_directories(level_type lvl) {
-		for (size_t i = 0; i < 8; i++) {
-			boost::filesystem::remove_all("/mnt/" + std::to_string(i) + "/full_text/" + level_to_str(lvl));
-		}
+		storage::remove_all("full_text/" + level_to_str(lvl));
 	}
 }
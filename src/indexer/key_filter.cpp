@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "key_filter.h"
+#include "algorithm/bloom_filter.h"
+#include "file/mmap_file.h"
+#include "logger/logger.h"
+#include <fstream>
+#include <cstring>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace indexer {
+
+	namespace key_filter {
+
+		struct mapped_filter {
+			dev_t m_device;
+			ino_t m_inode;
+			off_t m_size;
+			struct timespec m_modified;
+			unique_ptr<file::mmap_file> m_file;
+		};
+
+		shared_mutex filters_lock;
+		unordered_map<string, shared_ptr<const mapped_filter>> filters;
+
+		bool same_file(const mapped_filter &filter, const struct stat &st) {
+			return filter.m_device == st.st_dev && filter.m_inode == st.st_ino && filter.m_size == st.st_size &&
+				filter.m_modified.tv_sec == st.st_mtim.tv_sec && filter.m_modified.tv_nsec == st.st_mtim.tv_nsec;
+		}
+
+		void write(const string &file_name, const vector<uint64_t> &keys) {
+			::algorithm::bloom_filter filter(keys.size());
+			for (uint64_t key : keys) {
+				filter.insert(key);
+			}
+
+			const string tmp_file_name = file_name + ".tmp";
+			ofstream outfile(tmp_file_name, ios::binary | ios::trunc);
+			if (!outfile.is_open()) {
+				throw LOG_ERROR_EXCEPTION("Could not open key filter " + tmp_file_name + ". Error: " + string(strerror(errno)));
+			}
+			filter.serialize(outfile);
+			outfile.close();
+
+			boost::filesystem::rename(tmp_file_name, file_name);
+		}
+
+		void remove(const string &file_name) {
+			boost::system::error_code error;
+			boost::filesystem::remove(file_name, error);
+		}
+
+		bool may_contain(const string &file_name, uint64_t key) {
+			struct stat st;
+			if (stat(file_name.c_str(), &st) != 0) return true;
+
+			shared_ptr<const mapped_filter> filter;
+			{
+				shared_lock lock(filters_lock);
+				auto iter = filters.find(file_name);
+				if (iter != filters.end() && same_file(*iter->second, st)) {
+					filter = iter->second;
+				}
+			}
+
+			if (!filter) {
+				auto mapped = make_shared<mapped_filter>();
+				mapped->m_device = st.st_dev;
+				mapped->m_inode = st.st_ino;
+				mapped->m_size = st.st_size;
+				mapped->m_modified = st.st_mtim;
+				try {
+					mapped->m_file = make_unique<file::mmap_file>(file_name);
+				} catch (const runtime_error &error) {
+					return true;
+				}
+
+				unique_lock lock(filters_lock);
+				filters[file_name] = mapped;
+				filter = mapped;
+			}
+
+			return ::algorithm::bloom_filter::contains(filter->m_file->data(), filter->m_file->size(), key);
+		}
+
+	}
+
+}
@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+namespace indexer {
+
+	/*
+		Bloom filters of the keys in a shard. index_builder and full_text_shard_builder write one next to the key
+		file every time they rewrite a shard, index::find and full_text_shard::find check it first so keys that are
+		not in the shard are answered in memory without opening the key and data files.
+
+		The filters are mmapped once per process and shared by all readers. Every lookup stats the filter file and
+		maps it again if the file was replaced, the builders write the filter to a temporary file and rename it so
+		a filter that is in use is never changed in place. Shards without a filter file are always searched, so the
+		builders remove the filter before they truncate or rewrite the key and data files and write the new one when
+		the files are closed.
+	*/
+	namespace key_filter {
+		void write(const std::string &file_name, const std::vector<uint64_t> &keys);
+		void remove(const std::string &file_name);
+		bool may_contain(const std::string &file_name, uint64_t key);
+	}
+
+}
@@ -40,61 +40,6 @@ namespace indexer {
 		return "unknown";
 	}
 
-	template<typename data_record>
-	std::vector<return_record> level::intersection(const vector<vector<data_record>> &input) const {
-
-		if (input.size() == 0) return {};
-
-		size_t shortest_vector_position = 0;
-		size_t shortest_len = SIZE_MAX;
-		size_t iter_index = 0;
-		for (const vector<data_record> &vec : input) {
-			if (shortest_len > vec.size()) {
-				shortest_len = vec.size();
-				shortest_vector_position = iter_index;
-			}
-			iter_index++;
-		}
-
-		vector<size_t> positions(input.size(), 0);
-		vector<return_record> intersection;
-
-		while (positions[shortest_vector_position] < shortest_len) {
-
-			bool all_equal = true;
-			data_record value = input[shortest_vector_position][positions[shortest_vector_position]];
-
-			float score_sum = 0.0f;
-			size_t iter_index = 0;
-			for (const vector<data_record> &vec : input) {
-				const size_t len = vec.size();
-
-				size_t *pos = &(positions[iter_index]);
-				while (*pos < len && value.m_value > vec[*pos].m_value) {
-					(*pos)++;
-				}
-				if (*pos < len && value.m_value == vec[*pos].m_value) {
-					score_sum += vec[*pos].m_score;
-				}
-				if (((*pos < len) && (value.m_value < vec[*pos].m_value)) || *pos >= len) {
-					all_equal = false;
-					break;
-				}
-				iter_index++;
-			}
-			if (all_equal) {
-				intersection.emplace_back(generic_record(
-					input[shortest_vector_position][positions[shortest_vector_position]].m_value,
-					score_sum / input.size()
-					));
-			}
-
-			positions[shortest_vector_position]++;
-		}
-
-		return intersection;
-	}
-
 	template<typename data_record>
 	std::vector<return_record> level::summed_union(const vector<vector<data_record>> &input) const {
 		vector<return_record> records;
@@ -45,8 +45,9 @@ namespace indexer {
 
 	/*
 	This is the base class for the record stored on disk. Needs to be small!
+	The packing is popped at the end of this file so it does not leak into headers included after this one.
 	*/
-	#pragma pack(4)
+	#pragma pack(push, 4)
 	class generic_record {
 
 		public:
@@ -244,4 +245,62 @@ namespace indexer {
 		std::vector<return_record> find(const std::string &query, const std::vector<size_t> &keys,
 			const std::vector<link_record> &links, const std::vector<domain_link_record> &domain_links);
 	};
+
+	template<typename data_record>
+	std::vector<return_record> level::intersection(const std::vector<std::vector<data_record>> &input) const {
+
+		if (input.size() == 0) return {};
+
+		size_t shortest_vector_position = 0;
+		size_t shortest_len = SIZE_MAX;
+		size_t iter_index = 0;
+		for (const std::vector<data_record> &vec : input) {
+			if (shortest_len > vec.size()) {
+				shortest_len = vec.size();
+				shortest_vector_position = iter_index;
+			}
+			iter_index++;
+		}
+
+		std::vector<size_t> positions(input.size(), 0);
+		std::vector<return_record> intersection;
+
+		while (positions[shortest_vector_position] < shortest_len) {
+
+			bool all_equal = true;
+			data_record value = input[shortest_vector_position][positions[shortest_vector_position]];
+
+			float score_sum = 0.0f;
+			size_t iter_index = 0;
+			for (const std::vector<data_record> &vec : input) {
+				const size_t len = vec.size();
+
+				size_t *pos = &(positions[iter_index]);
+				while (*pos < len && value.m_value > vec[*pos].m_value) {
+					(*pos)++;
+				}
+				if (*pos < len && value.m_value == vec[*pos].m_value) {
+					score_sum += vec[*pos].m_score;
+				}
+				if (((*pos < len) && (value.m_value < vec[*pos].m_value)) || *pos >= len) {
+					all_equal = false;
+					break;
+				}
+				iter_index++;
+			}
+			if (all_equal) {
+				intersection.emplace_back(generic_record(
+					input[shortest_vector_position][positions[shortest_vector_position]].m_value,
+					score_sum / input.size()
+					));
+			}
+
+			positions[shortest_vector_position]++;
+		}
+
+		return intersection;
+	}
+
+	#pragma pack(pop)
+
 }
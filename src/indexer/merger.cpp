@@ -28,9 +28,13 @@
 #include "memory/memory.h"
 #include "memory/debugger.h"
 #include "utils/thread_pool.hpp"
+#include "utils/scheduler.hpp"
 #include <map>
+#include <set>
+#include <vector>
 #include <chrono>
 #include <thread>
+#include <condition_variable>
 
 using namespace std;
 
@@ -45,6 +49,13 @@ namespace indexer {
 		map<size_t, std::function<void()>> appenders;
 		mutex merger_lock;
 
+		/*
+		 * Ids of appenders currently running in append_all. deregister_merger waits for its id to leave this set so the
+		 * object is not destroyed under a running append. merger_lock is never held while waiting for the tasks.
+		 * */
+		set<size_t> running_appenders;
+		condition_variable appenders_done;
+
 		void wait_for_merges() {
 			while (is_merging) {
 				std::this_thread::sleep_for(100ms);
@@ -70,10 +81,10 @@ namespace indexer {
 		}
 
 		void deregister_merger(size_t id) {
-			merger_lock.lock();
+			unique_lock lock(merger_lock);
 			appenders.erase(id);
 			mergers.erase(id);
-			merger_lock.unlock();
+			appenders_done.wait(lock, [id]() { return running_appenders.count(id) == 0; });
 		}
 
 		bool merge_thread_is_running = true;
@@ -88,24 +99,36 @@ namespace indexer {
 			std::cout << "APPENDING ALL: " << appenders.size() << " mergers allocated memory: " << memory::allocated_memory() << " limit is: " <<
 				(available_memory * mem_limit) << std::endl;
 			
-			utils::thread_pool pool(24);
+			utils::task_group tasks(utils::priority::background);
+
+			vector<pair<size_t, std::function<void()>>> to_append;
+			{
+				lock_guard lock(merger_lock);
+				for (auto &iter : appenders) {
+					to_append.push_back(iter);
+					running_appenders.insert(iter.first);
+				}
+			}
 
-			merger_lock.lock();
-			for (auto &iter : appenders) {
-				pool.enqueue([iter]() {
+			for (auto &iter : to_append) {
+				tasks.run([iter]() {
 					try {
 						iter.second();
 					} catch (...) {
 
 					}
+					{
+						lock_guard lock(merger_lock);
+						running_appenders.erase(iter.first);
+					}
+					appenders_done.notify_all();
 				});
 			}
 
-			pool.run_all();
+			tasks.wait();
 
 			cout << "done... allocated memory: " << memory::allocated_memory() << endl;
 
-			merger_lock.unlock();
 			is_merging = false;
 		}
 
@@ -26,14 +26,12 @@
 
 #include "score_builder.h"
 #include <iostream>
-#include <map>
 
 namespace indexer {
 
-	score_builder::score_builder(size_t num_documents, const std::map<uint64_t, size_t> *document_sizes)
-	: m_num_documents(num_documents), m_document_sizes(document_sizes)
+	score_builder::score_builder(size_t num_documents, const document_stats *stats)
+	: m_num_documents(num_documents), m_avg_document_size(stats->avg_document_size()), m_document_stats(stats)
 	{
-		calculate_avg_document_size();
 	}
 		
 	float score_builder::score() const {
@@ -41,21 +39,7 @@ namespace indexer {
 	}
 
 	size_t score_builder::document_size(uint64_t doc_id) const {
-		if (m_document_sizes->count(doc_id)) {
-			return m_document_sizes->at(doc_id);
-		}
-		return 0;
-	}
-
-	void score_builder::calculate_avg_document_size() {
-		m_avg_document_size = 0.0f;
-		if (m_document_sizes->size()) {
-			size_t sum = 0;
-			for (const auto &iter : *m_document_sizes) {
-				sum += iter.second;
-			}
-			m_avg_document_size = (float)sum / m_document_sizes->size();
-		}
+		return m_document_stats->document_size(doc_id);
 	}
 
 }
@@ -27,7 +27,7 @@
 #pragma once
 
 #include <iostream>
-#include <map>
+#include "document_stats.h"
 
 namespace indexer {
 
@@ -35,7 +35,7 @@ namespace indexer {
 
 	public:
 
-		score_builder(size_t num_documents, const std::map<uint64_t, size_t> *document_sizes);
+		score_builder(size_t num_documents, const document_stats *stats);
 		
 		float score() const;
 		size_t document_count() const { return m_num_documents; }
@@ -46,9 +46,7 @@ namespace indexer {
 
 		size_t m_num_documents;
 		float m_avg_document_size;
-		const std::map<uint64_t, size_t> *m_document_sizes;
-
-		void calculate_avg_document_size();
+		const document_stats *m_document_stats;
 
 	};
 
@@ -27,7 +27,7 @@
 #pragma once
 
 #include "index_builder.h"
-#include "algorithm/hyper_log_log.h"
+#include "document_stats.h"
 
 namespace indexer {
 
@@ -54,8 +54,8 @@ namespace indexer {
 		*/
 		void calculate_scores(algorithm algo);
 
-		size_t num_documents() const { return m_document_counter.count(); }
-		size_t document_size(uint64_t document_id) { return m_document_sizes[document_id]; }
+		size_t num_documents() const { return m_document_stats.num_documents(); }
+		size_t document_size(uint64_t document_id) const { return m_document_stats.document_size(document_id); }
 
 		void truncate();
 		void truncate_cache_files();
@@ -65,9 +65,7 @@ namespace indexer {
 
 		std::string m_db_name;
 		std::vector<std::shared_ptr<index_builder<data_record>>> m_shards;
-		::algorithm::hyper_log_log m_document_counter;
-		std::map<uint64_t, size_t> m_document_sizes;
-		float m_avg_document_size = 0.0f;
+		document_stats m_document_stats;
 
 		void read_meta();
 		void write_meta();
@@ -89,7 +87,7 @@ namespace indexer {
 	sharded_index_builder<data_record>::sharded_index_builder(const std::string &db_name, size_t num_shards,
 			size_t hash_table_size) {
 	
-		db_name = m_db_name;
+		m_db_name = db_name;
 		for (size_t shard_id = 0; shard_id < num_shards; shard_id++) {
 			m_shards.push_back(std::make_shared<index_builder<data_record>>(db_name, shard_id, hash_table_size));
 		}
@@ -105,8 +103,7 @@ namespace indexer {
 	void sharded_index_builder<data_record>::add(uint64_t key, const data_record &record) {
 		m_shards[key % m_shards.size()]->add(key, record);
 
-		m_document_counter.insert(record.m_value);
-		m_document_sizes[record.m_value]++; // Raw non unique document size.
+		m_document_stats.add(record.m_value); // Raw non unique document size.
 	}
 
 	template<typename data_record>
@@ -114,6 +111,7 @@ namespace indexer {
 		for (auto &shard : m_shards) {
 			shard->append();
 		}
+		m_document_stats.merge();
 	}
 
 	template<typename data_record>
@@ -128,7 +126,7 @@ namespace indexer {
 	void sharded_index_builder<data_record>::calculate_scores(algorithm algo) {
 
 		const size_t num_docs = num_documents();
-		score_builder score(num_docs, &m_document_sizes);
+		score_builder score(num_docs, &m_document_stats);
 		
 		for (auto &shard : m_shards) {
 			shard->calculate_scores(algo, score);
@@ -141,8 +139,7 @@ namespace indexer {
 			shard->truncate();
 		}
 		std::ofstream meta_file(filename(), std::ios::trunc);
-		m_document_sizes.clear();
-		m_document_counter.reset();
+		m_document_stats.reset();
 	}
 
 	template<typename data_record>
@@ -165,19 +162,7 @@ namespace indexer {
 
 		if (meta_file.is_open()) {
 
-			meta_file.seekg(sizeof(size_t));
-			char *data = m_document_counter.data();
-			meta_file.read(data, m_document_counter.data_size());
-
-			size_t num_docs = 0;
-			meta_file.read((char *)(&num_docs), sizeof(size_t));
-			for (size_t i = 0; i < num_docs; i++) {
-				uint64_t doc_id = 0;
-				size_t count = 0;
-				meta_file.read((char *)(&doc_id), sizeof(uint64_t));
-				meta_file.read((char *)(&count), sizeof(size_t));
-				m_document_sizes[doc_id] = count;
-			}
+			m_document_stats.deserialize(meta_file);
 		}
 	}
 
@@ -187,25 +172,14 @@ namespace indexer {
 
 		if (meta_file.is_open()) {
 
-			size_t document_count = m_document_counter.count();
-
-			meta_file.write((char *)&document_count, sizeof(size_t));
-			char *data = m_document_counter.data();
-			meta_file.write(data, m_document_counter.data_size());
-
-			// Write document sizes.
-			const size_t num_docs = m_document_sizes.size();
-			meta_file.write((char *)(&num_docs), sizeof(size_t));
-			for (const auto &iter : m_document_sizes) {
-				meta_file.write((char *)(&iter.first), sizeof(uint64_t));
-				meta_file.write((char *)(&iter.second), sizeof(size_t));
-			}
+			m_document_stats.merge();
+			m_document_stats.serialize(meta_file);
 		}
 	}
 
 	template<typename data_record>
 	std::string sharded_index_builder<data_record>::filename() const {
 		// This file will contain meta data on the index. For example the hyper log log document counter.
-		return "/mnt/0/full_text/" + m_db_name + ".meta";
+		return storage::primary_path("full_text/" + m_db_name + ".meta");
 	}
 }
@@ -26,43 +26,182 @@
 
 #include "logger.h"
 #include <thread>
-#include <queue>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
 
 using namespace std;
 
 namespace logger {
 
+	namespace {
+
+		struct entry_header {
+			uint32_t m_size; // Size of the entry including header and padding.
+			uint32_t m_flags;
+			int64_t m_time_ns;
+			int32_t m_line;
+			uint32_t m_type_len;
+			uint32_t m_file_len;
+			uint32_t m_message_len;
+			uint32_t m_meta_len;
+			uint32_t m_unused;
+		};
+
+		const uint32_t entry_formatted = 0; // Formatted on the logger thread.
+		const uint32_t entry_raw = 1; // Written as is, from log_string.
+		const uint32_t entry_padding = 2; // Skip to the start of the ring.
+
+		/*
+			Single producer single consumer ring of log entries, one per thread that logs. The producer only writes
+			m_head and the consumer only writes m_tail so neither side takes a lock.
+		*/
+		class ring_buffer {
+
+			public:
+
+				static const size_t capacity = 1 << 18;
+
+				ring_buffer() : m_data(new uint64_t[capacity / sizeof(uint64_t)]) {}
+
+				// Returns false if the entry does not fit, the caller has to handle it some other way.
+				bool write(entry_header header, string_view type, string_view file, string_view message, string_view meta) {
+					const size_t size = (sizeof(entry_header) + type.size() + file.size() + message.size() + meta.size() + 7) & ~(size_t)7;
+					if (size > capacity / 4) return false;
+
+					size_t head = m_head.load(memory_order_relaxed);
+					const size_t tail = m_tail.load(memory_order_acquire);
+					size_t pos = head & (capacity - 1);
+					const size_t padding = pos + size > capacity ? capacity - pos : 0;
+					if (head + padding + size - tail > capacity) return false;
+
+					char *data = (char *)m_data.get();
+					if (padding) {
+						// Only the size and flags of a padding entry are read, they always fit since entries are 8 byte aligned.
+						const uint32_t padding_header[2] = {(uint32_t)padding, entry_padding};
+						memcpy(data + pos, padding_header, sizeof(padding_header));
+						head += padding;
+						pos = 0;
+					}
+
+					header.m_size = size;
+					header.m_type_len = type.size();
+					header.m_file_len = file.size();
+					header.m_message_len = message.size();
+					header.m_meta_len = meta.size();
+
+					char *ptr = data + pos;
+					memcpy(ptr, &header, sizeof(entry_header));
+					ptr += sizeof(entry_header);
+					memcpy(ptr, type.data(), type.size());
+					ptr += type.size();
+					memcpy(ptr, file.data(), file.size());
+					ptr += file.size();
+					memcpy(ptr, message.data(), message.size());
+					ptr += message.size();
+					memcpy(ptr, meta.data(), meta.size());
+
+					m_head.store(head + size, memory_order_release);
+					return true;
+				}
+
+				// Calls callback for every entry in the ring and frees them. Returns the number of entries.
+				template<typename callback_type>
+				size_t read(const callback_type &callback) {
+					size_t tail = m_tail.load(memory_order_relaxed);
+					const size_t head = m_head.load(memory_order_acquire);
+					const char *data = (const char *)m_data.get();
+					size_t num_entries = 0;
+					while (tail < head) {
+						const char *ptr = data + (tail & (capacity - 1));
+						uint32_t size_and_flags[2];
+						memcpy(size_and_flags, ptr, sizeof(size_and_flags));
+						if (size_and_flags[1] != entry_padding) {
+							entry_header header;
+							memcpy(&header, ptr, sizeof(entry_header));
+							const char *type = ptr + sizeof(entry_header);
+							const char *file = type + header.m_type_len;
+							const char *message = file + header.m_file_len;
+							const char *meta = message + header.m_message_len;
+							callback(header, string_view(type, header.m_type_len), string_view(file, header.m_file_len),
+								string_view(message, header.m_message_len), string_view(meta, header.m_meta_len));
+							num_entries++;
+						}
+						tail += size_and_flags[0];
+					}
+					m_tail.store(tail, memory_order_release);
+					return num_entries;
+				}
+
+				bool empty() const {
+					return m_tail.load(memory_order_acquire) == m_head.load(memory_order_acquire);
+				}
+
+				atomic<bool> m_abandoned = false;
+
+			private:
+
+				unique_ptr<uint64_t[]> m_data;
+				alignas(64) atomic<size_t> m_head = 0;
+				alignas(64) atomic<size_t> m_tail = 0;
+
+		};
+
+		mutex m_rings_lock;
+		vector<shared_ptr<ring_buffer>> m_rings;
+
+		// Marks the ring as abandoned when the thread exits, the logger thread drops it when it is empty.
+		struct thread_ring {
+			shared_ptr<ring_buffer> m_ring;
+			~thread_ring() {
+				if (m_ring) m_ring->m_abandoned = true;
+			}
+		};
+
+		thread_local thread_ring t_ring;
+
+		ring_buffer &local_ring() {
+			if (!t_ring.m_ring) {
+				t_ring.m_ring = make_shared<ring_buffer>();
+				lock_guard lock(m_rings_lock);
+				m_rings.push_back(t_ring.m_ring);
+			}
+			return *t_ring.m_ring;
+		}
+
+		int64_t now_ns() {
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+		}
+
+	}
+
 	thread m_logger_thread;
-	mutex *m_lock = nullptr;
-	queue<string> *m_queue = nullptr;
+	mutex m_lock;
+	vector<pair<int64_t, string>> m_overflow; // Entries that did not fit in the ring buffer, already formatted.
 	ofstream m_file;
 	chrono::seconds m_reopen_interval = std::chrono::seconds(300);
 	chrono::system_clock::time_point m_last_reopen;
-	bool m_verbose = false;
-	bool m_run_logger = true;
-	bool m_logger_started = false;
+	atomic<bool> m_verbose = false;
+	atomic<bool> m_run_logger = true;
+	atomic<bool> m_logger_started = false;
+	atomic<size_t> m_rounds = 0;
 
 	void verbose(bool verbose) {
 		m_verbose = verbose;
 	}
 
 	void initialize() {
-		m_lock = new mutex;
-		m_queue = new queue<string>;
 		m_logger_started = true;
 	}
 
 	void de_initialize() {
-		delete m_lock;
-		delete m_queue;
-		m_lock = nullptr;
-		m_queue = nullptr;
 		m_logger_started = false;
 	}
 
 	void reopen() {
 		auto now = chrono::system_clock::now();
-		m_lock->lock();
+		m_lock.lock();
 		if (now - m_last_reopen > m_reopen_interval) {
 			m_last_reopen = now;
 			try {
@@ -79,10 +218,26 @@ namespace logger {
 				} catch (...) {
 					
 				}
+				m_lock.unlock();
 				throw error;
 			}
 		}
-		m_lock->unlock();
+		m_lock.unlock();
+	}
+
+	void append_timestamp(int64_t time_ns, string &output) {
+		// Formatting the date is the slow part so the last second is cached, only the logger thread calls this.
+		static int64_t cached_second = -1;
+		static char cached[100];
+		const int64_t second = time_ns / 1000000000;
+		if (second != cached_second) {
+			time_t tt = second;
+			tm gmt{}; gmtime_r(&tt, &gmt);
+			snprintf(cached, sizeof(cached), "%04d-%02d-%02d %02d:%02d:%02d", gmt.tm_year + 1900, (short)gmt.tm_mon + 1,
+				(short)gmt.tm_mday, (short)gmt.tm_hour, (short)gmt.tm_min, (short)gmt.tm_sec);
+			cached_second = second;
+		}
+		output.append(cached, 19);
 	}
 
 	string timestamp() {
@@ -96,52 +251,126 @@ namespace logger {
 		return buffer;
 	}
 
+	void append_entry(string_view type, string_view file, int line, string_view message, string_view meta, string &output) {
+		output.append(" [");
+		output.append(type);
+		output.append("] ");
+		output.append(file);
+		output.append(":");
+		output.append(to_string(line));
+		output.append(" ");
+		output.append(message);
+		output.append(" ");
+		output.append(meta);
+	}
+
 	string format(const string &type, const string &file, int line, const string &message, const string &meta) {
-		string output;
-		output.append(timestamp());
-		output.append(" [" + type + "]");
-		output.append(" " + file + ":" + to_string(line));
-		output.append(" " + message);
-		output.append(" " + meta);
+		string output = timestamp();
+		append_entry(type, file, line, message, meta, output);
 		return output;
 	}
 
+	void log_entry(string_view type, string_view file, int line, string_view message, string_view meta) {
+		if (!m_logger_started) return; // logger thread not started.
+		entry_header header{};
+		header.m_flags = entry_formatted;
+		header.m_time_ns = now_ns();
+		header.m_line = line;
+		if (!local_ring().write(header, type, file, message, meta)) {
+			string output = timestamp();
+			append_entry(type, file, line, message, meta, output);
+			lock_guard lock(m_lock);
+			m_overflow.emplace_back(header.m_time_ns, std::move(output));
+		}
+	}
+
 	void log_message(const string &type, const string &file, int line, const string &message, const string &meta) {
-		log_string(format(type, file, line, message, meta));
+		log_entry(type, file, line, message, meta);
 	}
 
 	void log_string(const string &message) {
-		if (!m_logger_started || m_lock == nullptr || m_queue == nullptr) return; // logger thread not started.
-		m_lock->lock();
-		if (m_verbose) cout << message << endl;
-		m_queue->push(message);
-		m_lock->unlock();
+		if (!m_logger_started) return; // logger thread not started.
+		entry_header header{};
+		header.m_flags = entry_raw;
+		header.m_time_ns = now_ns();
+		if (!local_ring().write(header, "", "", message, "")) {
+			lock_guard lock(m_lock);
+			m_overflow.emplace_back(header.m_time_ns, message);
+		}
 	}
 
 	void log(const string &type, const string &file, int line, const string &message) {
-		log_message(type, file, line, message, "");
+		log_entry(type, file, line, message);
 	}
 
-	void write_message_to_logfile(const string &message) {
-		m_file << message << endl;
+	void log(const string &type, const string &file, int line, const string &message, const string &meta) {
+		log_entry(type, file, line, message, meta);
+	}
+
+	/*
+		Formats and writes everything in the ring buffers and the overflow. Entries are sorted by time since they come
+		from different threads. Returns the number of written entries.
+	*/
+	size_t write_round(vector<pair<int64_t, string>> &entries) {
+		entries.clear();
+
+		vector<shared_ptr<ring_buffer>> rings;
+		{
+			lock_guard lock(m_rings_lock);
+			// Drop rings of threads that have exited once they are empty.
+			m_rings.erase(remove_if(m_rings.begin(), m_rings.end(), [](const shared_ptr<ring_buffer> &ring) {
+				return ring->m_abandoned && ring->empty();
+			}), m_rings.end());
+			rings = m_rings;
+		}
+
+		for (auto &ring : rings) {
+			ring->read([&entries](const entry_header &header, string_view type, string_view file, string_view message,
+					string_view meta) {
+				string output;
+				if (header.m_flags == entry_raw) {
+					output = message;
+				} else {
+					append_timestamp(header.m_time_ns, output);
+					append_entry(type, file, header.m_line, message, meta, output);
+				}
+				entries.emplace_back(header.m_time_ns, std::move(output));
+			});
+		}
+		{
+			lock_guard lock(m_lock);
+			for (auto &entry : m_overflow) {
+				entries.push_back(std::move(entry));
+			}
+			m_overflow.clear();
+		}
+
+		stable_sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+			return a.first < b.first;
+		});
+
+		for (const auto &entry : entries) {
+			if (m_verbose) cout << entry.second << endl;
+			m_file << entry.second << '\n';
+		}
+		if (entries.size()) m_file.flush();
+
+		return entries.size();
 	}
 
 	void logger_thread() {
 		initialize();
 		reopen();
+		vector<pair<int64_t, string>> entries;
 		while (true) {
-			while (m_queue->empty() && m_run_logger) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(50));
-			}
+			const bool run_logger = m_run_logger;
+			const size_t num_written = write_round(entries);
+			m_rounds++;
 
-			if (m_queue->empty()) break;
-
-			m_lock->lock();
-			string message = m_queue->front();
-			m_queue->pop();
-			m_lock->unlock();
-
-			write_message_to_logfile(message);
+			if (num_written == 0) {
+				if (!run_logger) break;
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
 		}
 
 		de_initialize();
@@ -168,7 +397,27 @@ namespace logger {
 	}
 
 	void sync() {
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		// The round that is running might have passed our ring already, the one after it has not.
+		const size_t target = m_rounds + 2;
+		for (size_t i = 0; i < 1000 && m_logger_started && m_rounds < target; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	rate_limiter::rate_limiter(size_t per_second)
+	: m_interval_ns(1000000000 / max<size_t>(per_second, 1)), m_burst_ns(1000000000), m_next_ns(0)
+	{
+	}
+
+	bool rate_limiter::allow() {
+		// Generic cell rate algorithm, m_next_ns is the theoretical arrival time of the next call.
+		const int64_t now = now_ns();
+		int64_t next = m_next_ns.load(memory_order_relaxed);
+		while (true) {
+			const int64_t new_next = max(next, now) + m_interval_ns;
+			if (new_next - now > m_burst_ns) return false;
+			if (m_next_ns.compare_exchange_weak(next, new_next, memory_order_relaxed)) return true;
+		}
 	}
 
 	logged_exception::logged_exception(const string &message, const string &file, int line)
@@ -177,4 +426,3 @@ namespace logger {
 		m_formatted_message = format("EXCEPTION", m_file, m_line, m_message, "");
 	}
 }
-
@@ -30,9 +30,39 @@
 #include <mutex>
 #include <fstream>
 #include <iostream>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
 
-#define LOG_INFO(msg) (logger::log("info", __FILE__, __LINE__, msg))
-#define LOG_ERROR(msg) (logger::log("error", __FILE__, __LINE__, msg))
+/*
+	Log levels below LOG_LEVEL are compiled away, the message expression is not even evaluated.
+*/
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_ERROR 2
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(msg) (logger::log_entry("debug", __FILE__, __LINE__, msg))
+#else
+#define LOG_DEBUG(msg) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(msg) (logger::log_entry("info", __FILE__, __LINE__, msg))
+// Logs at most per_second messages per second from this line, the message is not built for dropped messages.
+#define LOG_INFO_RATE_LIMITED(per_second, msg) \
+	([]() { static logger::rate_limiter limiter(per_second); return limiter.allow(); }() ? \
+	logger::log_entry("info", __FILE__, __LINE__, msg) : (void)0)
+#else
+#define LOG_INFO(msg) ((void)0)
+#define LOG_INFO_RATE_LIMITED(per_second, msg) ((void)0)
+#endif
+
+#define LOG_ERROR(msg) (logger::log_entry("error", __FILE__, __LINE__, msg))
 
 #define LOG_ERROR_EXCEPTION(msg) (logger::logged_exception(msg, std::string(__FILE__), __LINE__))
 
@@ -44,14 +74,41 @@ namespace logger {
 	void log_message(const std::string &type, const std::string &file, int line, const std::string &message, const std::string &meta);
 	void log_string(const std::string &message);
 
+	/*
+		Copies the entry into the ring buffer of the calling thread without taking any lock, the logger thread formats
+		and writes it. This is what the LOG_ macros call.
+	*/
+	void log_entry(std::string_view type, std::string_view file, int line, std::string_view message,
+		std::string_view meta = std::string_view());
+
 	// Should be called like this: logger::log("error", __FILE__, __LINE__, error.what());
 	void log(const std::string &type, const std::string &file, int line, const std::string &message);
 	void log(const std::string &type, const std::string &file, int line, const std::string &message, const std::string &meta);
 
 	void start_logger_thread();
 	void join_logger_thread();
+
+	// Waits until everything logged before the call is written to the log file.
 	void sync();
 
+	/*
+		Token bucket that allows per_second calls per second with bursts of the same size. Used by
+		LOG_INFO_RATE_LIMITED, one limiter per call site.
+	*/
+	class rate_limiter {
+
+		public:
+			explicit rate_limiter(size_t per_second);
+
+			bool allow();
+
+		private:
+			const int64_t m_interval_ns;
+			const int64_t m_burst_ns;
+			std::atomic<int64_t> m_next_ns;
+
+	};
+
 	class logged_exception : public std::exception {
 
 		public:
@@ -31,7 +31,9 @@
 #include <new>
 #include <cstdlib>
 #include <array>
+#include <atomic>
 #include <mutex>
+#include <malloc.h>
 
 using namespace std;
 
@@ -40,28 +42,61 @@ using namespace std;
 	is running a virtual memory system we can only know exactly how many bytes we have allocated right now if we
 	keep a counter ourselves.
 
-	To do this we overload the global new, new[], delete and delete[] operators.
+	To do this we overload the global new, new[], delete and delete[] operators. The size of a freed pointer is taken
+	from malloc_usable_size so the counted bytes include the allocator rounding.
 
-	The problem is knowing how much memory is freed, we only have the pointer and not the length. To fix this issue
-	we allocate sizeof(size_t) bytes more when allocating memory, then we store the length there and return a pointer
-	to the address at offset "sizeof(size_t)" from the allocated pointer.
-
-	This seems like absolute madness at first but I don't have any other solution.
+	The counters are split in cache line sized shards, each thread picks one shard the first time it allocates. A
+	pointer can be freed on another thread than it was allocated on so a single shard can go negative, only the sum
+	over all shards is meaningful.
 */
 
 namespace memory {
 
-	mutex lock;
-	size_t mem_counter;
-	size_t ptr_counter;
+	struct alignas(64) counter_shard {
+		atomic<int64_t> m_bytes;
+		atomic<int64_t> m_pointers;
+	};
+
+	const size_t num_counter_shards = 64;
+	array<counter_shard, num_counter_shards> counter_shards;
+	atomic<size_t> next_counter_shard(0);
+	thread_local size_t thread_counter_shard = SIZE_MAX;
+
 	size_t total_memory_on_host = 0;
 
+	inline counter_shard &local_counter_shard() {
+		if (thread_counter_shard == SIZE_MAX) {
+			thread_counter_shard = next_counter_shard.fetch_add(1, memory_order_relaxed) % num_counter_shards;
+		}
+		return counter_shards[thread_counter_shard];
+	}
+
+	inline void count_allocation(void *p) {
+		counter_shard &shard = local_counter_shard();
+		shard.m_bytes.fetch_add(malloc_usable_size(p), memory_order_relaxed);
+		shard.m_pointers.fetch_add(1, memory_order_relaxed);
+	}
+
+	inline void count_deallocation(void *p) {
+		counter_shard &shard = local_counter_shard();
+		shard.m_bytes.fetch_sub(malloc_usable_size(p), memory_order_relaxed);
+		shard.m_pointers.fetch_sub(1, memory_order_relaxed);
+	}
+
 	size_t allocated_memory() {
-		return mem_counter;
+		int64_t sum = 0;
+		for (const counter_shard &shard : counter_shards) {
+			sum += shard.m_bytes.load(memory_order_relaxed);
+		}
+		return sum > 0 ? sum : 0;
 	}
 
 	size_t num_allocated() {
-		return ptr_counter;
+		int64_t sum = 0;
+		for (const counter_shard &shard : counter_shards) {
+			sum += shard.m_pointers.load(memory_order_relaxed);
+		}
+		return sum > 0 ? sum : 0;
 	}
 
 	size_t record_usage_base = 0;
@@ -122,15 +157,11 @@ namespace memory {
 // https://en.cppreference.com/w/cpp/memory/new/operator_new
 void *operator new(size_t n) {
 
-	void *m = malloc(n + sizeof(size_t));
+	void *m = malloc(n);
 
 	if (m) {
-		memory::lock.lock();
-		memory::mem_counter += n;
-		memory::ptr_counter++;
-		memory::lock.unlock();
-		static_cast<size_t *>(m)[0] = n;
-		return &(static_cast<size_t *>(m)[1]);
+		memory::count_allocation(m);
+		return m;
 	}
 
 	throw bad_alloc();
@@ -138,15 +169,11 @@ void *operator new(size_t n) {
 
 void *operator new[](size_t n) {
 
-	void *m = malloc(n + sizeof(size_t));
+	void *m = malloc(n);
 
 	if (m) {
-		memory::lock.lock();
-		memory::mem_counter += n;
-		memory::ptr_counter++;
-		memory::lock.unlock();
-		static_cast<size_t *>(m)[0] = n;
-		return &(static_cast<size_t *>(m)[1]);
+		memory::count_allocation(m);
+		return m;
 	}
 
 	throw bad_alloc();
@@ -154,26 +181,18 @@ void *operator new[](size_t n) {
 
 void operator delete(void *p) noexcept {
 
-	void *realp = &(static_cast<size_t *>(p)[-1]);
-	const size_t n = static_cast<size_t *>(p)[-1];
+	if (p == nullptr) return;
 
-	memory::lock.lock();
-	memory::mem_counter -= n;
-	memory::ptr_counter--;
-	memory::lock.unlock();
+	memory::count_deallocation(p);
 
-	free(realp);
+	free(p);
 }
 
 void operator delete[](void *p) noexcept {
 
-	void *realp = &(static_cast<size_t *>(p)[-1]);
-	const size_t n = static_cast<size_t *>(p)[-1];
+	if (p == nullptr) return;
 
-	memory::lock.lock();
-	memory::mem_counter -= n;
-	memory::ptr_counter--;
-	memory::lock.unlock();
+	memory::count_deallocation(p);
 
-	free(realp);
+	free(p);
 }
@@ -82,9 +82,9 @@ namespace parser {
 		}
 	}
 
-	bool unicode::is_valid(const std::string &str) {
+	bool unicode::is_valid(std::string_view str) {
 		
-		const char *cstr = str.c_str();
+		const char *cstr = str.data();
 		size_t len = str.size();
 
 		size_t utf8_len = 0;
@@ -32,18 +32,18 @@ using namespace std;
 
 namespace profiler {
 
-	std::chrono::_V2::system_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
 
 	instance::instance(const string &name) :
 		m_name(name)
 	{
-		m_start_time = std::chrono::high_resolution_clock::now();
+		m_start_time = std::chrono::steady_clock::now();
 	}
 
 	instance::instance() :
 		m_name("unnamed profile")
 	{
-		m_start_time = std::chrono::high_resolution_clock::now();
+		m_start_time = std::chrono::steady_clock::now();
 	}
 
 	instance::~instance() {
@@ -58,7 +58,7 @@ namespace profiler {
 
 	double instance::get() const {
 		if (!m_enabled) return 0;
-		auto timer_elapsed = chrono::high_resolution_clock::now() - m_start_time;
+		auto timer_elapsed = chrono::steady_clock::now() - m_start_time;
 		auto microseconds = chrono::duration_cast<std::chrono::microseconds>(timer_elapsed).count();
 
 		return (double)microseconds/1000;
@@ -66,7 +66,7 @@ namespace profiler {
 
 	double instance::get_micro() const {
 		if (!m_enabled) return 0;
-		auto timer_elapsed = chrono::high_resolution_clock::now() - m_start_time;
+		auto timer_elapsed = chrono::steady_clock::now() - m_start_time;
 		auto microseconds = chrono::duration_cast<std::chrono::microseconds>(timer_elapsed).count();
 
 		return (double)microseconds;
@@ -96,11 +96,9 @@ namespace profiler {
 	void tick(const string &name, const string &section) {
 
 	}
-	void report_reset();
-	void report_print();
 
 	double now_micro() {
-		auto timer_elapsed = chrono::high_resolution_clock::now() - start_time;
+		auto timer_elapsed = chrono::steady_clock::now() - start_time;
 		auto microseconds = chrono::duration_cast<std::chrono::microseconds>(timer_elapsed).count();
 
 		return (double)microseconds;
@@ -30,6 +30,7 @@
 #include <chrono>
 #include <fstream>
 #include <unistd.h>
+#include "trace.h"
 
 namespace profiler {
 
@@ -51,7 +52,7 @@ namespace profiler {
 		std::string m_name;
 		bool m_enabled = true;
 		bool m_has_stopped = false;
-		std::chrono::_V2::system_clock::time_point m_start_time;
+		std::chrono::steady_clock::time_point m_start_time;
 	};
 
 	void print_memory_status();
@@ -0,0 +1,402 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trace.h"
+#include "profiler.h"
+#include "logger/logger.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+
+using namespace std;
+using json = nlohmann::ordered_json;
+
+namespace profiler {
+
+	namespace {
+
+		const size_t max_span_names = 128;
+		const size_t max_trace_spans = 100000;
+
+		size_t bucket_for(uint64_t nanos) {
+			if (nanos == 0) return 0;
+			const size_t bucket = 64 - __builtin_clzll(nanos);
+			return bucket < span_summary::num_buckets ? bucket : span_summary::num_buckets - 1;
+		}
+
+		/*
+		 * Written only by the owning thread so updates are plain relaxed load/store, readers may see slightly stale
+		 * values.
+		 * */
+		struct histogram {
+			atomic<uint64_t> m_count{0};
+			atomic<uint64_t> m_total{0};
+			atomic<uint64_t> m_max{0};
+			array<atomic<uint64_t>, span_summary::num_buckets> m_buckets{};
+
+			void add(uint64_t nanos) {
+				m_count.store(m_count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+				m_total.store(m_total.load(memory_order_relaxed) + nanos, memory_order_relaxed);
+				if (nanos > m_max.load(memory_order_relaxed)) m_max.store(nanos, memory_order_relaxed);
+				atomic<uint64_t> &bucket = m_buckets[bucket_for(nanos)];
+				bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+			}
+
+			void add_to(span_summary &summary) const {
+				summary.m_count += m_count.load(memory_order_relaxed);
+				summary.m_total_nanos += m_total.load(memory_order_relaxed);
+				summary.m_max_nanos = max(summary.m_max_nanos, m_max.load(memory_order_relaxed));
+				for (size_t i = 0; i < span_summary::num_buckets; i++) {
+					summary.m_buckets[i] += m_buckets[i].load(memory_order_relaxed);
+				}
+			}
+
+			void reset() {
+				m_count.store(0, memory_order_relaxed);
+				m_total.store(0, memory_order_relaxed);
+				m_max.store(0, memory_order_relaxed);
+				for (auto &bucket : m_buckets) bucket.store(0, memory_order_relaxed);
+			}
+		};
+
+		struct name_slot {
+			atomic<const char *> m_name{nullptr};
+			atomic<histogram *> m_histogram{nullptr};
+		};
+
+		/*
+		 * Open addressing table from span name pointer to histogram. Names are never removed so a slot that has
+		 * been published stays valid for readers on other threads. The histograms are allocated when a name is first
+		 * recorded, so a pool thread that records a few spans only pays for those.
+		 * */
+		struct thread_stats {
+			array<name_slot, max_span_names> m_slots;
+
+			~thread_stats() {
+				for (name_slot &slot : m_slots) {
+					delete slot.m_histogram.load(memory_order_relaxed);
+				}
+			}
+
+			histogram *find(const char *name) {
+				const size_t start = (reinterpret_cast<uintptr_t>(name) * 0x9E3779B97F4A7C15ull) >> 57;
+				for (size_t i = 0; i < max_span_names; i++) {
+					name_slot &slot = m_slots[(start + i) % max_span_names];
+					const char *slot_name = slot.m_name.load(memory_order_relaxed);
+					if (slot_name == name) return slot.m_histogram.load(memory_order_relaxed);
+					if (slot_name == nullptr) {
+						// The histogram is published before the name so readers that see the name see the histogram.
+						histogram *hist = new histogram();
+						slot.m_histogram.store(hist, memory_order_release);
+						slot.m_name.store(name, memory_order_release);
+						return hist;
+					}
+				}
+				return nullptr;
+			}
+
+			template<typename callback>
+			void for_each(callback cb) const {
+				for (const name_slot &slot : m_slots) {
+					const char *name = slot.m_name.load(memory_order_acquire);
+					if (name != nullptr) cb(name, *slot.m_histogram.load(memory_order_acquire));
+				}
+			}
+		};
+
+		mutex stats_lock;
+		vector<shared_ptr<thread_stats>> live_stats;
+		// Summaries of threads that have exited, so short lived pool threads do not grow live_stats.
+		map<string, span_summary> retired_stats;
+
+		void fold(map<string, span_summary> &summaries, const thread_stats &stats) {
+			stats.for_each([&summaries](const char *name, const histogram &hist) {
+				span_summary &summary = summaries[name];
+				hist.add_to(summary);
+			});
+		}
+
+		struct thread_stats_holder {
+			shared_ptr<thread_stats> m_stats;
+
+			~thread_stats_holder() {
+				if (!m_stats) return;
+				lock_guard<mutex> lock(stats_lock);
+				fold(retired_stats, *m_stats);
+				live_stats.erase(std::find(live_stats.begin(), live_stats.end(), m_stats));
+			}
+		};
+
+		thread_local thread_stats_holder local_stats;
+
+		histogram *find_histogram(const char *name) {
+			if (!local_stats.m_stats) {
+				local_stats.m_stats = make_shared<thread_stats>();
+				lock_guard<mutex> lock(stats_lock);
+				live_stats.push_back(local_stats.m_stats);
+			}
+			return local_stats.m_stats->find(name);
+		}
+
+		/*
+		 * The spans of the thread that called start_trace() and of the tasks it passed its trace_context to.
+		 * m_buffer is null while the thread is not tracing.
+		 * */
+		struct thread_trace {
+			shared_ptr<trace_buffer> m_buffer;
+			uint32_t m_current = span_record::no_parent;
+			uint32_t m_depth = 0;
+		};
+
+		thread_local thread_trace local_trace;
+
+		// The kernel thread id, so the threads in a chrome trace match the ones in top and perf.
+		thread_local const uint32_t local_thread_id = gettid();
+
+		uint64_t duration(const span_record &record, uint64_t now) {
+			return (record.m_end ? record.m_end : now) - record.m_start;
+		}
+
+		json span_tree(const vector<span_record> &spans, const vector<vector<uint32_t>> &children, uint32_t index,
+				uint64_t origin, uint64_t now) {
+			const span_record &record = spans[index];
+			json node;
+			node["name"] = record.m_name;
+			node["start_us"] = (double)(record.m_start - origin) / 1000.0;
+			node["duration_us"] = (double)duration(record, now) / 1000.0;
+			if (record.m_end == 0) node["open"] = true;
+			json child_array = json::array();
+			for (uint32_t child : children[index]) {
+				child_array.push_back(span_tree(spans, children, child, origin, now));
+			}
+			node["children"] = child_array;
+			return node;
+		}
+
+	}
+
+	struct trace_buffer {
+		mutex m_lock;
+		vector<span_record> m_spans;
+	};
+
+	span::span(const char *name) :
+		m_name(name), m_start(now_nanos()), m_index(span_record::no_parent)
+	{
+		thread_trace &trace = local_trace;
+		if (trace.m_buffer) {
+			lock_guard<mutex> lock(trace.m_buffer->m_lock);
+			vector<span_record> &spans = trace.m_buffer->m_spans;
+			if (spans.size() < max_trace_spans) {
+				m_index = spans.size();
+				spans.push_back(span_record{name, m_start, 0, trace.m_current, trace.m_depth, local_thread_id});
+				trace.m_current = m_index;
+				trace.m_depth++;
+			}
+		}
+	}
+
+	span::~span() {
+		if (!m_stopped) {
+			stop();
+		}
+	}
+
+	void span::stop() {
+		if (m_stopped) return;
+		m_stopped = true;
+
+		const uint64_t end = now_nanos();
+		histogram *hist = find_histogram(m_name);
+		if (hist) hist->add(end - m_start);
+
+		thread_trace &trace = local_trace;
+		if (m_index == span_record::no_parent || !trace.m_buffer) return;
+
+		// The trace may have been restarted while this span was open, then the index belongs to someone else.
+		lock_guard<mutex> lock(trace.m_buffer->m_lock);
+		vector<span_record> &spans = trace.m_buffer->m_spans;
+		if (m_index < spans.size() && spans[m_index].m_name == m_name && spans[m_index].m_start == m_start) {
+			spans[m_index].m_end = end;
+			trace.m_current = spans[m_index].m_parent;
+			trace.m_depth = spans[m_index].m_depth;
+		}
+	}
+
+	uint64_t span_summary::percentile(double p) const {
+		if (m_count == 0) return 0;
+		const uint64_t target = max<uint64_t>(1, (uint64_t)(p * (double)m_count + 0.5));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < num_buckets; i++) {
+			seen += m_buckets[i];
+			if (seen >= target) {
+				const uint64_t upper = i == 0 ? 0 : (1ull << i) - 1;
+				return min(upper, m_max_nanos);
+			}
+		}
+		return m_max_nanos;
+	}
+
+	void start_trace() {
+		thread_trace &trace = local_trace;
+		trace.m_buffer = make_shared<trace_buffer>();
+		trace.m_current = span_record::no_parent;
+		trace.m_depth = 0;
+	}
+
+	vector<span_record> stop_trace() {
+		thread_trace &trace = local_trace;
+		vector<span_record> spans;
+		if (trace.m_buffer) {
+			lock_guard<mutex> lock(trace.m_buffer->m_lock);
+			spans.swap(trace.m_buffer->m_spans);
+		}
+		trace.m_buffer.reset();
+		trace.m_current = span_record::no_parent;
+		trace.m_depth = 0;
+		return spans;
+	}
+
+	bool is_tracing() {
+		return local_trace.m_buffer != nullptr;
+	}
+
+	vector<span_record> current_trace() {
+		thread_trace &trace = local_trace;
+		if (!trace.m_buffer) return {};
+		lock_guard<mutex> lock(trace.m_buffer->m_lock);
+		return trace.m_buffer->m_spans;
+	}
+
+	trace_context capture_trace() {
+		const thread_trace &trace = local_trace;
+		return trace_context{trace.m_buffer, trace.m_current, trace.m_depth};
+	}
+
+	trace_scope::trace_scope(const trace_context &context) {
+		thread_trace &trace = local_trace;
+		m_saved_buffer = std::move(trace.m_buffer);
+		m_saved_current = trace.m_current;
+		m_saved_depth = trace.m_depth;
+		trace.m_buffer = context.m_buffer;
+		trace.m_current = context.m_parent;
+		trace.m_depth = context.m_depth;
+	}
+
+	trace_scope::~trace_scope() {
+		thread_trace &trace = local_trace;
+		trace.m_buffer = std::move(m_saved_buffer);
+		trace.m_current = m_saved_current;
+		trace.m_depth = m_saved_depth;
+	}
+
+	string span_tree_json(const vector<span_record> &spans) {
+		json roots = json::array();
+		if (spans.size() == 0) return roots.dump();
+
+		const uint64_t now = now_nanos();
+		const uint64_t origin = spans[0].m_start;
+		vector<vector<uint32_t>> children(spans.size());
+		for (uint32_t i = 0; i < spans.size(); i++) {
+			if (spans[i].m_parent != span_record::no_parent) {
+				children[spans[i].m_parent].push_back(i);
+			}
+		}
+		for (uint32_t i = 0; i < spans.size(); i++) {
+			if (spans[i].m_parent == span_record::no_parent) {
+				roots.push_back(span_tree(spans, children, i, origin, now));
+			}
+		}
+		return roots.dump();
+	}
+
+	string chrome_trace_json(const vector<span_record> &spans) {
+		json events = json::array();
+		const uint64_t now = now_nanos();
+		const uint64_t origin = spans.size() ? spans[0].m_start : 0;
+		for (const span_record &record : spans) {
+			json event;
+			event["name"] = record.m_name;
+			event["cat"] = "alexandria";
+			event["ph"] = "X";
+			event["ts"] = (double)(record.m_start - origin) / 1000.0;
+			event["dur"] = (double)duration(record, now) / 1000.0;
+			event["pid"] = getpid();
+			event["tid"] = record.m_thread;
+			events.push_back(event);
+		}
+		json message;
+		message["traceEvents"] = events;
+		message["displayTimeUnit"] = "ms";
+		return message.dump();
+	}
+
+	vector<span_summary> span_summaries() {
+		map<string, span_summary> summaries;
+		{
+			lock_guard<mutex> lock(stats_lock);
+			summaries = retired_stats;
+			for (const auto &stats : live_stats) {
+				fold(summaries, *stats);
+			}
+		}
+		vector<span_summary> ret;
+		for (auto &iter : summaries) {
+			iter.second.m_name = iter.first;
+			ret.push_back(iter.second);
+		}
+		return ret;
+	}
+
+	void report_reset() {
+		lock_guard<mutex> lock(stats_lock);
+		retired_stats.clear();
+		for (const auto &stats : live_stats) {
+			for (name_slot &slot : stats->m_slots) {
+				histogram *hist = slot.m_histogram.load(memory_order_acquire);
+				if (hist) hist->reset();
+			}
+		}
+	}
+
+	void report_print() {
+		for (const span_summary &summary : span_summaries()) {
+			if (summary.m_count == 0) continue;
+			const double mean_us = (double)summary.m_total_nanos / summary.m_count / 1000.0;
+			LOG_INFO("profiler [" + summary.m_name + "] count: " + to_string(summary.m_count) +
+				" mean: " + to_string(mean_us) + "us" +
+				" p50: " + to_string(summary.percentile(0.5) / 1000.0) + "us" +
+				" p99: " + to_string(summary.percentile(0.99) / 1000.0) + "us" +
+				" max: " + to_string(summary.m_max_nanos / 1000.0) + "us");
+		}
+	}
+
+}
@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Scoped tracing spans.
+ *
+ * Every span feeds a per thread latency histogram keyed on the span name, the histograms are merged on demand by
+ * span_summaries(). If the thread has called start_trace() the span is also recorded with its parent so the whole
+ * span tree of one request can be exported as json. utils::task_group passes the trace on to its tasks so spans in
+ * the parallel parts of a request end up in the same tree, other threads have to use capture_trace() and
+ * trace_scope themselves.
+ *
+ * Span names must be string literals (or otherwise outlive the process), they are stored by pointer.
+ * */
+
+namespace profiler {
+
+	/*
+	 * Monotonic nanoseconds, only meaningful as differences.
+	 * */
+	inline uint64_t now_nanos() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	struct span_record {
+		const char *m_name;
+		uint64_t m_start;
+		uint64_t m_end; // zero if the span was still open when the trace was taken.
+		uint32_t m_parent; // index of the parent span or no_parent.
+		uint32_t m_depth;
+		uint32_t m_thread; // id of the thread that recorded the span.
+
+		static constexpr uint32_t no_parent = UINT32_MAX;
+	};
+
+	class span {
+
+	public:
+
+		explicit span(const char *name);
+		~span();
+
+		span(const span &) = delete;
+		span &operator=(const span &) = delete;
+
+		void stop();
+
+	private:
+		const char *m_name;
+		uint64_t m_start;
+		uint32_t m_index;
+		bool m_stopped = false;
+
+	};
+
+	/*
+	 * Log2 histogram of span durations, bucket i holds durations in [2^(i-1), 2^i) nanoseconds.
+	 * */
+	struct span_summary {
+		static constexpr size_t num_buckets = 64;
+
+		std::string m_name;
+		size_t m_count = 0;
+		uint64_t m_total_nanos = 0;
+		uint64_t m_max_nanos = 0;
+		std::array<uint64_t, num_buckets> m_buckets = {};
+
+		/*
+		 * Returns an upper bound of the p-quantile (0 < p <= 1) in nanoseconds.
+		 * */
+		uint64_t percentile(double p) const;
+	};
+
+	/*
+	 * Starts recording spans on the calling thread, clears any previous trace.
+	 * */
+	void start_trace();
+
+	/*
+	 * Stops recording and returns the spans recorded since start_trace() in start order.
+	 * */
+	std::vector<span_record> stop_trace();
+
+	bool is_tracing();
+
+	/*
+	 * Returns the spans recorded so far without stopping the trace.
+	 * */
+	std::vector<span_record> current_trace();
+
+	struct trace_buffer;
+
+	/*
+	 * The trace of the calling thread and its innermost open span, see trace_scope.
+	 * */
+	struct trace_context {
+		std::shared_ptr<trace_buffer> m_buffer; // null if the thread is not tracing.
+		uint32_t m_parent;
+		uint32_t m_depth;
+	};
+
+	trace_context capture_trace();
+
+	/*
+	 * Continues a captured trace on the calling thread until the scope ends. Spans started inside the scope are
+	 * recorded as children of the span that was open when the context was captured. A context captured while not
+	 * tracing stops the calling thread from tracing inside the scope.
+	 * */
+	class trace_scope {
+
+	public:
+
+		explicit trace_scope(const trace_context &context);
+		~trace_scope();
+
+		trace_scope(const trace_scope &) = delete;
+		trace_scope &operator=(const trace_scope &) = delete;
+
+	private:
+		std::shared_ptr<trace_buffer> m_saved_buffer;
+		uint32_t m_saved_current;
+		uint32_t m_saved_depth;
+
+	};
+
+	/*
+	 * Span tree as nested json objects: {"name", "start_us", "duration_us", "children"}. Start times are relative to
+	 * the first span.
+	 * */
+	std::string span_tree_json(const std::vector<span_record> &spans);
+
+	/*
+	 * Chrome trace event format with one track per thread, open in chrome://tracing or perfetto.
+	 * */
+	std::string chrome_trace_json(const std::vector<span_record> &spans);
+
+	/*
+	 * Aggregated histograms for all span names over all threads, sorted by name.
+	 * */
+	std::vector<span_summary> span_summaries();
+
+}
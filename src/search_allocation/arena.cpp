@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "arena.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace search_allocation {
+
+	arena::arena(size_t block_size, size_t max_retained_blocks) :
+		m_block_size(block_size), m_max_retained_blocks(max(max_retained_blocks, (size_t)1))
+	{
+		m_blocks.push_back(block{new char[m_block_size], m_block_size});
+	}
+
+	arena::~arena() {
+		for (block &blk : m_blocks) {
+			delete [] blk.m_data;
+		}
+	}
+
+	void arena::reset() {
+		size_t kept = 0;
+		for (const block &blk : m_blocks) {
+			if (blk.m_size > m_block_size || kept == m_max_retained_blocks) {
+				delete [] blk.m_data;
+			} else {
+				m_blocks[kept++] = blk;
+			}
+		}
+		m_blocks.resize(kept);
+		m_current = 0;
+		m_offset = 0;
+	}
+
+	size_t arena::bytes_used() const {
+		size_t used = m_offset;
+		for (size_t i = 0; i < m_current; i++) {
+			used += m_blocks[i].m_size;
+		}
+		return used;
+	}
+
+	size_t arena::capacity() const {
+		size_t total = 0;
+		for (const block &blk : m_blocks) {
+			total += blk.m_size;
+		}
+		return total;
+	}
+
+	void *arena::do_allocate(size_t bytes, size_t alignment) {
+
+		block *blk = &m_blocks[m_current];
+		uintptr_t base = reinterpret_cast<uintptr_t>(blk->m_data);
+		size_t offset = ((base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+		while (offset + bytes > blk->m_size) {
+			// Move on to the next block that is large enough, blocks from earlier requests are reused.
+			m_current++;
+			while (m_current < m_blocks.size() && m_blocks[m_current].m_size < bytes + alignment) {
+				m_current++;
+			}
+			if (m_current == m_blocks.size()) {
+				const size_t size = max(m_block_size, bytes + alignment);
+				m_blocks.push_back(block{new char[size], size});
+			}
+			blk = &m_blocks[m_current];
+			base = reinterpret_cast<uintptr_t>(blk->m_data);
+			offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+		}
+
+		m_offset = offset + bytes;
+		return blk->m_data + offset;
+	}
+
+	void arena::do_deallocate(void *p, size_t bytes, size_t alignment) {
+		// Roll back if this was the last allocation, typically a vector that grows.
+		char *ptr = static_cast<char *>(p);
+		const block &blk = m_blocks[m_current];
+		if (ptr >= blk.m_data && ptr + bytes == blk.m_data + m_offset) {
+			m_offset = ptr - blk.m_data;
+		}
+	}
+
+	bool arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+		return this == &other;
+	}
+
+}
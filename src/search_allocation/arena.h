@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+namespace search_allocation {
+
+	/*
+		Bump allocator for the short lived temporaries of one search request. Use it as a std::pmr::memory_resource, for
+		example std::pmr::vector<full_text_record> vec(&arena).
+
+		Deallocation is a no-op (except for the most recent allocation which is rolled back) so all memory is returned by
+		reset() which rewinds to the first block. Up to max_retained_blocks blocks of block_size are kept so the next
+		request does not allocate at all, larger blocks made for a single allocation are freed by reset() so one big
+		request does not pin its memory for the lifetime of the worker.
+
+		Not thread safe, a worker thread owns its arena.
+	*/
+	class arena : public std::pmr::memory_resource {
+
+	public:
+
+		static const size_t default_block_size = 16ull * 1024 * 1024;
+		static const size_t default_max_retained_blocks = 4;
+
+		explicit arena(size_t block_size = default_block_size, size_t max_retained_blocks = default_max_retained_blocks);
+		~arena();
+
+		arena(const arena &) = delete;
+		arena &operator=(const arena &) = delete;
+
+		void reset();
+
+		size_t bytes_used() const;
+		size_t capacity() const;
+		size_t num_blocks() const { return m_blocks.size(); }
+
+	private:
+
+		struct block {
+			char *m_data;
+			size_t m_size;
+		};
+
+		std::vector<block> m_blocks;
+		size_t m_block_size;
+		size_t m_max_retained_blocks;
+		size_t m_current = 0;
+		size_t m_offset = 0;
+
+		void *do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+	};
+
+}
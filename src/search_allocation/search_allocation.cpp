@@ -30,9 +30,10 @@ namespace search_allocation {
 
 	allocation *create_allocation() {
 		allocation *data_allocation = new allocation;
-		data_allocation->record_storage = create_storage<full_text::full_text_record>();
-		data_allocation->link_storage = create_storage<url_link::full_text_record>();
-		data_allocation->domain_link_storage = create_storage<domain_link::full_text_record>();
+		data_allocation->scratch = new arena();
+		data_allocation->record_storage = create_storage<full_text::full_text_record>(data_allocation->scratch);
+		data_allocation->link_storage = create_storage<url_link::full_text_record>(data_allocation->scratch);
+		data_allocation->domain_link_storage = create_storage<domain_link::full_text_record>(data_allocation->scratch);
 		return data_allocation;
 	}
 
@@ -40,7 +41,12 @@ namespace search_allocation {
 		delete_storage(data_allocation->record_storage);
 		delete_storage(data_allocation->link_storage);
 		delete_storage(data_allocation->domain_link_storage);
+		delete data_allocation->scratch;
 		delete data_allocation;
 	}
 
+	void reset_allocation(allocation *data_allocation) {
+		data_allocation->scratch->reset();
+	}
+
 }
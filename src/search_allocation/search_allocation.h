@@ -31,6 +31,7 @@
 #include "url_link/full_text_record.h"
 #include "domain_link/full_text_record.h"
 #include "config.h"
+#include "arena.h"
 #include <map>
 #include <vector>
 
@@ -50,17 +51,24 @@ namespace search_allocation {
 
 		// To hold the intersection of the result sets.
 		full_text::full_text_result_set<data_record> * intersected_result;
+
+		// Temporaries during the search are allocated here, not owned by the storage.
+		std::pmr::memory_resource *scratch;
 	};
 
 	struct allocation {
 		storage<full_text::full_text_record> *record_storage;
 		storage<url_link::full_text_record> *link_storage;
 		storage<domain_link::full_text_record> *domain_link_storage;
+
+		// Shared by the storages above, reset after each request.
+		arena *scratch;
 	};
 
 	template <typename data_record>
-	storage<data_record> *create_storage() {
+	storage<data_record> *create_storage(std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) {
 		storage<data_record> *record_storage = new storage<data_record>;
+		record_storage->scratch = scratch;
 
 		// Allocate result_sets.
 		for (size_t j = 0; j < config::query_max_words; j++) {
@@ -85,4 +93,9 @@ namespace search_allocation {
 	allocation *create_allocation();
 	void delete_allocation(allocation *allocation);
 
+	/*
+		Releases all scratch memory of the request, nothing allocated from allocation->scratch may be used after this.
+	*/
+	void reset_allocation(allocation *allocation);
+
 }
@@ -47,11 +47,15 @@ namespace search_engine {
 		const full_text_index<full_text_record> &index, const vector<url_link::full_text_record> &links,
 		const vector<domain_link::full_text_record> &domain_links, const string &query, size_t limit, struct search_metric &metric) {
 
-		vector<full_text_record> complete_result = search_wrapper(storage, index, links, domain_links, query, config::pre_result_limit, metric);
+		full_text_result_set<full_text_record> *result = make_search<full_text_record>(storage, index.shards(), links, domain_links, query,
+			config::pre_result_limit, metric);
 
-		vector<full_text_record> deduped_result = deduplicate_result_vector<full_text_record>(complete_result, limit);
+		// Up to pre_result_limit records, only the deduplicated top is returned so sort them in the scratch arena.
+		profiler::span profiler_deduplicate("search_engine::deduplicate");
+		pmr::vector<full_text_record> complete_result(result->span_pointer()->begin(), result->span_pointer()->end(), storage->scratch);
+		sort_by_score<full_text_record>(complete_result);
 
-		return deduped_result;
+		return deduplicate_result_vector<full_text_record>(complete_result, limit, storage->scratch);
 	}
 
 }
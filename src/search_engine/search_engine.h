@@ -29,6 +29,10 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <memory_resource>
+#include <queue>
+#include <set>
+#include <unordered_map>
 #include "full_text/full_text_index.h"
 #include "full_text/full_text_record.h"
 #include "full_text/full_text_shard.h"
@@ -43,6 +47,7 @@
 #include "algorithm/algorithm.h"
 #include "algorithm/sort.h"
 #include "search_allocation/search_allocation.h"
+#include "utils/scheduler.hpp"
 #include <cassert>
 
 namespace search_engine {
@@ -141,7 +146,8 @@ namespace search_engine {
 		Add scores for the given links to the result set. The links are assumed to be ordered by link.m_target_hash ascending.
 	*/
 	template<typename data_record>
-	size_t apply_link_scores(const vector<url_link::full_text_record> &links, full_text_result_set<data_record> *results) {
+	size_t apply_link_scores(const vector<url_link::full_text_record> &links, full_text_result_set<data_record> *results,
+		std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) {
 
 		if (typeid(data_record) != typeid(full_text::full_text_record)) return 0;
 		if (links.size() == 0) return 0;
@@ -150,7 +156,7 @@ namespace search_engine {
 
 		size_t i = 0;
 		size_t j = 0;
-		map<pair<uint64_t, uint64_t>, uint64_t> domain_unique;
+		std::pmr::set<pair<uint64_t, uint64_t>> domain_unique(scratch);
 		full_text::full_text_record *data = (full_text::full_text_record *)results->data_pointer();
 		while (i < links.size() && j < results->size()) {
 
@@ -161,11 +167,10 @@ namespace search_engine {
 				i++;
 			} else if (hash1 == hash2) {
 
-				if (domain_unique.count(std::make_pair(links[i].m_source_domain, links[i].m_target_hash)) == 0) {
+				if (domain_unique.insert(std::make_pair(links[i].m_source_domain, links[i].m_target_hash)).second) {
 					const float url_score = expm1(25.0f*links[i].m_score) / 50.0f;
 					data[j].m_score += url_score;
 					applied_links++;
-					domain_unique[std::make_pair(links[i].m_source_domain, links[i].m_target_hash)] = links[i].m_source_domain;
 				}
 
 				i++;
@@ -178,25 +183,26 @@ namespace search_engine {
 	}
 
 	template<typename data_record>
-	size_t apply_domain_link_scores(const vector<domain_link::full_text_record> &links, full_text_result_set<data_record> *results) {
+	size_t apply_domain_link_scores(const vector<domain_link::full_text_record> &links, full_text_result_set<data_record> *results,
+		std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) {
 
 		if (typeid(data_record) != typeid(full_text::full_text_record)) return 0;
 		if (links.size() == 0) return 0;
 
 		size_t applied_links = 0;
 		{
-			unordered_map<uint64_t, float> domain_scores;
-			unordered_map<uint64_t, int> domain_counts;
-			map<pair<uint64_t, uint64_t>, uint64_t> domain_unique;
+			// Score and number of links per target domain.
+			std::pmr::unordered_map<uint64_t, pair<float, int>> domain_scores(scratch);
+			std::pmr::set<pair<uint64_t, uint64_t>> domain_unique(scratch);
 			{
 				for (const domain_link::full_text_record &link : links) {
 
-					if (domain_unique.count(std::make_pair(link.m_source_domain, link.m_target_domain)) == 0) {
+					if (domain_unique.insert(std::make_pair(link.m_source_domain, link.m_target_domain)).second) {
 
 						const float domain_score = expm1(25.0f*link.m_score) / 50.0f;
-						domain_scores[link.m_target_domain] += domain_score;
-						domain_counts[link.m_target_domain]++;
-						domain_unique[std::make_pair(link.m_source_domain, link.m_target_domain)] = link.m_source_domain;
+						pair<float, int> &score = domain_scores[link.m_target_domain];
+						score.first += domain_score;
+						score.second++;
 
 					}
 				}
@@ -205,9 +211,10 @@ namespace search_engine {
 			// Loop over the results and add the calculated domain scores.
 			full_text::full_text_record *data = (full_text::full_text_record *)results->data_pointer();
 			for (size_t i = 0; i < results->size(); i++) {
-				const float domain_score = domain_scores[data[i].m_domain_hash];
-				data[i].m_score += domain_score;
-				applied_links += domain_counts[data[i].m_domain_hash];
+				auto iter = domain_scores.find(data[i].m_domain_hash);
+				if (iter == domain_scores.end()) continue;
+				data[i].m_score += iter->second.first;
+				applied_links += iter->second.second;
 			}
 		}
 
@@ -228,8 +235,12 @@ namespace search_engine {
 		return pos;
 	}
 
-	template<typename data_record>
-	void value_intersection(const vector<full_text_result_set<data_record> *> &result_sets, vector<int> sections, vector<data_record> &dest) {
+	/*
+		Appends the intersection to dest. Never appends more than the size of the shortest result set so callers can
+		reserve that up front.
+	*/
+	template<typename data_record, typename vector_type>
+	void value_intersection(const vector<full_text_result_set<data_record> *> &result_sets, const vector<int> &sections, vector_type &dest) {
 
 		if (result_sets.size() == 0) {
 			return;
@@ -290,7 +301,8 @@ namespace search_engine {
 	}
 
 	template<typename data_record>
-	void calculate_intersection(const vector<full_text_result_set<data_record> *> &result_sets, full_text_result_set<data_record> *dest) {
+	void calculate_intersection(const vector<full_text_result_set<data_record> *> &result_sets, full_text_result_set<data_record> *dest,
+		std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) {
 
 		for (full_text_result_set<data_record> *result : result_sets) {
 			if (result->size() == 0) return;
@@ -311,7 +323,7 @@ namespace search_engine {
 
 		// First just try the top sections.
 		{
-			vector<data_record> result;
+			std::pmr::vector<data_record> result(scratch);
 			value_intersection(sorted_result_sets, partitions[0], result);
 			if (result.size() >= config::result_limit) {
 				dest->copy_vector(result);
@@ -329,37 +341,53 @@ namespace search_engine {
 			sorted_result_sets[i]->read_to_section(maximum[i]);
 		}
 
-		size_t idx = 0;
-		const size_t num_threads = 8;
+		size_t shortest_len = SIZE_MAX;
+		for (full_text_result_set<data_record> *result_set : sorted_result_sets) {
+			shortest_len = std::min(shortest_len, result_set->size());
+		}
 
-		ThreadPool pool(num_threads);
-		vector<vector<data_record>> results(partitions.size());
-		std::vector<std::future<vector<data_record>>> thread_results;
+		/*
+			The arena is not thread safe so the result vectors are reserved here, value_intersection never grows them
+			past the shortest result set.
+		*/
+		utils::task_group tasks(utils::priority::query);
+		std::pmr::vector<std::pmr::vector<data_record>> results(scratch);
+		results.reserve(partitions.size());
 		for (const vector<int> &partition : partitions) {
-			thread_results.emplace_back(pool.enqueue([sorted_result_sets, partition]() {
-				vector<data_record> result;
-				value_intersection(sorted_result_sets, partition, result);
-				return result;
-			}));
-			idx++;
+			results.emplace_back();
+			results.back().reserve(shortest_len);
+			std::pmr::vector<data_record> *result = &results.back();
+			tasks.run([&sorted_result_sets, &partition, result]() {
+				value_intersection(sorted_result_sets, partition, *result);
+			});
+		}
+		tasks.wait();
+
+		/*
+			k-way merge on m_value straight into dest. The partitions are disjoint combinations of sections so every
+			value is in exactly one of them.
+		*/
+		using head = pair<uint64_t, size_t>;
+		std::pmr::vector<head> heap_storage(scratch);
+		heap_storage.reserve(results.size());
+		std::priority_queue<head, std::pmr::vector<head>, std::greater<head>> heads(std::greater<head>(), std::move(heap_storage));
+		std::pmr::vector<size_t> positions(results.size(), 0, scratch);
+		for (size_t i = 0; i < results.size(); i++) {
+			if (results[i].size()) heads.emplace(results[i][0].m_value, i);
 		}
-		idx = 0;
-		for (auto && result: thread_results) {
-			results[idx] = result.get();
-			idx++;
+		data_record *dest_data = dest->data_pointer();
+		size_t num_merged = 0;
+		while (!heads.empty()) {
+			const size_t i = heads.top().second;
+			heads.pop();
+			dest_data[num_merged++] = results[i][positions[i]++];
+			if (positions[i] < results[i].size()) heads.emplace(results[i][positions[i]].m_value, i);
 		}
-		// merge
-		vector<data_record> merged_vec;
-		algorithm::sort::merge_arrays(results, [](const data_record &a, const data_record &b) {
-			return a.m_value < b.m_value;
-		}, merged_vec);
-
-		// copy.
-		dest->copy_vector(merged_vec);
+		dest->resize(num_merged);
 	}
 
-	template<typename data_record>
-	void sort_by_score(vector<data_record> &results) {
+	template<typename data_record, typename allocator>
+	void sort_by_score(std::vector<data_record, allocator> &results) {
 		sort(results.begin(), results.end(), [](const data_record &a, const data_record &b) {
 			return a.m_score > b.m_score;
 		});
@@ -418,13 +446,14 @@ namespace search_engine {
 		results->resize(j);
 	}
 
-	template<typename data_record>
-	vector<data_record> deduplicate_result_vector(const vector<data_record> &results, size_t limit) {
+	template<typename data_record, typename allocator>
+	vector<data_record> deduplicate_result_vector(const std::vector<data_record, allocator> &results, size_t limit,
+		std::pmr::memory_resource *scratch = std::pmr::get_default_resource()) {
 
-		vector<data_record> deduped;
-		vector<data_record> non_deduped;
+		std::pmr::vector<data_record> deduped(scratch);
+		std::pmr::vector<data_record> non_deduped(scratch);
 
-		map<uint64_t, size_t> d_count;
+		std::pmr::unordered_map<uint64_t, size_t> d_count(scratch);
 		for (const data_record &result : results) {
 			if (d_count[result.m_domain_hash] < config::deduplicate_domain_count) {
 				deduped.push_back(result);
@@ -439,15 +468,18 @@ namespace search_engine {
 				non_deduped.resize(num_missing);
 			}
 			vector<data_record> ret;
-			algorithm::sort::merge_arrays(deduped, non_deduped, [] (const data_record &a, const data_record &b) {
+			ret.reserve(deduped.size() + non_deduped.size());
+			// std::merge takes from the second range only on strictly greater score, ties go to non_deduped.
+			std::merge(non_deduped.begin(), non_deduped.end(), deduped.begin(), deduped.end(), std::back_inserter(ret),
+				[] (const data_record &a, const data_record &b) {
 				return a.m_score > b.m_score;
-			}, ret);
+			});
 			return ret;
 		}
 
 		deduped.resize(limit);
 
-		return deduped;
+		return vector<data_record>(deduped.begin(), deduped.end());
 	}
 
 	template<typename data_record>
@@ -506,15 +538,18 @@ namespace search_engine {
 		vector<string> words = text::get_full_text_words(query, config::query_max_words);
 		if (words.size() == 0) return new full_text_result_set<data_record>(0);
 
+		profiler::span profiler_shards("search_engine::search_shards");
 		vector<full_text_result_set<data_record> *> result_vector = search_shards<data_record>(storage->result_sets, shards, words);
+		profiler_shards.stop();
 
 		full_text_result_set<data_record> *flat_result;
 		if (result_vector.size() > 1) {
 
 			// We need to calculate the intersection of the given results.
+			profiler::span profiler_intersection("search_engine::calculate_intersection");
 			flat_result = storage->intersected_result;
 			flat_result->resize(0);
-			calculate_intersection<data_record>(result_vector, flat_result);
+			calculate_intersection<data_record>(result_vector, flat_result, storage->scratch);
 
 			set_total_found<data_record>(result_vector, metric, (double)flat_result->size() / largest_result(result_vector));
 		} else {
@@ -527,8 +562,9 @@ namespace search_engine {
 			result_set->close_sections();
 		}
 
-		metric.m_link_domain_matches = apply_domain_link_scores(domain_links, flat_result);
-		metric.m_link_url_matches = apply_link_scores(links, flat_result);
+		profiler::span profiler_scores("search_engine::apply_scores");
+		metric.m_link_domain_matches = apply_domain_link_scores(domain_links, flat_result, storage->scratch);
+		metric.m_link_url_matches = apply_link_scores(links, flat_result, storage->scratch);
 
 		get_unsorted_results_with_top_scores<data_record>(flat_result, limit);
 
@@ -552,7 +588,7 @@ namespace search_engine {
 			// We need to calculate the intersection of the given results.
 			flat_result = storage->intersected_result;
 			flat_result->resize(0);
-			calculate_intersection<data_record>(result_vector, flat_result);
+			calculate_intersection<data_record>(result_vector, flat_result, storage->scratch);
 
 			set_total_found<data_record>(result_vector, metric, (double)flat_result->size() / largest_result(result_vector));
 		} else {
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "storage.h"
+#include "config.h"
+#include "algorithm/hash.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+
+namespace storage {
+
+	mutex capacity_lock;
+	map<string, double> capacity_cache;
+
+	/*
+		Capacity of the file system holding the device, measured once per device root. A device that does not exist or
+		can not be measured would silently get a made up weight and move shards once it is created, so size_balanced
+		placement requires every device root to exist.
+	*/
+	double device_capacity(const string &root) {
+		lock_guard lock(capacity_lock);
+		auto iter = capacity_cache.find(root);
+		if (iter != capacity_cache.end()) return iter->second;
+
+		boost::system::error_code error;
+		const boost::filesystem::space_info info = boost::filesystem::space(root, error);
+		if (error || info.capacity == 0) {
+			throw runtime_error("Can not measure capacity of storage device " + root + " for size_balanced placement");
+		}
+		const double capacity = (double)info.capacity;
+		capacity_cache[root] = capacity;
+		return capacity;
+	}
+
+	/*
+		Weighted rendezvous hashing. Every device gets the score weight / -ln(u) where u is a uniform number in (0, 1)
+		from hashing the key with the device, the device with the highest score wins. Adding a device only moves the
+		shards that the new device wins.
+	*/
+	size_t rendezvous(uint64_t key, bool weighted) {
+		const size_t devices = num_devices();
+		size_t best_device = 0;
+		double best_score = -1.0;
+		for (size_t device = 0; device < devices; device++) {
+			const uint64_t h = algorithm::mix64(key ^ algorithm::mix64(device + 1));
+			const double u = ((double)(h >> 11) + 0.5) * 0x1.0p-53;
+			const double weight = weighted ? device_capacity(device_root(device)) : 1.0;
+			const double score = weight / -log(u);
+			if (score > best_score) {
+				best_score = score;
+				best_device = device;
+			}
+		}
+		return best_device;
+	}
+
+	placement placement_policy() {
+		if (config::storage_placement == "round_robin") return placement::round_robin;
+		if (config::storage_placement == "hash") return placement::hash;
+		if (config::storage_placement == "size_balanced") return placement::size_balanced;
+		throw runtime_error("Unknown storage_placement: " + config::storage_placement);
+	}
+
+	size_t num_devices() {
+		const size_t devices = config::storage_devices.size() ? config::storage_devices.size() : config::storage_num_devices;
+		if (devices == 0) throw runtime_error("No storage devices configured");
+		return devices;
+	}
+
+	string device_root(size_t device) {
+		if (config::storage_devices.size()) return config::storage_devices[device];
+		return config::storage_root + "/" + to_string(device);
+	}
+
+	size_t shard_device(const string &name, size_t shard_id) {
+		const placement policy = placement_policy();
+		if (policy == placement::round_robin) return shard_id % num_devices();
+
+		const uint64_t key = algorithm::mix64(algorithm::hash(name) ^ algorithm::mix64(shard_id));
+		return rendezvous(key, policy == placement::size_balanced);
+	}
+
+	string shard_path(const string &name, size_t shard_id, const string &relative_path) {
+		return device_root(shard_device(name, shard_id)) + "/" + relative_path;
+	}
+
+	string primary_path(const string &relative_path) {
+		return device_root(0) + "/" + relative_path;
+	}
+
+	void create_directories(const string &relative_dir) {
+		for (size_t device = 0; device < num_devices(); device++) {
+			boost::filesystem::create_directories(device_root(device) + "/" + relative_dir);
+		}
+	}
+
+	void remove_all(const string &relative_dir) {
+		for (size_t device = 0; device < num_devices(); device++) {
+			boost::filesystem::remove_all(device_root(device) + "/" + relative_dir);
+		}
+	}
+
+	void create_layout() {
+		for (const char *dir : {"input", "output", "upload", "hash_table", "full_text", "tmp"}) {
+			create_directories(dir);
+		}
+	}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <iostream>
+
+namespace storage {
+
+	/*
+		Storage topology. Every on-disk component resolves its paths through these functions instead of hardcoding
+		/mnt/N. The devices are config::storage_devices if given, otherwise config::storage_root/0 ...
+		config::storage_root/(config::storage_num_devices - 1). With the default config this is /mnt/0 ... /mnt/7.
+
+		Sharded data sets are spread over the devices with config::storage_placement:
+
+		round_robin		shard_id % num_devices (default, same layout as the old hardcoded paths)
+		hash			rendezvous hash of (name, shard_id), so shard 0 of every data set does not end up on device 0
+		size_balanced	rendezvous hash weighted with the capacity of each device, bigger devices get more shards. Every
+						device root must exist, shard_device throws otherwise
+
+		Placement only depends on the config and the device capacities so readers and writers in different processes
+		agree on where a shard is, and all files of one shard end up on the same device.
+
+		Shard and index classes resolve their device once in the constructor, placement is not evaluated per file name.
+	*/
+
+	enum class placement { round_robin, hash, size_balanced };
+
+	placement placement_policy();
+	size_t num_devices();
+	std::string device_root(size_t device);
+
+	/*
+		Device and path for shard shard_id of the data set called name. Components that store several files per
+		shard should pass the same name for all of them.
+	*/
+	size_t shard_device(const std::string &name, size_t shard_id);
+	std::string shard_path(const std::string &name, size_t shard_id, const std::string &relative_path);
+
+	/*
+		Path on the first device, for files that are not sharded like meta files and downloaded tsv files.
+	*/
+	std::string primary_path(const std::string &relative_path);
+
+	/*
+		Creates or removes relative_dir on every device.
+	*/
+	void create_directories(const std::string &relative_dir);
+	void remove_all(const std::string &relative_dir);
+
+	/*
+		Creates the directories the indexers expect on every device (input, output, upload, hash_table, full_text
+		and tmp), same as scripts/clean.sh does for /mnt.
+	*/
+	void create_layout();
+
+}
@@ -30,6 +30,38 @@ using namespace std;
 
 namespace text {
 
+	namespace {
+
+		inline bool is_word_boundary(char ch) {
+			return ch == ' ' || ch == '\t' || ch == ',' || ch == '|' || ch == '!';
+		}
+
+		inline bool is_trim_char(char ch) {
+			return isspace((unsigned char)ch) || ispunct((unsigned char)ch);
+		}
+
+		inline bool is_blend_char(char ch) {
+			return ch == '.' || ch == '-' || ch == ':';
+		}
+
+		// Same as trim() but on a view.
+		inline string_view trim_view(string_view word) {
+			size_t start = 0;
+			size_t end = word.size();
+			while (start < end && is_trim_char(word[start])) start++;
+			while (end > start && is_trim_char(word[end - 1])) end--;
+			return word.substr(start, end - start);
+		}
+
+		inline void lower_case_into(string_view str, string &buffer) {
+			buffer.assign(str.data(), str.size());
+			for (char &ch : buffer) {
+				ch = tolower((unsigned char)ch);
+			}
+		}
+
+	}
+
 	bool is_clean_char(const char *ch, size_t multibyte_len) {
 		if (multibyte_len == 1) {
 			return (ch[0] >= 'a' && ch[0] <= 'z') || (ch[0] >= '0' && ch[0] <= '9');
@@ -166,6 +198,90 @@ namespace text {
 		return get_tokens(str, algorithm::hash);
 	}
 
+	void get_full_text_words(string_view str, string &buffer, vector<string_view> &words, size_t limit) {
+
+		lower_case_into(str, buffer);
+		words.clear();
+
+		const size_t len = buffer.size();
+		size_t word_start = 0;
+		for (size_t i = 0; i <= len; i++) {
+			if (i < len && !is_word_boundary(buffer[i])) continue;
+
+			string_view word(buffer.data() + word_start, i - word_start);
+			word_start = i + 1;
+
+			if (parser::unicode::is_valid(word)) {
+				word = trim_view(word);
+				if (word.size() <= CC_MAX_WORD_LEN && word.size() > 0) {
+					words.push_back(word);
+				}
+				if (limit && words.size() == limit) break;
+			}
+		}
+	}
+
+	void get_expanded_full_text_words(string_view str, string &buffer, vector<string_view> &words, size_t limit) {
+
+		lower_case_into(str, buffer);
+		words.clear();
+
+		const size_t len = buffer.size();
+		size_t word_start = 0;
+		for (size_t i = 0; i <= len; i++) {
+			if (i < len && !is_word_boundary(buffer[i])) continue;
+
+			string_view word(buffer.data() + word_start, i - word_start);
+			word_start = i + 1;
+
+			if (!parser::unicode::is_valid(word)) continue;
+
+			word = trim_view(word);
+			if (word.size() > CC_MAX_WORD_LEN || word.size() == 0) continue;
+
+			words.push_back(word);
+			if (limit && words.size() == limit) break;
+
+			// Split on blend chars, the same way as boost::split does it (empty parts included).
+			if (find_if(word.begin(), word.end(), is_blend_char) == word.end()) continue;
+
+			size_t part_start = 0;
+			for (size_t j = 0; j <= word.size(); j++) {
+				if (j < word.size() && !is_blend_char(word[j])) continue;
+				words.push_back(trim_view(word.substr(part_start, j - part_start)));
+				part_start = j + 1;
+				if (limit && words.size() == limit) break;
+			}
+		}
+	}
+
+	void get_tokens(string_view str, string &buffer, vector<uint64_t> &tokens) {
+
+		// The tokens never get longer than the input so the buffer can be written without bounds checks.
+		buffer.resize(str.size());
+		tokens.clear();
+
+		char *out = buffer.data();
+		size_t token_start = 0;
+		size_t token_end = 0;
+		for (const char ch : str) {
+			if (is_word_boundary(ch)) {
+				string_view token(out + token_start, token_end - token_start);
+				if (token.size() && parser::unicode::is_valid(token)) {
+					tokens.push_back(algorithm::murmur_hash(token.data(), token.size()));
+				}
+				token_start = token_end;
+			} else if (!is_trim_char(ch)) {
+				out[token_end++] = tolower((unsigned char)ch);
+			}
+		}
+
+		string_view token(out + token_start, token_end - token_start);
+		if (token.size() && parser::unicode::is_valid(token)) {
+			tokens.push_back(algorithm::murmur_hash(token.data(), token.size()));
+		}
+	}
+
 	vector<string> get_snippets(const string &str) {
 		const size_t snippet_len = 300;
 		const char *word_boundary = " \t,|!";
@@ -34,6 +34,8 @@
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <sstream>
+#include <span>
+#include <string_view>
 #include "stopwords.h"
 #include "parser/unicode.h"
 #include "algorithm/hash.h"
@@ -119,6 +121,35 @@ namespace text {
 	std::vector<uint64_t> get_tokens(const std::string &str, std::function<uint64_t(std::string)> str2token);
 	std::vector<uint64_t> get_tokens(const std::string &str);
 
+	/*
+		Allocation free versions of get_full_text_words, get_expanded_full_text_words and get_tokens. They give the
+		same result but the words are string_views into buffer. The buffer and the output vector are owned by the
+		caller and can be reused between calls, so nothing is allocated once they have grown large enough.
+		The views are invalidated by the next call that uses the same buffer.
+	*/
+	void get_full_text_words(std::string_view str, std::string &buffer, std::vector<std::string_view> &words,
+		size_t limit = 0);
+	void get_expanded_full_text_words(std::string_view str, std::string &buffer, std::vector<std::string_view> &words,
+		size_t limit = 0);
+	void get_tokens(std::string_view str, std::string &buffer, std::vector<uint64_t> &tokens);
+
+	/*
+		Splits str on delimiter into views of str, gives the same columns as boost::split with is_any_of(delimiter).
+	*/
+	inline void split_view(std::string_view str, std::vector<std::string_view> &columns, char delimiter = '\t') {
+		columns.clear();
+		size_t start = 0;
+		while (true) {
+			const size_t end = str.find(delimiter, start);
+			if (end == std::string_view::npos) {
+				columns.push_back(str.substr(start));
+				return;
+			}
+			columns.push_back(str.substr(start, end - start));
+			start = end + 1;
+		}
+	}
+
 	std::vector<std::string> get_snippets(const std::string &str);
 
 	/*
@@ -134,22 +165,35 @@ namespace text {
 	std::vector<std::string> get_words_without_stopwords(const std::string &str, size_t limit);
 	std::vector<std::string> get_words_without_stopwords(const std::string &str);
 
-	template<typename T>
-	void words_to_ngram_hash(const std::vector<std::string> &words, size_t n_grams, T fun) {
-		
-		const size_t word_iter_max = words.size();
+	template<typename W, typename T>
+	void words_to_ngram_hash(const W *words, size_t word_iter_max, size_t n_grams, T fun) {
 
 		for (size_t i = 0; i < word_iter_max; i++) {
+			size_t n_gram_len = 0;
 			for (size_t j = 0; j < n_grams && (j + i) < word_iter_max; j++) {
-				std::string n_gram = words[i];
+				// Hashes the same bytes as words[i] + " " + ... + " " + words[i + j] without building that string.
+				n_gram_len += words[i + j].size() + (j ? 1 : 0);
+				algorithm::incremental_hash hasher(n_gram_len);
+				hasher.update(words[i].data(), words[i].size());
 				for (size_t k = i + 1; k <= i + j; k++) {
-					n_gram += " " + words[k];
+					hasher.update(" ", 1);
+					hasher.update(words[k].data(), words[k].size());
 				}
-				fun(algorithm::hash(n_gram));
+				fun(hasher.digest());
 			}
 		}
 	}
 
+	template<typename T>
+	void words_to_ngram_hash(const std::vector<std::string> &words, size_t n_grams, T fun) {
+		words_to_ngram_hash(words.data(), words.size(), n_grams, fun);
+	}
+
+	template<typename T>
+	void words_to_ngram_hash(std::span<const std::string_view> words, size_t n_grams, T fun) {
+		words_to_ngram_hash(words.data(), words.size(), n_grams, fun);
+	}
+
 	std::map<std::string, size_t> get_word_counts(const std::string &text);
 	std::map<std::string, float> get_word_frequency(const std::string &text);
 
@@ -2,11 +2,14 @@
 #include "calculate_harmonic.h"
 
 #include "config.h"
+#include "storage/storage.h"
 #include "url_link/link.h"
 #include "URL.h"
-#include "common/ThreadPool.h"
+#include "url_view.h"
+#include "utils/scheduler.hpp"
 #include "algorithm/algorithm.h"
 #include "algorithm/hyper_ball.h"
+#include "host_graph.h"
 #include <iostream>
 #include <vector>
 #include <mutex>
@@ -14,7 +17,8 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/filesystem.hpp>
 #include <unordered_map>
-#include <unordered_set>
+#include <functional>
+#include <atomic>
 
 using namespace std;
 
@@ -33,7 +37,7 @@ namespace tools {
 
 			string line;
 			while (getline(decompress_stream, line)) {
-				const URL url(line.substr(0, line.find("\t")));
+				const url_view url(string_view(line).substr(0, line.find("\t")));
 				uint64_t host_hash = url.host_hash();
 				if (hosts.count(host_hash) == 0) {
 					hosts[host_hash] = url.host();
@@ -44,15 +48,14 @@ namespace tools {
 		return hosts;
 	}
 
-	struct pair_hash {
-		inline size_t operator() (const pair<uint32_t, uint32_t> &p) const {
-			return (uint64_t)p.first << 32 | (uint64_t)p.second;
-		}
-	};
-
-	unordered_set<pair<uint32_t, uint32_t>, pair_hash> run_uniq_link(const vector<string> files, const unordered_map<uint64_t, uint32_t> &hosts) {
+	/*
+		Collects the edges (to << 32 | from) of the links in the files. The buffer is spilled to a sorted run file
+		when it gets larger than max_buffered_edges.
+	*/
+	void run_uniq_link(const vector<string> &files, const host_table &hosts, vector<uint64_t> &edges,
+			const function<void()> &spill) {
 
-		unordered_set<pair<uint32_t, uint32_t>, pair_hash> edges;
+		const size_t max_buffered_edges = 32000000;
 
 		for (const string &warc_path : files) {
 
@@ -65,19 +68,18 @@ namespace tools {
 			while (getline(decompress_stream, line)) {
 				const url_link::link link(line);
 
-				const uint64_t source_hash = link.source_url().host_hash();
-				const uint64_t target_hash = link.target_url().host_hash();
-
-				const size_t source_count = hosts.count(source_hash);
-				const size_t target_count = hosts.count(target_hash);
-				if (source_count && target_count) {
-					// Link between two hosts in the host map.
-					edges.insert(make_pair(hosts.at(source_hash), hosts.at(target_hash)));
+				uint32_t source_id, target_id;
+				if (hosts.find(link.source_url().host_hash(), source_id) &&
+						hosts.find(link.target_url().host_hash(), target_id)) {
+					// Link between two hosts in the host table.
+					edges.push_back((uint64_t)target_id << 32 | source_id);
 				}
 			}
-		}
 
-		return edges;
+			if (edges.size() > max_buffered_edges) {
+				spill();
+			}
+		}
 	}
 
 	void calculate_harmonic_hosts() {
@@ -110,21 +112,21 @@ namespace tools {
 		vector<vector<string>> chunks;
 		algorithm::vector_chunk<string>(files, files.size() / (num_threads * 200), chunks);
 
-		ThreadPool pool(num_threads);
-		vector<future<unordered_map<uint64_t, string>>> results;
+		vector<unordered_map<uint64_t, string>> results(chunks.size());
+		utils::task_group tasks(utils::priority::background);
 
-		for (const vector<string> &chunk : chunks) {
-
-			results.emplace_back(pool.enqueue([chunk] {
-				return run_uniq_host(chunk);
-			}));
+		for (size_t chunk_id = 0; chunk_id < chunks.size(); chunk_id++) {
+			tasks.run([&chunks, &results, chunk_id] {
+				results[chunk_id] = run_uniq_host(chunks[chunk_id]);
+			});
 		}
 
+		tasks.wait();
+
 		unordered_map<uint64_t, string> hosts;
 		size_t idx = 0;
 		cout.precision(2);
-		for (auto &result : results) {
-			const unordered_map<uint64_t, string> result_map = result.get();
+		for (const auto &result_map : results) {
 			for (const auto &iter : result_map) {
 				hosts[iter.first] = iter.second;
 			}
@@ -133,79 +135,26 @@ namespace tools {
 			idx++;
 		}
 
-		idx = 0;
-		ofstream outfile("/mnt/hosts.txt", ios::trunc);
+		// The id of a host is its position in the sorted host table.
+		vector<uint64_t> host_hashes;
+		host_hashes.reserve(hosts.size());
 		for (const auto &iter : hosts) {
-			outfile << idx << '\t' << iter.first << '\t' << iter.second << '\n';
-			idx++;
-		}
-		outfile.close();
-	}
-
-	unordered_map<uint64_t, uint32_t> read_hosts_file() {
-
-		// Load the hosts from /mnt/hosts.txt
-		ifstream infile("/mnt/hosts.txt");
-
-		unordered_map<uint64_t, uint32_t> ret;
-
-		string line;
-		while (getline(infile, line)) {
-			vector<string> parts;
-			boost::algorithm::split(parts, line, boost::is_any_of("\t"));
-
-			uint32_t id = stoi(parts[0]);
-			uint64_t hash = stoull(parts[1]);
-			ret[hash] = id;
-		}
-
-		return ret;
-	}
-
-	vector<uint32_t> read_hosts_file_vec() {
-
-		// Load the hosts from /mnt/hosts.txt
-		ifstream infile("/mnt/hosts.txt");
-
-		vector<uint32_t> ret;
-
-		string line;
-		while (getline(infile, line)) {
-			vector<string> parts;
-			boost::algorithm::split(parts, line, boost::is_any_of("\t"));
-
-			uint32_t id = stoi(parts[0]);
-			ret.push_back(id);
+			host_hashes.push_back(iter.first);
 		}
+		host_table::write(storage::primary_path("hosts.bin"), host_hashes);
 
-		return ret;
-	}
-
-	vector<uint32_t> *read_edge_file(size_t vlen) {
-
-		// Load the hosts from /mnt/hosts.txt
-		ifstream infile("/mnt/edges.txt");
-
-		vector<uint32_t> *edge_map = new vector<uint32_t>[vlen];
-
-		string line;
-		while (getline(infile, line)) {
-			vector<string> parts;
-			boost::algorithm::split(parts, line, boost::is_any_of("\t"));
-
-			uint32_t from = stoi(parts[0]); // I think we are counting from 0 now but from 1 when we created the edge file.
-			uint32_t to = stoi(parts[1]);
-			edge_map[to].push_back(from);
+		ofstream outfile(storage::primary_path("hosts.txt"), ios::trunc);
+		for (size_t id = 0; id < host_hashes.size(); id++) {
+			outfile << id << '\t' << host_hashes[id] << '\t' << hosts[host_hashes[id]] << '\n';
 		}
-
-		return edge_map;
+		outfile.close();
 	}
 
 	void calculate_harmonic_links() {
 
 		const size_t num_threads = 12;
 
-		unordered_map<uint64_t, uint32_t> hosts = read_hosts_file();
+		const host_table hosts(storage::primary_path("hosts.bin"));
 
 		cout << "loaded " << hosts.size() << " hosts" << endl;
 
@@ -236,58 +185,67 @@ namespace tools {
 		vector<vector<string>> chunks;
 		algorithm::vector_chunk<string>(files, files.size() / (num_threads * 500), chunks);
 
-		ThreadPool pool(num_threads);
-		vector<future<unordered_set<pair<uint32_t, uint32_t>, pair_hash>>> results;
-
-		for (const vector<string> &chunk : chunks) {
-			results.emplace_back(pool.enqueue([chunk, &hosts] {
-				return run_uniq_link(chunk, hosts);
-			}));
+		/*
+			Every thread takes chunks from the shared chunk index and keeps its own edge buffer. Full buffers are
+			sorted and spilled to run files that are merged into the graph file at the end.
+		*/
+		mutex run_lock;
+		vector<string> run_files;
+		atomic<size_t> next_chunk = 0;
+
+		utils::task_group tasks(utils::priority::background);
+
+		for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+			tasks.run([thread_id, &chunks, &hosts, &next_chunk, &run_lock, &run_files] {
+				vector<uint64_t> edges;
+				size_t run_id = 0;
+				auto spill = [thread_id, &edges, &run_id, &run_lock, &run_files]() {
+					const string run_file = storage::shard_path("edges", thread_id,
+						"tmp/edges_" + to_string(thread_id) + "_" + to_string(run_id++) + ".run");
+					write_edge_run(run_file, edges);
+					lock_guard lock(run_lock);
+					run_files.push_back(run_file);
+				};
+
+				size_t chunk_id;
+				while ((chunk_id = next_chunk++) < chunks.size()) {
+					run_uniq_link(chunks[chunk_id], hosts, edges, spill);
+					cout << "processed chunk " << chunk_id << " of " << chunks.size() << endl;
+				}
+				spill();
+			});
 		}
 
-		unordered_set<pair<uint32_t, uint32_t>, pair_hash> edges;
-		size_t idx = 0;
-		cout.precision(2);
-		for (auto &result : results) {
-			const unordered_set<pair<uint32_t, uint32_t>, pair_hash> result_set = result.get();
-			size_t idasd = 0;
-			for (const pair<uint32_t, uint32_t> &edge : result_set) {
-				edges.insert(edge);
-				idasd++;
-			}
-			const double percent = (100.0*(double)idx/results.size());
-			cout << "edges contains " << edges.size() << " elements " << percent << "% done" << endl;
-			idx++;
-		}
+		tasks.wait();
 
-		ofstream outfile("/mnt/edges.txt", ios::trunc);
-		for (const pair<uint32_t, uint32_t> edge : edges) {
-			outfile << edge.first << '\t' << edge.second << '\n';
+		cout << "merging " << run_files.size() << " edge runs" << endl;
+
+		write_host_graph(storage::primary_path("edges.bin"), hosts.size(), run_files);
+
+		for (const string &run_file : run_files) {
+			boost::filesystem::remove(run_file);
 		}
-		outfile.close();
 	}
 
 	void calculate_harmonic() {
 
-		const size_t num_threads = 8;
+		const algorithm::csr_graph graph = read_host_graph(storage::primary_path("edges.bin"));
 
-		vector<uint32_t> hosts = read_hosts_file_vec();
-		const vector<uint32_t> *edge_map = read_edge_file(hosts.size());
-
-		cout << "loaded " << hosts.size() << " hosts" << endl;
+		cout << "loaded " << graph.num_vertices() << " hosts and " << graph.num_edges() << " edges" << endl;
 
-		cout << "running harmonic centrality algorithm on " << num_threads << " threads" << endl;
+		cout << "running harmonic centrality algorithm" << endl;
 
 		//vector<double> harmonic = algorithm::harmonic_centrality_threaded(hosts.size(), edge_map, 3, num_threads);
 
-		vector<double> harmonic = algorithm::hyper_ball(hosts.size(), edge_map);
+		// 2^8 registers per host keeps the counters at 512 bytes per host, memory mapped from the tmp directory.
+		const int register_bits = 8;
 
-		delete [] edge_map;
+		vector<double> harmonic = algorithm::hyper_ball(graph, register_bits, 40, storage::primary_path("tmp"));
 
 		// Save harmonic centrality.
-		ofstream outfile("/mnt/harmonic.txt", ios::trunc);
-		for (size_t i = 0; i < hosts.size(); i++) {
-			outfile << fixed << hosts[i] << '\t' << harmonic[i] << '\n';
+		ofstream outfile(storage::primary_path("harmonic.txt"), ios::trunc);
+		for (size_t i = 0; i < graph.num_vertices(); i++) {
+			outfile << fixed << i << '\t' << harmonic[i] << '\n';
 		}
 
 	}
@@ -25,6 +25,7 @@
  */
 
 #include "counter.h"
+#include "host_counter.h"
 
 #include <iostream>
 #include <future>
@@ -34,6 +35,8 @@
 #include <boost/filesystem.hpp>
 #include "config.h"
 #include "URL.h"
+#include "url_view.h"
+#include "text/text.h"
 #include "url_link/link.h"
 #include "url_link/link_counter.h"
 #include "transfer/transfer.h"
@@ -46,9 +49,7 @@ using namespace std;
 
 namespace tools {
 
-	map<string, size_t> count_urls_per_domain(const vector<string> &warc_paths) {
-
-		map<string, size_t> counts;
+	void count_urls_per_domain(const vector<string> &warc_paths, host_counter &counter, size_t thread_id) {
 
 		size_t idx = 0;
 		for (const string &warc_path : warc_paths) {
@@ -59,8 +60,8 @@ namespace tools {
 
 			string line;
 			while (getline(decompress_stream, line)) {
-				const URL url(line.substr(0, line.find("\t")));
-				counts[url.host()]++;
+				const string_view url = string_view(line).substr(0, line.find("\t"));
+				counter.add(thread_id, url_view(url).host());
 			}
 
 			if (idx % 100 == 0) {
@@ -69,11 +70,9 @@ namespace tools {
 
 			idx++;
 		}
-
-		return counts;
 	}
 
-	void run_counter_per_domain(const string &batch) {
+	void run_counter_per_domain(const string &batch, size_t top_k) {
 
 		const size_t num_threads = 12;
 
@@ -105,23 +104,25 @@ namespace tools {
 		/*
 		Run url counters
 		*/
-		vector<future<map<string, size_t>>> futures;
+		// Exact counts for all hosts, the top hosts are counted in bounded memory.
+		const size_t top_k_capacity = 100000;
+		host_counter counter(num_threads, top_k ? max(top_k, top_k_capacity) : 0);
+		vector<future<void>> futures;
 		for (size_t i = 0; i < num_threads && i < thread_input.size(); i++) {
-			futures.emplace_back(std::async(launch::async, count_urls_per_domain, thread_input[i]));
+			futures.emplace_back(std::async(launch::async, count_urls_per_domain, cref(thread_input[i]), ref(counter), i));
 		}
 
-		map<string, size_t> all_counts;
 		for (auto &future : futures) {
-			map<string, size_t> result = future.get();
-			for (const auto &iter : result) {
-				all_counts[iter.first] += iter.second;
-			}
+			future.get();
 		}
 
 		futures.clear();
 
-		for (const auto &iter : all_counts) {
-			cout << iter.first << "\t" << iter.second << endl;
+		counter.merge();
+
+		const vector<host_counter::host_count> counts = top_k ? counter.top_k(top_k) : counter.sorted_by_host();
+		for (const auto &host_count : counts) {
+			cout << host_count.m_host << "\t" << host_count.m_count << endl;
 		}
 	}
 
@@ -138,8 +139,7 @@ namespace tools {
 
 			string line;
 			while (getline(decompress_stream, line)) {
-				const URL url(line.substr(0, line.find("\t")));
-				counter->insert(url.hash());
+				counter->insert(url_view(string_view(line).substr(0, line.find("\t"))).hash());
 			}
 
 			if (idx % 100 == 0) {
@@ -164,9 +164,11 @@ namespace tools {
 			decompress_stream.push(infile);
 
 			string line;
+			vector<string_view> columns;
 			while (getline(decompress_stream, line)) {
-				const url_link::link link(line);
-				counter->insert(link.target_url().hash());
+				text::split_view(line, columns);
+				if (columns.size() < 4) continue;
+				counter->insert(url_view(columns[2], columns[3]).hash());
 			}
 
 			if (idx % 100 == 0) {
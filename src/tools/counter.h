@@ -30,7 +30,11 @@
 
 namespace tools {
 
-	void run_counter_per_domain(const std::string &batch);
+	/*
+		Prints the number of urls per host in the batch. Prints all hosts sorted by host or only the top_k hosts
+		with the most urls if top_k is not zero.
+	*/
+	void run_counter_per_domain(const std::string &batch, size_t top_k = 0);
 	void run_counter();
 	void count_all_links();
 
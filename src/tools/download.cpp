@@ -30,6 +30,7 @@
 #include "profiler/profiler.h"
 #include "algorithm/algorithm.h"
 #include "url_link/link.h"
+#include "url_view.h"
 #include "common/system.h"
 #include "config.h"
 #include "logger/logger.h"
@@ -121,7 +122,7 @@ namespace tools {
 
 			string line;
 			while (getline(infile, line)) {
-				const URL url(line.substr(0, line.find("\t")));
+				const url_view url(string_view(line).substr(0, line.find("\t")));
 
 				if (url_set.count(url.hash())) {
 					const size_t node_id = url.host_hash() % max_num_batches;
@@ -2,6 +2,7 @@
 #include "find_links.h"
 #include "file/gz_tsv_file.h"
 #include "URL.h"
+#include "url_view.h"
 #include "algorithm/algorithm.h"
 #include <boost/algorithm/string.hpp>
 #include <iostream>
@@ -118,10 +119,7 @@ namespace tools {
 
 			string line;
 			while (getline(decompress_stream, line)) {
-				vector<string> col_values;
-				boost::algorithm::split(col_values, line, boost::is_any_of("\t"));
-
-				URL url(col_values[0]);
+				const url_view url(string_view(line).substr(0, line.find("\t")));
 
 				host_hashes.insert(url.host_hash());
 			}
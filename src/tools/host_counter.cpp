@@ -0,0 +1,260 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "host_counter.h"
+#include "utils/scheduler.hpp"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+using namespace std;
+
+namespace tools {
+
+	host_counter::host_counter(size_t num_threads, size_t capacity)
+	: m_capacity(capacity) {
+		if (m_capacity) {
+			m_summaries.reserve(num_threads);
+			for (size_t i = 0; i < num_threads; i++) {
+				m_summaries.emplace_back(capacity);
+			}
+			m_hosts.resize(num_threads);
+		} else {
+			m_counts.resize(num_threads);
+		}
+	}
+
+	void host_counter::add(size_t thread_id, string_view host, size_t count) {
+		const uint64_t host_hash = hash<string_view>{}(host);
+		if (m_capacity) {
+			m_summaries[thread_id].add(host_hash, host, count);
+			m_hosts[thread_id].insert(host_hash);
+			return;
+		}
+
+		host_count &counted = m_counts[thread_id][host_hash];
+		if (counted.m_count == 0) counted.m_host = host;
+		counted.m_count += count;
+	}
+
+	void host_counter::merge() {
+		if (m_capacity) {
+			merge_summaries();
+		} else {
+			merge_counts();
+		}
+	}
+
+	/*
+		Every thread first splits its hosts into partitions on the top bits of the host hash, then every partition is
+		merged by its own task. The same host always ends up in the same partition.
+	*/
+	void host_counter::merge_counts() {
+
+		const size_t num_partitions = 1ull << m_partition_bits;
+		const size_t num_threads = m_counts.size();
+
+		vector<vector<vector<uint32_t>>> partitioned(num_threads, vector<vector<uint32_t>>(num_partitions));
+		vector<vector<host_count>> merged(num_partitions);
+
+		{
+			utils::task_group tasks(utils::priority::background);
+			for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+				tasks.run([this, thread_id, &partitioned]() {
+					uint32_t index = 0;
+					for (const auto &iter : m_counts[thread_id]) {
+						partitioned[thread_id][iter.first >> (64 - m_partition_bits)].push_back(index++);
+					}
+				});
+			}
+			tasks.wait();
+		}
+
+		{
+			utils::task_group tasks(utils::priority::background);
+			for (size_t partition = 0; partition < num_partitions; partition++) {
+				tasks.run([this, partition, num_threads, &partitioned, &merged]() {
+					algorithm::hash_map<host_count> counts;
+					for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+						const auto thread_counts = m_counts[thread_id].begin();
+						for (uint32_t index : partitioned[thread_id][partition]) {
+							const auto &iter = thread_counts[index];
+							host_count &counted = counts[iter.first];
+							if (counted.m_count == 0) counted.m_host = iter.second.m_host;
+							counted.m_count += iter.second.m_count;
+						}
+					}
+					merged[partition].reserve(counts.size());
+					for (auto &iter : counts) {
+						merged[partition].push_back(std::move(iter.second));
+					}
+				});
+			}
+			tasks.wait();
+		}
+
+		m_merged.clear();
+		for (vector<host_count> &partition : merged) {
+			m_merged.insert(m_merged.end(), make_move_iterator(partition.begin()), make_move_iterator(partition.end()));
+		}
+	}
+
+	/*
+		Merges the summaries like mergeable summaries, a full summary that does not hold a host could have seen it up
+		to its lowest count so that count is added to both the count and the error of the host. The capacity hosts
+		with the highest counts are kept.
+	*/
+	void host_counter::merge_summaries() {
+
+		struct merged_count {
+			host_count m_count;
+			size_t m_held_min = 0;
+		};
+
+		unordered_map<uint64_t, merged_count> counts;
+		size_t sum_of_mins = 0;
+		for (const summary &thread_summary : m_summaries) {
+			const size_t min_count = thread_summary.full() ? thread_summary.min_count() : 0;
+			sum_of_mins += min_count;
+			for (const summary::entry &entry : thread_summary.entries()) {
+				auto [iter, inserted] = counts.try_emplace(entry.m_hash);
+				if (inserted) {
+					iter->second.m_count.m_host = entry.m_count.m_host;
+				}
+				iter->second.m_count.m_count += entry.m_count.m_count;
+				iter->second.m_count.m_error += entry.m_count.m_error;
+				iter->second.m_held_min += min_count;
+			}
+		}
+
+		m_merged.clear();
+		m_merged.reserve(counts.size());
+		for (auto &iter : counts) {
+			const size_t not_held = sum_of_mins - iter.second.m_held_min;
+			m_merged.push_back(std::move(iter.second.m_count));
+			m_merged.back().m_count += not_held;
+			m_merged.back().m_error += not_held;
+		}
+
+		if (m_merged.size() > m_capacity) {
+			nth_element(m_merged.begin(), m_merged.begin() + m_capacity, m_merged.end(),
+				[](const host_count &a, const host_count &b) {
+				return a.m_count > b.m_count;
+			});
+			m_merged.resize(m_capacity);
+		}
+
+		m_merged_hosts.reset();
+		for (const algorithm::hyper_log_log &hosts : m_hosts) {
+			m_merged_hosts += hosts;
+		}
+	}
+
+	size_t host_counter::size() const {
+		if (m_capacity) return m_merged_hosts.count();
+		return m_merged.size();
+	}
+
+	vector<host_counter::host_count> host_counter::top_k(size_t k) const {
+		vector<host_count> ret = m_merged;
+		k = min(k, ret.size());
+		partial_sort(ret.begin(), ret.begin() + k, ret.end(), [](const host_count &a, const host_count &b) {
+			return a.m_count > b.m_count;
+		});
+		ret.resize(k);
+		return ret;
+	}
+
+	vector<host_counter::host_count> host_counter::sorted_by_host() const {
+		vector<host_count> ret = m_merged;
+		sort(ret.begin(), ret.end(), [](const host_count &a, const host_count &b) {
+			return a.m_host < b.m_host;
+		});
+		return ret;
+	}
+
+	host_counter::summary::summary(size_t capacity)
+	: m_capacity(capacity) {
+	}
+
+	void host_counter::summary::add(uint64_t host_hash, string_view host, size_t count) {
+		if (m_capacity == 0) return;
+
+		auto iter = m_index.find(host_hash);
+		if (iter != m_index.end()) {
+			m_heap[iter->second].m_count.m_count += count;
+			sift_down(iter->second);
+			return;
+		}
+
+		if (!full()) {
+			m_heap.push_back(entry{.m_hash = host_hash, .m_count = host_count{.m_host = string(host), .m_count = count}});
+			m_index[host_hash] = m_heap.size() - 1;
+			sift_up(m_heap.size() - 1);
+			return;
+		}
+
+		// Replace the host with the lowest count, the new host could have been one of the hosts counted in it.
+		entry &lowest = m_heap[0];
+		m_index.erase(lowest.m_hash);
+		const size_t min_count = lowest.m_count.m_count;
+		lowest.m_hash = host_hash;
+		lowest.m_count.m_host = host;
+		lowest.m_count.m_count = min_count + count;
+		lowest.m_count.m_error = min_count;
+		m_index[host_hash] = 0;
+		sift_down(0);
+	}
+
+	void host_counter::summary::sift_up(size_t pos) {
+		while (pos > 0) {
+			const size_t parent = (pos - 1) / 2;
+			if (m_heap[parent].m_count.m_count <= m_heap[pos].m_count.m_count) break;
+			swap_entries(parent, pos);
+			pos = parent;
+		}
+	}
+
+	void host_counter::summary::sift_down(size_t pos) {
+		while (true) {
+			size_t smallest = pos;
+			const size_t left = 2 * pos + 1;
+			const size_t right = left + 1;
+			if (left < m_heap.size() && m_heap[left].m_count.m_count < m_heap[smallest].m_count.m_count) smallest = left;
+			if (right < m_heap.size() && m_heap[right].m_count.m_count < m_heap[smallest].m_count.m_count) smallest = right;
+			if (smallest == pos) break;
+			swap_entries(smallest, pos);
+			pos = smallest;
+		}
+	}
+
+	void host_counter::summary::swap_entries(size_t a, size_t b) {
+		swap(m_heap[a], m_heap[b]);
+		m_index[m_heap[a].m_hash] = a;
+		m_index[m_heap[b].m_hash] = b;
+	}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "algorithm/hash_map.h"
+#include "algorithm/hyper_log_log.h"
+
+namespace tools {
+
+	/*
+		Counts hosts over many threads. Every thread counts into its own structures so the threads never share anything
+		while counting, merge() combines them.
+
+		By default the counts are exact. Every thread keeps an algorithm::hash_map from host hash to count and merge()
+		partitions all hosts on the hash so the partitions are merged in parallel.
+
+		With a capacity the memory is bounded for when only the top hosts are needed. Every thread then keeps a
+		space-saving summary of at most capacity hosts and a hyper_log_log of all host hashes. Hosts with a count above
+		(total count / capacity) are always kept. The count of a kept host is an upper bound that is at most m_error
+		above the real count, it is exact as long as no thread has seen more than capacity hosts.
+	*/
+	class host_counter {
+
+		public:
+
+			struct host_count {
+				std::string m_host;
+				size_t m_count = 0;
+				size_t m_error = 0;
+			};
+
+			// Counts exactly if capacity is zero, otherwise keeps at most capacity hosts per thread.
+			explicit host_counter(size_t num_threads, size_t capacity = 0);
+
+			// Must only be called by one thread for each thread_id.
+			void add(size_t thread_id, std::string_view host, size_t count = 1);
+
+			void merge();
+
+			// Number of unique hosts, estimated if the counter has a capacity. Only valid after merge().
+			size_t size() const;
+
+			// The k hosts with the highest counts sorted by count, only valid after merge().
+			std::vector<host_count> top_k(size_t k) const;
+
+			// The kept hosts sorted by host, only valid after merge().
+			std::vector<host_count> sorted_by_host() const;
+
+		private:
+
+			/*
+				Space-saving summary, a min heap on count with an index from host hash to heap position. When the
+				summary is full a new host replaces the host with the lowest count and inherits its count as error.
+			*/
+			class summary {
+
+				public:
+
+					struct entry {
+						uint64_t m_hash;
+						host_count m_count;
+					};
+
+					explicit summary(size_t capacity);
+
+					void add(uint64_t host_hash, std::string_view host, size_t count);
+					bool full() const { return m_heap.size() == m_capacity; }
+					size_t min_count() const { return m_heap.size() ? m_heap[0].m_count.m_count : 0; }
+					const std::vector<entry> &entries() const { return m_heap; }
+
+				private:
+
+					const size_t m_capacity;
+					std::vector<entry> m_heap;
+					std::unordered_map<uint64_t, size_t> m_index;
+
+					void sift_up(size_t pos);
+					void sift_down(size_t pos);
+					void swap_entries(size_t a, size_t b);
+
+			};
+
+			const size_t m_capacity;
+			const size_t m_partition_bits = 6;
+			std::vector<algorithm::hash_map<host_count>> m_counts;
+			std::vector<summary> m_summaries;
+			std::vector<algorithm::hyper_log_log> m_hosts;
+			std::vector<host_count> m_merged;
+			algorithm::hyper_log_log m_merged_hosts;
+
+			void merge_counts();
+			void merge_summaries();
+
+	};
+
+}
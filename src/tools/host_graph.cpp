@@ -0,0 +1,272 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "host_graph.h"
+#include "utils/scheduler.hpp"
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+namespace tools {
+
+	namespace {
+
+		const char host_table_magic[8] = {'A', 'L', 'X', 'H', 'O', 'S', 'T', '1'};
+		const char host_graph_magic[8] = {'A', 'L', 'X', 'G', 'R', 'P', 'H', '1'};
+
+		void write_varint(ostream &stream, uint32_t value) {
+			char buffer[5];
+			size_t len = 0;
+			while (value >= 0x80) {
+				buffer[len++] = (char)(value | 0x80);
+				value >>= 7;
+			}
+			buffer[len++] = (char)value;
+			stream.write(buffer, len);
+		}
+
+		uint32_t read_varint(const uint8_t *&data) {
+			uint32_t value = 0;
+			int shift = 0;
+			while (*data & 0x80) {
+				value |= (uint32_t)(*data++ & 0x7f) << shift;
+				shift += 7;
+			}
+			value |= (uint32_t)(*data++) << shift;
+			return value;
+		}
+
+		class run_reader {
+
+			public:
+
+				explicit run_reader(const string &file_name)
+				: m_reader(file_name, ios::binary) {
+					if (!m_reader.is_open()) {
+						throw runtime_error("Could not open edge run " + file_name);
+					}
+				}
+
+				bool next(uint64_t &edge) {
+					if (m_pos == m_len) {
+						m_reader.read((char *)m_buffer, sizeof(m_buffer));
+						m_len = m_reader.gcount() / sizeof(uint64_t);
+						m_pos = 0;
+						if (m_len == 0) return false;
+					}
+					edge = m_buffer[m_pos++];
+					return true;
+				}
+
+			private:
+
+				ifstream m_reader;
+				uint64_t m_buffer[8192];
+				size_t m_pos = 0;
+				size_t m_len = 0;
+
+		};
+
+	}
+
+	host_table::host_table(const string &file_name)
+	: m_file(file_name) {
+		if (m_file.size() < sizeof(host_table_magic) + sizeof(uint64_t) ||
+				memcmp(m_file.data(), host_table_magic, sizeof(host_table_magic)) != 0) {
+			throw runtime_error("Invalid host table " + file_name);
+		}
+		const uint64_t size = *(const uint64_t *)(m_file.data() + sizeof(host_table_magic));
+		m_size = size;
+		m_hashes = (const uint64_t *)(m_file.data() + sizeof(host_table_magic) + sizeof(uint64_t));
+	}
+
+	bool host_table::find(uint64_t host_hash, uint32_t &id) const {
+		const uint64_t *end = m_hashes + m_size;
+		const uint64_t *iter = lower_bound(m_hashes, end, host_hash);
+		if (iter == end || *iter != host_hash) return false;
+		id = iter - m_hashes;
+		return true;
+	}
+
+	void host_table::write(const string &file_name, vector<uint64_t> &host_hashes) {
+		sort(host_hashes.begin(), host_hashes.end());
+		host_hashes.erase(unique(host_hashes.begin(), host_hashes.end()), host_hashes.end());
+
+		ofstream outfile(file_name, ios::binary | ios::trunc);
+		if (!outfile.is_open()) {
+			throw runtime_error("Could not open host table " + file_name);
+		}
+		const uint64_t size = host_hashes.size();
+		outfile.write(host_table_magic, sizeof(host_table_magic));
+		outfile.write((const char *)&size, sizeof(uint64_t));
+		outfile.write((const char *)host_hashes.data(), size * sizeof(uint64_t));
+		outfile.close();
+		if (!outfile) {
+			throw runtime_error("Could not write host table " + file_name);
+		}
+	}
+
+	void write_edge_run(const string &file_name, vector<uint64_t> &edges) {
+		sort(edges.begin(), edges.end());
+		edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+		ofstream outfile(file_name, ios::binary | ios::trunc);
+		if (!outfile.is_open()) {
+			throw runtime_error("Could not open edge run " + file_name);
+		}
+		outfile.write((const char *)edges.data(), edges.size() * sizeof(uint64_t));
+		outfile.close();
+		if (!outfile) {
+			throw runtime_error("Could not write edge run " + file_name);
+		}
+		edges.clear();
+	}
+
+	void write_host_graph(const string &file_name, uint32_t num_vertices, const vector<string> &run_files) {
+
+		ofstream outfile(file_name, ios::binary | ios::trunc);
+		if (!outfile.is_open()) {
+			throw runtime_error("Could not open host graph " + file_name);
+		}
+
+		host_graph_header header;
+		memcpy(header.m_magic, host_graph_magic, sizeof(host_graph_magic));
+		header.m_num_vertices = num_vertices;
+		header.m_edge_data_pos = sizeof(host_graph_header);
+		outfile.write((const char *)&header, sizeof(host_graph_header));
+
+		vector<unique_ptr<run_reader>> runs;
+		using heap_item = pair<uint64_t, size_t>;
+		priority_queue<heap_item, vector<heap_item>, greater<heap_item>> heap;
+		for (const string &run_file : run_files) {
+			runs.push_back(make_unique<run_reader>(run_file));
+			uint64_t edge;
+			if (runs.back()->next(edge)) {
+				heap.emplace(edge, runs.size() - 1);
+			}
+		}
+
+		vector<uint64_t> edge_offsets(num_vertices + 1, 0);
+		vector<uint64_t> byte_offsets(num_vertices + 1, 0);
+		uint64_t num_edges = 0;
+		uint64_t last_edge = UINT64_MAX;
+		uint32_t current_vertex = 0;
+		uint32_t last_from = 0;
+
+		while (!heap.empty()) {
+			const auto [edge, run_id] = heap.top();
+			heap.pop();
+			uint64_t next_edge;
+			if (runs[run_id]->next(next_edge)) {
+				heap.emplace(next_edge, run_id);
+			}
+
+			if (edge == last_edge) continue;
+			last_edge = edge;
+
+			const uint32_t to = edge >> 32;
+			const uint32_t from = edge & 0xffffffff;
+			if (to >= num_vertices || from >= num_vertices) continue;
+
+			// Close the edge lists of all vertices up to to.
+			while (current_vertex < to) {
+				current_vertex++;
+				edge_offsets[current_vertex] = num_edges;
+				byte_offsets[current_vertex] = (uint64_t)outfile.tellp() - header.m_edge_data_pos;
+				last_from = 0;
+			}
+
+			write_varint(outfile, from - last_from);
+			last_from = from;
+			num_edges++;
+		}
+		while (current_vertex < num_vertices) {
+			current_vertex++;
+			edge_offsets[current_vertex] = num_edges;
+			byte_offsets[current_vertex] = (uint64_t)outfile.tellp() - header.m_edge_data_pos;
+		}
+
+		// Padding so a varint can always be read without checking the end of the data.
+		const char padding[8] = {0};
+		outfile.write(padding, sizeof(padding));
+
+		header.m_num_edges = num_edges;
+		header.m_edge_offsets_pos = outfile.tellp();
+		outfile.write((const char *)edge_offsets.data(), edge_offsets.size() * sizeof(uint64_t));
+		header.m_byte_offsets_pos = outfile.tellp();
+		outfile.write((const char *)byte_offsets.data(), byte_offsets.size() * sizeof(uint64_t));
+
+		outfile.seekp(0);
+		outfile.write((const char *)&header, sizeof(host_graph_header));
+		outfile.close();
+		if (!outfile) {
+			throw runtime_error("Could not write host graph " + file_name);
+		}
+	}
+
+	algorithm::csr_graph read_host_graph(const string &file_name) {
+
+		file::mmap_file graph_file(file_name);
+		if (graph_file.size() < sizeof(host_graph_header) ||
+				memcmp(graph_file.data(), host_graph_magic, sizeof(host_graph_magic)) != 0) {
+			throw runtime_error("Invalid host graph " + file_name);
+		}
+
+		const host_graph_header *header = (const host_graph_header *)graph_file.data();
+		const size_t n = header->m_num_vertices;
+		const uint64_t *edge_offsets = (const uint64_t *)(graph_file.data() + header->m_edge_offsets_pos);
+		const uint64_t *byte_offsets = (const uint64_t *)(graph_file.data() + header->m_byte_offsets_pos);
+		const uint8_t *edge_data = (const uint8_t *)(graph_file.data() + header->m_edge_data_pos);
+
+		vector<uint64_t> offsets(edge_offsets, edge_offsets + n + 1);
+		vector<uint32_t> edges(header->m_num_edges);
+
+		utils::task_group tasks(utils::priority::background);
+		const size_t vertices_per_task = 1 << 16;
+		for (size_t begin = 0; begin < n; begin += vertices_per_task) {
+			const size_t end = min(n, begin + vertices_per_task);
+			tasks.run([&, begin, end]() {
+				for (size_t v = begin; v < end; v++) {
+					const uint8_t *data = edge_data + byte_offsets[v];
+					uint32_t from = 0;
+					for (uint64_t i = edge_offsets[v]; i < edge_offsets[v + 1]; i++) {
+						from += read_varint(data);
+						edges[i] = from;
+					}
+				}
+			});
+		}
+		tasks.wait();
+
+		return algorithm::csr_graph(std::move(offsets), std::move(edges));
+	}
+
+}
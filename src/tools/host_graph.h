@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "file/mmap_file.h"
+#include "algorithm/csr_graph.h"
+
+namespace tools {
+
+	/*
+		Binary files for the host graph used by calculate_harmonic.
+
+		The host table is the sorted list of host hashes, the id of a host is its position in the list:
+		[magic "ALXHOST1"][uint64 num_hosts][uint64 host_hash] * num_hosts
+
+		The graph file stores the incoming edges of every host, sorted and delta encoded as varints:
+		[host_graph_header][edge data][uint64 edge offset] * (num_hosts + 1)[uint64 byte offset] * (num_hosts + 1)
+		The edge offsets are the positions in the decoded csr_graph and the byte offsets the positions in the edge data
+		so the lists can be decoded in parallel.
+	*/
+
+	struct host_graph_header {
+		char m_magic[8];
+		uint64_t m_num_vertices;
+		uint64_t m_num_edges;
+		uint64_t m_edge_data_pos;
+		uint64_t m_edge_offsets_pos;
+		uint64_t m_byte_offsets_pos;
+	};
+
+	class host_table {
+
+		public:
+
+			explicit host_table(const std::string &file_name);
+
+			uint32_t size() const { return m_size; }
+
+			// Returns false if the host is not in the table.
+			bool find(uint64_t host_hash, uint32_t &id) const;
+
+			static void write(const std::string &file_name, std::vector<uint64_t> &host_hashes);
+
+		private:
+
+			file::mmap_file m_file;
+			const uint64_t *m_hashes;
+			uint32_t m_size;
+
+	};
+
+	/*
+		Builds the graph file from runs of edges. Every run is a file of uint64 (to << 32 | from) sorted ascending,
+		duplicates over runs are removed.
+	*/
+	void write_host_graph(const std::string &file_name, uint32_t num_vertices, const std::vector<std::string> &run_files);
+	void write_edge_run(const std::string &file_name, std::vector<uint64_t> &edges);
+	algorithm::csr_graph read_host_graph(const std::string &file_name);
+
+}
@@ -0,0 +1,325 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "split_pipeline.h"
+#include "storage/storage.h"
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/filesystem.hpp>
+#include "zlib.h"
+
+using namespace std;
+
+namespace tools {
+
+	namespace {
+
+		template<typename item_type>
+		class bounded_queue {
+
+			public:
+
+				explicit bounded_queue(size_t capacity) : m_capacity(capacity) {}
+
+				void push(item_type &&item) {
+					unique_lock lock(m_lock);
+					m_not_full.wait(lock, [this]() { return m_items.size() < m_capacity; });
+					m_items.push_back(std::move(item));
+					m_not_empty.notify_one();
+				}
+
+				// Returns false when the queue is closed and empty.
+				bool pop(item_type &item) {
+					unique_lock lock(m_lock);
+					m_not_empty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+					if (m_items.empty()) return false;
+					item = std::move(m_items.front());
+					m_items.pop_front();
+					m_not_full.notify_one();
+					return true;
+				}
+
+				void close() {
+					lock_guard lock(m_lock);
+					m_closed = true;
+					m_not_empty.notify_all();
+				}
+
+			private:
+
+				const size_t m_capacity;
+				deque<item_type> m_items;
+				mutex m_lock;
+				condition_variable m_not_full;
+				condition_variable m_not_empty;
+				bool m_closed = false;
+
+		};
+
+		struct output_buffer {
+			size_t m_destination = 0;
+			string m_data;
+		};
+
+		struct destination_files {
+			mutex m_lock;
+			ofstream m_file;
+			size_t m_file_size = 0;
+			size_t m_first_file = 0;
+			vector<string> m_file_names;
+		};
+
+		string destination_path(const string &name, size_t destination) {
+			return "crawl-data/" + name + "-" + to_string(destination) + "-BIG";
+		}
+
+		class gzip_member_compressor {
+
+			public:
+
+				gzip_member_compressor() {
+					m_zstream.zalloc = Z_NULL;
+					m_zstream.zfree = Z_NULL;
+					m_zstream.opaque = Z_NULL;
+					if (deflateInit2(&m_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+						throw runtime_error("Could not initialize deflate");
+					}
+				}
+
+				~gzip_member_compressor() {
+					deflateEnd(&m_zstream);
+				}
+
+				// Compresses data into one complete gzip member.
+				const string &compress(const string &data) {
+					deflateReset(&m_zstream);
+					m_output.resize(deflateBound(&m_zstream, data.size()));
+					m_zstream.next_in = (Bytef *)data.data();
+					m_zstream.avail_in = data.size();
+					m_zstream.next_out = (Bytef *)m_output.data();
+					m_zstream.avail_out = m_output.size();
+					if (deflate(&m_zstream, Z_FINISH) != Z_STREAM_END) {
+						throw runtime_error("Could not deflate buffer");
+					}
+					m_output.resize(m_zstream.total_out);
+					return m_output;
+				}
+
+			private:
+
+				z_stream m_zstream;
+				string m_output;
+
+		};
+
+	}
+
+	split_pipeline::split_pipeline(const string &name, size_t num_destinations, const route_function &route,
+			size_t num_threads, size_t max_memory_mb)
+	: m_name(name), m_num_destinations(num_destinations), m_route(route), m_num_threads(num_threads) {
+		/*
+			A quarter of the memory goes to line blocks between decompression and routing, the rest to the output
+			buffers. Every destination has one buffer in the router and two per compression thread are in flight.
+		*/
+		const size_t max_memory = max_memory_mb * 1024 * 1024;
+		m_block_size = max<size_t>(64 * 1024, max_memory / 4 / (num_threads * 2));
+		m_num_buffers = num_destinations + num_threads * 2;
+		m_buffer_size = max<size_t>(4096, (max_memory - max_memory / 4) / m_num_buffers);
+	}
+
+	void split_pipeline::run(const vector<string> &input_files) {
+
+		vector<destination_files> files(m_num_destinations);
+		for (size_t destination = 0; destination < m_num_destinations; destination++) {
+			boost::filesystem::create_directories(storage::primary_path(destination_path(m_name, destination) + "/files"));
+
+			// Number the files after the ones earlier runs wrote.
+			ifstream paths(storage::primary_path(destination_path(m_name, destination) + "/warc.paths"));
+			string line;
+			while (getline(paths, line)) {
+				files[destination].m_first_file++;
+			}
+		}
+
+		bounded_queue<string> blocks(m_num_threads * 2);
+		bounded_queue<output_buffer> full_buffers(m_num_threads * 2);
+		bounded_queue<string> free_buffers(m_num_buffers);
+		for (size_t i = 0; i < m_num_buffers; i++) {
+			free_buffers.push(string());
+		}
+
+		// Decompression stage.
+		atomic<size_t> next_file = 0;
+		vector<thread> readers;
+		for (size_t i = 0; i < m_num_threads; i++) {
+			readers.emplace_back([this, &input_files, &next_file, &blocks]() {
+				size_t file_index;
+				while ((file_index = next_file++) < input_files.size()) {
+					ifstream infile(input_files[file_index]);
+					boost::iostreams::filtering_istream decompress_stream;
+					decompress_stream.push(boost::iostreams::gzip_decompressor());
+					decompress_stream.push(infile);
+
+					string block(m_block_size, '\0');
+					size_t len = 0;
+					while (true) {
+						decompress_stream.read(block.data() + len, block.size() - len);
+						const size_t bytes_read = decompress_stream.gcount();
+						len += bytes_read;
+
+						if (bytes_read == 0) {
+							if (len > 0) {
+								block.resize(len);
+								if (block.back() != '\n') block.push_back('\n');
+								blocks.push(std::move(block));
+							}
+							break;
+						}
+						if (len < block.size()) continue;
+
+						// Send everything up to the last complete line, a single line longer than the block grows it.
+						const size_t end = block.rfind('\n');
+						if (end == string::npos) {
+							block.resize(block.size() * 2);
+							continue;
+						}
+						const size_t rest = len - end - 1;
+						string next(max(m_block_size, rest * 2), '\0');
+						copy(block.begin() + end + 1, block.end(), next.begin());
+						block.resize(end + 1);
+						blocks.push(std::move(block));
+						block = std::move(next);
+						len = rest;
+					}
+
+					if (file_index % 100 == 0) {
+						cout << input_files[file_index] << " done " << file_index << "/" << input_files.size() << endl;
+					}
+				}
+			});
+		}
+
+		// Routing stage.
+		thread router([this, &blocks, &full_buffers, &free_buffers]() {
+			vector<string> buffers(m_num_destinations);
+			for (string &buffer : buffers) {
+				free_buffers.pop(buffer);
+			}
+
+			string block;
+			while (blocks.pop(block)) {
+				string_view data(block);
+				while (!data.empty()) {
+					const size_t line_end = data.find('\n');
+					const string_view line = data.substr(0, line_end);
+					data.remove_prefix(line_end + 1);
+
+					size_t destination;
+					if (!m_route(line, destination)) continue;
+
+					string &buffer = buffers[destination];
+					if (buffer.size() && buffer.size() + line.size() + 1 > m_buffer_size) {
+						full_buffers.push(output_buffer{destination, std::move(buffer)});
+						free_buffers.pop(buffer);
+					}
+					if (buffer.capacity() < m_buffer_size) buffer.reserve(m_buffer_size);
+					buffer.append(line);
+					buffer.push_back('\n');
+				}
+			}
+
+			for (size_t destination = 0; destination < m_num_destinations; destination++) {
+				if (buffers[destination].size()) {
+					full_buffers.push(output_buffer{destination, std::move(buffers[destination])});
+				}
+			}
+			full_buffers.close();
+		});
+
+		// Compression stage.
+		vector<thread> compressors;
+		for (size_t i = 0; i < m_num_threads; i++) {
+			compressors.emplace_back([this, &full_buffers, &free_buffers, &files]() {
+				gzip_member_compressor compressor;
+				output_buffer buffer;
+				while (full_buffers.pop(buffer)) {
+					const string &compressed = compressor.compress(buffer.m_data);
+
+					destination_files &dest = files[buffer.m_destination];
+					{
+						lock_guard lock(dest.m_lock);
+						if (!dest.m_file.is_open() || dest.m_file_size > m_max_file_size) {
+							if (dest.m_file.is_open()) dest.m_file.close();
+							dest.m_file_names.push_back(destination_path(m_name, buffer.m_destination) + "/files/" +
+								to_string(dest.m_first_file + dest.m_file_names.size()) + ".gz");
+							dest.m_file.open(storage::primary_path(dest.m_file_names.back()), ios::trunc | ios::binary);
+							dest.m_file_size = 0;
+						}
+						dest.m_file.write(compressed.data(), compressed.size());
+						dest.m_file_size += compressed.size();
+					}
+
+					buffer.m_data.clear();
+					free_buffers.push(std::move(buffer.m_data));
+				}
+			});
+		}
+
+		for (thread &reader : readers) {
+			reader.join();
+		}
+		blocks.close();
+		router.join();
+		for (thread &compressor : compressors) {
+			compressor.join();
+		}
+
+		for (size_t destination = 0; destination < m_num_destinations; destination++) {
+			files[destination].m_file.close();
+			ofstream outfile(storage::primary_path(destination_path(m_name, destination) + "/warc.paths"), ios::app);
+			for (const string &file_name : files[destination].m_file_names) {
+				outfile << file_name << "\n";
+			}
+		}
+	}
+
+	void split_pipeline::truncate(const string &name, size_t num_destinations) {
+		for (size_t destination = 0; destination < num_destinations; destination++) {
+			boost::filesystem::remove_all(storage::primary_path(destination_path(name, destination) + "/files"));
+			boost::filesystem::remove(storage::primary_path(destination_path(name, destination) + "/warc.paths"));
+		}
+	}
+
+}
@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+namespace tools {
+
+	/*
+		Splits gzipped line files into gzipped files per destination (cluster node) in three pipeline stages:
+		decompression threads read the input files into blocks of complete lines, a router thread appends every line to
+		the buffer of its destination and compression threads compress full buffers into gzip members that are appended
+		to the destination files. Every destination keeps its current file open for the whole run.
+
+		All buffers come from a fixed pool and the queues between the stages are bounded, so memory use stays around
+		max_memory_mb no matter how many destinations there are.
+
+		Output goes to crawl-data/<name>-<destination>-BIG/files/<n>.gz under storage::primary_path and the written files
+		are appended to crawl-data/<name>-<destination>-BIG/warc.paths. Every run continues the file numbering of the
+		previous runs so a split done in several runs (like run_splitter_with_links) keeps all output. Call truncate once
+		before the first run of a split.
+	*/
+	class split_pipeline {
+
+		public:
+
+			// Returns false if the line should be skipped, otherwise sets destination.
+			typedef std::function<bool(std::string_view line, size_t &destination)> route_function;
+
+			split_pipeline(const std::string &name, size_t num_destinations, const route_function &route,
+				size_t num_threads, size_t max_memory_mb = 1024);
+
+			void run(const std::vector<std::string> &input_files);
+
+			// Removes the output files and warc.paths of all destinations.
+			static void truncate(const std::string &name, size_t num_destinations);
+
+		private:
+
+			const std::string m_name;
+			const size_t m_num_destinations;
+			const route_function m_route;
+			const size_t m_num_threads;
+
+			size_t m_block_size;
+			size_t m_buffer_size;
+			size_t m_num_buffers;
+
+			const size_t m_max_file_size = 256ull * 1024 * 1024;
+
+	};
+
+}
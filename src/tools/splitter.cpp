@@ -1,6 +1,7 @@
 
 #include "splitter.h"
 #include "config.h"
+#include "storage/storage.h"
 #include <iostream>
 #include <vector>
 #include <unordered_set>
@@ -14,182 +15,28 @@
 #include "full_text/full_text.h"
 #include "algorithm/algorithm.h"
 #include "URL.h"
+#include "url_view.h"
+#include "text/text.h"
 #include "common/system.h"
+#include "split_pipeline.h"
 
 using namespace std;
 
 namespace tools {
 
-	// File structure is /mnt/crawl-data/NODE-[node_id]/files/thread_id-file_index.gz
-	string write_cache(size_t file_index, size_t thread_id, vector<string> &lines, size_t node_id) {
-		const string filename = "crawl-data/NODE-" + to_string(node_id) + "-BIG/files/" + to_string(thread_id) + "-" + to_string(file_index) + ".gz";
-		ofstream outfile("/mnt/" + filename, ios::trunc | ios::binary);
-
-		boost::iostreams::filtering_ostream compress_stream;
-		compress_stream.push(boost::iostreams::gzip_compressor());
-		compress_stream.push(outfile);
-
-		for (const string &line : lines) {
-			compress_stream << line << "\n";
-		}
-		lines.clear();
-		return filename;
-	}
-
-	// File structure is /mnt/crawl-data/NODE-[node_id]/files/thread_id-file_index.gz
-	string write_link_cache(size_t file_index, size_t thread_id, vector<string> &lines, size_t node_id) {
-		const string filename = "crawl-data/LINK-" + to_string(node_id) + "-BIG/files/" + to_string(thread_id) + "-" + to_string(file_index) + ".gz";
-		ofstream outfile("/mnt/" + filename, ios::trunc | ios::binary);
-
-		boost::iostreams::filtering_ostream compress_stream;
-		compress_stream.push(boost::iostreams::gzip_compressor());
-		compress_stream.push(outfile);
-
-		for (const string &line : lines) {
-			compress_stream << line << "\n";
-		}
-		lines.clear();
-		return filename;
-	}
-
-	void splitter(const vector<string> &warc_paths, mutex &write_file_mutex) {
-
-		const size_t max_cache_size = 10000;
-		size_t thread_id = common::thread_id();
-		size_t file_index = 1;
-
-		vector<vector<string>> file_names(config::nodes_in_cluster);
-		vector<vector<string>> cache(config::nodes_in_cluster);
-		for (const string &warc_path : warc_paths) {
-			ifstream infile(warc_path);
-			boost::iostreams::filtering_istream decompress_stream;
-			decompress_stream.push(boost::iostreams::gzip_decompressor());
-			decompress_stream.push(infile);
-
-			string line;
-			while (getline(decompress_stream, line)) {
-				const URL url(line.substr(0, line.find("\t")));
-				const size_t node_id = full_text::url_to_node(url);
-				cache[node_id].push_back(line);
-			}
-
-			for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-				if (cache[node_id].size() > max_cache_size) {
-					file_names[node_id].push_back(write_cache(file_index++, thread_id, cache[node_id], node_id));
-				}
-			}
-		}
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			file_names[node_id].push_back(write_cache(file_index++, thread_id, cache[node_id], node_id));
-		}
-
-		write_file_mutex.lock();
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			const string filename = "/mnt/crawl-data/NODE-" + to_string(node_id) + "-BIG/warc.paths";
-			ofstream outfile(filename, ios::app);
-			for (const string &file : file_names[node_id]) {
-				outfile << file << "\n";
-			}
-		}
-		write_file_mutex.unlock();
-	}
-
-	void link_splitter(const vector<string> &warc_paths, mutex &write_file_mutex) {
-
-		const size_t max_cache_size = 1000000;
-		size_t thread_id = common::thread_id();
-		size_t file_index = 1;
-
-		vector<vector<string>> file_names(config::nodes_in_cluster);
-		vector<vector<string>> cache(config::nodes_in_cluster);
-		size_t done = 0;
-		for (const string &warc_path : warc_paths) {
-
-			cout << "done " << done << "/" << warc_paths.size() << endl;
-			done++;
-
-			ifstream infile(warc_path);
-			boost::iostreams::filtering_istream decompress_stream;
-			decompress_stream.push(boost::iostreams::gzip_decompressor());
-			decompress_stream.push(infile);
-
-			string line;
-			while (getline(decompress_stream, line)) {
-				const url_link::link link(line);
-				const size_t node_id = full_text::link_to_node(link);
-				cache[node_id].push_back(line);
-			}
-
-			for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-				if (cache[node_id].size() > max_cache_size) {
-					file_names[node_id].push_back(write_link_cache(file_index++, thread_id, cache[node_id], node_id));
-				}
-			}
-		}
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			file_names[node_id].push_back(write_link_cache(file_index++, thread_id, cache[node_id], node_id));
-		}
-
-		write_file_mutex.lock();
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			const string filename = "/mnt/crawl-data/LINK-" + to_string(node_id) + "-BIG/warc.paths";
-			ofstream outfile(filename, ios::app);
-			for (const string &file : file_names[node_id]) {
-				outfile << file << "\n";
-			}
-		}
-		write_file_mutex.unlock();
+	// Lines in the url files are routed by the host of the url, same as full_text::url_to_node.
+	bool route_url(string_view line, size_t &node_id) {
+		node_id = url_view(line.substr(0, line.find('\t'))).host_hash() % config::nodes_in_cluster;
+		return true;
 	}
 
-	void splitter_with_urls(const unordered_set<size_t> &urls, const vector<string> &warc_paths, mutex &write_file_mutex) {
-
-		const size_t max_cache_size = 150000;
-		size_t thread_id = common::thread_id();
-		size_t file_index = 1;
-
-		vector<vector<string>> file_names(config::nodes_in_cluster);
-		vector<vector<string>> cache(config::nodes_in_cluster);
-		size_t idx = 0;
-		for (const string &warc_path : warc_paths) {
-			cout << warc_path << endl;
-			ifstream infile(warc_path);
-			boost::iostreams::filtering_istream decompress_stream;
-			decompress_stream.push(boost::iostreams::gzip_decompressor());
-			decompress_stream.push(infile);
-
-			string line;
-			while (getline(decompress_stream, line)) {
-				const URL url(line.substr(0, line.find("\t")));
-				if (urls.count(url.hash())) {
-					const size_t node_id = full_text::url_to_node(url);
-					cache[node_id].push_back(line);
-				}
-			}
-
-			for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-				if (cache[node_id].size() > max_cache_size) {
-					file_names[node_id].push_back(write_cache(file_index++, thread_id, cache[node_id], node_id));
-				}
-			}
-
-			if (idx % 100 == 0) {
-				cout << warc_path << " done " << idx << "/" << warc_paths.size() << endl;
-			} 
-			idx++;
-		}
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			file_names[node_id].push_back(write_cache(file_index++, thread_id, cache[node_id], node_id));
-		}
-
-		write_file_mutex.lock();
-		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			const string filename = "/mnt/crawl-data/NODE-" + to_string(node_id) + "-BIG/warc.paths";
-			ofstream outfile(filename, ios::app);
-			for (const string &file : file_names[node_id]) {
-				outfile << file << "\n";
-			}
-		}
-		write_file_mutex.unlock();
+	// Links are routed by the host of the target url, same as full_text::link_to_node.
+	bool route_link(string_view line, size_t &node_id) {
+		thread_local vector<string_view> columns;
+		text::split_view(line, columns);
+		if (columns.size() < 4) return false;
+		node_id = url_view(columns[2], columns[3]).host_hash() % config::nodes_in_cluster;
+		return true;
 	}
 
 	unordered_set<size_t> build_link_set(const vector<string> &warc_paths, size_t hash_min, size_t hash_max) {
@@ -202,9 +49,11 @@ namespace tools {
 			decompress_stream.push(infile);
 
 			string line;
+			vector<string_view> columns;
 			while (getline(decompress_stream, line)) {
-				const url_link::link link(line);
-				const size_t hash = link.target_url().hash();
+				text::split_view(line, columns);
+				if (columns.size() < 4) continue;
+				const size_t hash = url_view(columns[2], columns[3]).hash();
 				if (hash >= hash_min && hash <= hash_max) {
 					result.insert(hash);
 				}
@@ -217,12 +66,10 @@ namespace tools {
 	void create_warc_directories() {
 		// Create directories.
 		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			boost::filesystem::create_directories("/mnt/crawl-data/NODE-" + to_string(node_id) + "-BIG");
-			boost::filesystem::create_directories("/mnt/crawl-data/NODE-" + to_string(node_id) + "-BIG/files");
+			boost::filesystem::create_directories(storage::primary_path("crawl-data/NODE-" + to_string(node_id) + "-BIG/files"));
 		}
 		for (size_t node_id = 0; node_id < config::nodes_in_cluster; node_id++) {
-			boost::filesystem::create_directories("/mnt/crawl-data/LINK-" + to_string(node_id));
-			boost::filesystem::create_directories("/mnt/crawl-data/LINK-" + to_string(node_id) + "/files");
+			boost::filesystem::create_directories(storage::primary_path("crawl-data/LINK-" + to_string(node_id) + "/files"));
 		}
 	}
 
@@ -232,7 +79,6 @@ namespace tools {
 
 		const size_t num_threads = 12;
 
-		vector<thread> threads;
 		vector<string> files;
 		vector<string> link_files;
 
@@ -281,36 +127,18 @@ namespace tools {
 			}
 		}
 
-		vector<vector<string>> thread_input;
-		algorithm::vector_chunk(files, ceil((double)files.size() / num_threads), thread_input);
-
-		vector<vector<string>> link_thread_input;
-		algorithm::vector_chunk(link_files, ceil((double)link_files.size() / num_threads), link_thread_input);
-
-		mutex write_file_mutex;
-
 		/*
-		Run splitter threads
+		Run splitter pipeline
 		*/
-		for (size_t i = 0; i < thread_input.size(); i++) {
-			threads.emplace_back(thread(splitter, thread_input[i], ref(write_file_mutex)));
-		}
-
-		for (thread &one_thread : threads) {
-			one_thread.join();
-		}
-
-		threads.clear();
+		split_pipeline::truncate("NODE", config::nodes_in_cluster);
+		split_pipeline pipeline("NODE", config::nodes_in_cluster, route_url, num_threads);
+		pipeline.run(files);
 
 		/*
-		Run link_splitter threads
-		for (size_t i = 0; i < link_thread_input.size(); i++) {
-			threads.emplace_back(thread(link_splitter, link_thread_input[i], ref(write_file_mutex)));
-		}
-
-		for (thread &one_thread : threads) {
-			one_thread.join();
-		}
+		Run link splitter pipeline
+		split_pipeline::truncate("LINK", config::nodes_in_cluster);
+		split_pipeline link_pipeline("LINK", config::nodes_in_cluster, route_link, num_threads);
+		link_pipeline.run(link_files);
 		*/
 	}
 
@@ -320,7 +148,6 @@ namespace tools {
 
 		const size_t num_threads = 12;
 
-		vector<thread> threads;
 		vector<string> files;
 		for (const string &batch : config::batches) {
 
@@ -346,22 +173,17 @@ namespace tools {
 			}
 		}
 
-		vector<vector<string>> thread_input;
-		algorithm::vector_chunk(files, ceil((double)files.size() / num_threads), thread_input);
-
-		mutex write_file_mutex;
-
 		/*
-		Run splitter threads
+		Run splitter pipeline on the urls in the set
 		*/
-		for (size_t i = 0; i < thread_input.size(); i++) {
-			threads.emplace_back(thread(splitter_with_urls, cref(urls), cref(thread_input[i]), ref(write_file_mutex)));
-		}
-
-		for (thread &one_thread : threads) {
-			one_thread.join();
-		}
-
+		split_pipeline pipeline("NODE", config::nodes_in_cluster, [&urls](string_view line, size_t &node_id) {
+			const string_view url = line.substr(0, line.find('\t'));
+			const url_view view(url);
+			if (urls.count(view.hash()) == 0) return false;
+			node_id = view.host_hash() % config::nodes_in_cluster;
+			return true;
+		}, num_threads);
+		pipeline.run(files);
 	}
 
 	void run_splitter_with_links_interval(size_t hash_min, size_t hash_max) {
@@ -417,6 +239,8 @@ namespace tools {
 	}
 
 	void run_splitter_with_links() {
+		// Every interval appends its part of the split to the same NODE output.
+		split_pipeline::truncate("NODE", config::nodes_in_cluster);
 		const size_t chunk = (SIZE_MAX >> 3) + 1;
 		for (size_t i = 0; i < (1ull << 3); i++) {
 			run_splitter_with_links_interval(chunk * i, chunk * (i + 1) - 1);
@@ -31,9 +31,11 @@
 #include "logger/logger.h"
 #include "profiler/profiler.h"
 #include "file/file.h"
+#include "file/gz_decoder.h"
 #include "text/text.h"
 #include "parser/parser.h"
 #include "algorithm/hash.h"
+#include "storage/storage.h"
 
 using namespace std;
 
@@ -141,14 +143,9 @@ namespace transfer {
 
 			res = curl_easy_perform(curl);
 
-			string response_str;
-			try {
-				boost::iostreams::filtering_istream decompress_stream;
-				decompress_stream.push(boost::iostreams::gzip_decompressor());
-				decompress_stream.push(response);
-
-				response_str = string(istreambuf_iterator<char>(decompress_stream), {});
-			} catch (...) {
+			bool decompress_error;
+			string response_str = file::gz_decompress(response.str(), decompress_error);
+			if (decompress_error) {
 				curl_easy_cleanup(curl);
 				error = ERROR;
 				return "";
@@ -223,13 +220,9 @@ namespace transfer {
 				}
 			}
 
-			try {
-				boost::iostreams::filtering_istream decompress_stream;
-				decompress_stream.push(boost::iostreams::gzip_decompressor());
-				decompress_stream.push(response);
-
-				output_stream << decompress_stream.rdbuf();
-			} catch(...) {
+			bool decompress_error;
+			file::gz_decompress_to_stream(response.str(), output_stream, decompress_error);
+			if (decompress_error) {
 				error = ERROR;
 			}
 
@@ -270,7 +263,7 @@ namespace transfer {
 
 	string run_gz_download_thread(const string &file_path) {
 		size_t hsh = algorithm::hash(file_path);
-		const string target_filename = "/mnt/" + to_string(hsh % 8) + "/tmp/tmp_" + to_string(hsh);
+		const string target_filename = storage::shard_path("tmp", hsh, "tmp/tmp_" + to_string(hsh));
 		ofstream target_file(target_filename, ios::binary | ios::trunc);
 		int error;
 		gz_file_to_stream(file_path, target_file, error);
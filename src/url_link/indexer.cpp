@@ -53,34 +53,17 @@ namespace url_link {
 		}
 	}
 
-	void indexer::add_stream(vector<hash_table::hash_table_shard_builder *> &shard_builders, basic_istream<char> &stream) {
+	void indexer::add_link(uint64_t link_hash, const url_view &source_url, const url_view &target_url,
+		const vector<uint64_t> &word_hashes, float score) {
 
-		string line;
-		while (getline(stream, line)) {
-			vector<string> col_values;
-			boost::algorithm::split(col_values, line, boost::is_any_of("\t"));
-
-			URL target_url(col_values[2], col_values[3]);
-
-			if (m_url_to_domain->has_url(target_url.hash())) {
-
-				float target_harmonic = target_url.harmonic(m_sub_system);
-
-				URL source_url(col_values[0], col_values[1]);
-				float source_harmonic = source_url.harmonic(m_sub_system);
-
-
-				const string link_text = col_values[4].substr(0, 1000);
-
-				const ::url_link::link link(source_url, target_url, source_harmonic, target_harmonic);
-
-				uint64_t link_hash = source_url.link_hash(target_url, link_text);
-
-				add_expanded_data_to_shards(link_hash, source_url, target_url, link_text, source_harmonic);			
-			}
+		const ::url_link::full_text_record record{.m_value = link_hash, .m_score = score,
+			.m_source_domain = source_url.host_hash(), .m_target_hash = target_url.hash()};
+		for (uint64_t word_hash : word_hashes) {
+			m_shards[word_hash % config::ft_num_shards]->add(word_hash, record);
 		}
+	}
 
-		// sort shards.
+	void indexer::sort_cache() {
 		for (auto shard : m_shards) {
 			shard->sort_cache();
 		}
@@ -112,19 +95,5 @@ namespace url_link {
 		}
 	}
 
-	void indexer::add_expanded_data_to_shards(uint64_t link_hash, const URL &source_url, const URL &target_url,
-		const string &link_text, float score) {
-
-		vector<string> words = text::get_expanded_full_text_words(link_text);
-		for (const string &word : words) {
-
-			const uint64_t word_hash = m_hasher(word);
-			const size_t shard_id = word_hash % config::ft_num_shards;
-
-			m_shards[shard_id]->add(word_hash, ::url_link::full_text_record{.m_value = link_hash, .m_score = score,
-				.m_source_domain = source_url.host_hash(), .m_target_hash = target_url.hash()});
-		}
-	}
-
 }
 
@@ -32,6 +32,7 @@
 #include <mutex>
 
 #include "URL.h"
+#include "url_view.h"
 #include "common/sub_system.h"
 #include "hash_table/hash_table_shard_builder.h"
 #include "full_text/url_to_domain.h"
@@ -47,7 +48,13 @@ namespace url_link {
 		indexer(int id, const std::string &db_name, const common::sub_system *sub_system, full_text::url_to_domain *url_to_domain);
 		~indexer();
 
-		void add_stream(std::vector<hash_table::hash_table_shard_builder *> &shard_builders, std::basic_istream<char> &stream);
+		/*
+			Adds a parsed link under the hashes of its expanded link text words. The link files are parsed once by
+			url_link::indexer_runner which feeds the same words to both the url and the domain link indexer.
+		*/
+		void add_link(uint64_t link_hash, const url_view &source_url, const url_view &target_url,
+			const std::vector<uint64_t> &word_hashes, float score);
+		void sort_cache();
 		void write_cache(std::vector<std::mutex> &write_mutexes);
 		void flush_cache(std::vector<std::mutex> &write_mutexes);
 
@@ -57,13 +64,9 @@ namespace url_link {
 		const std::string m_db_name;
 		const common::sub_system *m_sub_system;
 		full_text::url_to_domain *m_url_to_domain;
-		std::hash<std::string> m_hasher;
 
 		std::vector<full_text::full_text_shard_builder<::url_link::full_text_record> *> m_shards;
 
-		void add_expanded_data_to_shards(uint64_t link_hash, const URL &source_url, const URL &target_url, const std::string &link_text,
-			float score);
-
 	};
 
 }
@@ -32,6 +32,8 @@
 #include <math.h>
 #include "logger/logger.h"
 #include "full_text/full_text.h"
+#include "text/text.h"
+#include "url_view.h"
 #include "algorithm/algorithm.h"
 
 using namespace std;
@@ -134,6 +136,51 @@ namespace url_link {
 		}
 	}
 
+	void indexer_runner::add_link_stream(::url_link::indexer &indexer, domain_link::indexer &domain_link_indexer,
+		vector<hash_table::hash_table_shard_builder *> &domain_shard_builders, basic_istream<char> &stream) {
+
+		string line;
+		vector<string_view> columns;
+		string word_buffer;
+		vector<string_view> words;
+		vector<uint64_t> word_hashes;
+		while (getline(stream, line)) {
+			text::split_view(line, columns);
+
+			const url_view target_url(columns[2], columns[3]);
+			const bool has_url = m_url_to_domain->has_url(target_url.hash());
+			const bool has_domain = m_url_to_domain->has_domain(target_url.host_hash());
+			if (!has_url && !has_domain) continue;
+
+			const url_view source_url(columns[0], columns[1]);
+			const float source_harmonic = source_url.harmonic(m_sub_system);
+
+			const string_view link_text = columns[4].substr(0, 1000);
+
+			text::get_expanded_full_text_words(link_text, word_buffer, words);
+			word_hashes.clear();
+			for (string_view word : words) {
+				word_hashes.push_back(std::hash<string_view>{}(word));
+			}
+
+			if (has_url) {
+				const uint64_t link_hash = source_url.link_hash(target_url, link_text);
+				indexer.add_link(link_hash, source_url, target_url, word_hashes, source_harmonic);
+			}
+
+			if (has_domain) {
+				const uint64_t domain_link_hash = source_url.domain_link_hash(target_url, link_text);
+#ifdef COMPILE_WITH_LINK_INDEX
+				domain_shard_builders[domain_link_hash % config::ht_num_shards]->add(domain_link_hash, line);
+#endif
+				domain_link_indexer.add_link(domain_link_hash, source_url, target_url, word_hashes, source_harmonic);
+			}
+		}
+
+		indexer.sort_cache();
+		domain_link_indexer.sort_cache();
+	}
+
 	string indexer_runner::run_index_thread_with_local_files(const vector<string> &local_files, int id) {
 
 		vector<hash_table::hash_table_shard_builder *> shard_builders;
@@ -154,16 +201,9 @@ namespace url_link {
 			ifstream stream(local_file, ios::in);
 
 			if (stream.is_open()) {
-				{
-					indexer.add_stream(shard_builders, stream);
-					indexer.write_cache(m_link_mutexes);
-				}
-				stream.clear();
-				stream.seekg(0);
-				{
-					domain_link_indexer.add_stream(domain_shard_builders, stream);
-					domain_link_indexer.write_cache(m_domain_link_mutexes);
-				}
+				add_link_stream(indexer, domain_link_indexer, domain_shard_builders, stream);
+				indexer.write_cache(m_link_mutexes);
+				domain_link_indexer.write_cache(m_domain_link_mutexes);
 			}
 
 			stream.close();
@@ -37,6 +37,8 @@
 #include "url_link/full_text_record.h"
 #include "domain_link/full_text_record.h"
 #include "full_text/full_text_record.h"
+#include "url_link/indexer.h"
+#include "domain_link/indexer.h"
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/copy.hpp>
@@ -71,6 +73,12 @@ namespace url_link {
 
 		full_text::url_to_domain *m_url_to_domain;
 
+		/*
+			Parses every line of the link file once and adds it to the url link indexer if the target url is
+			indexed and to the domain link indexer if the target domain is indexed.
+		*/
+		void add_link_stream(::url_link::indexer &indexer, domain_link::indexer &domain_link_indexer,
+			std::vector<hash_table::hash_table_shard_builder *> &domain_shard_builders, std::basic_istream<char> &stream);
 		std::string run_index_thread_with_local_files(const std::vector<std::string> &local_files, int id);
 		std::string run_link_index_thread(const std::vector<std::string> &warc_paths, int id);
 		std::string run_merge_thread(size_t shard_id);
@@ -36,6 +36,7 @@
 #include "url_store/url_store.h"
 #include "algorithm/algorithm.h"
 #include "config.h"
+#include "storage/storage.h"
 #include <vector>
 #include <mutex>
 #include "leveldb/db.h"
@@ -123,7 +124,7 @@ namespace url_link {
 		vector<vector<string>> chunks;
 		algorithm::vector_chunk<string>(local_files, ceil(local_files.size() / config::ft_num_threads_indexing) + 1, chunks);
 
-		key_value_store kv_store("/mnt/0/tmp_kwstore");
+		key_value_store kv_store(storage::primary_path("tmp_kwstore"));
 
 		for (const vector<string> &chunk : chunks) {
 
@@ -33,6 +33,7 @@
 #include <thread>
 #include <boost/filesystem.hpp>
 #include "config.h"
+#include "storage/storage.h"
 #include "algorithm/hash.h"
 #include "transfer/transfer.h"
 #include "profiler/profiler.h"
@@ -119,8 +120,9 @@ namespace url_store {
 	url_store<store_data>::url_store()  {
 		const string &db_prefix = store_data::uri;
 		for (size_t i = 0; i < config::url_store_shards; i++) {
-			boost::filesystem::create_directories("/mnt/" + std::to_string(i % 8) + "/store/"+db_prefix+"/url_store_" + std::to_string(i));
-			m_shards.push_back(new key_value_store("/mnt/" + std::to_string(i % 8) + "/store/"+db_prefix+"/url_store_" + std::to_string(i)));
+			const std::string path = storage::shard_path("url_store_" + db_prefix, i, "store/" + db_prefix + "/url_store_" + std::to_string(i));
+			boost::filesystem::create_directories(path);
+			m_shards.push_back(new key_value_store(path));
 		}
 	}
 
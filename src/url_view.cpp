@@ -0,0 +1,237 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "url_view.h"
+#include "URL.h"
+#include "algorithm/hash.h"
+
+using namespace std;
+
+namespace {
+
+	const string_view parts_scheme = "http://";
+
+	bool is_simple_host_char(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_';
+	}
+
+	/*
+		Hash of the labels of host in reverse order, same as hash(URL::host_reverse(host)) but without building the
+		string.
+	*/
+	uint64_t reverse_labels_hash(string_view host) {
+		algorithm::incremental_hash hasher(host.size());
+		size_t end = host.size();
+		while (true) {
+			const size_t dot = end == 0 ? string_view::npos : host.rfind('.', end - 1);
+			const size_t start = dot == string_view::npos ? 0 : dot + 1;
+			hasher.update(host.substr(start, end - start));
+			if (dot == string_view::npos) break;
+			hasher.update(".");
+			end = dot;
+		}
+		return hasher.digest();
+	}
+
+}
+
+url_view::url_view() {
+}
+
+url_view::url_view(string_view url) {
+	if (!parse_simple(url)) {
+		parse_fallback(url);
+	}
+}
+
+url_view::url_view(string_view host, string_view path) :
+	m_from_parts(true), m_host(host), m_path(path)
+{
+}
+
+string_view url_view::host_top_domain() const {
+	/*
+	 * Same as URL::host_top_domain, the last two labels of the host.
+	 * */
+	const size_t last_dot = m_host.rfind('.');
+	if (last_dot == string_view::npos || last_dot == 0) return m_host;
+	const size_t second_last_dot = m_host.rfind('.', last_dot - 1);
+	if (second_last_dot == string_view::npos) return m_host;
+	return m_host.substr(second_last_dot + 1);
+}
+
+string_view url_view::domain_without_tld() const {
+	const size_t last_dot = m_host.rfind('.');
+	if (last_dot == string_view::npos) return string_view();
+	const size_t second_last_dot = last_dot == 0 ? string_view::npos : m_host.rfind('.', last_dot - 1);
+	const size_t start = second_last_dot == string_view::npos ? 0 : second_last_dot + 1;
+	return m_host.substr(start, last_dot - start);
+}
+
+uint64_t url_view::hash() const {
+	algorithm::incremental_hash hasher(m_host.size() + m_path.size() + m_query.size());
+	hasher.update(m_host);
+	hasher.update(m_path);
+	hasher.update(m_query);
+	return hasher.digest();
+}
+
+uint64_t url_view::host_hash() const {
+	return algorithm::murmur_hash(m_host.data(), m_host.size());
+}
+
+uint64_t url_view::link_hash(const url_view &target_url, string_view link_text) const {
+	const string_view top_domain = host_top_domain();
+	algorithm::incremental_hash hasher(top_domain.size() + target_url.str_size() + link_text.size());
+	hasher.update(top_domain);
+	if (target_url.m_from_parts) {
+		hasher.update(parts_scheme);
+		hasher.update(target_url.m_host);
+		hasher.update(target_url.m_path);
+	} else {
+		hasher.update(target_url.m_url);
+	}
+	hasher.update(link_text);
+	return hasher.digest();
+}
+
+uint64_t url_view::domain_link_hash(const url_view &target_url, string_view link_text) const {
+	const string_view top_domain = host_top_domain();
+	algorithm::incremental_hash hasher(top_domain.size() + target_url.m_host.size() + link_text.size());
+	hasher.update(top_domain);
+	hasher.update(target_url.m_host);
+	hasher.update(link_text);
+	return hasher.digest();
+}
+
+uint64_t url_view::host_reverse_hash() const {
+	return reverse_labels_hash(m_host);
+}
+
+uint64_t url_view::host_reverse_top_domain_hash() const {
+	return reverse_labels_hash(host_top_domain());
+}
+
+float url_view::harmonic(const common::sub_system *sub_system) const {
+
+	const common::dictionary *domain_index = sub_system->domain_index();
+
+	const auto iter = domain_index->find_hash(host_reverse_hash());
+	if (iter != domain_index->end()) {
+		return iter->second.get_float(1);
+	}
+
+	const auto iter2 = domain_index->find_hash(host_reverse_top_domain_hash());
+	if (iter2 != domain_index->end()) {
+		return iter2->second.get_float(1) / 2.0; // Half the power for sub domains.
+	}
+
+	return 0.0f;
+}
+
+size_t url_view::str_size() const {
+	if (m_from_parts) {
+		return parts_scheme.size() + m_host.size() + m_path.size();
+	}
+	return m_url.size();
+}
+
+bool url_view::parse_simple(string_view url) {
+
+	/*
+	 * Only accept urls where we know that curl gives the same parts, everything else goes to parse_fallback.
+	 * */
+	for (char c : url) {
+		if ((unsigned char)c <= 0x20 || (unsigned char)c >= 0x7f || c == '\\') return false;
+	}
+
+	const size_t scheme_end = url.find("://");
+	if (scheme_end == string_view::npos) return false;
+	const string_view scheme = url.substr(0, scheme_end);
+	if (scheme != "http" && scheme != "https") return false;
+
+	string_view rest = url.substr(scheme_end + 3);
+	const size_t host_end = min(rest.find_first_of("/?#"), rest.size());
+	string_view host = rest.substr(0, host_end);
+	rest.remove_prefix(host_end);
+
+	// No user info, port, upper case or international hosts.
+	if (host.find("..") != string_view::npos) return false;
+	for (char c : host) {
+		if (!is_simple_host_char(c)) return false;
+	}
+
+	const size_t fragment = rest.find('#');
+	if (fragment != string_view::npos) {
+		rest = rest.substr(0, fragment);
+	}
+	const size_t query = rest.find('?');
+	string_view path = rest.substr(0, query);
+
+	// curl removes dot segments.
+	if (path.find("/.") != string_view::npos) return false;
+
+	const bool has_www = host.starts_with("www.");
+	if (has_www) {
+		host.remove_prefix(4);
+	}
+
+	// URL trims punctuation from the host and curl normalizes numeric hosts as ipv4 addresses.
+	if (host.empty() || !isalnum((unsigned char)host.front()) || !isalnum((unsigned char)host.back())) return false;
+	const size_t tld_start = host.rfind('.') + 1;
+	if (!isalpha((unsigned char)host[tld_start])) return false;
+
+	m_url = url;
+	m_scheme = scheme;
+	m_has_www = has_www;
+	m_host = host;
+	m_path = path.empty() ? string_view("/") : path;
+	m_query = query == string_view::npos ? string_view() : rest.substr(query + 1);
+
+	return true;
+}
+
+void url_view::parse_fallback(string_view url) {
+	m_fallback = make_unique<owned_parts>();
+	m_fallback->m_url = url;
+
+	const URL parsed(m_fallback->m_url);
+	m_fallback->m_host = parsed.host();
+	m_fallback->m_scheme = parsed.scheme();
+	m_fallback->m_path = parsed.path();
+	m_fallback->m_query = parsed.path_with_query().substr(parsed.path().size());
+	if (m_fallback->m_query.size()) {
+		// path_with_query is path + "?" + query.
+		m_fallback->m_query.erase(0, 1);
+	}
+
+	m_url = m_fallback->m_url;
+	m_host = m_fallback->m_host;
+	m_scheme = m_fallback->m_scheme;
+	m_path = m_fallback->m_path;
+	m_query = m_fallback->m_query;
+	m_has_www = m_host.size() ? parsed.has_www() : false;
+}
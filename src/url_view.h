@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include "common/sub_system.h"
+
+/*
+	Non owning url for the ingestion hot paths. Parsing and hashing does not allocate and every hash is identical to
+	the one of the corresponding URL, so url_view and URL can be mixed freely.
+
+	The fast parser only handles plain http(s) urls with a lower case host and a path without dot segments, which is
+	what almost all urls in the crawl data look like. Anything else is parsed by URL (curl) and the parts are owned by
+	the view, see is_simple().
+
+	The viewed string must outlive the url_view.
+*/
+class url_view {
+
+public:
+
+	url_view();
+
+	// Same parts as URL(url).
+	explicit url_view(std::string_view url);
+
+	// Same as URL(host, path), the host is used as is and nothing is parsed.
+	url_view(std::string_view host, std::string_view path);
+
+	url_view(url_view &&other) = default;
+	url_view &operator=(url_view &&other) = default;
+
+	bool is_simple() const { return m_fallback == nullptr; }
+
+	std::string_view host() const { return m_host; }
+	std::string_view scheme() const { return m_scheme; }
+	std::string_view path() const { return m_path; }
+	std::string_view query() const { return m_query; }
+	bool has_www() const { return m_has_www; }
+
+	std::string_view host_top_domain() const;
+	std::string_view domain_without_tld() const;
+
+	uint64_t hash() const;
+	uint64_t host_hash() const;
+	uint64_t link_hash(const url_view &target_url, std::string_view link_text) const;
+	uint64_t domain_link_hash(const url_view &target_url, std::string_view link_text) const;
+
+	// Hashes of URL::host_reverse(host()) and URL::host_reverse_top_domain(host()).
+	uint64_t host_reverse_hash() const;
+	uint64_t host_reverse_top_domain_hash() const;
+
+	float harmonic(const common::sub_system *sub_system) const;
+
+private:
+
+	struct owned_parts {
+		std::string m_url;
+		std::string m_host;
+		std::string m_scheme;
+		std::string m_path;
+		std::string m_query;
+	};
+
+	// For the (host, path) form URL::str() is "http://" + host + path and m_url is empty.
+	bool m_from_parts = false;
+	std::string_view m_url;
+	std::string_view m_host;
+	std::string_view m_scheme;
+	std::string_view m_path;
+	std::string_view m_query;
+	bool m_has_www = false;
+	std::unique_ptr<owned_parts> m_fallback;
+
+	bool parse_simple(std::string_view url);
+	void parse_fallback(std::string_view url);
+	size_t str_size() const;
+
+};
@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scheduler.hpp"
+#include "profiler/trace.h"
+#include <chrono>
+
+using namespace std;
+
+namespace utils {
+
+	// The scheduler and worker id of the current thread, worker id is SIZE_MAX on threads that are not workers.
+	thread_local scheduler *current_scheduler = nullptr;
+	thread_local size_t current_worker_id = SIZE_MAX;
+
+	scheduler::scheduler(size_t num_threads) {
+		num_threads = max(num_threads, (size_t)1);
+		for (size_t i = 0; i < num_threads; i++) {
+			m_queues.push_back(make_unique<worker_queue>());
+		}
+		for (size_t i = 0; i < num_threads; i++) {
+			m_workers.emplace_back([this, i]() {
+				handle_work(i);
+			});
+		}
+	}
+
+	scheduler::~scheduler() {
+		{
+			lock_guard lock(m_sleep_lock);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (thread &worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	scheduler &scheduler::instance() {
+		static scheduler global_scheduler(default_num_threads());
+		return global_scheduler;
+	}
+
+	size_t scheduler::default_num_threads() {
+		return max(thread::hardware_concurrency(), 1u);
+	}
+
+	void scheduler::submit(function<void()> &&task, priority prio) {
+		size_t queue_id;
+		if (current_scheduler == this) {
+			queue_id = current_worker_id;
+		} else {
+			queue_id = m_next_queue.fetch_add(1, memory_order_relaxed) % m_queues.size();
+		}
+
+		// Counted before the push so m_pending never goes below the number of queued tasks, and before taking the
+		// sleep lock so a worker that checks m_pending under the lock can not miss the task.
+		m_pending.fetch_add(1);
+		{
+			lock_guard lock(m_queues[queue_id]->m_lock);
+			m_queues[queue_id]->m_tasks[(size_t)prio].push_back(std::move(task));
+		}
+		{
+			lock_guard lock(m_sleep_lock);
+		}
+		m_wake.notify_one();
+	}
+
+	bool scheduler::run_one(priority prio) {
+		function<void()> task;
+		const size_t worker_id = current_scheduler == this ? current_worker_id : SIZE_MAX;
+		if (!take_task(worker_id, prio, task)) return false;
+		task();
+		return true;
+	}
+
+	void scheduler::handle_work(size_t worker_id) {
+		current_scheduler = this;
+		current_worker_id = worker_id;
+
+		while (true) {
+			function<void()> task;
+			if (take_task(worker_id, priority::background, task)) {
+				task();
+				continue;
+			}
+
+			unique_lock lock(m_sleep_lock);
+			m_wake.wait(lock, [this]() {
+				return m_stop || m_pending.load() > 0;
+			});
+			if (m_stop && m_pending.load() == 0) return;
+		}
+	}
+
+	bool scheduler::take_task(size_t worker_id, priority prio, function<void()> &task) {
+		if (m_pending.load() == 0) return false;
+
+		const size_t num_queues = m_queues.size();
+		const size_t first = worker_id == SIZE_MAX ? 0 : worker_id;
+		for (size_t p = 0; p <= (size_t)prio; p++) {
+			if (worker_id != SIZE_MAX && take_from(worker_id, p, true, task)) return true;
+			for (size_t i = 0; i < num_queues; i++) {
+				const size_t queue_id = (first + i) % num_queues;
+				if (queue_id == worker_id) continue;
+				if (take_from(queue_id, p, false, task)) return true;
+			}
+		}
+		return false;
+	}
+
+	bool scheduler::take_from(size_t queue_id, size_t prio, bool back, function<void()> &task) {
+		worker_queue &queue = *m_queues[queue_id];
+		lock_guard lock(queue.m_lock);
+		deque<function<void()>> &tasks = queue.m_tasks[prio];
+		if (tasks.empty()) return false;
+		if (back) {
+			task = std::move(tasks.back());
+			tasks.pop_back();
+		} else {
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		m_pending.fetch_sub(1);
+		return true;
+	}
+
+	task_group::task_group(priority prio, scheduler &sched)
+	: m_scheduler(sched), m_priority(prio), m_state(make_shared<group_state>())
+	{
+	}
+
+	task_group::~task_group() {
+		try {
+			wait();
+		} catch (...) {
+			// wait() has to be called explicitly to get the exception.
+		}
+	}
+
+	void task_group::run(function<void()> &&task) {
+		group_state &state = *m_state;
+		{
+			lock_guard lock(state.m_lock);
+			state.m_pending++;
+			state.m_tasks.push_back([&state, task = std::move(task), trace = profiler::capture_trace()]() {
+				exception_ptr exception;
+				if (!state.m_cancelled) {
+					profiler::trace_scope scope(trace);
+					try {
+						task();
+					} catch (...) {
+						exception = current_exception();
+					}
+				}
+
+				// Under the lock so wait() can not miss the last task finishing.
+				lock_guard lock(state.m_lock);
+				if (exception && !state.m_exception) {
+					state.m_exception = exception;
+					state.m_cancelled = true;
+				}
+				state.m_pending--;
+				if (state.m_pending == 0) {
+					state.m_done.notify_all();
+				}
+			});
+		}
+		// A task that runs on another thread can add tasks to the group, wake up wait() so it can help.
+		state.m_done.notify_all();
+
+		m_scheduler.submit([state = m_state]() {
+			run_queued(*state);
+		}, m_priority);
+	}
+
+	void task_group::wait() {
+		group_state &state = *m_state;
+		while (true) {
+			{
+				lock_guard lock(state.m_lock);
+				if (state.m_pending == 0) break;
+			}
+			if (run_queued(state)) continue;
+
+			// Our remaining tasks are running on other threads, they can still add tasks we can help with.
+			unique_lock lock(state.m_lock);
+			state.m_done.wait(lock, [&state]() {
+				return state.m_pending == 0 || !state.m_tasks.empty();
+			});
+		}
+
+		lock_guard lock(state.m_lock);
+		if (state.m_exception) {
+			exception_ptr exception = state.m_exception;
+			state.m_exception = nullptr;
+			rethrow_exception(exception);
+		}
+	}
+
+	bool task_group::run_queued(group_state &state) {
+		function<void()> task;
+		{
+			lock_guard lock(state.m_lock);
+			if (state.m_tasks.empty()) return false;
+			task = std::move(state.m_tasks.front());
+			state.m_tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+}
@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+	/*
+		Tasks with query priority are always taken before background tasks, so a search running at the same time
+		as a merge does not queue behind it.
+	*/
+	enum class priority {
+		query = 0,
+		background = 1
+	};
+
+	/*
+		Work stealing scheduler. Every worker has its own deque per priority, tasks submitted from a worker go to
+		the back of its own deque and are taken from the back (most recently submitted first). Idle workers steal
+		from the front of the other deques. Tasks submitted from other threads are spread round robin over the
+		workers.
+
+		Use scheduler::instance() which has one worker per core instead of creating thread pools with hard coded
+		sizes. Tasks should be cpu bound, blocking io (downloads, uploads) belongs in its own thread pool.
+	*/
+	class scheduler {
+
+		public:
+
+			explicit scheduler(size_t num_threads);
+			~scheduler();
+
+			static scheduler &instance();
+			static size_t default_num_threads();
+
+			size_t num_threads() const { return m_workers.size(); }
+
+			void submit(std::function<void()> &&task, priority prio = priority::background);
+
+			/*
+				Runs one pending task with priority prio or higher on the calling thread. Returns false if there
+				was no such task.
+			*/
+			bool run_one(priority prio = priority::background);
+
+		private:
+
+			static const size_t num_priorities = 2;
+
+			struct alignas(64) worker_queue {
+				std::mutex m_lock;
+				std::deque<std::function<void()>> m_tasks[num_priorities];
+			};
+
+			std::vector<std::unique_ptr<worker_queue>> m_queues;
+			std::vector<std::thread> m_workers;
+
+			std::atomic<size_t> m_pending = 0;
+			std::atomic<size_t> m_next_queue = 0;
+			std::mutex m_sleep_lock;
+			std::condition_variable m_wake;
+			bool m_stop = false;
+
+			void handle_work(size_t worker_id);
+			bool take_task(size_t worker_id, priority prio, std::function<void()> &task);
+			bool take_from(size_t queue_id, size_t prio, bool back, std::function<void()> &task);
+
+	};
+
+	/*
+		A set of tasks that can be waited for together. wait() runs the pending tasks of this group on the calling
+		thread while waiting, so task groups can be nested inside tasks. It never runs tasks of other groups, a thread
+		that waits while holding a lock or while other work is blocked on it can not pick up an unrelated task that
+		needs the same lock. The first exception thrown by a task cancels the group and is rethrown by wait(). After
+		cancel() tasks that have not started yet are skipped. Tasks continue the profiler trace of the thread that
+		called run(), see profiler::trace_scope.
+	*/
+	class task_group {
+
+		public:
+
+			explicit task_group(priority prio = priority::background, scheduler &sched = scheduler::instance());
+			~task_group();
+
+			task_group(const task_group &) = delete;
+			task_group &operator=(const task_group &) = delete;
+
+			void run(std::function<void()> &&task);
+			void wait();
+			void cancel() { m_state->m_cancelled = true; }
+			bool cancelled() const { return m_state->m_cancelled; }
+
+		private:
+
+			/*
+				Shared with the scheduler tasks, a scheduler task can start after wait() ran its group task and the
+				group is gone. It then finds the queue empty and does nothing.
+			*/
+			struct group_state {
+				std::atomic<bool> m_cancelled = false;
+				size_t m_pending = 0;
+				std::deque<std::function<void()>> m_tasks;
+				std::exception_ptr m_exception;
+				std::mutex m_lock;
+				std::condition_variable m_done;
+			};
+
+			scheduler &m_scheduler;
+			const priority m_priority;
+			std::shared_ptr<group_state> m_state;
+
+			static bool run_queued(group_state &state);
+
+	};
+
+}
@@ -1,6 +1,7 @@
 
 #include "warc.h"
 #include "tlds.h"
+#include "config.h"
 #include "text/text.h"
 #include "logger/logger.h"
 #include "transfer/transfer.h"
@@ -9,14 +10,13 @@ using namespace std;
 
 namespace warc {
 
-	parser::parser() {
+	parser::parser()
+	: m_decoder(config::gz_num_threads_decoding) {
 		m_z_buffer_in = new char[WARC_PARSER_ZLIB_IN];
-		m_z_buffer_out = new char[WARC_PARSER_ZLIB_OUT];
 	}
 
 	parser::~parser() {
 		delete [] m_z_buffer_in;
-		delete [] m_z_buffer_out;
 	}
 
 	bool parser::parse_stream(istream &stream) {
@@ -29,151 +29,39 @@ namespace warc {
 			total_bytes_read += bytes_read;
 
 			if (bytes_read > 0) {
-				if (unzip_chunk(bytes_read) < 0) {
+				/*
+					Every warc record is its own gzip member so the decoder can inflate them in parallel. A member that
+					continues in the next read is kept in m_pending until we have all of it.
+				*/
+				m_pending.append(m_z_buffer_in, bytes_read);
+				const size_t consumed = m_decoder.decode(m_pending.data(), m_pending.size(),
+					[this](const char *member, size_t len) {
+						handle_record_chunk(member, len);
+					});
+
+				if (m_decoder.error()) {
 					cout << "Stopped because fatal error" << endl;
+					m_pending.clear();
 					break;
 				}
-			}
-		}
-
-		return true;
-	}
-
-	int parser::unzip_record(char *data, int size) {
-
-		/*
-			data is:
-			#|------------------|-----|------------------------|--|----#-------|
-			 |doc_a______________doc_b_doc_c_____|
-								 WARC_PARSER_ZLIB_IN
-			 |_________________________________________________________|
-																   size
-		*/
-
-		int data_size = size;
-		int consumed = 0, consumed_total = 0;
-		int avail_in_before_inflate;
-		int ret = Z_OK;
-		unsigned have;
-
-		if (!m_continue_inflate) {
-			m_zstream.zalloc = Z_NULL;
-			m_zstream.zfree = Z_NULL;
-			m_zstream.opaque = Z_NULL;
-
-			m_zstream.avail_in = 0;
-			m_zstream.next_in = Z_NULL;
-
-			int err = inflateInit2(&m_zstream, 16);
-			if (err != Z_OK) {
-				cout << "zlib error" << endl;
-			}
-		} else {
-			// just continue on the last one.
-		}
-
-		/* decompress until deflate stream ends or end of file */
-		do {
-
-			m_zstream.next_in = (unsigned char *)(data + consumed_total);
-
-			m_zstream.avail_in = min(WARC_PARSER_ZLIB_IN, data_size);
-
-			if (m_zstream.avail_in == 0)
-				break;
-
-			/* run inflate() on input until output buffer not full */
-			do {
-
-				m_zstream.avail_out = WARC_PARSER_ZLIB_OUT;
-				m_zstream.next_out = (unsigned char *)m_z_buffer_out;
-
-				avail_in_before_inflate = m_zstream.avail_in;
-
-				ret = inflate(&m_zstream, Z_NO_FLUSH);
-
-				// consumed is the number of bytes read from input in this inflate
-				consumed = (avail_in_before_inflate - m_zstream.avail_in);
-				data_size -= consumed;
-				consumed_total += consumed;
-				assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-				switch (ret) {
-				case Z_BUF_ERROR:
-					//cout << "Z_BUF_ERROR" << endl;
-					// Not fatal, just keep going.
-					break;
-				case Z_NEED_DICT:
-					ret = Z_DATA_ERROR;	 /* and fall through */
-				case Z_DATA_ERROR:
-				case Z_MEM_ERROR:
-					cout << "Z_MEM_ERROR" << endl;
-					(void)inflateEnd(&m_zstream);
-					return -1;
-				}
-
-				have = WARC_PARSER_ZLIB_OUT - m_zstream.avail_out;
-				handle_record_chunk((char *)m_z_buffer_out, have);
 
-			} while (m_zstream.avail_out == 0);
-
-			if (data_size <= 0) {
-				break;
+				m_pending.erase(0, consumed);
 			}
-
-			/* done when inflate() says it's done */
-		} while (ret != Z_STREAM_END);
-
-		//cout << "ret: " << ret << endl;
-		//cout << "Ending with code: " << ret << endl;
-		if (ret == Z_OK || ret == Z_BUF_ERROR) {
-			m_continue_inflate = true;
-		} else {
-			m_continue_inflate = false;
-			(void)inflateEnd(&m_zstream);
 		}
 
-		/* clean up and return */
-		return consumed_total;
-	}
-
-	int parser::unzip_chunk(int bytes_in) {
-
-		int consumed = 0;
-		int consumed_total = 0;
-
-		char *ptr = m_z_buffer_in;
-		int len = bytes_in;
-
-		while (len > 0) {
-			consumed = unzip_record(ptr, len);
-			//cout << "consumed: " << consumed << " len: " << len << endl;
-			if (consumed == 0) {
-				cout << "Nothing consumed, done..." << endl;
-				break;
-			}
-			if (consumed < 0) {
-				cout << "Encountered fatal error" << endl;
-				return -1;
-			}
-			ptr += consumed;
-			len -= consumed;
-			consumed_total += consumed;
-		}
-
-		return 0;
+		return true;
 	}
 
 	/*
 	 * Handles unzipped data. The data pointer is either pointing to a new warc record or it is the continuation of a previous warc record.
 	 * */
-	void parser::handle_record_chunk(char *data, int len) {
+	void parser::handle_record_chunk(const char *data, size_t len) {
 
 		m_handled += len;
 		m_num_handled++;
 
 		if (len > 8 && strncmp(data, "WARC/1.0", 8) == 0) {
 			// data is the start of a warc record
-			string record(data, len);
 			m_current_record.assign(data, len);
 		} else {
 			m_current_record.append(data, len);
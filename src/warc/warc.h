@@ -4,10 +4,9 @@
 #include <iostream>
 #include "parser/html_parser.h"
 #include "parser/parser.h"
-#include "zlib.h"
+#include "file/gz_decoder.h"
 
 #define WARC_PARSER_ZLIB_IN 1024*1024*16
-#define WARC_PARSER_ZLIB_OUT 1024*1024*16
 
 namespace warc {
 
@@ -27,26 +26,22 @@ namespace warc {
 
 		private:
 
-			int m_cur_offset = 0;
-			bool m_continue_inflate = false;
 			std::string m_result;
 			std::string m_links;
 			std::string m_internal_links;
 			::parser::html_parser m_html_parser;
 
 			char *m_z_buffer_in;
-			char *m_z_buffer_out;
 
-			z_stream m_zstream; /* decompression stream */
+			// Compressed data from the end of the last read that did not contain a complete gzip member.
+			std::string m_pending;
+			file::gz_decoder m_decoder;
 
 			size_t m_handled = 0;
 			size_t m_num_handled = 0;
 			string m_current_record;
 
-			int unzip_record(char *data, int size);
-			int unzip_chunk(int bytes_in);
-
-			void handle_record_chunk(char *data, int len);
+			void handle_record_chunk(const char *data, size_t len);
 			void parse_record(const std::string &warc_header, const std::string &warc_record);
 			std::string get_warc_header(const std::string &record);
 			size_t http_response_code(const string &http_header);
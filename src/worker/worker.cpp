@@ -107,7 +107,7 @@ namespace worker {
 			string uri(uri_ptr);
 			string request_method(req_ptr);
 
-			LOG_INFO("Serving request: " + uri);
+			LOG_INFO_RATE_LIMITED(100, "Serving request: " + uri);
 
 			URL url("http://alexandria.org" + uri);
 
@@ -115,6 +115,12 @@ namespace worker {
 
 			stringstream response_stream;
 
+			// trace=1 attaches the span tree of this request to the response.
+			const bool trace = query.find("trace") != query.end() && query["trace"] == "1";
+			if (trace) {
+				profiler::start_trace();
+			}
+
 			bool deduplicate = true;
 			if (query.find("d") != query.end()) {
 				if (query["d"] == "a") {
@@ -144,6 +150,12 @@ namespace worker {
 				output_binary_response(request, response_stream);
 			}
 
+			if (trace) {
+				profiler::stop_trace();
+			}
+
+			search_allocation::reset_allocation(allocation);
+
 			FCGX_Finish_r(&request);
 		}
 
@@ -27,6 +27,9 @@
 #include "algorithm/algorithm.h"
 #include "algorithm/intersection.h"
 #include "algorithm/hyper_ball.h"
+#include "algorithm/hash_map.h"
+#include "algorithm/bloom_filter.h"
+#include "indexer/key_filter.h"
 
 BOOST_AUTO_TEST_SUITE(algorithms)
 
@@ -301,4 +304,115 @@ BOOST_AUTO_TEST_CASE(harmonic_centrality_threaded) {
 	}
 }
 
+BOOST_AUTO_TEST_CASE(harmonic_centrality_multi_source) {
+
+	// Skewed in-degree like the host graph, the multi source bfs has to give the same result as one bfs per vertex.
+	const uint32_t n = 2000;
+	srand(4711);
+	set<pair<uint32_t, uint32_t>> e;
+	for (uint32_t v = 0; v < n; v++) {
+		const size_t out_degree = 1 + rand() % 9;
+		for (size_t i = 0; i < out_degree; i++) {
+			const double u = (double)rand() / RAND_MAX;
+			e.insert(std::make_pair(v, (uint32_t)(u * u * u * (n - 1))));
+		}
+	}
+
+	vector<uint32_t> *edge_map = algorithm::set_to_edge_map(n, e);
+	const vector<double> expected = algorithm::harmonic_centrality(n, edge_map, 6);
+	delete [] edge_map;
+
+	const algorithm::csr_graph graph(n, e);
+	for (size_t num_threads : {1, 3}) {
+		const vector<double> h = algorithm::harmonic_centrality(graph, 6, num_threads);
+		BOOST_REQUIRE(h.size() == n);
+		for (uint32_t v = 0; v < n; v++) {
+			BOOST_CHECK_CLOSE(h[v] + 1.0, expected[v] + 1.0, 0.000001);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(hash_map) {
+
+	algorithm::hash_map<float> map(4);
+	std::map<uint64_t, float> reference;
+
+	for (size_t round = 0; round < 3; round++) {
+		map.clear();
+		reference.clear();
+		BOOST_CHECK(map.empty());
+
+		for (size_t i = 0; i < 10000; i++) {
+			const uint64_t key = (i * 7919) % (1000 * (round + 1)) << 32;
+			map[key] += 1.0f;
+			reference[key] += 1.0f;
+		}
+
+		BOOST_REQUIRE_EQUAL(map.size(), reference.size());
+		for (const auto &iter : map) {
+			BOOST_CHECK_EQUAL(iter.second, reference[iter.first]);
+		}
+		BOOST_CHECK(!map.contains(1));
+		BOOST_CHECK(map.find(1) == nullptr);
+		BOOST_REQUIRE(map.find(0) != nullptr);
+		BOOST_CHECK_EQUAL(*map.find(0), reference[0]);
+	}
+
+	algorithm::hash_map<bool> uniq;
+	BOOST_CHECK(uniq.insert(123, true));
+	BOOST_CHECK(!uniq.insert(123, true));
+	BOOST_CHECK_EQUAL(uniq.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter) {
+	algorithm::bloom_filter filter(10000);
+	for (uint64_t key = 0; key < 10000; key++) {
+		filter.insert(key * 7919);
+	}
+	BOOST_CHECK_EQUAL(filter.num_keys(), 10000);
+
+	stringstream stream;
+	filter.serialize(stream);
+	const string data = stream.str();
+	BOOST_CHECK_EQUAL(data.size(), algorithm::bloom_filter::header_size + filter.num_blocks() * algorithm::bloom_filter::block_size);
+
+	for (uint64_t key = 0; key < 10000; key++) {
+		BOOST_CHECK(filter.contains(key * 7919));
+		BOOST_CHECK(algorithm::bloom_filter::contains(data.data(), data.size(), key * 7919));
+	}
+
+	size_t false_positives = 0;
+	for (uint64_t key = 0; key < 100000; key++) {
+		const bool found = filter.contains(key * 7919 + 1);
+		BOOST_CHECK_EQUAL(found, algorithm::bloom_filter::contains(data.data(), data.size(), key * 7919 + 1));
+		if (found) false_positives++;
+	}
+	BOOST_CHECK(false_positives < 2000);
+
+	// Empty filters contain nothing, broken ones everything.
+	algorithm::bloom_filter empty(0);
+	BOOST_CHECK(!empty.contains(123));
+	BOOST_CHECK(algorithm::bloom_filter::contains(data.data(), 10, 123));
+}
+
+BOOST_AUTO_TEST_CASE(key_filter) {
+	const string file_name = "/tmp/alexandria_test_key_filter.bloom";
+
+	indexer::key_filter::remove(file_name);
+	BOOST_CHECK(indexer::key_filter::may_contain(file_name, 1));
+
+	indexer::key_filter::write(file_name, {1, 2, 3});
+	BOOST_CHECK(indexer::key_filter::may_contain(file_name, 1));
+	BOOST_CHECK(indexer::key_filter::may_contain(file_name, 3));
+
+	// Rewriting the filter replaces the mapped one.
+	indexer::key_filter::write(file_name, {});
+	BOOST_CHECK(!indexer::key_filter::may_contain(file_name, 1));
+	indexer::key_filter::write(file_name, {1000});
+	BOOST_CHECK(indexer::key_filter::may_contain(file_name, 1000));
+
+	indexer::key_filter::remove(file_name);
+	BOOST_CHECK(indexer::key_filter::may_contain(file_name, 12345));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
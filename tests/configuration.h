@@ -55,6 +55,10 @@ BOOST_AUTO_TEST_CASE(read_config) {
 	BOOST_CHECK_EQUAL(config::result_limit, 1000);
 	BOOST_CHECK_EQUAL(config::ft_max_sections, 4);
 	BOOST_CHECK_EQUAL(config::ft_max_results_per_section, 2000000);
+	BOOST_CHECK_EQUAL(config::storage_root, "/mnt");
+	BOOST_CHECK_EQUAL(config::storage_num_devices, 8);
+	BOOST_CHECK(config::storage_devices.empty());
+	BOOST_CHECK_EQUAL(config::storage_placement, "round_robin");
 
 	config::read_config("../tests/test_config2.conf");
 	BOOST_CHECK_EQUAL(config::nodes_in_cluster, 8);
@@ -86,6 +90,10 @@ BOOST_AUTO_TEST_CASE(read_config) {
 	BOOST_CHECK_EQUAL(config::n_grams, 5);
 	BOOST_CHECK_EQUAL(config::index_snippets, false);
 
+	vector<string> storage_devices{"/nvme0/alexandria", "/nvme1/alexandria"};
+	BOOST_CHECK(config::storage_devices == storage_devices);
+	BOOST_CHECK_EQUAL(config::storage_placement, "size_balanced");
+
 	config::read_config("../tests/test_config.conf");
 }
 
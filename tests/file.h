@@ -27,6 +27,7 @@
 #include "transfer/transfer.h"
 #include "text/text.h"
 #include "file/tsv_file_remote.h"
+#include "file/gz_decoder.h"
 #include "algorithm/hash.h"
 
 BOOST_AUTO_TEST_SUITE(file)
@@ -207,4 +208,69 @@ BOOST_AUTO_TEST_CASE(test_upload_gz) {
 	}
 }
 
+BOOST_AUTO_TEST_CASE(gz_decoder_multi_member) {
+
+	// Build a multi member gzip buffer, one member per "record" like the warc files.
+	vector<string> records;
+	string compressed;
+	string expected;
+	for (size_t i = 0; i < 20000; i++) {
+		string record = "WARC/1.0 record number " + std::to_string(i) + " ";
+		for (size_t j = 0; j < i % 100; j++) {
+			record += std::to_string(rand()) + " ";
+		}
+		stringstream ss;
+		{
+			boost::iostreams::filtering_ostream compress_stream;
+			compress_stream.push(boost::iostreams::gzip_compressor());
+			compress_stream.push(ss);
+			compress_stream << record;
+		}
+		compressed += ss.str();
+		expected += record;
+		records.push_back(record);
+	}
+
+	{
+		file::gz_decoder decoder(8);
+		size_t num_members = 0;
+		bool in_order = true;
+		const size_t consumed = decoder.decode(compressed.data(), compressed.size(), [&](const char *data, size_t len) {
+			if (string(data, len) != records[num_members]) in_order = false;
+			num_members++;
+		});
+		BOOST_CHECK(!decoder.error());
+		BOOST_CHECK(in_order);
+		BOOST_CHECK_EQUAL(consumed, compressed.size());
+		BOOST_CHECK_EQUAL(num_members, records.size());
+	}
+
+	{
+		// Feed the data in chunks that does not end on member boundaries.
+		file::gz_decoder decoder(4);
+		string pending;
+		string result;
+		const size_t chunk_size = 1000003;
+		for (size_t pos = 0; pos < compressed.size(); pos += chunk_size) {
+			pending.append(compressed.substr(pos, chunk_size));
+			const size_t consumed = decoder.decode(pending.data(), pending.size(), [&result](const char *data, size_t len) {
+				result.append(data, len);
+			});
+			BOOST_CHECK(!decoder.error());
+			pending.erase(0, consumed);
+		}
+		BOOST_CHECK_EQUAL(pending.size(), 0);
+		BOOST_CHECK(result == expected);
+	}
+
+	{
+		bool error;
+		BOOST_CHECK(file::gz_decompress(compressed, error) == expected);
+		BOOST_CHECK(!error);
+
+		file::gz_decompress("this is not gzip data", error);
+		BOOST_CHECK(error);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -34,7 +34,10 @@
 #include "full_text/url_to_domain.h"
 #include "full_text/full_text_index.h"
 #include "full_text/full_text_indexer_runner.h"
+#include "full_text/full_text_shard_builder.h"
+#include "full_text/full_text_shard_writer.h"
 #include "search_engine/search_engine.h"
+#include <boost/filesystem.hpp>
 
 #include "json.hpp"
 
@@ -388,4 +391,132 @@ BOOST_AUTO_TEST_CASE(is_indexed) {
 	search_allocation::delete_allocation(allocation);
 }
 
+BOOST_AUTO_TEST_CASE(shard_writer) {
+
+	full_text::truncate_index("test_shard_writer");
+	for (size_t shard_id = 0; shard_id < config::ft_num_shards; shard_id++) {
+		full_text::full_text_shard_builder<full_text_record> builder("test_shard_writer", shard_id);
+		builder.truncate_cache_files();
+	}
+
+	const size_t num_producers = 3;
+	const uint64_t num_keys = 100;
+
+	{
+		full_text::full_text_shard_writer shard_writer("test_shard_writer", 3);
+
+		std::vector<std::thread> producers;
+		for (size_t producer = 0; producer < num_producers; producer++) {
+			producers.emplace_back([&shard_writer, producer]() {
+				std::vector<full_text::full_text_shard_writer::batch> partitions(shard_writer.num_writers());
+				for (uint64_t key = 0; key < num_keys; key++) {
+					const size_t writer_id = shard_writer.writer_for_key(key);
+					partitions[writer_id].emplace_back(key, full_text_record{.m_value = key * num_producers + producer,
+						.m_score = 1.0f, .m_domain_hash = 0});
+				}
+				for (size_t writer_id = 0; writer_id < partitions.size(); writer_id++) {
+					shard_writer.push(writer_id, std::move(partitions[writer_id]));
+				}
+			});
+		}
+		for (std::thread &producer : producers) {
+			producer.join();
+		}
+	}
+
+	for (size_t shard_id = 0; shard_id < config::ft_num_shards; shard_id++) {
+		full_text::full_text_shard_builder<full_text_record> builder("test_shard_writer", shard_id);
+		builder.merge();
+	}
+
+	for (uint64_t key = 0; key < num_keys; key++) {
+		full_text::full_text_shard<full_text_record> shard("test_shard_writer", key % config::ft_num_shards);
+		BOOST_CHECK_EQUAL(shard.total_num_results(key), num_producers);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(shard_builder_external_merge) {
+
+	const size_t initial_merge_memory = config::ft_max_merge_memory_mb;
+	config::ft_max_merge_memory_mb = 0;
+
+	full_text::full_text_shard_builder<full_text_record> builder("test_external_merge", 0);
+	builder.truncate();
+
+	// Spread over several runs and two merges, every value is added twice.
+	const uint64_t num_values = 5000;
+	for (size_t merge = 0; merge < 2; merge++) {
+		for (uint64_t value = 0; value < num_values; value++) {
+			builder.add(123, full_text_record{.m_value = value, .m_score = (float)value, .m_domain_hash = 0});
+			builder.add(value + 1000, full_text_record{.m_value = value, .m_score = 1.0f, .m_domain_hash = 0});
+		}
+		builder.append();
+		builder.merge();
+	}
+
+	full_text::full_text_shard<full_text_record> shard("test_external_merge", 0);
+	BOOST_CHECK_EQUAL(shard.total_num_results(123), num_values);
+	BOOST_CHECK_EQUAL(shard.total_num_results(1000), 1);
+	BOOST_CHECK_EQUAL(shard.total_num_results(1000 + num_values - 1), 1);
+	BOOST_CHECK_EQUAL(shard.total_num_results(1000 + num_values), 0);
+
+	config::ft_max_merge_memory_mb = initial_merge_memory;
+}
+
+BOOST_AUTO_TEST_CASE(url_to_domain_table) {
+
+	full_text::truncate_url_to_domain("test_url_to_domain");
+
+	{
+		full_text::url_to_domain url_store("test_url_to_domain");
+		for (uint64_t url_hash = 0; url_hash < 10000; url_hash++) {
+			url_store.add_url(url_hash, url_hash % 100);
+		}
+		// Duplicates in other buckets, the last entry of the highest bucket wins.
+		url_store.write(0);
+		url_store.add_url(5, 5);
+		url_store.add_url(7, 50);
+		url_store.write(3);
+		url_store.add_url(7, 60);
+		url_store.add_url(0, 70);
+		url_store.write(2);
+		url_store.add_url(8, 11);
+		url_store.add_url(8, 22);
+		url_store.write(6);
+
+		url_store.read();
+		BOOST_CHECK_EQUAL(url_store.size(), 10000);
+		BOOST_CHECK(url_store.has_url(0));
+		BOOST_CHECK(url_store.has_url(9999));
+		BOOST_CHECK(!url_store.has_url(10000));
+		BOOST_CHECK_EQUAL(*url_store.find_url(1234), 34);
+		BOOST_CHECK_EQUAL(*url_store.find_url(7), 50);
+		BOOST_CHECK_EQUAL(*url_store.find_url(0), 70);
+		BOOST_CHECK_EQUAL(*url_store.find_url(8), 22);
+		BOOST_CHECK(url_store.has_domain(99));
+		BOOST_CHECK(!url_store.has_domain(100));
+	}
+
+	{
+		// Loaded from the saved table.
+		BOOST_CHECK(boost::filesystem::exists(full_text::url_to_domain::table_file_name("test_url_to_domain")));
+		full_text::url_to_domain url_store("test_url_to_domain");
+		url_store.read();
+		BOOST_CHECK_EQUAL(url_store.size(), 10000);
+		BOOST_CHECK_EQUAL(*url_store.find_url(1234), 34);
+		BOOST_CHECK(!url_store.has_url(10001));
+
+		url_store.add_url(10001, 100);
+		url_store.write(1);
+		BOOST_CHECK(!boost::filesystem::exists(full_text::url_to_domain::table_file_name("test_url_to_domain")));
+
+		url_store.read();
+		BOOST_CHECK_EQUAL(url_store.size(), 10001);
+		BOOST_CHECK(url_store.has_url(10001));
+		BOOST_CHECK(url_store.has_domain(100));
+	}
+
+	full_text::truncate_url_to_domain("test_url_to_domain");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,7 @@
  */
 
 #include "algorithm/hyper_ball.h"
+#include "tools/host_graph.h"
 
 BOOST_AUTO_TEST_SUITE(hyper_ball)
 
@@ -130,5 +131,87 @@ BOOST_AUTO_TEST_CASE(harmonic_centrality_hyper_ball3) {
 
 }
 
+BOOST_AUTO_TEST_CASE(hyper_ball_small_registers) {
+
+	const uint32_t n = 2000;
+	srand(42);
+	set<pair<uint32_t, uint32_t>> e;
+	for (uint32_t v = 0; v < n; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			e.insert(std::make_pair(v, rand() % n));
+		}
+	}
+
+	vector<uint32_t> *edge_map = algorithm::set_to_edge_map(n, e);
+	const algorithm::csr_graph graph(n, edge_map);
+	vector<double> exact = algorithm::harmonic_centrality(n, edge_map, 40);
+	delete [] edge_map;
+
+	BOOST_CHECK_EQUAL(graph.num_vertices(), n);
+	BOOST_CHECK_EQUAL(graph.num_edges(), e.size());
+
+	vector<double> h = algorithm::hyper_ball(graph, 8);
+	vector<double> h_mmap = algorithm::hyper_ball(graph, 8, 40, "/tmp");
+
+	BOOST_REQUIRE(h.size() == n);
+	BOOST_CHECK(h == h_mmap);
+
+	double sum_exact = 0.0;
+	double sum_error = 0.0;
+	for (uint32_t v = 0; v < n; v++) {
+		sum_exact += exact[v];
+		sum_error += std::abs(h[v] - exact[v]);
+	}
+	BOOST_CHECK(sum_error / sum_exact < 0.1);
+}
+
+BOOST_AUTO_TEST_CASE(host_graph_file) {
+
+	vector<uint64_t> host_hashes = {900, 100, 500, 100, 300};
+	tools::host_table::write("/tmp/hosts_test.bin", host_hashes);
+
+	const tools::host_table hosts("/tmp/hosts_test.bin");
+	BOOST_CHECK_EQUAL(hosts.size(), 4);
+	uint32_t id = 0;
+	BOOST_CHECK(hosts.find(100, id) && id == 0);
+	BOOST_CHECK(hosts.find(900, id) && id == 3);
+	BOOST_CHECK(!hosts.find(200, id));
+
+	const uint32_t n = 2000;
+	set<pair<uint32_t, uint32_t>> e;
+	for (uint32_t v = 0; v < n; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			e.insert(std::make_pair(rand() % n, v));
+		}
+	}
+	e.insert(std::make_pair(n - 1, 0));
+	e.insert(std::make_pair(0, n - 1));
+
+	// Two overlapping runs, the duplicates should be removed when merging.
+	vector<uint64_t> run1, run2;
+	for (const auto &edge : e) {
+		const uint64_t packed = (uint64_t)edge.second << 32 | edge.first;
+		if (edge.first % 2 == 0) run1.push_back(packed);
+		if (edge.first % 3 == 0 || edge.first % 2 == 1) run2.push_back(packed);
+	}
+	tools::write_edge_run("/tmp/edges_test_1.run", run1);
+	tools::write_edge_run("/tmp/edges_test_2.run", run2);
+	tools::write_host_graph("/tmp/edges_test.bin", n, {"/tmp/edges_test_1.run", "/tmp/edges_test_2.run"});
+
+	const algorithm::csr_graph graph = tools::read_host_graph("/tmp/edges_test.bin");
+	const algorithm::csr_graph expected(n, e);
+
+	BOOST_REQUIRE_EQUAL(graph.num_vertices(), n);
+	BOOST_REQUIRE_EQUAL(graph.num_edges(), e.size());
+	for (uint32_t v = 0; v < n; v++) {
+		const auto a = graph.neighbours(v);
+		const auto b = expected.neighbours(v);
+		BOOST_REQUIRE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+	}
+
+	// A run that cannot be written is an error, the graph would silently miss its edges.
+	BOOST_CHECK_THROW(tools::write_edge_run("/tmp/non_existing_dir/edges_test.run", run1), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
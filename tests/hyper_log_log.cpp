@@ -28,6 +28,7 @@
 #include "algorithm/hyper_log_log.h"
 #include <cstdlib>
 #include <vector>
+#include <sstream>
 
 using namespace std;
 
@@ -129,4 +130,96 @@ BOOST_AUTO_TEST_CASE(hyper_log_log_test2) {
 	cout << "size: " << hl1.count() << endl;
 }
 
+BOOST_AUTO_TEST_CASE(hyper_log_log_sparse) {
+	algorithm::hyper_log_log sparse;
+	algorithm::hyper_log_log dense;
+	dense.data(); // Forces the dense representation.
+
+	for (size_t i = 0; i < 5000; i++) {
+		sparse.insert(i);
+		dense.insert(i);
+		if (i == 100) {
+			BOOST_CHECK(sparse.sparse());
+			BOOST_CHECK_EQUAL(sparse.count(), dense.count());
+		}
+	}
+
+	BOOST_CHECK(!sparse.sparse());
+	BOOST_CHECK_EQUAL(sparse.count(), dense.count());
+
+	// Merging sparse into dense and dense into sparse.
+	algorithm::hyper_log_log small;
+	for (size_t i = 10000; i < 10100; i++) {
+		small.insert(i);
+	}
+	algorithm::hyper_log_log merged1 = dense + small;
+	algorithm::hyper_log_log merged2 = small + dense;
+	BOOST_CHECK(small.sparse());
+	BOOST_CHECK_EQUAL(merged1.count(), merged2.count());
+	BOOST_CHECK(std::abs((int)merged1.count() - 5100) < 5100 * merged1.error_bound());
+}
+
+BOOST_AUTO_TEST_CASE(hyper_log_log_serialize) {
+	algorithm::hyper_log_log small;
+	algorithm::hyper_log_log large;
+	for (size_t i = 0; i < 100; i++) {
+		small.insert(i);
+	}
+	for (size_t i = 0; i < 100000; i++) {
+		large.insert(i);
+	}
+
+	std::stringstream stream;
+	small.serialize(stream);
+	const size_t small_size = stream.str().size();
+	large.serialize(stream);
+
+	BOOST_CHECK(small_size < 1000);
+	BOOST_CHECK_EQUAL(stream.str().size() - small_size, large.data_size() + 1);
+
+	algorithm::hyper_log_log small_copy;
+	algorithm::hyper_log_log large_copy;
+	small_copy.deserialize(stream);
+	large_copy.deserialize(stream);
+
+	BOOST_CHECK(small_copy.sparse());
+	BOOST_CHECK_EQUAL(small_copy.count(), small.count());
+	BOOST_CHECK_EQUAL(large_copy.count(), large.count());
+}
+
+BOOST_AUTO_TEST_CASE(hyper_log_log_legacy_format) {
+	algorithm::hyper_log_log small;
+	algorithm::hyper_log_log large;
+	for (size_t i = 0; i < 100; i++) {
+		small.insert(i);
+	}
+	for (size_t i = 0; i < 100000; i++) {
+		large.insert(i);
+	}
+
+	// The legacy format is the raw dense registers.
+	std::stringstream stream;
+	stream.write(small.data(), small.data_size());
+	stream.write(large.data(), large.data_size());
+
+	algorithm::hyper_log_log small_copy;
+	algorithm::hyper_log_log large_copy;
+	small_copy.deserialize(stream);
+	large_copy.deserialize(stream);
+	BOOST_CHECK(stream);
+	BOOST_CHECK_EQUAL(small_copy.count(), small.count());
+	BOOST_CHECK_EQUAL(large_copy.count(), large.count());
+
+	// A sparse list longer than the sparse limit is rejected.
+	std::stringstream corrupt;
+	const uint8_t format = 0xf1;
+	const uint32_t len = 0xffffffff;
+	corrupt.write((char *)&format, sizeof(format));
+	corrupt.write((char *)&len, sizeof(len));
+	algorithm::hyper_log_log corrupt_copy;
+	corrupt_copy.deserialize(corrupt);
+	BOOST_CHECK(!corrupt);
+	BOOST_CHECK_EQUAL(corrupt_copy.count(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -46,4 +46,41 @@ BOOST_AUTO_TEST_CASE(test_logger1) {
 	BOOST_CHECK_EQUAL(line2, "test2");
 }
 
+BOOST_AUTO_TEST_CASE(test_logger_entries) {
+
+	for (size_t i = 0; i < 1000; i++) {
+		LOG_INFO("entry " + std::to_string(i));
+	}
+	logger::log_string("last entry");
+
+	logger::sync();
+
+	ifstream logfile(config::log_file_path);
+	string line, last, second_last;
+	while (getline(logfile, line)) {
+		second_last = last;
+		last = line;
+	}
+	BOOST_CHECK_EQUAL(last, "last entry");
+	BOOST_CHECK(second_last.find("[info]") != string::npos);
+	BOOST_CHECK(second_last.find("entry 999") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(test_rate_limiter) {
+
+	logger::rate_limiter limiter(10);
+
+	size_t allowed = 0;
+	for (size_t i = 0; i < 1000; i++) {
+		if (limiter.allow()) allowed++;
+	}
+	BOOST_CHECK_EQUAL(allowed, 10);
+
+	size_t evaluated = 0;
+	for (size_t i = 0; i < 1000; i++) {
+		LOG_INFO_RATE_LIMITED(5, std::to_string(evaluated++));
+	}
+	BOOST_CHECK_EQUAL(evaluated, 5);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -83,6 +83,8 @@ using std::pair;
 //#include "index_array.h"
 #include "memory.h"
 #include "thread_pool.h"
+#include "profiler.h"
+#include "storage.h"
 
 void run_before() {
 	config::read_config("../tests/test_config.conf");
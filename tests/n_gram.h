@@ -60,6 +60,28 @@ BOOST_AUTO_TEST_CASE(words_to_ngram) {
 
 }
 
+BOOST_AUTO_TEST_CASE(words_to_ngram_views) {
+	const string sentence = "The quick brown fox jumps over the lazy dog, and some longer words like incomprehensibilities";
+
+	vector<uint64_t> ngrams;
+	text::words_to_ngram_hash(text::get_full_text_words(sentence), 4, [&ngrams](const uint64_t hash) {
+		ngrams.push_back(hash);
+	});
+
+	string buffer;
+	vector<std::string_view> words;
+	text::get_full_text_words(sentence, buffer, words);
+
+	vector<uint64_t> ngrams_views;
+	text::words_to_ngram_hash(words, 4, [&ngrams_views](const uint64_t hash) {
+		ngrams_views.push_back(hash);
+	});
+
+	BOOST_CHECK(ngrams == ngrams_views);
+	BOOST_CHECK_EQUAL(ngrams_views[1], algorithm::hash("the quick"));
+	BOOST_CHECK_EQUAL(ngrams_views[ngrams_views.size() - 1], algorithm::hash("incomprehensibilities"));
+}
+
 BOOST_AUTO_TEST_CASE(n_gram) {
 
 	size_t initial_results_per_section = config::ft_max_results_per_section;
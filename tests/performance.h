@@ -24,6 +24,10 @@
  * SOFTWARE.
  */
 
+#include "text/text.h"
+#include "profiler/profiler.h"
+#include "memory/debugger.h"
+#include <thread>
 
 BOOST_AUTO_TEST_SUITE(performance)
 
@@ -33,4 +37,47 @@ BOOST_AUTO_TEST_CASE(domain_index_sharp) {
 
 }
 
+BOOST_AUTO_TEST_CASE(allocation_accounting) {
+
+	// Indexing like workload, every word is a heap allocated string so operator new dominates.
+	const vector<string> vocabulary = {"the", "search", "engine", "Alexandria", "index,", "(open)", "källkod", "über",
+		"a.b-c", "C++", "www.example.com", "|", "!", "data:", "incomprehensibilities"};
+	srand(4711);
+	vector<string> documents;
+	for (size_t i = 0; i < 1000; i++) {
+		string document;
+		for (size_t j = 0; j < 200; j++) {
+			document += vocabulary[rand() % vocabulary.size()] + " ";
+		}
+		documents.push_back(document);
+	}
+
+	const size_t num_threads = 4;
+	const size_t allocated_before = memory::allocated_memory();
+
+	profiler::instance prof("allocation accounting");
+	vector<size_t> sums(num_threads, 0);
+	vector<std::thread> threads;
+	for (size_t t = 0; t < num_threads; t++) {
+		threads.emplace_back([&documents, &sum = sums[t]]() {
+			for (const string &document : documents) {
+				vector<string> words = text::get_expanded_full_text_words(document);
+				sum += words.size();
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	prof.stop();
+
+	for (size_t sum : sums) {
+		BOOST_CHECK(sum > 0);
+	}
+
+	// Everything allocated by the threads has been freed, possibly on other shards than it was allocated on.
+	const size_t allocated_after = memory::allocated_memory();
+	BOOST_CHECK(allocated_after < allocated_before + 1024*1024);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
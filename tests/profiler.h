@@ -0,0 +1,162 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "profiler/profiler.h"
+#include "utils/scheduler.hpp"
+#include "json.hpp"
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(profiler_trace)
+
+BOOST_AUTO_TEST_CASE(span_tree) {
+
+	profiler::start_trace();
+	{
+		profiler::span outer("test::outer");
+		{
+			profiler::span inner1("test::inner");
+		}
+		{
+			profiler::span inner2("test::inner");
+			profiler::span leaf("test::leaf");
+		}
+	}
+	std::vector<profiler::span_record> spans = profiler::stop_trace();
+
+	BOOST_REQUIRE_EQUAL(spans.size(), 4);
+	BOOST_CHECK_EQUAL(spans[0].m_parent, profiler::span_record::no_parent);
+	BOOST_CHECK_EQUAL(spans[1].m_parent, 0);
+	BOOST_CHECK_EQUAL(spans[2].m_parent, 0);
+	BOOST_CHECK_EQUAL(spans[3].m_parent, 2);
+	BOOST_CHECK_EQUAL(spans[3].m_depth, 2);
+	for (const profiler::span_record &record : spans) {
+		BOOST_CHECK(record.m_end >= record.m_start);
+	}
+
+	nlohmann::json tree = nlohmann::json::parse(profiler::span_tree_json(spans));
+	BOOST_REQUIRE_EQUAL(tree.size(), 1);
+	BOOST_CHECK_EQUAL(tree[0]["name"], "test::outer");
+	BOOST_REQUIRE_EQUAL(tree[0]["children"].size(), 2);
+	BOOST_CHECK_EQUAL(tree[0]["children"][1]["children"][0]["name"], "test::leaf");
+
+	nlohmann::json chrome = nlohmann::json::parse(profiler::chrome_trace_json(spans));
+	BOOST_CHECK_EQUAL(chrome["traceEvents"].size(), 4);
+	BOOST_CHECK_EQUAL(chrome["traceEvents"][0]["ph"], "X");
+	BOOST_CHECK_EQUAL(chrome["traceEvents"][0]["tid"], spans[0].m_thread);
+	BOOST_CHECK_EQUAL(chrome["traceEvents"][3]["tid"], chrome["traceEvents"][0]["tid"]);
+
+	// Not tracing, spans only go to the histograms.
+	{
+		profiler::span outer("test::outer");
+	}
+	BOOST_CHECK(!profiler::is_tracing());
+	BOOST_CHECK_EQUAL(profiler::stop_trace().size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(span_tree_tasks) {
+
+	profiler::start_trace();
+	{
+		profiler::span outer("test::outer");
+		utils::task_group tasks;
+		for (size_t i = 0; i < 8; i++) {
+			tasks.run([]() {
+				profiler::span task("test::task");
+				profiler::span leaf("test::leaf");
+			});
+		}
+		tasks.wait();
+	}
+	std::vector<profiler::span_record> spans = profiler::stop_trace();
+
+	BOOST_REQUIRE_EQUAL(spans.size(), 17);
+	BOOST_CHECK_EQUAL(spans[0].m_parent, profiler::span_record::no_parent);
+	for (size_t i = 1; i < spans.size(); i++) {
+		const profiler::span_record &record = spans[i];
+		BOOST_CHECK(record.m_end >= record.m_start);
+		if (std::string(record.m_name) == "test::task") {
+			BOOST_CHECK_EQUAL(record.m_parent, 0);
+			BOOST_CHECK_EQUAL(record.m_depth, 1);
+		} else {
+			BOOST_CHECK_EQUAL(std::string(spans[record.m_parent].m_name), "test::task");
+			BOOST_CHECK_EQUAL(record.m_depth, 2);
+		}
+	}
+
+	// Spans recorded on another thread keep the id of that thread in the chrome trace.
+	profiler::start_trace();
+	{
+		profiler::span outer("test::outer");
+		const profiler::trace_context context = profiler::capture_trace();
+		std::thread other([&context]() {
+			profiler::trace_scope scope(context);
+			profiler::span task("test::task");
+		});
+		other.join();
+	}
+	spans = profiler::stop_trace();
+	BOOST_REQUIRE_EQUAL(spans.size(), 2);
+	nlohmann::json chrome = nlohmann::json::parse(profiler::chrome_trace_json(spans));
+	BOOST_CHECK(chrome["traceEvents"][0]["tid"] != chrome["traceEvents"][1]["tid"]);
+
+	// Tasks run while not tracing are not recorded.
+	bool task_tracing = true;
+	{
+		utils::task_group tasks;
+		tasks.run([&task_tracing]() {
+			task_tracing = profiler::is_tracing();
+		});
+		tasks.wait();
+	}
+	BOOST_CHECK(!task_tracing);
+}
+
+BOOST_AUTO_TEST_CASE(span_histograms) {
+
+	profiler::report_reset();
+
+	std::thread other([]() {
+		for (size_t i = 0; i < 100; i++) {
+			profiler::span s("test::histogram");
+		}
+	});
+	other.join();
+	for (size_t i = 0; i < 50; i++) {
+		profiler::span s("test::histogram");
+	}
+
+	size_t count = 0;
+	for (const profiler::span_summary &summary : profiler::span_summaries()) {
+		if (summary.m_name == "test::histogram") {
+			count = summary.m_count;
+			BOOST_CHECK(summary.percentile(0.5) <= summary.percentile(0.99));
+			BOOST_CHECK(summary.percentile(1.0) <= summary.m_max_nanos);
+		}
+	}
+	BOOST_CHECK_EQUAL(count, 150);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
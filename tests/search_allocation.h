@@ -36,4 +36,64 @@ BOOST_AUTO_TEST_CASE(create) {
 	search_allocation::delete_storage(search_alloc);
 }
 
+BOOST_AUTO_TEST_CASE(arena) {
+
+	search_allocation::arena arena(1024);
+
+	{
+		std::pmr::vector<uint64_t> vec(&arena);
+		for (uint64_t i = 0; i < 1000; i++) {
+			vec.push_back(i);
+		}
+		BOOST_CHECK_EQUAL(vec[999], 999);
+
+		// Larger than the block size.
+		std::pmr::vector<char> large(4096, 'a', &arena);
+		BOOST_CHECK_EQUAL(large[4095], 'a');
+
+		void *aligned = arena.allocate(64, 64);
+		BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+	}
+
+	BOOST_CHECK(arena.bytes_used() > 8000);
+
+	arena.reset();
+	BOOST_CHECK_EQUAL(arena.bytes_used(), 0);
+
+	// The oversized blocks are freed, at most max_retained_blocks blocks of the block size are kept.
+	const size_t num_blocks = arena.num_blocks();
+	const size_t capacity = arena.capacity();
+	BOOST_CHECK(num_blocks <= search_allocation::arena::default_max_retained_blocks);
+	BOOST_CHECK_EQUAL(capacity, num_blocks * 1024);
+
+	// The same work again reuses the kept blocks.
+	{
+		std::pmr::vector<uint64_t> vec(&arena);
+		for (uint64_t i = 0; i < 1000; i++) {
+			vec.push_back(i);
+		}
+		std::pmr::vector<char> large(4096, 'a', &arena);
+	}
+	arena.reset();
+	BOOST_CHECK_EQUAL(arena.num_blocks(), num_blocks);
+	BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(allocation_scratch) {
+
+	search_allocation::allocation *allocation = search_allocation::create_allocation();
+
+	BOOST_CHECK(allocation->record_storage->scratch == allocation->scratch);
+	BOOST_CHECK(allocation->link_storage->scratch == allocation->scratch);
+
+	void *scratch = allocation->record_storage->scratch->allocate(1000);
+	BOOST_CHECK(scratch != nullptr);
+	BOOST_CHECK(allocation->scratch->bytes_used() >= 1000);
+
+	search_allocation::reset_allocation(allocation);
+	BOOST_CHECK_EQUAL(allocation->scratch->bytes_used(), 0);
+
+	search_allocation::delete_allocation(allocation);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -93,4 +93,30 @@ BOOST_AUTO_TEST_CASE(apply_domain_link_scores) {
 	}
 }
 
+BOOST_AUTO_TEST_CASE(deduplicate_result_vector) {
+
+	search_allocation::arena arena;
+
+	std::pmr::vector<full_text_record> results(&arena);
+	for (size_t i = 0; i < 100; i++) {
+		// 10 domains, scores descending.
+		results.push_back(full_text_record{.m_value = i, .m_score = 100.0f - i, .m_domain_hash = i % 10});
+	}
+
+	const size_t per_domain = config::deduplicate_domain_count;
+
+	vector<full_text_record> deduped = search_engine::deduplicate_result_vector<full_text_record>(results, 10 * per_domain, &arena);
+	BOOST_REQUIRE_EQUAL(deduped.size(), 10 * per_domain);
+	for (size_t i = 0; i < deduped.size(); i++) {
+		BOOST_CHECK_EQUAL(deduped[i].m_value, i);
+	}
+
+	// More than the deduplicated results, the rest is filled up with the best of the duplicates in score order.
+	deduped = search_engine::deduplicate_result_vector<full_text_record>(results, 10 * per_domain + 20, &arena);
+	BOOST_REQUIRE_EQUAL(deduped.size(), 10 * per_domain + 20);
+	for (size_t i = 0; i < deduped.size(); i++) {
+		BOOST_CHECK_EQUAL(deduped[i].m_value, i);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
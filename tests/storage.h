@@ -0,0 +1,226 @@
+/*
+ * MIT License
+ *
+ * Alexandria.org
+ *
+ * Copyright (c) 2021 Josef Cullhed, <info@alexandria.org>, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+#include "storage/storage.h"
+#include "hash_table/hash_table.h"
+#include "hash_table_helper/hash_table_helper.h"
+#include "tools/split_pipeline.h"
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+BOOST_AUTO_TEST_SUITE(storage_topology)
+
+/*
+	Sets the storage config for one test case and restores the previous one when it goes out of scope.
+*/
+struct storage_config {
+	std::string m_root = config::storage_root;
+	size_t m_num_devices = config::storage_num_devices;
+	std::vector<std::string> m_devices = config::storage_devices;
+	std::string m_placement = config::storage_placement;
+
+	storage_config(const std::string &root, size_t num_devices, const std::string &placement) {
+		config::storage_root = root;
+		config::storage_num_devices = num_devices;
+		config::storage_devices.clear();
+		config::storage_placement = placement;
+	}
+
+	~storage_config() {
+		config::storage_root = m_root;
+		config::storage_num_devices = m_num_devices;
+		config::storage_devices = m_devices;
+		config::storage_placement = m_placement;
+	}
+};
+
+BOOST_AUTO_TEST_CASE(round_robin) {
+	storage_config conf("/mnt", 8, "round_robin");
+
+	BOOST_CHECK_EQUAL(storage::num_devices(), 8);
+	BOOST_CHECK_EQUAL(storage::device_root(3), "/mnt/3");
+	BOOST_CHECK_EQUAL(storage::shard_device("fti_main_index", 13), 5);
+	BOOST_CHECK_EQUAL(storage::shard_path("ht_test", 9, "hash_table/ht_test_9.data"), "/mnt/1/hash_table/ht_test_9.data");
+	BOOST_CHECK_EQUAL(storage::primary_path("indexed"), "/mnt/0/indexed");
+
+	config::storage_devices = {"/nvme0", "/nvme1", "/nvme2"};
+	BOOST_CHECK_EQUAL(storage::num_devices(), 3);
+	BOOST_CHECK_EQUAL(storage::shard_path("ht_test", 5, "hash_table/ht_test_5.data"), "/nvme2/hash_table/ht_test_5.data");
+}
+
+BOOST_AUTO_TEST_CASE(hash_placement) {
+	storage_config conf("/mnt", 8, "hash");
+
+	vector<size_t> shards_per_device(8, 0);
+	for (size_t shard_id = 0; shard_id < 8000; shard_id++) {
+		const size_t device = storage::shard_device("fti_main_index", shard_id);
+		BOOST_REQUIRE(device < 8);
+		BOOST_CHECK_EQUAL(device, storage::shard_device("fti_main_index", shard_id));
+		shards_per_device[device]++;
+	}
+	for (size_t count : shards_per_device) {
+		BOOST_CHECK(count > 800 && count < 1200);
+	}
+
+	// Adding a device only moves the shards the new device wins.
+	vector<size_t> before;
+	for (size_t shard_id = 0; shard_id < 1000; shard_id++) {
+		before.push_back(storage::shard_device("fti_main_index", shard_id));
+	}
+	config::storage_num_devices = 9;
+	for (size_t shard_id = 0; shard_id < 1000; shard_id++) {
+		const size_t device = storage::shard_device("fti_main_index", shard_id);
+		BOOST_CHECK(device == before[shard_id] || device == 8);
+	}
+
+	config::storage_placement = "random";
+	BOOST_CHECK_THROW(storage::shard_device("fti_main_index", 0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(size_balanced_placement) {
+	const std::string root = "/tmp/alexandria_test_size_balanced";
+	boost::filesystem::remove_all(root);
+	storage_config conf(root, 2, "size_balanced");
+
+	BOOST_CHECK_THROW(storage::shard_device("fti_main_index", 0), std::runtime_error);
+
+	storage::create_layout();
+	for (size_t shard_id = 0; shard_id < 100; shard_id++) {
+		const size_t device = storage::shard_device("fti_main_index", shard_id);
+		BOOST_CHECK(device < 2);
+		BOOST_CHECK_EQUAL(device, storage::shard_device("fti_main_index", shard_id));
+	}
+	boost::filesystem::remove_all(root);
+}
+
+BOOST_AUTO_TEST_CASE(hash_table_on_storage_root) {
+	const std::string root = "/tmp/alexandria_test_storage";
+	boost::filesystem::remove_all(root);
+	storage_config conf(root, 3, "hash");
+	storage::create_layout();
+
+	hash_table_helper::truncate("test_storage");
+	{
+		vector<hash_table::hash_table_shard_builder *> shards = hash_table_helper::create_shard_builders("test_storage");
+		for (size_t i = 0; i < 1000; i++) {
+			hash_table_helper::add_data(shards, i, "data " + std::to_string(i));
+		}
+		hash_table_helper::write(shards);
+		hash_table_helper::sort(shards);
+		hash_table_helper::delete_shard_builders(shards);
+	}
+
+	hash_table::hash_table table("test_storage");
+	BOOST_CHECK_EQUAL(table.size(), 1000);
+	BOOST_CHECK_EQUAL(table.find(123), "data 123");
+
+	for (size_t device = 0; device < 3; device++) {
+		BOOST_CHECK(!boost::filesystem::is_empty(root + "/" + std::to_string(device) + "/hash_table"));
+	}
+	boost::filesystem::remove_all(root);
+}
+
+BOOST_AUTO_TEST_CASE(split_pipeline_round_trip) {
+	const std::string root = "/tmp/alexandria_test_split";
+	boost::filesystem::remove_all(root);
+	storage_config conf(root, 1, "round_robin");
+	boost::filesystem::create_directories(storage::primary_path("input"));
+
+	// Three input files, every tenth line is skipped by the route function.
+	const size_t num_files = 3;
+	const size_t lines_per_file = 20000;
+	vector<std::string> input_files;
+	for (size_t file = 0; file < num_files; file++) {
+		input_files.push_back(storage::primary_path("input/" + std::to_string(file) + ".gz"));
+		std::ofstream outfile(input_files.back(), std::ios::binary | std::ios::trunc);
+		boost::iostreams::filtering_ostream compress_stream;
+		compress_stream.push(boost::iostreams::gzip_compressor());
+		compress_stream.push(outfile);
+		for (size_t i = 0; i < lines_per_file; i++) {
+			compress_stream << "line " << file << " " << i << "\tdata\n";
+		}
+	}
+
+	const size_t num_destinations = 3;
+	const auto route = [](std::string_view line, size_t &destination) {
+		const size_t i = std::stoull(std::string(line.substr(line.rfind(' ') + 1)));
+		if (i % 10 == 9) return false;
+		destination = std::hash<std::string_view>{}(line) % num_destinations;
+		return true;
+	};
+
+	// A split in two runs keeps the output of both runs, truncate starts a new split.
+	const auto read_counts = [&route]() {
+		std::map<std::string, size_t> counts;
+		for (size_t destination = 0; destination < num_destinations; destination++) {
+			std::ifstream paths(storage::primary_path("crawl-data/TEST-" + std::to_string(destination) + "-BIG/warc.paths"));
+			std::string file_name;
+			while (getline(paths, file_name)) {
+				std::ifstream infile(storage::primary_path(file_name), std::ios::binary);
+				BOOST_REQUIRE(infile.is_open());
+				boost::iostreams::filtering_istream decompress_stream;
+				decompress_stream.push(boost::iostreams::gzip_decompressor());
+				decompress_stream.push(infile);
+				std::string line;
+				while (getline(decompress_stream, line)) {
+					size_t line_destination;
+					BOOST_REQUIRE(route(line, line_destination));
+					BOOST_CHECK_EQUAL(line_destination, destination);
+					counts[line]++;
+				}
+			}
+		}
+
+		return counts;
+	};
+
+	tools::split_pipeline::truncate("TEST", num_destinations);
+	for (size_t run = 0; run < 2; run++) {
+		tools::split_pipeline pipeline("TEST", num_destinations, route, 4, 1);
+		pipeline.run(input_files);
+	}
+
+	std::map<std::string, size_t> counts = read_counts();
+	BOOST_CHECK_EQUAL(counts.size(), num_files * (lines_per_file - lines_per_file / 10));
+	for (const auto &iter : counts) {
+		BOOST_CHECK_EQUAL(iter.second, 2);
+	}
+
+	tools::split_pipeline::truncate("TEST", num_destinations);
+	tools::split_pipeline pipeline("TEST", num_destinations, route, 4, 1);
+	pipeline.run(input_files);
+
+	counts = read_counts();
+	BOOST_CHECK_EQUAL(counts.size(), num_files * (lines_per_file - lines_per_file / 10));
+	for (const auto &iter : counts) {
+		BOOST_CHECK_EQUAL(iter.second, 1);
+	}
+	boost::filesystem::remove_all(root);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
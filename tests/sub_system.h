@@ -26,6 +26,7 @@
 
 #include "common/sub_system.h"
 #include "common/dictionary.h"
+#include "domain_stats/stats_table.h"
 
 BOOST_AUTO_TEST_SUITE(test_sub_system)
 
@@ -36,4 +37,47 @@ BOOST_AUTO_TEST_CASE(subsys) {
 	delete ss;
 }
 
+BOOST_AUTO_TEST_CASE(stats_table) {
+
+	vector<uint64_t> keys;
+	vector<float> values;
+	for (uint64_t i = 0; i < 10000; i++) {
+		keys.push_back(i * 7919 + 1);
+		values.push_back((float)i);
+		values.push_back((float)i / 2);
+	}
+	// Duplicate key, the last row wins.
+	keys.push_back(1);
+	values.push_back(100.0f);
+	values.push_back(200.0f);
+
+	domain_stats::stats_table table;
+	table.build(keys, values, 2);
+	BOOST_CHECK_EQUAL(table.size(), 10000);
+	BOOST_REQUIRE(table.find(1) != nullptr);
+	BOOST_CHECK_EQUAL(table.find(1)[1], 200.0f);
+	BOOST_CHECK_EQUAL(table.find(7919 * 5 + 1)[1], 2.5f);
+	BOOST_CHECK(table.find(0) == nullptr);
+	BOOST_CHECK(table.find(2) == nullptr);
+
+	table.write("/tmp/test_stats_table.bin");
+
+	domain_stats::stats_table mapped;
+	mapped.read("/tmp/test_stats_table.bin");
+	BOOST_CHECK_EQUAL(mapped.size(), 10000);
+	BOOST_CHECK_EQUAL(mapped.num_columns(), 2);
+
+	vector<uint64_t> lookup = {7919 * 9999 + 1, 2, 7919 * 10 + 1};
+	vector<float> harmonics(lookup.size());
+	mapped.find_column(lookup.data(), lookup.size(), 0, harmonics.data(), -1.0f);
+	BOOST_CHECK_EQUAL(harmonics[0], 9999.0f);
+	BOOST_CHECK_EQUAL(harmonics[1], -1.0f);
+	BOOST_CHECK_EQUAL(harmonics[2], 10.0f);
+
+	for (uint64_t i = 1; i < 10000; i++) {
+		BOOST_REQUIRE(mapped.find(i * 7919 + 1) != nullptr);
+		BOOST_REQUIRE_EQUAL(mapped.find(i * 7919 + 1)[0], (float)i);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
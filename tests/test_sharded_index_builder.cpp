@@ -30,6 +30,9 @@
 #include "indexer/level.h"
 #include "text/text.h"
 #include "algorithm/hash.h"
+#include "indexer/document_stats.h"
+#include <sstream>
+#include <thread>
 
 BOOST_AUTO_TEST_SUITE(test_sharded_index_builder)
 
@@ -118,4 +121,96 @@ BOOST_AUTO_TEST_CASE(test_sharded_index_builder_bm25) {
 
 }
 
+BOOST_AUTO_TEST_CASE(test_document_stats) {
+
+	indexer::document_stats stats;
+
+	// Every thread adds document i with size i + 1, the documents overlap between the threads.
+	const size_t num_threads = 8;
+	vector<std::thread> threads;
+	for (size_t t = 0; t < num_threads; t++) {
+		threads.emplace_back([&stats]() {
+			for (uint64_t doc_id = 0; doc_id < 1000; doc_id++) {
+				for (uint64_t i = 0; i <= doc_id; i++) {
+					stats.add(doc_id);
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	stats.merge();
+
+	// Adding after a merge adds to the existing sizes.
+	stats.add(5);
+	stats.add(2000);
+	stats.merge();
+
+	BOOST_CHECK_EQUAL(stats.table_size(), 1001);
+	BOOST_CHECK(stats.num_documents() > 990 && stats.num_documents() < 1010);
+	BOOST_CHECK_EQUAL(stats.document_size(0), num_threads);
+	BOOST_CHECK_EQUAL(stats.document_size(5), 6 * num_threads + 1);
+	BOOST_CHECK_EQUAL(stats.document_size(999), 1000 * num_threads);
+	BOOST_CHECK_EQUAL(stats.document_size(2000), 1);
+	BOOST_CHECK_EQUAL(stats.document_size(1500), 0);
+
+	std::stringstream stream;
+	stats.serialize(stream);
+
+	indexer::document_stats loaded;
+	loaded.deserialize(stream);
+
+	BOOST_CHECK_EQUAL(loaded.table_size(), stats.table_size());
+	BOOST_CHECK_EQUAL(loaded.num_documents(), stats.num_documents());
+	BOOST_CHECK_EQUAL(loaded.document_size(5), stats.document_size(5));
+	BOOST_CHECK_EQUAL(loaded.avg_document_size(), stats.avg_document_size());
+}
+
+BOOST_AUTO_TEST_CASE(test_document_stats_legacy_meta) {
+
+	// Legacy meta file: document count, dense hyper log log registers and unsorted (document id, size_t) pairs.
+	algorithm::hyper_log_log counter;
+	counter.insert(7);
+	counter.insert(3);
+	std::stringstream legacy;
+	const size_t document_count = counter.count();
+	legacy.write((char *)&document_count, sizeof(size_t));
+	legacy.write(counter.data(), counter.data_size());
+	const size_t num_docs = 2;
+	legacy.write((char *)&num_docs, sizeof(size_t));
+	for (const std::pair<uint64_t, size_t> &doc : {std::pair<uint64_t, size_t>(7, 4), std::pair<uint64_t, size_t>(3, 2)}) {
+		legacy.write((char *)&doc.first, sizeof(uint64_t));
+		legacy.write((char *)&doc.second, sizeof(size_t));
+	}
+
+	indexer::document_stats loaded;
+	loaded.deserialize(legacy);
+	BOOST_CHECK_EQUAL(loaded.num_documents(), 2);
+	BOOST_CHECK_EQUAL(loaded.table_size(), 2);
+	BOOST_CHECK_EQUAL(loaded.document_size(3), 2);
+	BOOST_CHECK_EQUAL(loaded.document_size(7), 4);
+	BOOST_CHECK_EQUAL(loaded.avg_document_size(), 3.0f);
+
+	// An empty meta file loads as empty stats.
+	std::stringstream empty;
+	loaded.deserialize(empty);
+	BOOST_CHECK_EQUAL(loaded.table_size(), 0);
+
+	// A table larger than the file is rejected before allocating it.
+	std::stringstream stream;
+	loaded.serialize(stream);
+	std::string data = stream.str();
+	const size_t huge = 1ull << 60;
+	memcpy(&data[data.size() - sizeof(size_t)], &huge, sizeof(size_t));
+	std::stringstream corrupt(data);
+	BOOST_CHECK_THROW(loaded.deserialize(corrupt), std::runtime_error);
+
+	// An unknown version is rejected.
+	data = stream.str();
+	data[sizeof(uint64_t)] = 2;
+	std::stringstream future_version(data);
+	BOOST_CHECK_THROW(loaded.deserialize(future_version), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
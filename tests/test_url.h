@@ -25,6 +25,11 @@
  */
 
 #include "URL.h"
+#include "url_view.h"
+#include "text/text.h"
+#include "url_link/link.h"
+#include "tools/host_counter.h"
+#include <boost/algorithm/string.hpp>
 
 BOOST_AUTO_TEST_SUITE(test_url)
 
@@ -146,4 +151,136 @@ BOOST_AUTO_TEST_CASE(unescape) {
 
 }
 
+BOOST_AUTO_TEST_CASE(url_view_hashes) {
+
+	const vector<string> urls = {
+		"https://www.facebook.com/test.html?key=value",
+		"http://facebook.com",
+		"http://example.com:8080/a/b/c?x=1&y=2#fragment",
+		"https://user@sub.example.org/path/",
+		"http://www.example.com?query",
+		"https://www.svt.se/nyheter/inrikes/",
+		"http://example.com/a/../b/./c",
+		"https://EXAMPLE.com/Path",
+		"http://xn--kllkod-bua.se/",
+		"https://www.bbc.co.uk/news",
+	};
+
+	const string target = "https://www.example.com/target.html";
+	const string link_text = "the link text";
+
+	for (const string &str : urls) {
+		const URL url(str);
+		const url_view view(str);
+		BOOST_CHECK_EQUAL(view.host(), url.host());
+		BOOST_CHECK_EQUAL(view.path(), url.path());
+		BOOST_CHECK_EQUAL(view.hash(), url.hash());
+		BOOST_CHECK_EQUAL(view.host_hash(), url.host_hash());
+		BOOST_CHECK_EQUAL(view.host_top_domain(), url.host_top_domain());
+		BOOST_CHECK_EQUAL(view.host_reverse_hash(), std::hash<string>{}(url.host_reverse()));
+		BOOST_CHECK_EQUAL(view.link_hash(url_view(target), link_text), url.link_hash(URL(target), link_text));
+		BOOST_CHECK_EQUAL(view.domain_link_hash(url_view(target), link_text), url.domain_link_hash(URL(target), link_text));
+	}
+
+	// Link files store host and path in separate columns.
+	const url_view view("www.test.com", "/target.html");
+	const URL url("www.test.com", "/target.html");
+	BOOST_CHECK_EQUAL(view.host(), url.host());
+	BOOST_CHECK_EQUAL(view.hash(), url.hash());
+	BOOST_CHECK_EQUAL(view.host_hash(), url.host_hash());
+	BOOST_CHECK_EQUAL(view.link_hash(url_view(target), link_text), url.link_hash(URL(target), link_text));
+
+	// Link file lines split into views give the same hashes as the split strings.
+	const vector<string> lines = {
+		"www.example.com\t/page1.html\tsvt.se\t/target/1\tsome link text",
+		"github.com\t/\twww.bbc.co.uk\t/news?id=2\t",
+		"sub.domain.org\t/a/b\tsub.domain.org\t\tlink\textra",
+	};
+	vector<std::string_view> view_cols;
+	for (const string &line : lines) {
+		vector<string> cols;
+		boost::algorithm::split(cols, line, boost::is_any_of("\t"));
+		text::split_view(line, view_cols);
+		BOOST_REQUIRE(vector<string>(view_cols.begin(), view_cols.end()) == cols);
+
+		const URL source_url(cols[0], cols[1]);
+		const URL target_url(cols[2], cols[3]);
+		const url_view source_view(view_cols[0], view_cols[1]);
+		const url_view target_view(view_cols[2], view_cols[3]);
+		BOOST_CHECK_EQUAL(source_view.link_hash(target_view, view_cols[4]), source_url.link_hash(target_url, cols[4]));
+		BOOST_CHECK_EQUAL(target_view.host_hash(), target_url.host_hash());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(host_counter) {
+
+	tools::host_counter counter(2);
+	for (size_t i = 0; i < 1000; i++) {
+		counter.add(i % 2, "host" + std::to_string(i % 100), i % 100 == 7 ? 10 : 1);
+	}
+	counter.merge();
+
+	BOOST_CHECK_EQUAL(counter.size(), 100);
+
+	const auto top = counter.top_k(2);
+	BOOST_REQUIRE_EQUAL(top.size(), 2);
+	BOOST_CHECK_EQUAL(top[0].m_host, "host7");
+	BOOST_CHECK_EQUAL(top[0].m_count, 100);
+	BOOST_CHECK_EQUAL(top[1].m_count, 10);
+
+	const auto all = counter.sorted_by_host();
+	BOOST_REQUIRE_EQUAL(all.size(), 100);
+	BOOST_CHECK_EQUAL(all[0].m_host, "host0");
+	BOOST_CHECK_EQUAL(all[1].m_host, "host1");
+	BOOST_CHECK_EQUAL(all[2].m_host, "host10");
+}
+
+BOOST_AUTO_TEST_CASE(host_counter_exact) {
+
+	// Many more hosts than partitions, every host is counted by all threads.
+	const size_t num_threads = 4;
+	const size_t num_hosts = 20000;
+	tools::host_counter counter(num_threads);
+	for (size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+		for (size_t i = 0; i < num_hosts; i++) {
+			counter.add(thread_id, "host" + std::to_string(i), i % 3 + 1);
+		}
+	}
+	counter.merge();
+
+	BOOST_CHECK_EQUAL(counter.size(), num_hosts);
+	const auto all = counter.sorted_by_host();
+	BOOST_REQUIRE_EQUAL(all.size(), num_hosts);
+	for (const auto &host : all) {
+		const size_t i = std::stoull(host.m_host.substr(4));
+		BOOST_CHECK_EQUAL(host.m_count, num_threads * (i % 3 + 1));
+		BOOST_CHECK_EQUAL(host.m_error, 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(host_counter_bounded) {
+
+	// 10 hosts seen 1000 times each among 10000 hosts seen once, only 50 hosts fit in each summary.
+	tools::host_counter counter(2, 50);
+	for (size_t i = 0; i < 20000; i++) {
+		if (i % 2 == 0) {
+			counter.add(0, "heavy" + std::to_string((i / 2) % 10));
+		} else {
+			counter.add(1, "light" + std::to_string(i));
+		}
+	}
+	counter.merge();
+
+	BOOST_CHECK(counter.size() >= 9500 && counter.size() <= 10500);
+
+	const auto top = counter.top_k(10);
+	BOOST_REQUIRE_EQUAL(top.size(), 10);
+	for (const auto &host : top) {
+		BOOST_CHECK(host.m_host.starts_with("heavy"));
+		BOOST_CHECK(host.m_count >= 1000);
+		BOOST_CHECK(host.m_count - host.m_error <= 1000);
+	}
+	BOOST_CHECK_EQUAL(counter.sorted_by_host().size(), 50);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -63,6 +63,44 @@ BOOST_AUTO_TEST_CASE(get_tokens2) {
 	BOOST_CHECK(tokens == targets);
 }
 
+BOOST_AUTO_TEST_CASE(tokenizer_views) {
+	const vector<string> texts = {
+		"C++ map",
+		"Test. Ing! the    test   +function+",
+		"Hej asd!asd jag, heter! !josef. cullhed 	jfoidjfoai823hr9hfhwe9f8hshgohewogiqhoih",
+		"Tills alla dör - Diamant Salihu - Bok (9789189061842) | Bokus",
+		"www.example.com/path:8080 a.b-c: ...",
+		"Science SARU – 紙本分格 \xc3 broken"
+	};
+
+	string buffer;
+	vector<std::string_view> words;
+	vector<uint64_t> tokens;
+	for (const string &str : texts) {
+		text::get_full_text_words(str, buffer, words);
+		BOOST_CHECK(vector<string>(words.begin(), words.end()) == text::get_full_text_words(str));
+
+		text::get_full_text_words(str, buffer, words, 2);
+		BOOST_CHECK(vector<string>(words.begin(), words.end()) == text::get_full_text_words(str, 2));
+
+		text::get_expanded_full_text_words(str, buffer, words);
+		BOOST_CHECK(vector<string>(words.begin(), words.end()) == text::get_expanded_full_text_words(str));
+
+		vector<uint64_t> ngrams;
+		vector<uint64_t> view_ngrams;
+		text::words_to_ngram_hash(text::get_expanded_full_text_words(str), 3, [&ngrams](uint64_t hash) {
+			ngrams.push_back(hash);
+		});
+		text::words_to_ngram_hash(words, 3, [&view_ngrams](uint64_t hash) {
+			view_ngrams.push_back(hash);
+		});
+		BOOST_CHECK(ngrams == view_ngrams);
+
+		text::get_tokens(str, buffer, tokens);
+		BOOST_CHECK(tokens == text::get_tokens(str));
+	}
+}
+
 BOOST_AUTO_TEST_CASE(get_snippets) {
 	{
 		vector<string> snippets = text::get_snippets("A small text that should fit in one snippet");
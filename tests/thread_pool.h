@@ -25,6 +25,8 @@
  */
 
 #include "utils/thread_pool.hpp"
+#include "utils/scheduler.hpp"
+#include <atomic>
 
 BOOST_AUTO_TEST_SUITE(thread_pool)
 
@@ -71,4 +73,136 @@ BOOST_AUTO_TEST_CASE(thread_pool2) {
 	
 }
 
+BOOST_AUTO_TEST_CASE(task_group) {
+	utils::scheduler sched(4);
+
+	vector<int> vec(1000);
+	utils::task_group tasks(utils::priority::background, sched);
+	for (int &i : vec) {
+		tasks.run([&i]() {
+			i++;
+		});
+	}
+	tasks.wait();
+
+	for (int i : vec) {
+		BOOST_CHECK(i == 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(task_group_nested) {
+	// More nested waits than workers, the waiting tasks have to help or this deadlocks.
+	utils::scheduler sched(2);
+
+	std::atomic<int> sum = 0;
+	utils::task_group outer(utils::priority::background, sched);
+	for (int i = 0; i < 8; i++) {
+		outer.run([&sum, &sched]() {
+			utils::task_group inner(utils::priority::background, sched);
+			for (int j = 0; j < 100; j++) {
+				inner.run([&sum]() {
+					sum++;
+				});
+			}
+			inner.wait();
+		});
+	}
+	outer.wait();
+
+	BOOST_CHECK_EQUAL(sum, 800);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_wait_runs_own_tasks) {
+	utils::scheduler sched(1);
+
+	// Block the only worker, then wait for a group on this thread while another group has a task queued in front.
+	std::atomic<bool> release = false;
+	utils::task_group blocker(utils::priority::background, sched);
+	blocker.run([&release]() {
+		while (!release) std::this_thread::yield();
+	});
+
+	std::atomic<bool> other_done = false;
+	std::thread::id other_thread;
+	utils::task_group other(utils::priority::background, sched);
+	other.run([&other_done, &other_thread]() {
+		other_thread = std::this_thread::get_id();
+		other_done = true;
+	});
+
+	int num_run = 0;
+	utils::task_group mine(utils::priority::background, sched);
+	mine.run([&num_run]() {
+		num_run++;
+	});
+	mine.wait();
+	BOOST_CHECK_EQUAL(num_run, 1);
+
+	release = true;
+	while (!other_done) std::this_thread::yield();
+	BOOST_CHECK(other_thread != std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE(task_group_exception_and_cancel) {
+	utils::scheduler sched(2);
+
+	std::atomic<int> num_run = 0;
+	utils::task_group tasks(utils::priority::background, sched);
+	tasks.run([]() {
+		throw std::runtime_error("task failed");
+	});
+
+	BOOST_CHECK_THROW(tasks.wait(), std::runtime_error);
+	BOOST_CHECK(tasks.cancelled());
+
+	// The exception cancelled the group so later tasks are skipped.
+	tasks.run([&num_run]() {
+		num_run++;
+	});
+	tasks.wait();
+	BOOST_CHECK_EQUAL(num_run, 0);
+
+	utils::task_group cancelled(utils::priority::background, sched);
+	cancelled.cancel();
+	for (int i = 0; i < 10; i++) {
+		cancelled.run([&num_run]() {
+			num_run++;
+		});
+	}
+	cancelled.wait();
+	BOOST_CHECK_EQUAL(num_run, 0);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_priority) {
+	utils::scheduler sched(1);
+
+	// Block the only worker while both groups are queued, then the query task has to run first.
+	std::atomic<bool> queued = false;
+	utils::task_group blocker(utils::priority::background, sched);
+	blocker.run([&queued]() {
+		while (!queued) std::this_thread::yield();
+	});
+
+	std::mutex order_lock;
+	vector<string> order;
+	utils::task_group background(utils::priority::background, sched);
+	utils::task_group query(utils::priority::query, sched);
+	background.run([&order, &order_lock]() {
+		std::lock_guard lock(order_lock);
+		order.push_back("background");
+	});
+	query.run([&order, &order_lock]() {
+		std::lock_guard lock(order_lock);
+		order.push_back("query");
+	});
+	queued = true;
+
+	blocker.wait();
+	query.wait();
+	background.wait();
+
+	BOOST_REQUIRE_EQUAL(order.size(), 2);
+	BOOST_CHECK_EQUAL(order[0], "query");
+}
+
 BOOST_AUTO_TEST_SUITE_END()